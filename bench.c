@@ -0,0 +1,2567 @@
+/**
+ * @file bench.c
+ * @brief Micro-benchmarks du système de fichiers virtuel
+ *
+ * Ce programme construit des arborescences synthétiques en mémoire et
+ * mesure le coût des opérations du système de fichiers. Il est lancé
+ * par la cible `make bench`; un nom de benchmark peut être passé en
+ * argument pour n'exécuter que celui-ci (ex: `./fs_bench lookup`).
+ *
+ * Le système de fichiers est initialisé dans un répertoire temporaire
+ * afin de ne jamais toucher au fichier filesystem.dat de l'utilisateur.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include "fs_cli.h"
+#include "fs_internal.h"
+
+/** @brief Nombre de répertoires au premier niveau de l'arbre synthétique */
+#define BENCH_TOP_DIRS 100
+/** @brief Nombre de sous-répertoires par répertoire de premier niveau */
+#define BENCH_SUB_DIRS 50
+/** @brief Nombre de fichiers par sous-répertoire */
+#define BENCH_FILES 20
+/** @brief Nombre de chemins aléatoires distincts générés */
+#define BENCH_PATH_POOL 65536
+/** @brief Nombre de résolutions de chemins mesurées */
+#define BENCH_LOOKUPS 4000000
+/** @brief Nombre de fichiers créés dans un même répertoire par bench_nodes() */
+#define BENCH_NODES 1000000
+/** @brief Nombre de répertoires de l'image sauvegardée par bench_image() */
+#define BENCH_IMAGE_DIRS 1000
+/** @brief Nombre de fichiers par répertoire de l'image */
+#define BENCH_IMAGE_FILES 1000
+
+/** @brief Nombre de fichiers de l'arborescence modifiée par bench_journal() */
+#define BENCH_JOURNAL_FILES 100000
+/** @brief Nombre de modifications persistées par journalisation */
+#define BENCH_JOURNAL_OPS 2000
+/** @brief Nombre de modifications persistées par réécriture complète de l'image */
+#define BENCH_JOURNAL_SAVES 20
+
+/** @brief Taille de chaque ajout mesuré par bench_extents() */
+#define BENCH_APPEND_SIZE 1024
+/** @brief Taille du fichier construit par ajouts successifs */
+#define BENCH_APPEND_TOTAL (64LL * 1024 * 1024)
+/** @brief Taille du fichier pour le modèle « chaîne entière », quadratique */
+#define BENCH_STRING_TOTAL (2LL * 1024 * 1024)
+/** @brief Taille de chaque lecture aléatoire */
+#define BENCH_READ_SIZE 4096
+/** @brief Nombre de lectures aléatoires sur le fichier par extents */
+#define BENCH_READS 200000
+/** @brief Nombre de lectures aléatoires sur le modèle « chaîne entière » */
+#define BENCH_STRING_READS 2000
+
+/** @brief Taille du fichier copié par bench_copy() */
+#define BENCH_COPY_SIZE (64LL * 1024 * 1024)
+/** @brief Nombre de copies du fichier */
+#define BENCH_COPIES 100
+
+/** @brief Nombre d'aller-retours mesurés par bench_move() */
+#define BENCH_MOVES 10000
+
+/** @brief Nombre de répertoires lus en parallèle par bench_threads() */
+#define BENCH_THREAD_DIRS 100
+/** @brief Nombre de fichiers par répertoire */
+#define BENCH_THREAD_FILES 100
+/** @brief Taille du contenu de chaque fichier */
+#define BENCH_THREAD_CONTENT 64
+/** @brief Nombre de lectures effectuées par chaque thread */
+#define BENCH_THREAD_READS 400000
+/** @brief Nombre maximal de threads mesurés */
+#define BENCH_MAX_THREADS 64
+/** @brief Nombre de fichiers créés, écrits puis supprimés par chaque écrivain */
+#define BENCH_THREAD_WRITES 2000
+
+/** @brief Nombre de répertoires parcourus par les sessions de bench_sessions() */
+#define BENCH_SESSION_DIRS 100
+/** @brief Nombre de fichiers par répertoire */
+#define BENCH_SESSION_FILES 10
+/** @brief Nombre total d'itérations cd/ls/lecture par mesure */
+#define BENCH_SESSION_STEPS 100000
+/** @brief Nombre maximal de sessions mesurées */
+#define BENCH_MAX_SESSIONS 10000
+
+/** @brief Préfixe des répertoires de bench_dcache() (cinq niveaux) */
+#define BENCH_DCACHE_PREFIX "/deep/level1/level2/level3/level4"
+/** @brief Nombre de répertoires feuilles de bench_dcache() */
+#define BENCH_DCACHE_DIRS 32
+/** @brief Nombre de fichiers par répertoire feuille de bench_dcache() */
+#define BENCH_DCACHE_FILES 64
+/** @brief Nombre de résolutions par mesure de bench_dcache() */
+#define BENCH_DCACHE_LOOKUPS 4000000
+
+/** @brief Nombre de répertoires créés par le script de bench_batch() */
+#define BENCH_BATCH_DIRS 1000
+/** @brief Nombre de fichiers par répertoire du script de bench_batch() */
+#define BENCH_BATCH_FILES 100
+/** @brief Nombre de commandes rejouées en mode interactif par bench_batch() */
+#define BENCH_BATCH_PROMPTED 2000
+/** @brief Script de commandes écrit par bench_batch() */
+#define BENCH_BATCH_SCRIPT "commands.log"
+
+/** @brief Profondeur du fichier lu par bench_handles() */
+#define BENCH_HANDLE_DEPTH 8
+/** @brief Taille du fichier lu par bench_handles() */
+#define BENCH_HANDLE_SIZE (1024 * 1024)
+/** @brief Taille de chaque lecture de bench_handles() */
+#define BENCH_HANDLE_READ 64
+/** @brief Nombre de lectures par mesure (et par thread) de bench_handles() */
+#define BENCH_HANDLE_READS 2000000
+
+/** @brief Nombre d'entrées du répertoire parcouru par bench_readdir() */
+#define BENCH_READDIR_ENTRIES 1000000
+/** @brief Nombre d'entrées lues à la fois par read_directory */
+#define BENCH_READDIR_BATCH 256
+/** @brief Nombre de créations et de suppressions concurrentes d'un parcours */
+#define BENCH_READDIR_CHURN 2000
+
+/** @brief Nombre de répertoires de premier niveau de l'arbre de bench_walk() */
+#define BENCH_WALK_DIRS 1000
+/** @brief Nombre de sous-répertoires par répertoire de premier niveau */
+#define BENCH_WALK_SUB_DIRS 10
+/** @brief Nombre de fichiers par sous-répertoire */
+#define BENCH_WALK_FILES 100
+
+/** @brief Nombre de projets de l'arborescence réaliste (bench_names) */
+#define BENCH_NAMES_PROJECTS 5000
+/** @brief Nombre de fichiers au nom unique par projet */
+#define BENCH_NAMES_UNIQUE 4
+/** @brief Nombre d'entrées du répertoire de recherche, aux noms de même préfixe */
+#define BENCH_NAMES_ENTRIES 10000
+/** @brief Nombre de recherches d'un nom dans ce répertoire */
+#define BENCH_NAMES_LOOKUPS 4000000
+
+/** @brief Nombre de recherches par taille de répertoire et par noyau (bench_tags) */
+#define BENCH_TAGS_LOOKUPS 2000000
+/** @brief Nombre de recherches par balayage linéaire (coût proportionnel à la taille) */
+#define BENCH_TAGS_SCANS 20000
+
+/** @brief Nombre de fichiers de la bibliothèque recopiée dans chaque projet (bench_dedup) */
+#define BENCH_DEDUP_FILES 64
+/** @brief Taille maximale d'un fichier de la bibliothèque */
+#define BENCH_DEDUP_MAX_SIZE 65536
+/** @brief Nombre de projets qui embarquent la bibliothèque */
+#define BENCH_DEDUP_PROJECTS 50
+
+/** @brief Nombre d'entrées du répertoire parcouru dans l'ordre des noms (bench_order) */
+#define BENCH_ORDER_ENTRIES 200000
+/** @brief Nombre d'entrées d'une page */
+#define BENCH_ORDER_PAGE 100
+/** @brief Nombre de pages lues à partir d'un nom tiré au hasard */
+#define BENCH_ORDER_PAGES 2000
+/** @brief Nombre de pages obtenues en triant tout le répertoire à chaque fois */
+#define BENCH_ORDER_SORTS 5
+/** @brief Nombre de fichiers créés pour mesurer le maintien de l'index */
+#define BENCH_ORDER_CREATES 50000
+
+/** @brief Nombre de répertoires de premier niveau de l'arbre de bench_usage() */
+#define BENCH_USAGE_DIRS 1000
+/** @brief Nombre de sous-répertoires de chacun */
+#define BENCH_USAGE_SUB_DIRS 10
+/** @brief Nombre de fichiers de chaque sous-répertoire */
+#define BENCH_USAGE_FILES 100
+/** @brief Nombre de lectures de l'occupation en temps constant */
+#define BENCH_USAGE_READS 1000000
+/** @brief Nombre d'écritures en fin de fichier, sans puis sous quotas */
+#define BENCH_USAGE_WRITES 200000
+/** @brief Taille de chacune de ces écritures */
+#define BENCH_USAGE_WRITE_SIZE 64
+
+/** @brief Répertoire des fichiers désignés par la ferme de liens (bench_symlink) */
+#define BENCH_SYMLINK_PREFIX "/store/level1/level2/level3/level4/level5/level6"
+/** @brief Nombre de fichiers désignés, chacun par une chaîne de liens */
+#define BENCH_SYMLINK_FILES 512
+/** @brief Nombre de liens de chaque chaîne */
+#define BENCH_SYMLINK_CHAIN 4
+/** @brief Nombre de résolutions par mesure */
+#define BENCH_SYMLINK_LOOKUPS 1000000
+
+/** @brief Taille de chaque fichier écrit puis relu (bench_compress) */
+#define BENCH_COMPRESS_SIZE (16LL << 20)
+/** @brief Taille de chaque écriture et de chaque lecture */
+#define BENCH_COMPRESS_CHUNK 65536
+
+/** @brief Descripteur de la sortie standard mise de côté par bench_mute() */
+static int saved_stdout = -1;
+
+/**
+ * @brief Redirige la sortie standard vers /dev/null
+ *
+ * Les opérations du système de fichiers affichent un message à chaque
+ * appel; on les fait taire pendant la construction des arbres.
+ */
+static void bench_mute() {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+}
+
+/**
+ * @brief Rétablit la sortie standard redirigée par bench_mute()
+ */
+static void bench_unmute() {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    saved_stdout = -1;
+}
+
+/**
+ * @brief Retourne l'heure courante en nanosecondes (horloge monotone)
+ */
+static double bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Retourne la mémoire résidente actuelle du processus en octets
+ */
+static long bench_rss_bytes() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Retourne le pic de mémoire résidente du processus en octets
+ */
+static long bench_peak_rss_bytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss * 1024L;
+}
+
+/**
+ * @brief Générateur pseudo-aléatoire (xorshift64) reproductible
+ */
+static unsigned long long bench_rand_state = 88172645463325252ULL;
+static unsigned long long bench_rand() {
+    bench_rand_state ^= bench_rand_state << 13;
+    bench_rand_state ^= bench_rand_state >> 7;
+    bench_rand_state ^= bench_rand_state << 17;
+    return bench_rand_state;
+}
+
+/**
+ * @brief Résolution de chemin historique par balayage linéaire
+ *
+ * Reproduit l'ancienne boucle de get_file_by_path (strtok puis strcmp
+ * sur chaque enfant) afin de servir de point de comparaison.
+ *
+ * @param path Chemin absolu à résoudre
+ * @return FileNode* Nœud trouvé, NULL sinon
+ */
+static FileNode* linear_lookup(const char* path) {
+    char path_copy[MAX_PATH_LENGTH];
+    strncpy(path_copy, path + 1, MAX_PATH_LENGTH - 1);
+    path_copy[MAX_PATH_LENGTH - 1] = '\0';
+
+    FileNode* current = root_directory;
+    char* token = strtok(path_copy, "/");
+    while (token != NULL) {
+        int found = 0;
+        for (int i = 0; i < current->dir_data->child_count; i++) {
+            if (strcmp(current->dir_data->children[i]->name, token) == 0) {
+                current = current->dir_data->children[i];
+                found = 1;
+                break;
+            }
+        }
+        if (!found) return NULL;
+        token = strtok(NULL, "/");
+    }
+    return current;
+}
+
+/**
+ * @brief Mesure la résolution de chemins aléatoires sur un arbre synthétique
+ *
+ * @details
+ * - Construit BENCH_TOP_DIRS x BENCH_SUB_DIRS répertoires contenant
+ *   chacun BENCH_FILES fichiers
+ * - Tire BENCH_PATH_POOL chemins de fichiers au hasard
+ * - Résout BENCH_LOOKUPS chemins avec l'ancienne méthode (balayage
+ *   linéaire) puis avec get_file_by_path (index haché)
+ */
+static void bench_lookup() {
+    char path[MAX_PATH_LENGTH];
+
+    bench_mute();
+    for (int d = 0; d < BENCH_TOP_DIRS; d++) {
+        snprintf(path, sizeof(path), "/dir_%03d", d);
+        create_directory(path, 755);
+        for (int s = 0; s < BENCH_SUB_DIRS; s++) {
+            snprintf(path, sizeof(path), "/dir_%03d/sub_%03d", d, s);
+            create_directory(path, 755);
+            for (int f = 0; f < BENCH_FILES; f++) {
+                snprintf(path, sizeof(path), "/dir_%03d/sub_%03d/file_%03d.txt", d, s, f);
+                create_file(path, 644);
+            }
+        }
+    }
+    bench_unmute();
+
+    char (*paths)[40] = malloc(BENCH_PATH_POOL * sizeof(*paths));
+    for (int i = 0; i < BENCH_PATH_POOL; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "/dir_%03d/sub_%03d/file_%03d.txt",
+                 (int)(bench_rand() % BENCH_TOP_DIRS),
+                 (int)(bench_rand() % BENCH_SUB_DIRS),
+                 (int)(bench_rand() % BENCH_FILES));
+    }
+
+    long misses = 0;
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        if (linear_lookup(paths[i & (BENCH_PATH_POOL - 1)]) == NULL) misses++;
+    }
+    double linear_ns = (bench_now_ns() - start) / BENCH_LOOKUPS;
+
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        FileNode* node = get_file_by_path(paths[i & (BENCH_PATH_POOL - 1)]);
+        if (node == NULL || node->type != FILE_TYPE) misses++;
+    }
+    double hashed_ns = (bench_now_ns() - start) / BENCH_LOOKUPS;
+
+    printf("lookup: %d répertoires, %d fichiers, %d résolutions (%ld échecs)\n",
+           BENCH_TOP_DIRS * (BENCH_SUB_DIRS + 1), BENCH_TOP_DIRS * BENCH_SUB_DIRS * BENCH_FILES,
+           BENCH_LOOKUPS, misses);
+    printf("  avant (balayage linéaire) : %8.1f ns/résolution\n", linear_ns);
+    printf("  après (index haché)       : %8.1f ns/résolution\n", hashed_ns);
+    free(paths);
+}
+
+/**
+ * @brief Mesure l'empreinte mémoire d'un répertoire d'un million de fichiers
+ *
+ * @details
+ * - Crée BENCH_NODES fichiers dans un unique répertoire
+ * - Rapporte la taille d'un FileNode, le coût réel par fichier
+ *   (mémoire résidente ajoutée / nombre de fichiers) et le pic de RSS
+ */
+static void bench_nodes() {
+    char path[MAX_PATH_LENGTH];
+    long rss_before = bench_rss_bytes();
+
+    bench_mute();
+    create_directory("/big", 755);
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_NODES; i++) {
+        snprintf(path, sizeof(path), "/big/file_%07d", i);
+        create_file(path, 644);
+    }
+    double elapsed = bench_now_ns() - start;
+    bench_unmute();
+
+    FileNode* big = get_file_by_path("/big");
+    long rss_after = bench_rss_bytes();
+    printf("nodes: %d fichiers dans un seul répertoire (%d entrées), %.0f ns/création\n",
+           BENCH_NODES, big->dir_data->child_count, elapsed / BENCH_NODES);
+    printf("  sizeof(FileNode)          : %8zu octets\n", sizeof(FileNode));
+    printf("  mémoire par fichier       : %8.1f octets (nœud, nom, entrée et index)\n",
+           (double)(rss_after - rss_before) / BENCH_NODES);
+    printf("  pic de RSS                : %8.1f Mo\n", bench_peak_rss_bytes() / 1048576.0);
+}
+
+/**
+ * @brief Mesure la sauvegarde et le chargement d'une image d'un million de nœuds
+ *
+ * @details
+ * - Crée BENCH_IMAGE_DIRS répertoires de BENCH_IMAGE_FILES fichiers,
+ *   un fichier sur dix recevant un contenu
+ * - Mesure save_file_system(), puis load_file_system() dans chacun des
+ *   modes de chargement : durée d'ouverture, durée du premier accès à un
+ *   fichier profond et mémoire résidente ajoutée
+ */
+static void bench_image() {
+    char path[MAX_PATH_LENGTH];
+
+    bench_mute();
+    for (int d = 0; d < BENCH_IMAGE_DIRS; d++) {
+        snprintf(path, sizeof(path), "/d%04d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_IMAGE_FILES; f++) {
+            snprintf(path, sizeof(path), "/d%04d/f%04d", d, f);
+            create_file(path, 644);
+            if (f % 10 == 0) {
+                open_file(path, "w");
+                write_file(path, "Lorem ipsum dolor sit amet, consectetur adipiscing elit.");
+                close_file(path);
+            }
+        }
+    }
+    bench_unmute();
+
+    double start = bench_now_ns();
+    save_file_system();
+    double save_ms = (bench_now_ns() - start) / 1e6;
+
+    struct stat st;
+    stat(FS_FILENAME, &st);
+    printf("image: %d nœuds, %.1f Mo sur disque\n",
+           1 + BENCH_IMAGE_DIRS * (1 + BENCH_IMAGE_FILES), st.st_size / 1048576.0);
+    printf("  sauvegarde                : %8.1f ms\n", save_ms);
+
+    // Rechargement dans chacun des modes, chacun dans un processus fils
+    // pour que le tas et la mémoire résidente ne dépendent pas du précédent
+    static const struct { LoadMode mode; const char* label; } modes[] = {
+        { LOAD_EAGER, "lecture" },
+        { LOAD_MMAP, "projection" },
+    };
+    fflush(stdout);
+    for (int m = 0; m < 2; m++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return;
+        }
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
+            continue;
+        }
+
+        // L'arborescence héritée du parent est abandonnée, pas libérée
+        root_directory = NULL;
+        fs_load_mode = modes[m].mode;
+
+        long rss_before = bench_rss_bytes();
+        start = bench_now_ns();
+        int status = load_file_system();
+        double load_ms = (bench_now_ns() - start) / 1e6;
+        long rss_loaded = bench_rss_bytes();
+
+        start = bench_now_ns();
+        FileNode* sample = get_file_by_path("/d0999/f0990");
+        double lookup_us = (bench_now_ns() - start) / 1e3;
+        char head[5];
+        int correct = status == 0 && sample != NULL && data_size(sample->data) == 56 &&
+                      data_read(sample->data, head, 5, 0) == 5 && memcmp(head, "Lorem", 5) == 0;
+
+        printf("  %-10s : ouverture %8.2f ms, premier accès %8.1f us, RSS +%6.1f Mo (%s)\n",
+               modes[m].label, load_ms, lookup_us, (rss_loaded - rss_before) / 1048576.0,
+               correct ? "correct" : "INCORRECT");
+        fflush(stdout);
+        _exit(0);
+    }
+}
+
+/**
+ * @brief Vérifie qu'une écriture postérieure à un chmod 0 survit au rejeu du journal
+ *
+ * @return int 1 si le contenu rejoué est celui écrit avant l'arrêt
+ *
+ * @details
+ * Le fichier est ouvert en écriture, rendu illisible et inscriptible
+ * par personne, puis écrit par le descripteur resté valide. Un arrêt
+ * brutal est simulé dans un processus fils, qui abandonne l'arborescence
+ * sans rien sauver, recharge l'image et rejoue le journal.
+ */
+static int bench_journal_replay_check() {
+    create_file("/replayed", 644);
+    open_file("/replayed", "w");
+    set_permissions("/replayed", 0);
+    write_file("/replayed", "lost?");
+    close_file("/replayed");
+    journal_sync();
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        // L'arborescence héritée du parent est abandonnée, pas libérée
+        close(journal_fd);
+        journal_fd = -1;
+        root_directory = NULL;
+        dcache_flush();
+        char content[8] = "";
+        FileNode* file = NULL;
+        if (load_file_system() == FS_OK && journal_open() == 0) {
+            file = get_file_by_path("/replayed");
+        }
+        int correct = file != NULL && data_size(file->data) == 5 &&
+                      data_read(file->data, content, 5, 0) == 5 && memcmp(content, "lost?", 5) == 0;
+        _exit(correct ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * @brief Compare la persistance d'une modification par journal et par réécriture
+ *
+ * @details
+ * - Construit une arborescence de BENCH_JOURNAL_FILES fichiers et en
+ *   fait un point de reprise
+ * - Mesure un chmod suivi d'une réécriture complète de l'image, comme
+ *   le faisait chaque fermeture du système de fichiers
+ * - Mesure un chmod journalisé et synchronisé sur disque, comme après
+ *   chaque commande de l'interface
+ * - Vérifie le rejeu d'une écriture faite après un chmod 0
+ *   (bench_journal_replay_check), et qu'une écriture par descripteur
+ *   qui ne pourrait être journalisée est refusée
+ */
+static void bench_journal() {
+    char path[MAX_PATH_LENGTH];
+
+    bench_mute();
+    for (int d = 0; d < BENCH_JOURNAL_FILES / 1000; d++) {
+        snprintf(path, sizeof(path), "/d%03d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < 1000; f++) {
+            snprintf(path, sizeof(path), "/d%03d/f%03d", d, f);
+            create_file(path, 644);
+        }
+    }
+    save_file_system();
+
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_JOURNAL_SAVES; i++) {
+        snprintf(path, sizeof(path), "/d%03d/f%03d", i % 100, i % 1000);
+        set_permissions(path, 600);
+        save_file_system();
+    }
+    double save_us = (bench_now_ns() - start) / 1e3 / BENCH_JOURNAL_SAVES;
+
+    journal_open();
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_JOURNAL_OPS; i++) {
+        snprintf(path, sizeof(path), "/d%03d/f%03d", i % 100, i % 1000);
+        set_permissions(path, 640);
+        journal_sync();
+    }
+    double journal_us = (bench_now_ns() - start) / 1e3 / BENCH_JOURNAL_OPS;
+    struct stat st;
+    stat(FS_JOURNAL_FILENAME, &st);
+    int replayed = bench_journal_replay_check();
+
+    // Un descripteur dont le fichier est déplacé hors de MAX_PATH_LENGTH
+    // ne peut plus être journalisé : l'écriture est refusée
+    char outer[MAX_PATH_LENGTH] = "/", inner[MAX_PATH_LENGTH] = "/";
+    memset(outer + 1, 'o', 126);
+    memset(inner + 1, 'i', 126);
+    snprintf(path, sizeof(path), "%s/f", inner);
+    create_directory(outer, 755);
+    create_directory(inner, 755);
+    create_file(path, 644);
+    int fd = fd_open(path, "w");
+    int unlogged = fd >= 0 && fd_write(fd, "x", 1) == 1 && move_file(inner, outer) == FS_OK &&
+                   fd_write(fd, "y", 1) == FS_ERR_NAME_TOO_LONG;
+    fd_close(fd);
+    journal_close();
+    bench_unmute();
+
+    printf("journal: %d fichiers, persistance d'un chmod\n", BENCH_JOURNAL_FILES);
+    printf("  réécriture de l'image     : %10.1f us/opération\n", save_us);
+    printf("  journal synchronisé       : %10.1f us/opération (%lld octets pour %d opérations)\n",
+           journal_us, (long long)st.st_size, BENCH_JOURNAL_OPS);
+    printf("  écriture après chmod 0    : %s au rejeu\n", replayed ? "correct" : "INCORRECT");
+    printf("  écriture hors chemin      : %s\n", unlogged ? "refusée" : "INCORRECT");
+}
+
+/**
+ * @brief Compare le contenu par extents au modèle « chaîne entière »
+ *
+ * @details
+ * - Construit un fichier par ajouts de BENCH_APPEND_SIZE octets avec
+ *   append_file, puis y lit des blocs à des positions aléatoires avec
+ *   pread_file
+ * - Émule l'ancien modèle, où le contenu était une seule chaîne : chaque
+ *   ajout réalloue et recopie tout le contenu, et lire à une position
+ *   recopie le contenu depuis le début. Ce modèle étant quadratique, il
+ *   est mesuré sur un fichier plus petit (BENCH_STRING_TOTAL)
+ */
+static void bench_extents() {
+    static char chunk[BENCH_APPEND_SIZE];
+    static char buffer[BENCH_READ_SIZE];
+    for (int i = 0; i < BENCH_APPEND_SIZE; i++) chunk[i] = 'a' + i % 26;
+    long long appends = BENCH_APPEND_TOTAL / BENCH_APPEND_SIZE;
+    long long string_appends = BENCH_STRING_TOTAL / BENCH_APPEND_SIZE;
+
+    bench_mute();
+    create_file("/stream", 644);
+    open_file("/stream", "rw");
+    double start = bench_now_ns();
+    double small_ns = 0;
+    for (long long i = 0; i < appends; i++) {
+        append_file("/stream", chunk, BENCH_APPEND_SIZE);
+        if (i + 1 == string_appends) small_ns = bench_now_ns() - start;
+    }
+    double append_ns = bench_now_ns() - start;
+
+    int correct = 1;
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_READS; i++) {
+        long long offset = bench_rand() % (BENCH_APPEND_TOTAL - BENCH_READ_SIZE);
+        if (pread_file("/stream", buffer, BENCH_READ_SIZE, offset) != BENCH_READ_SIZE ||
+            buffer[0] != chunk[offset % BENCH_APPEND_SIZE]) {
+            correct = 0;
+        }
+    }
+    double read_ns = bench_now_ns() - start;
+    close_file("/stream");
+    bench_unmute();
+
+    // Modèle « chaîne entière » : un ajout recopie tout le contenu
+    char* content = NULL;
+    long long size = 0;
+    start = bench_now_ns();
+    for (long long i = 0; i < string_appends; i++) {
+        char* grown = malloc(size + BENCH_APPEND_SIZE + 1);
+        if (content != NULL) memcpy(grown, content, size);
+        memcpy(grown + size, chunk, BENCH_APPEND_SIZE);
+        size += BENCH_APPEND_SIZE;
+        grown[size] = '\0';
+        free(content);
+        content = grown;
+    }
+    double string_append_ns = bench_now_ns() - start;
+
+    // Lire à une position : recopier le contenu jusqu'à la fin du bloc
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_STRING_READS; i++) {
+        long long offset = bench_rand() % (size - BENCH_READ_SIZE);
+        char* copy = malloc(offset + BENCH_READ_SIZE + 1);
+        memcpy(copy, content, offset + BENCH_READ_SIZE);
+        copy[offset + BENCH_READ_SIZE] = '\0';
+        if (copy[offset] != chunk[offset % BENCH_APPEND_SIZE]) correct = 0;
+        free(copy);
+    }
+    double string_read_ns = bench_now_ns() - start;
+    free(content);
+
+    printf("extents: ajouts de %d octets, lectures aléatoires de %d octets (%s)\n",
+           BENCH_APPEND_SIZE, BENCH_READ_SIZE, correct ? "correct" : "INCORRECT");
+    printf("  chaîne entière, %4lld Mo    : ajout %10.0f ns, lecture %10.0f ns\n",
+           BENCH_STRING_TOTAL >> 20, string_append_ns / string_appends, string_read_ns / BENCH_STRING_READS);
+    printf("  extents, %4lld Mo           : ajout %10.0f ns\n",
+           BENCH_STRING_TOTAL >> 20, small_ns / string_appends);
+    printf("  extents, %4lld Mo           : ajout %10.0f ns, lecture %10.0f ns (%.0f Mo/s en ajout)\n",
+           BENCH_APPEND_TOTAL >> 20, append_ns / appends, read_ns / BENCH_READS,
+           (BENCH_APPEND_TOTAL / 1048576.0) / (append_ns / 1e9));
+}
+
+/**
+ * @brief Mesure la copie d'un gros fichier, dont les blocs sont partagés
+ *
+ * @details
+ * - Écrit un fichier de BENCH_COPY_SIZE octets puis en fait BENCH_COPIES
+ *   copies par copy_file : durée par copie et mémoire résidente ajoutée
+ * - Compare à une copie intégrale du contenu (malloc + memcpy), ce que
+ *   faisait copy_file avant le partage des blocs
+ * - Écrit un octet dans une copie et vérifie que la source est intacte
+ */
+static void bench_copy() {
+    char path[MAX_PATH_LENGTH];
+    static char chunk[DATA_BLOCK_SIZE];
+    memset(chunk, 'c', sizeof(chunk));
+
+    bench_mute();
+    create_file("/source", 644);
+    open_file("/source", "w");
+    for (long long offset = 0; offset < BENCH_COPY_SIZE; offset += sizeof(chunk)) {
+        append_file("/source", chunk, sizeof(chunk));
+    }
+    close_file("/source");
+
+    long rss_before = bench_rss_bytes();
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_COPIES; i++) {
+        snprintf(path, sizeof(path), "/copy%03d", i);
+        copy_file("/source", path);
+    }
+    double copy_ns = (bench_now_ns() - start) / BENCH_COPIES;
+    long rss_copies = bench_rss_bytes() - rss_before;
+
+    start = bench_now_ns();
+    open_file("/copy000", "w");
+    pwrite_file("/copy000", "X", 1, BENCH_COPY_SIZE / 2);
+    close_file("/copy000");
+    double write_ns = bench_now_ns() - start;
+    bench_unmute();
+
+    char source_byte = 0, copy_byte = 0;
+    FileNode* source = get_file_by_path("/source");
+    FileNode* copy = get_file_by_path("/copy000");
+    data_read(source->data, &source_byte, 1, BENCH_COPY_SIZE / 2);
+    data_read(copy->data, &copy_byte, 1, BENCH_COPY_SIZE / 2);
+
+    // Copie intégrale du contenu, comme avant le partage des blocs
+    char* content = malloc(BENCH_COPY_SIZE);
+    data_read(source->data, content, BENCH_COPY_SIZE, 0);
+    start = bench_now_ns();
+    char* duplicate = malloc(BENCH_COPY_SIZE);
+    memcpy(duplicate, content, BENCH_COPY_SIZE);
+    double full_ns = bench_now_ns() - start;
+    free(duplicate);
+    free(content);
+
+    printf("copy: %d copies d'un fichier de %lld Mo (%s)\n", BENCH_COPIES, BENCH_COPY_SIZE >> 20,
+           source_byte == 'c' && copy_byte == 'X' ? "correct" : "INCORRECT");
+    printf("  copie intégrale           : %10.1f us/copie\n", full_ns / 1e3);
+    printf("  copy_file (blocs partagés): %10.1f us/copie, RSS +%.1f Mo pour %d copies\n",
+           copy_ns / 1e3, rss_copies / 1048576.0, BENCH_COPIES);
+    printf("  première écriture (1 bloc): %10.1f us\n", write_ns / 1e3);
+}
+
+/**
+ * @brief Mesure le déplacement d'un répertoire d'un million de descendants
+ *
+ * @details
+ * - Crée /arbre contenant BENCH_IMAGE_DIRS répertoires de
+ *   BENCH_IMAGE_FILES fichiers, et un répertoire /cible
+ * - Déplace /arbre dans /cible puis le ramène, BENCH_MOVES fois
+ * - Vérifie qu'un fichier profond est accessible à son nouveau chemin, et
+ *   qu'un déplacement, un chmod ou une suppression à travers un
+ *   répertoire manquant est refusé
+ */
+static void bench_move() {
+    char path[MAX_PATH_LENGTH];
+
+    bench_mute();
+    create_directory("/arbre", 755);
+    create_directory("/cible", 755);
+    for (int d = 0; d < BENCH_IMAGE_DIRS; d++) {
+        snprintf(path, sizeof(path), "/arbre/d%04d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_IMAGE_FILES; f++) {
+            snprintf(path, sizeof(path), "/arbre/d%04d/f%04d", d, f);
+            create_file(path, 644);
+        }
+    }
+
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_MOVES; i++) {
+        move_file("/arbre", "/cible/arbre");
+        move_file("/cible/arbre", "/arbre");
+    }
+    double move_ns = (bench_now_ns() - start) / (2.0 * BENCH_MOVES);
+    move_file("/arbre", "/cible");
+    // Un répertoire manquant, source ou destination, ne désigne pas la racine
+    int rejected = move_file("/cible", "/absent/cible") == FS_ERR_INVALID_PATH &&
+                   move_file("/cible", "/absent/") == FS_ERR_INVALID_PATH &&
+                   move_file("/absent/cible", "/autre") == FS_ERR_INVALID_PATH &&
+                   set_permissions("/absent/cible", 700) == FS_ERR_INVALID_PATH &&
+                   delete_file("/absent/cible") == FS_ERR_INVALID_PATH;
+    bench_unmute();
+
+    FileNode* moved = get_file_by_path("/cible/arbre/d0999/f0999");
+    int correct = moved != NULL && strcmp(moved->name, "f0999") == 0 && rejected &&
+                  root_directory->dir_data->child_count == 1;
+    printf("move: répertoire de %d descendants (%s)\n",
+           BENCH_IMAGE_DIRS * (1 + BENCH_IMAGE_FILES), correct ? "correct" : "INCORRECT");
+    printf("  move_file                 : %10.2f us/déplacement\n", move_ns / 1e3);
+}
+
+/**
+ * @brief Paramètres et résultats d'un thread de bench_threads()
+ */
+typedef struct {
+    unsigned long long seed;        /**< Graine du générateur du thread */
+    int id;                         /**< Numéro du thread */
+    Session* session;               /**< Session du thread */
+    long reads;                     /**< Nombre de lectures à effectuer (lecteurs) */
+    long done;                      /**< Nombre de lectures effectuées */
+    long errors;                    /**< Lectures ou écritures incorrectes */
+} ThreadBench;
+
+/** @brief Levée par bench_threads() pour arrêter les lecteurs de la phase mixte */
+static int bench_threads_stop = 0;
+
+/**
+ * @brief Lecteur : résout un chemin aléatoire et lit le fichier désigné
+ *
+ * @param arg ThreadBench du thread ; reads < 0 lit jusqu'à bench_threads_stop
+ */
+static void* bench_thread_reader(void* arg) {
+    ThreadBench* bench = arg;
+    char path[MAX_PATH_LENGTH];
+    char buffer[BENCH_THREAD_CONTENT];
+    unsigned long long state = bench->seed;
+    session_attach(bench->session);
+
+    for (long i = 0; bench->reads < 0 ? !__atomic_load_n(&bench_threads_stop, __ATOMIC_RELAXED) : i < bench->reads; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int d = state % BENCH_THREAD_DIRS;
+        int f = (state >> 32) % BENCH_THREAD_FILES;
+        snprintf(path, sizeof(path), "/t%03d/f%03d", d, f);
+        if (pread_file(path, buffer, sizeof(buffer), 0) != BENCH_THREAD_CONTENT ||
+            buffer[0] != 'a' + d % 26 || buffer[BENCH_THREAD_CONTENT - 1] != 'a' + f % 26) {
+            bench->errors++;
+        }
+        bench->done++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Écrivain : crée, écrit, relit puis supprime des fichiers dans son sous-arbre
+ *
+ * @param arg ThreadBench du thread
+ */
+static void* bench_thread_writer(void* arg) {
+    ThreadBench* bench = arg;
+    char path[MAX_PATH_LENGTH];
+    char buffer[32];
+    session_attach(bench->session);
+
+    for (int i = 0; i < BENCH_THREAD_WRITES; i++) {
+        snprintf(path, sizeof(path), "/w%d/f%d", bench->id, i);
+        if (create_file(path, 644) != 0 || open_file(path, "rw") != 0 ||
+            append_file(path, path, strlen(path)) != (long long)strlen(path) ||
+            pread_file(path, buffer, sizeof(buffer), 0) != (long long)strlen(path) ||
+            memcmp(buffer, path, strlen(path)) != 0) {
+            bench->errors++;
+        }
+        close_file(path);
+        // Garder un fichier sur deux
+        if (i % 2 == 1 && delete_file(path) != 0) {
+            bench->errors++;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Mesure la montée en charge des lectures sur plusieurs threads
+ *
+ * @details
+ * - Crée BENCH_THREAD_DIRS répertoires de BENCH_THREAD_FILES fichiers de
+ *   BENCH_THREAD_CONTENT octets ; chaque thread a sa session, dans
+ *   laquelle tous les fichiers sont ouverts en lecture
+ * - Avec 1, 2, 4... threads, chacun résout BENCH_THREAD_READS chemins
+ *   aléatoires et lit le fichier désigné (pread_file) : le débit total
+ *   doit croître avec le nombre de cœurs
+ * - Phase mixte : autant de lecteurs que de cœurs (au moins deux) lisent
+ *   pendant que deux écrivains créent, écrivent et suppriment des
+ *   fichiers dans leurs propres sous-arbres ; vérifie ensuite que chaque
+ *   lecture a vu le bon contenu et que chaque sous-arbre est complet
+ */
+static void bench_threads() {
+    char path[MAX_PATH_LENGTH];
+    char content[BENCH_THREAD_CONTENT];
+
+    bench_mute();
+    for (int d = 0; d < BENCH_THREAD_DIRS; d++) {
+        snprintf(path, sizeof(path), "/t%03d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_THREAD_FILES; f++) {
+            snprintf(path, sizeof(path), "/t%03d/f%03d", d, f);
+            memset(content, 'a' + d % 26, sizeof(content) - 1);
+            content[sizeof(content) - 1] = 'a' + f % 26;
+            create_file(path, 644);
+            open_file(path, "rw");
+            pwrite_file(path, content, sizeof(content), 0);
+        }
+    }
+    bench_unmute();
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cores > 4 ? (int)cores : 4;
+    if (max_threads > BENCH_MAX_THREADS) max_threads = BENCH_MAX_THREADS;
+    pthread_t threads[BENCH_MAX_THREADS];
+    ThreadBench benches[BENCH_MAX_THREADS];
+    Session* sessions[BENCH_MAX_THREADS];
+    int readers = cores > 2 ? (int)cores : 2;
+    if (readers > BENCH_MAX_THREADS - 2) readers = BENCH_MAX_THREADS - 2;
+    int writers = 2;
+    int session_count = max_threads > readers + writers ? max_threads : readers + writers;
+
+    bench_mute();
+    for (int t = 0; t < session_count; t++) {
+        sessions[t] = session_create();
+        session_attach(sessions[t]);
+        for (int i = 0; i < BENCH_THREAD_DIRS * BENCH_THREAD_FILES; i++) {
+            snprintf(path, sizeof(path), "/t%03d/f%03d", i / BENCH_THREAD_FILES, i % BENCH_THREAD_FILES);
+            open_file(path, "r");
+        }
+    }
+    session_attach(NULL);
+    bench_unmute();
+
+    printf("threads: %d fichiers, %ld cœur(s) disponible(s)\n",
+           BENCH_THREAD_DIRS * BENCH_THREAD_FILES, cores);
+    double single_rate = 0;
+    long errors = 0;
+    for (int count = 1; count <= max_threads; count *= 2) {
+        double start = bench_now_ns();
+        for (int t = 0; t < count; t++) {
+            benches[t] = (ThreadBench){ .seed = bench_rand() | 1, .id = t, .session = sessions[t],
+                                        .reads = BENCH_THREAD_READS };
+            pthread_create(&threads[t], NULL, bench_thread_reader, &benches[t]);
+        }
+        for (int t = 0; t < count; t++) {
+            pthread_join(threads[t], NULL);
+            errors += benches[t].errors;
+        }
+        double rate = (double)count * BENCH_THREAD_READS / ((bench_now_ns() - start) / 1e9);
+        if (count == 1) single_rate = rate;
+        printf("  %2d thread(s)              : %10.0f lectures/s (x%.2f)\n",
+               count, rate, rate / single_rate);
+    }
+
+    // Lecteurs et écrivains en même temps
+    bench_mute();
+    for (int w = 0; w < writers; w++) {
+        snprintf(path, sizeof(path), "/w%d", w);
+        create_directory(path, 755);
+    }
+    __atomic_store_n(&bench_threads_stop, 0, __ATOMIC_RELAXED);
+    double start = bench_now_ns();
+    for (int t = 0; t < readers + writers; t++) {
+        benches[t] = (ThreadBench){ .seed = bench_rand() | 1, .id = t - readers, .session = sessions[t],
+                                    .reads = -1 };
+        pthread_create(&threads[t], NULL, t < readers ? bench_thread_reader : bench_thread_writer,
+                       &benches[t]);
+    }
+    for (int t = readers; t < readers + writers; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double mixed_ms = (bench_now_ns() - start) / 1e6;
+    __atomic_store_n(&bench_threads_stop, 1, __ATOMIC_RELAXED);
+    long mixed_reads = 0;
+    for (int t = 0; t < readers; t++) {
+        pthread_join(threads[t], NULL);
+        mixed_reads += benches[t].done;
+    }
+    bench_unmute();
+
+    for (int t = 0; t < readers + writers; t++) {
+        errors += benches[t].errors;
+    }
+    for (int t = 0; t < session_count; t++) {
+        session_destroy(sessions[t]);
+    }
+    int correct = errors == 0;
+    for (int w = 0; w < writers; w++) {
+        snprintf(path, sizeof(path), "/w%d", w);
+        FileNode* dir = get_file_by_path(path);
+        correct = correct && dir != NULL && dir->dir_data->child_count == BENCH_THREAD_WRITES / 2;
+    }
+    printf("  %d lecteurs + %d écrivains : %10.0f lectures/s, %d créations en %.1f ms (%s)\n",
+           readers, writers, mixed_reads / (mixed_ms / 1e3), writers * BENCH_THREAD_WRITES,
+           mixed_ms, correct ? "correct" : "INCORRECT");
+}
+
+/**
+ * @brief Paramètres et résultats d'un thread de bench_sessions()
+ */
+typedef struct {
+    Session** sessions;             /**< Toutes les sessions */
+    int first;                      /**< Première session servie par le thread */
+    int stride;                     /**< Écart entre deux sessions servies (nombre de threads) */
+    int count;                      /**< Nombre total de sessions */
+    long steps;                     /**< Nombre d'itérations à effectuer */
+    long errors;                    /**< Itérations dont le résultat est incorrect */
+} SessionBench;
+
+/**
+ * @brief Répertoire visité par une session à une itération donnée
+ *
+ * @param session Numéro de la session
+ * @param round Numéro de l'itération de la session
+ */
+static int bench_session_dir(int session, long round) {
+    return (int)((session * 7 + round) % BENCH_SESSION_DIRS);
+}
+
+/**
+ * @brief Compte les entrées d'un répertoire (DirVisitor)
+ */
+static int bench_count_entry(const char* name, const FileInfo* info, void* arg) {
+    (*(int*)arg)++;
+    return 0;
+}
+
+/**
+ * @brief Sert à tour de rôle les sessions d'un thread : cd, ls, lecture
+ *
+ * @param arg SessionBench du thread
+ */
+static void* bench_session_worker(void* arg) {
+    SessionBench* bench = arg;
+    char path[MAX_PATH_LENGTH];
+    char name[32];
+    char buffer[64];
+    int mine = (bench->count - bench->first + bench->stride - 1) / bench->stride;
+
+    for (long step = 0; step < bench->steps; step++) {
+        int k = bench->first + (int)(step % mine) * bench->stride;
+        long round = step / mine;
+        int d = bench_session_dir(k, round);
+        session_attach(bench->sessions[k]);
+
+        snprintf(path, sizeof(path), "/s%03d", d);
+        snprintf(name, sizeof(name), "f%d", (int)(round % BENCH_SESSION_FILES));
+        if (change_directory(path) != 0 || strcmp(get_current_path(), path) != 0) {
+            bench->errors++;
+        }
+        int entries = 0;
+        if (list_directory(".", bench_count_entry, &entries) != 0 || entries == 0) {
+            bench->errors++;
+        }
+        if (open_file(name, "r") != 0 || read_file(name, buffer, sizeof(buffer)) != 4 ||
+            buffer[1] != '0' + d / 10 || close_file(name) != 0) {
+            bench->errors++;
+        }
+    }
+    session_attach(NULL);
+    return NULL;
+}
+
+/**
+ * @brief Mesure des sessions concurrentes sur une arborescence partagée
+ *
+ * @details
+ * - Crée BENCH_SESSION_DIRS répertoires de BENCH_SESSION_FILES fichiers
+ * - Pour 1, 10, 100... sessions, des threads (au moins 4, un par cœur
+ *   sinon) servent les sessions à tour de rôle ; chaque itération fait
+ *   un cd absolu, un ls du répertoire courant et ouvre, lit et ferme un
+ *   fichier par un chemin relatif
+ * - Vérifie que chaque session a vu son propre répertoire de travail, et
+ *   qu'à la fin chacune est dans le dernier répertoire qu'elle a visité
+ */
+static void bench_sessions() {
+    char path[MAX_PATH_LENGTH];
+    char content[8];
+
+    bench_mute();
+    for (int d = 0; d < BENCH_SESSION_DIRS; d++) {
+        snprintf(path, sizeof(path), "/s%03d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_SESSION_FILES; f++) {
+            snprintf(path, sizeof(path), "/s%03d/f%d", d, f);
+            snprintf(content, sizeof(content), "d%02d%d", d, f);
+            create_file(path, 644);
+            open_file(path, "w");
+            write_file(path, content);
+            close_file(path);
+        }
+    }
+    bench_unmute();
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = cores > 4 ? (int)cores : 4;
+    if (workers > BENCH_MAX_THREADS) workers = BENCH_MAX_THREADS;
+    static Session* sessions[BENCH_MAX_SESSIONS];
+    pthread_t threads[BENCH_MAX_THREADS];
+    SessionBench benches[BENCH_MAX_THREADS];
+
+    printf("sessions: %d threads, %d itérations cd + ls + open/read/close par mesure\n",
+           workers, BENCH_SESSION_STEPS);
+    for (int count = 1; count <= BENCH_MAX_SESSIONS; count *= 10) {
+        for (int k = 0; k < count; k++) {
+            sessions[k] = session_create();
+        }
+        int used = count < workers ? count : workers;
+
+        bench_mute();
+        double start = bench_now_ns();
+        for (int t = 0; t < used; t++) {
+            benches[t] = (SessionBench){ sessions, t, used, count, BENCH_SESSION_STEPS / used, 0 };
+            pthread_create(&threads[t], NULL, bench_session_worker, &benches[t]);
+        }
+        long errors = 0;
+        for (int t = 0; t < used; t++) {
+            pthread_join(threads[t], NULL);
+            errors += benches[t].errors;
+        }
+        double elapsed_ns = bench_now_ns() - start;
+        bench_unmute();
+
+        // Chaque session est restée dans le dernier répertoire qu'elle a visité
+        for (int t = 0; t < used; t++) {
+            int mine = (count - t + used - 1) / used;
+            for (int k = t; k < count; k += used) {
+                long position = (k - t) / used;
+                long steps = benches[t].steps;
+                if (position >= steps) continue;
+                long last_round = (steps - 1 - position) / mine;
+                snprintf(path, sizeof(path), "/s%03d", bench_session_dir(k, last_round));
+                session_attach(sessions[k]);
+                if (strcmp(get_current_path(), path) != 0) errors++;
+            }
+        }
+        session_attach(NULL);
+        for (int k = 0; k < count; k++) {
+            session_destroy(sessions[k]);
+        }
+
+        long steps = (long)used * (BENCH_SESSION_STEPS / used);
+        printf("  %5d session(s)          : %10.0f itérations/s, %6.2f us/itération (%s)\n",
+               count, steps / (elapsed_ns / 1e9), elapsed_ns / 1e3 / steps,
+               errors == 0 ? "correct" : "INCORRECT");
+    }
+}
+
+/**
+ * @brief Rejoue un script de commandes sur un système de fichiers neuf
+ *
+ * @param options Options de run_commands
+ * @param limit Nombre de lignes du script à rejouer
+ * @param journal 1 pour journaliser les commandes
+ * @param failures Nombre de commandes en erreur
+ * @return double Durée en ms, fermeture du système comprise
+ */
+static double bench_batch_run(int options, long limit, int journal, long* failures) {
+    char line[128];
+    tree_release();
+    unlink(FS_FILENAME);
+    unlink(FS_JOURNAL_FILENAME);
+    init_file_system();
+    if (!journal) journal_close();
+
+    // Le script complet, ou ses premières lignes
+    FILE* input = fopen(BENCH_BATCH_SCRIPT, "r");
+    FILE* prefix = limit > 0 ? tmpfile() : NULL;
+    for (long i = 0; prefix != NULL && i < limit && fgets(line, sizeof(line), input) != NULL; i++) {
+        fputs(line, prefix);
+    }
+    if (prefix != NULL) {
+        fclose(input);
+        input = prefix;
+        rewind(input);
+    }
+
+    bench_mute();
+    double start = bench_now_ns();
+    *failures = run_commands(input, options | COMMAND_QUIET);
+    double elapsed_ms = (bench_now_ns() - start) / 1e6;
+    bench_unmute();
+    fclose(input);
+    return elapsed_ms;
+}
+
+/**
+ * @brief Mesure le débit du mode script (run_commands)
+ *
+ * @details
+ * - Écrit un script qui crée BENCH_BATCH_DIRS répertoires de
+ *   BENCH_BATCH_FILES fichiers, et ouvre, écrit, complète, lit, ferme et
+ *   change les permissions de chacun
+ * - Le rejoue en mode script silencieux sans journal, puis avec le
+ *   journal (synchronisé par lots)
+ * - Rejoue ses BENCH_BATCH_PROMPTED premières commandes en mode
+ *   interactif (invite, synchronisation du journal après chaque commande)
+ * - Vérifie qu'aucune commande n'a échoué et que l'arborescence est complète
+ */
+static void bench_batch() {
+    FILE* script = fopen(BENCH_BATCH_SCRIPT, "w");
+    long count = 0;
+    for (int d = 0; d < BENCH_BATCH_DIRS; d++) {
+        fprintf(script, "mkdir /batch%04d 755\n", d);
+        fprintf(script, "cd /batch%04d\n", d);
+        count += 2;
+        for (int f = 0; f < BENCH_BATCH_FILES; f++) {
+            fprintf(script, "create file%03d 644\nopen file%03d rw\nwrite file%03d \"contenu %d\"\n"
+                            "append file%03d \" suite\"\nread file%03d\nclose file%03d\nchmod file%03d 600\n",
+                    f, f, f, f, f, f, f, f);
+            count += 7;
+        }
+        fprintf(script, "ls\n");
+        count++;
+    }
+    fclose(script);
+
+    long failures = 0, errors = 0;
+    double plain_ms = bench_batch_run(0, 0, 0, &failures);
+    errors += failures;
+    FileInfo last;
+    int complete = root_directory->dir_data->child_count == BENCH_BATCH_DIRS &&
+                   stat_file("/batch0999/file099", &last) == FS_OK &&
+                   last.size == (long long)strlen("contenu 99 suite") && last.permissions == 600;
+    double journal_ms = bench_batch_run(0, 0, 1, &failures);
+    errors += failures;
+    double prompted_ms = bench_batch_run(COMMAND_PROMPT, BENCH_BATCH_PROMPTED, 1, &failures);
+    errors += failures;
+    unlink(BENCH_BATCH_SCRIPT);
+
+    printf("batch: script de %ld commandes (%d répertoires, %d fichiers)\n",
+           count, BENCH_BATCH_DIRS, BENCH_BATCH_DIRS * BENCH_BATCH_FILES);
+    printf("  script, sans journal      : %10.0f commandes/s (%.0f ms)\n", count / (plain_ms / 1e3), plain_ms);
+    printf("  script, journal par lots  : %10.0f commandes/s (%.0f ms)\n", count / (journal_ms / 1e3), journal_ms);
+    printf("  interactif, journal       : %10.0f commandes/s (%d premières commandes)\n",
+           BENCH_BATCH_PROMPTED / (prompted_ms / 1e3), BENCH_BATCH_PROMPTED);
+    printf("  %s\n", errors == 0 && complete ? "correct" : "INCORRECT");
+}
+
+/**
+ * @brief Résout en boucle un ensemble de chemins
+ *
+ * @param paths Chemins, BENCH_DCACHE_DIRS * BENCH_DCACHE_FILES entrées
+ * @param expected Type attendu du nœud renvoyé pour chaque chemin
+ * @param errors Incrémenté pour chaque résultat inattendu
+ * @return double Coût moyen d'une résolution en ns
+ */
+static double bench_dcache_pass(char (*paths)[64], FileType expected, long* errors) {
+    int count = BENCH_DCACHE_DIRS * BENCH_DCACHE_FILES;
+    double start = bench_now_ns();
+    for (long i = 0; i < BENCH_DCACHE_LOOKUPS; i++) {
+        FileNode* node = get_file_by_path(paths[i % count]);
+        if (node == NULL || node->type != expected) (*errors)++;
+    }
+    return (bench_now_ns() - start) / BENCH_DCACHE_LOOKUPS;
+}
+
+/**
+ * @brief Mesure le cache de résolution sur un ensemble de chemins profonds
+ *
+ * @details
+ * - Crée BENCH_DCACHE_DIRS répertoires de BENCH_DCACHE_FILES fichiers
+ *   à sept niveaux de profondeur
+ * - Résout en boucle tous les chemins de fichiers existants, puis autant
+ *   de chemins absents, par chemin absolu (cache) puis par le même chemin
+ *   relatif à la racine (parcours composant par composant, sans cache)
+ * - Vérifie l'invalidation : les chemins absents sont créés puis
+ *   supprimés, et un répertoire est déplacé, entre deux résolutions
+ */
+static void bench_dcache() {
+    int count = BENCH_DCACHE_DIRS * BENCH_DCACHE_FILES;
+    char (*present)[64] = malloc(count * sizeof(*present));
+    char (*absent)[64] = malloc(count * sizeof(*absent));
+    char (*relative)[64] = malloc(count * sizeof(*relative));
+    char path[MAX_PATH_LENGTH] = "";
+
+    bench_mute();
+    snprintf(path, sizeof(path), "%s/", BENCH_DCACHE_PREFIX);
+    for (char* slash = strchr(path + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        create_directory(path, 755);
+        *slash = '/';
+    }
+    for (int d = 0; d < BENCH_DCACHE_DIRS; d++) {
+        snprintf(path, sizeof(path), BENCH_DCACHE_PREFIX "/dir_%02d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_DCACHE_FILES; f++) {
+            int i = d * BENCH_DCACHE_FILES + f;
+            snprintf(present[i], sizeof(present[i]), BENCH_DCACHE_PREFIX "/dir_%02d/file_%02d", d, f);
+            snprintf(absent[i], sizeof(absent[i]), BENCH_DCACHE_PREFIX "/dir_%02d/missing_%02d", d, f);
+            create_file(present[i], 644);
+        }
+    }
+    bench_unmute();
+
+    long errors = 0;
+    for (int i = 0; i < count; i++) {
+        snprintf(relative[i], sizeof(relative[i]), "%s", present[i] + 1);
+    }
+    double present_walk = bench_dcache_pass(relative, FILE_TYPE, &errors);
+    double present_cached = bench_dcache_pass(present, FILE_TYPE, &errors);
+    for (int i = 0; i < count; i++) {
+        snprintf(relative[i], sizeof(relative[i]), "%s", absent[i] + 1);
+    }
+    // Un chemin absent résout vers le répertoire qui le recevrait
+    double absent_walk = bench_dcache_pass(relative, DIRECTORY_TYPE, &errors);
+    double absent_cached = bench_dcache_pass(absent, DIRECTORY_TYPE, &errors);
+
+    // Les créations, suppressions et déplacements invalident le cache
+    bench_mute();
+    for (int i = 0; i < count; i++) {
+        create_file(absent[i], 644);
+    }
+    for (int i = 0; i < count; i++) {
+        FileNode* node = get_file_by_path(absent[i]);
+        if (node == NULL || node->type != FILE_TYPE) errors++;
+        delete_file(absent[i]);
+        node = get_file_by_path(absent[i]);
+        if (node == NULL || node->type != DIRECTORY_TYPE) errors++;
+    }
+    move_file(BENCH_DCACHE_PREFIX "/dir_00", "/moved");
+    bench_unmute();
+    FileNode* moved = get_file_by_path("/moved/file_00");
+    if (get_file_by_path(present[0]) != NULL || moved == NULL || moved->type != FILE_TYPE) errors++;
+
+    printf("dcache: %d chemins à 7 niveaux, %d résolutions par mesure\n", count, BENCH_DCACHE_LOOKUPS);
+    printf("  existants, parcours       : %8.1f ns/résolution\n", present_walk);
+    printf("  existants, cache          : %8.1f ns/résolution (x%.1f)\n",
+           present_cached, present_walk / present_cached);
+    printf("  absents, parcours         : %8.1f ns/résolution\n", absent_walk);
+    printf("  absents, cache            : %8.1f ns/résolution (x%.1f)\n",
+           absent_cached, absent_walk / absent_cached);
+    printf("  invalidation              : %s\n", errors == 0 ? "correct" : "INCORRECT");
+    free(present);
+    free(absent);
+    free(relative);
+}
+
+/**
+ * @brief Paramètres et résultats d'un thread de bench_handles()
+ */
+typedef struct {
+    Session* session;               /**< Session du thread */
+    const char* path;               /**< Fichier lu */
+    long errors;                    /**< Lectures incorrectes */
+} HandleBench;
+
+/**
+ * @brief Lit BENCH_HANDLE_READS fois le fichier par un descripteur, en boucle
+ *
+ * @param bench HandleBench du lecteur
+ * @return long Nombre de lectures incorrectes
+ */
+static long bench_handle_reads(HandleBench* bench) {
+    char buffer[BENCH_HANDLE_READ];
+    long errors = 0;
+    int fd = fd_open(bench->path, "r");
+    if (fd < 0) return BENCH_HANDLE_READS;
+
+    long long offset = 0;
+    for (long i = 0; i < BENCH_HANDLE_READS; i++) {
+        if (offset == BENCH_HANDLE_SIZE) {
+            fd_seek(fd, 0, SEEK_SET);
+            offset = 0;
+        }
+        if (fd_read(fd, buffer, sizeof(buffer)) != BENCH_HANDLE_READ ||
+            buffer[0] != 'a' + (offset / BENCH_HANDLE_READ) % 26) {
+            errors++;
+        }
+        offset += BENCH_HANDLE_READ;
+    }
+    fd_close(fd);
+    return errors;
+}
+
+/**
+ * @brief Lecteur concurrent de bench_handles(), dans sa propre session
+ *
+ * @param arg HandleBench du thread
+ */
+static void* bench_handle_worker(void* arg) {
+    HandleBench* bench = arg;
+    session_attach(bench->session);
+    bench->errors = bench_handle_reads(bench);
+    session_attach(NULL);
+    return NULL;
+}
+
+/**
+ * @brief Compare les lectures par chemin et par descripteur
+ *
+ * @details
+ * - Crée un fichier de BENCH_HANDLE_SIZE octets à BENCH_HANDLE_DEPTH
+ *   niveaux de profondeur ; chaque bloc de BENCH_HANDLE_READ octets est
+ *   rempli d'une lettre qui dépend de sa position
+ * - Le parcourt séquentiellement par blocs de BENCH_HANDLE_READ octets,
+ *   d'abord par pread_file (le chemin est résolu à chaque lecture), puis
+ *   par fd_read
+ * - Avec 1, 2, 4... threads, chacun dans sa session ouvre son propre
+ *   descripteur sur le même fichier et le lit en parallèle des autres
+ */
+static void bench_handles() {
+    char path[MAX_PATH_LENGTH] = "";
+    char buffer[BENCH_HANDLE_READ];
+
+    bench_mute();
+    for (int depth = 0; depth < BENCH_HANDLE_DEPTH; depth++) {
+        snprintf(path + strlen(path), sizeof(path) - strlen(path), "/dir%d", depth);
+        create_directory(path, 755);
+    }
+    strcat(path, "/data");
+    create_file(path, 644);
+    int fd = fd_open(path, "w");
+    for (int block = 0; block < BENCH_HANDLE_SIZE / BENCH_HANDLE_READ; block++) {
+        memset(buffer, 'a' + block % 26, sizeof(buffer));
+        fd_write(fd, buffer, sizeof(buffer));
+    }
+    fd_close(fd);
+    open_file(path, "r");
+    bench_unmute();
+
+    long errors = 0;
+    double start = bench_now_ns();
+    long long offset = 0;
+    for (long i = 0; i < BENCH_HANDLE_READS; i++) {
+        if (offset == BENCH_HANDLE_SIZE) offset = 0;
+        if (pread_file(path, buffer, sizeof(buffer), offset) != BENCH_HANDLE_READ ||
+            buffer[0] != 'a' + (offset / BENCH_HANDLE_READ) % 26) {
+            errors++;
+        }
+        offset += BENCH_HANDLE_READ;
+    }
+    double path_ns = (bench_now_ns() - start) / BENCH_HANDLE_READS;
+    bench_mute();
+    close_file(path);
+    bench_unmute();
+
+    HandleBench single = { session_current(), path, 0 };
+    start = bench_now_ns();
+    errors += bench_handle_reads(&single);
+    double handle_ns = (bench_now_ns() - start) / BENCH_HANDLE_READS;
+
+    printf("handles: fichier de %d Ko à %d niveaux, lectures de %d octets\n",
+           BENCH_HANDLE_SIZE / 1024, BENCH_HANDLE_DEPTH + 1, BENCH_HANDLE_READ);
+    printf("  pread_file (chemin)       : %10.1f ns/lecture\n", path_ns);
+    printf("  fd_read (descripteur)     : %10.1f ns/lecture (x%.2f)\n", handle_ns, path_ns / handle_ns);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cores > 4 ? (int)cores : 4;
+    if (max_threads > BENCH_MAX_THREADS) max_threads = BENCH_MAX_THREADS;
+    pthread_t threads[BENCH_MAX_THREADS];
+    HandleBench benches[BENCH_MAX_THREADS];
+    double single_rate = 0;
+    for (int count = 1; count <= max_threads; count *= 2) {
+        for (int t = 0; t < count; t++) {
+            benches[t] = (HandleBench){ session_create(), path, 0 };
+        }
+        start = bench_now_ns();
+        for (int t = 0; t < count; t++) {
+            pthread_create(&threads[t], NULL, bench_handle_worker, &benches[t]);
+        }
+        for (int t = 0; t < count; t++) {
+            pthread_join(threads[t], NULL);
+            errors += benches[t].errors;
+            session_destroy(benches[t].session);
+        }
+        double rate = (double)count * BENCH_HANDLE_READS / ((bench_now_ns() - start) / 1e9);
+        if (count == 1) single_rate = rate;
+        printf("  %2d lecteur(s)             : %10.0f lectures/s (x%.2f)\n",
+               count, rate, rate / single_rate);
+    }
+    printf("  %s\n", errors == 0 ? "correct" : "INCORRECT");
+}
+
+/**
+ * @brief Mesure la création puis la destruction d'un million de nœuds
+ *
+ * @details
+ * - Crée BENCH_IMAGE_DIRS répertoires de BENCH_IMAGE_FILES fichiers
+ * - Supprime la moitié des répertoires par delete_file (rm -r)
+ * - Détruit le reste de l'arborescence en bloc par tree_release()
+ */
+static void bench_teardown() {
+    char path[MAX_PATH_LENGTH];
+
+    bench_mute();
+    double start = bench_now_ns();
+    for (int d = 0; d < BENCH_IMAGE_DIRS; d++) {
+        snprintf(path, sizeof(path), "/d%04d", d);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_IMAGE_FILES; f++) {
+            snprintf(path, sizeof(path), "/d%04d/f%04d", d, f);
+            create_file(path, 644);
+        }
+    }
+    double create_ms = (bench_now_ns() - start) / 1e6;
+
+    start = bench_now_ns();
+    for (int d = 0; d < BENCH_IMAGE_DIRS / 2; d++) {
+        snprintf(path, sizeof(path), "/d%04d", d);
+        delete_file(path);
+    }
+    double delete_ms = (bench_now_ns() - start) / 1e6;
+
+    start = bench_now_ns();
+    tree_release();
+    double release_ms = (bench_now_ns() - start) / 1e6;
+    bench_unmute();
+
+    int nodes = BENCH_IMAGE_DIRS * (1 + BENCH_IMAGE_FILES);
+    printf("teardown: %d nœuds dans %d répertoires\n", nodes, BENCH_IMAGE_DIRS);
+    printf("  création                  : %8.1f ms (%.0f ns/nœud)\n", create_ms, create_ms * 1e6 / nodes);
+    printf("  rm -r de la moitié        : %8.1f ms\n", delete_ms);
+    printf("  destruction en bloc       : %8.1f ms\n", release_ms);
+
+    // Le prochain benchmark repart d'une racine neuve
+    root_directory = node_alloc("/", DIRECTORY_TYPE, 755);
+    session_set_cwd(session_current(), root_directory);
+}
+
+/**
+ * @brief Parcourt /huge par lots de batch entrées
+ *
+ * @param batch Nombre d'entrées par appel à read_directory
+ * @param seen Compteur de passages de chaque fichier d'origine (NULL : pas de décompte)
+ * @return long Nombre d'entrées lues
+ */
+static long bench_readdir_scan(int batch, int* seen) {
+    static DirEntry entries[BENCH_READDIR_BATCH];
+    DirCursor cursor;
+    long total = 0;
+    int count;
+    if (open_directory("/huge", &cursor) != 0) return -1;
+    while ((count = read_directory(&cursor, entries, batch)) > 0) {
+        for (int i = 0; seen != NULL && i < count; i++) {
+            int k;
+            if (sscanf(entries[i].name, "file_%d", &k) == 1) seen[k]++;
+        }
+        total += count;
+    }
+    close_directory(&cursor);
+    return count < 0 ? -1 : total;
+}
+
+/**
+ * @brief Crée et supprime des entrées de /huge pendant un parcours
+ *
+ * @param arg Inutilisé
+ */
+static void* bench_readdir_churn(void* arg) {
+    char path[MAX_PATH_LENGTH];
+    for (int i = 0; i < BENCH_READDIR_CHURN; i++) {
+        snprintf(path, sizeof(path), "/huge/new_%07d", i);
+        create_file(path, 644);
+        snprintf(path, sizeof(path), "/huge/file_%07d", 2 * i + 1);
+        delete_file(path);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Mesure le parcours d'un répertoire d'un million d'entrées
+ *
+ * @details
+ * - list_directory : une seule passe sous le verrou du répertoire
+ * - read_directory par lots de BENCH_READDIR_BATCH, puis entrée par
+ *   entrée : mémoire bornée, verrou relâché entre deux lots
+ * - Parcours pendant que BENCH_READDIR_CHURN fichiers sont créés et
+ *   autant supprimés : chaque fichier jamais supprimé doit être vu
+ *   exactement une fois, les autres au plus une fois
+ */
+static void bench_readdir() {
+    char path[MAX_PATH_LENGTH];
+    bench_mute();
+    create_directory("/huge", 755);
+    for (int i = 0; i < BENCH_READDIR_ENTRIES; i++) {
+        snprintf(path, sizeof(path), "/huge/file_%07d", i);
+        create_file(path, 644);
+    }
+    bench_unmute();
+
+    int visited = 0;
+    double start = bench_now_ns();
+    list_directory("/huge", bench_count_entry, &visited);
+    double visit_ns = (bench_now_ns() - start) / BENCH_READDIR_ENTRIES;
+
+    start = bench_now_ns();
+    long batched = bench_readdir_scan(BENCH_READDIR_BATCH, NULL);
+    double batch_ns = (bench_now_ns() - start) / BENCH_READDIR_ENTRIES;
+
+    start = bench_now_ns();
+    long single = bench_readdir_scan(1, NULL);
+    double single_ns = (bench_now_ns() - start) / BENCH_READDIR_ENTRIES;
+
+    int* seen = calloc(BENCH_READDIR_ENTRIES, sizeof(int));
+    pthread_t churn;
+    pthread_create(&churn, NULL, bench_readdir_churn, NULL);
+    long concurrent = bench_readdir_scan(64, seen);
+    pthread_join(churn, NULL);
+    int errors = visited != BENCH_READDIR_ENTRIES || batched != BENCH_READDIR_ENTRIES ||
+                 single != BENCH_READDIR_ENTRIES || concurrent < 0;
+    for (int i = 0; i < BENCH_READDIR_ENTRIES; i++) {
+        int churned = i % 2 == 1 && i < 2 * BENCH_READDIR_CHURN;
+        if (seen[i] > 1 || (!churned && seen[i] != 1)) errors++;
+    }
+    free(seen);
+
+    printf("readdir: %d entrées dans un seul répertoire\n", BENCH_READDIR_ENTRIES);
+    printf("  list_directory (visiteur) : %8.1f ns/entrée\n", visit_ns);
+    printf("  read_directory par %-4d   : %8.1f ns/entrée (%zu octets de lot)\n",
+           BENCH_READDIR_BATCH, batch_ns, sizeof(DirEntry) * BENCH_READDIR_BATCH);
+    printf("  read_directory par 1      : %8.1f ns/entrée\n", single_ns);
+    printf("  parcours concurrent       : %ld entrées, %s\n", concurrent,
+           errors == 0 ? "correct" : "INCORRECT");
+}
+
+/**
+ * @brief Compte les entrées trouvées (FindVisitor)
+ */
+static int bench_count_found(const char* path, const FileInfo* info, void* arg) {
+    (*(long*)arg)++;
+    return 0;
+}
+
+/**
+ * @brief Mesure les parcours parallèles de sous-arbres selon le nombre de threads
+ *
+ * @details
+ * Pour chaque nombre de threads (fs_walk_threads), construit /w :
+ * BENCH_WALK_DIRS répertoires de BENCH_WALK_SUB_DIRS sous-répertoires
+ * de BENCH_WALK_FILES fichiers, puis mesure find -name, chmod -R et
+ * rm -r, et vérifie leurs résultats ainsi que l'occupation tenue à jour
+ * (disk_usage, qui ne parcourt plus rien : voir bench_usage).
+ */
+static void bench_walk() {
+    char path[MAX_PATH_LENGTH];
+    long long dirs = 1 + BENCH_WALK_DIRS + (long long)BENCH_WALK_DIRS * BENCH_WALK_SUB_DIRS;
+    long long files = (long long)BENCH_WALK_DIRS * BENCH_WALK_SUB_DIRS * BENCH_WALK_FILES;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cores > 4 ? (int)cores : 4;
+    if (max_threads > BENCH_MAX_THREADS) max_threads = BENCH_MAX_THREADS;
+
+    printf("walk: %lld répertoires, %lld fichiers, %ld processeur(s)\n", dirs, files, cores);
+    printf("  threads     find   chmod -R     rm -r (ms)\n");
+    int errors = 0;
+    for (int count = 1; count <= max_threads; count *= 2) {
+        fs_walk_threads = count;
+        create_directory("/w", 755);
+        for (int d = 0; d < BENCH_WALK_DIRS; d++) {
+            snprintf(path, sizeof(path), "/w/d%04d", d);
+            create_directory(path, 755);
+            for (int s = 0; s < BENCH_WALK_SUB_DIRS; s++) {
+                snprintf(path, sizeof(path), "/w/d%04d/s%02d", d, s);
+                create_directory(path, 755);
+                for (int f = 0; f < BENCH_WALK_FILES; f++) {
+                    snprintf(path, sizeof(path), "/w/d%04d/s%02d/f%03d", d, s, f);
+                    create_file(path, 644);
+                }
+            }
+        }
+
+        DiskUsage usage;
+        disk_usage("/w", &usage);
+
+        long found = 0;
+        FindQuery query = { "f07?", FILE_TYPE, -1, -1 };
+        double start = bench_now_ns();
+        find_files("/w", &query, bench_count_found, &found);
+        double find_ms = (bench_now_ns() - start) / 1e6;
+
+        start = bench_now_ns();
+        set_permissions_recursive("/w", 700);
+        double chmod_ms = (bench_now_ns() - start) / 1e6;
+        FileInfo info;
+        stat_file("/w/d0999/s09/f099", &info);
+
+        start = bench_now_ns();
+        delete_file("/w");
+        double rm_ms = (bench_now_ns() - start) / 1e6;
+
+        if (usage.directories != dirs || usage.files != files ||
+            found != (long)BENCH_WALK_DIRS * BENCH_WALK_SUB_DIRS * 10 ||
+            info.permissions != 700 || stat_file("/w", &info) != FS_ERR_NOT_FOUND) {
+            errors++;
+        }
+        printf("  %7d %8.1f   %8.1f  %8.1f\n", count, find_ms, chmod_ms, rm_ms);
+    }
+    fs_walk_threads = 0;
+    printf("  %s\n", errors == 0 ? "correct" : "INCORRECT");
+}
+
+/** @brief Sous-répertoires de chaque projet de bench_names */
+static const char* const bench_names_dirs[] = { "src", "include", "doc", "test" };
+
+/** @brief Noms de fichiers répétés dans chaque répertoire de bench_names */
+static const char* const bench_names_files[] = {
+    "README.md", "Makefile", "LICENSE", ".gitignore",
+    "index.html", "main.c", "config.json", "CMakeLists.txt"
+};
+
+/**
+ * @brief Crée un fichier et ajoute à *copies le coût d'une copie privée de son nom
+ *
+ * @param path Chemin du fichier
+ * @param name Nom du fichier (dernier composant de path)
+ * @param copies Octets qu'occuperaient les noms copiés nœud par nœud
+ *        (granularité de 16 octets des dalles)
+ */
+static void bench_names_create(const char* path, const char* name, size_t* copies) {
+    create_file(path, 644);
+    *copies += (strlen(name) + 1 + 15) & ~(size_t)15;
+}
+
+/**
+ * @brief Mesure le partage des noms et la recherche d'un enfant par son nom
+ *
+ * @details
+ * - Construit BENCH_NAMES_PROJECTS projets dont chaque répertoire contient
+ *   les mêmes noms (README.md, Makefile...), plus quelques fichiers au
+ *   nom unique, et compare la place des noms internés à celle de copies
+ *   privées ; la mémoire par nœud est celle des objets alloués dans les
+ *   dalles (nœuds, DirData, noms), indépendante du reste du programme
+ * - Cherche des noms relatifs (sans le cache de résolution) dans un
+ *   répertoire de BENCH_NAMES_ENTRIES entrées de même préfixe : seul le
+ *   candidat de même empreinte et de même longueur est comparé
+ * - Vérifie qu'un nom trop long est refusé sans être tronqué et que les
+ *   références des noms disparaissent avec l'arborescence
+ */
+static void bench_names() {
+    char path[MAX_PATH_LENGTH];
+    size_t distinct_before, refs_before, bytes_before;
+    names_stats(&distinct_before, &refs_before, &bytes_before);
+
+    size_t copies = 0;
+    long nodes = 0;
+    size_t small_before = small_live_bytes();
+    create_directory("/names", 755);
+    for (int p = 0; p < BENCH_NAMES_PROJECTS; p++) {
+        snprintf(path, sizeof(path), "/names/p%05d", p);
+        create_directory(path, 755);
+        copies += 16;
+        nodes++;
+        int dir_count = sizeof(bench_names_dirs) / sizeof(bench_names_dirs[0]);
+        int file_count = sizeof(bench_names_files) / sizeof(bench_names_files[0]);
+        for (int d = -1; d < dir_count; d++) {
+            int length = snprintf(path, sizeof(path), "/names/p%05d", p);
+            if (d >= 0) {
+                length += snprintf(path + length, sizeof(path) - length, "/%s", bench_names_dirs[d]);
+                create_directory(path, 755);
+                copies += (strlen(bench_names_dirs[d]) + 1 + 15) & ~(size_t)15;
+                nodes++;
+            }
+            for (int f = 0; f < file_count; f++) {
+                snprintf(path + length, sizeof(path) - length, "/%s", bench_names_files[f]);
+                bench_names_create(path, bench_names_files[f], &copies);
+                nodes++;
+            }
+        }
+        for (int u = 0; u < BENCH_NAMES_UNIQUE; u++) {
+            snprintf(path, sizeof(path), "/names/p%05d/src/p%05d_module_%d.c", p, p, u);
+            bench_names_create(path, strrchr(path, '/') + 1, &copies);
+            nodes++;
+        }
+    }
+    size_t small_after = small_live_bytes();
+    size_t distinct, refs, bytes;
+    names_stats(&distinct, &refs, &bytes);
+    distinct -= distinct_before;
+    refs -= refs_before;
+
+    printf("names: %ld nœuds, %zu noms distincts (%.1f nœuds par nom)\n",
+           nodes, distinct, (double)refs / distinct);
+    printf("  noms copiés par nœud      : %8.1f Ko\n", copies / 1024.0);
+    printf("  noms internés (et table)  : %8.1f Ko\n", (bytes - bytes_before) / 1024.0);
+    printf("  mémoire par nœud (dalles) : %8.1f octets\n", (double)(small_after - small_before) / nodes);
+
+    // Recherche parmi des noms de même préfixe et de longueurs voisines
+    create_directory("/names/flat", 755);
+    for (int i = 0; i < BENCH_NAMES_ENTRIES; i++) {
+        snprintf(path, sizeof(path), "/names/flat/component_with_a_long_shared_prefix_%d.h", i);
+        create_file(path, 644);
+    }
+    change_directory("/names/flat");
+    char (*names)[64] = malloc(BENCH_PATH_POOL * sizeof(*names));
+    for (int i = 0; i < BENCH_PATH_POOL; i++) {
+        snprintf(names[i], sizeof(names[i]), "component_with_a_long_shared_prefix_%d.h",
+                 (int)(bench_rand() % BENCH_NAMES_ENTRIES));
+    }
+    long misses = 0;
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_NAMES_LOOKUPS; i++) {
+        if (get_file_by_path(names[i & (BENCH_PATH_POOL - 1)]) == NULL) misses++;
+    }
+    double lookup_ns = (bench_now_ns() - start) / BENCH_NAMES_LOOKUPS;
+    free(names);
+    printf("  recherche (préfixe commun): %8.1f ns/recherche (%ld échecs)\n", lookup_ns, misses);
+
+    // Un nom trop long est refusé sans être tronqué, le plus long nom admis est retrouvé
+    char name[MAX_NAME_LENGTH + 1];
+    memset(name, 'n', MAX_NAME_LENGTH);
+    name[MAX_NAME_LENGTH] = '\0';
+    int rejected = create_file(name, 644) == FS_ERR_NAME_TOO_LONG &&
+                   create_symbolic_link("/names", name) == FS_ERR_NAME_TOO_LONG &&
+                   move_file("component_with_a_long_shared_prefix_0.h", name) == FS_ERR_NAME_TOO_LONG;
+    name[MAX_NAME_LENGTH - 1] = '\0';
+    int accepted = create_file(name, 644) == FS_OK && get_file_by_path(name) != NULL;
+    change_directory("/");
+    delete_file("/names");
+
+    names_stats(&distinct, &refs, &bytes);
+    int released = distinct == distinct_before && refs == refs_before;
+    printf("  %s\n", rejected && accepted && released && misses == 0 ? "correct" : "INCORRECT");
+}
+
+/** @brief Tailles des répertoires de bench_tags */
+static const int bench_tags_sizes[] = { 10, 100, 1000, 10000, 100000 };
+
+/** @brief Noyaux de filtrage comparés par bench_tags */
+static const char* const bench_tags_kernels[] = { "scalar", "sse2", "avx2" };
+
+/**
+ * @brief Recherche un enfant par balayage linéaire avec strcmp
+ *
+ * @param dir Répertoire dans lequel chercher
+ * @param name Nom recherché
+ * @return FileNode* Nœud trouvé, NULL sinon
+ */
+static FileNode* bench_tags_scan(FileNode* dir, const char* name) {
+    for (int i = 0; i < dir->dir_data->child_count; i++) {
+        if (strcmp(dir->dir_data->children[i]->name, name) == 0) {
+            return dir->dir_data->children[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Mesure la recherche d'un enfant selon la taille du répertoire et le noyau
+ *
+ * @details
+ * Pour chaque taille de bench_tags_sizes, remplit un répertoire puis
+ * cherche des noms tirés au hasard, une moitié présents et l'autre
+ * absente : par balayage linéaire (strcmp sur chaque enfant), puis par
+ * l'index avec chacun des noyaux de filtrage des étiquettes que le
+ * processeur exécute (voir fs_tags.c).
+ */
+static void bench_tags() {
+    char path[MAX_PATH_LENGTH];
+    int kernel_count = sizeof(bench_tags_kernels) / sizeof(bench_tags_kernels[0]);
+    const char* best = tag_kernel->name;
+
+    printf("tags: recherche d'un enfant, moitié de noms absents (ns/recherche), noyau par défaut %s\n", best);
+    printf("  entrées   linéaire");
+    for (int k = 0; k < kernel_count; k++) printf(" %9s", bench_tags_kernels[k]);
+    printf("\n");
+
+    char (*names)[32] = malloc(BENCH_PATH_POOL * sizeof(*names));
+    long misses = 0;
+    int count = sizeof(bench_tags_sizes) / sizeof(bench_tags_sizes[0]);
+    for (int c = 0; c < count; c++) {
+        int size = bench_tags_sizes[c];
+        snprintf(path, sizeof(path), "/tags%d", size);
+        create_directory(path, 755);
+        for (int i = 0; i < size; i++) {
+            snprintf(path, sizeof(path), "/tags%d/entry_%06d.dat", size, i);
+            create_file(path, 644);
+        }
+        snprintf(path, sizeof(path), "/tags%d", size);
+        FileNode* dir = get_file_by_path(path);
+        for (int i = 0; i < BENCH_PATH_POOL; i++) {
+            // Indices pairs : présents ; impairs : absents
+            int index = (int)(bench_rand() % size);
+            snprintf(names[i], sizeof(names[i]), (i & 1) ? "entry_%06d.tmp" : "entry_%06d.dat", index);
+        }
+
+        long found = 0;
+        double start = bench_now_ns();
+        for (int i = 0; i < BENCH_TAGS_SCANS; i++) {
+            if (bench_tags_scan(dir, names[i & (BENCH_PATH_POOL - 1)]) != NULL) found++;
+        }
+        if (found != BENCH_TAGS_SCANS / 2) misses++;
+        printf("  %7d %10.1f", size, (bench_now_ns() - start) / BENCH_TAGS_SCANS);
+
+        for (int k = 0; k < kernel_count; k++) {
+            if (tags_select(bench_tags_kernels[k]) != 0) {
+                printf(" %9s", "-");
+                continue;
+            }
+            found = 0;
+            start = bench_now_ns();
+            for (int i = 0; i < BENCH_TAGS_LOOKUPS; i++) {
+                if (dir_lookup(dir, names[i & (BENCH_PATH_POOL - 1)]) != NULL) found++;
+            }
+            if (found != BENCH_TAGS_LOOKUPS / 2) misses++;
+            printf(" %9.1f", (bench_now_ns() - start) / BENCH_TAGS_LOOKUPS);
+        }
+        printf("\n");
+        tags_select(best);
+    }
+    free(names);
+    printf("  %s\n", misses == 0 ? "correct" : "INCORRECT");
+}
+
+/**
+ * @brief Remplit un tampon de lignes de journal (répétitives, variables par endroits)
+ */
+static void bench_compress_log(char* buffer, long long size) {
+    static const char* levels[] = { "INFO", "INFO", "INFO", "WARN", "DEBUG" };
+    long long done = 0;
+    while (done < size) {
+        char line[160];
+        int length = snprintf(line, sizeof(line),
+                              "2024-05-%02d 10:%02d:%02d %s request id=%06d path=/api/v1/items/%d status=%d\n",
+                              (int)(bench_rand() % 28) + 1, (int)(bench_rand() % 60), (int)(bench_rand() % 60),
+                              levels[bench_rand() % 5], (int)(bench_rand() % 1000000),
+                              (int)(bench_rand() % 5000), bench_rand() % 10 ? 200 : 404);
+        if (length > size - done) length = (int)(size - done);
+        memcpy(buffer + done, line, length);
+        done += length;
+    }
+}
+
+/**
+ * @brief Remplit un tampon d'enregistrements binaires à champs peu variés
+ */
+static void bench_compress_records(char* buffer, long long size) {
+    for (long long i = 0; i + 16 <= size; i += 16) {
+        unsigned int fields[4] = { (unsigned int)(i / 16), 42, (unsigned int)(bench_rand() % 16), 0 };
+        memcpy(buffer + i, fields, sizeof(fields));
+    }
+}
+
+/**
+ * @brief Remplit un tampon d'octets aléatoires (incompressibles)
+ */
+static void bench_compress_random(char* buffer, long long size) {
+    for (long long i = 0; i + 8 <= size; i += 8) {
+        unsigned long long value = bench_rand();
+        memcpy(buffer + i, &value, sizeof(value));
+    }
+}
+
+/**
+ * @brief Écrit puis relit un contenu dans un fichier et mesure les débits
+ *
+ * @param path Fichier à créer
+ * @param content Contenu de BENCH_COMPRESS_SIZE octets
+ * @param write_mbs Reçoit le débit d'écriture (Mo/s)
+ * @param read_mbs Reçoit le débit de lecture (Mo/s)
+ * @return long long Octets stockés (disk_usage), -1 si la relecture diffère
+ */
+static long long bench_compress_file(const char* path, const char* content, double* write_mbs, double* read_mbs) {
+    static char buffer[BENCH_COMPRESS_CHUNK];
+    double megabytes = BENCH_COMPRESS_SIZE / 1048576.0;
+    int correct = 1;
+
+    bench_mute();
+    create_file(path, 644);
+    open_file(path, "rw");
+    double start = bench_now_ns();
+    for (long long offset = 0; offset < BENCH_COMPRESS_SIZE; offset += BENCH_COMPRESS_CHUNK) {
+        pwrite_file(path, content + offset, BENCH_COMPRESS_CHUNK, offset);
+    }
+    *write_mbs = megabytes / ((bench_now_ns() - start) / 1e9);
+
+    start = bench_now_ns();
+    for (long long offset = 0; offset < BENCH_COMPRESS_SIZE; offset += BENCH_COMPRESS_CHUNK) {
+        if (pread_file(path, buffer, BENCH_COMPRESS_CHUNK, offset) != BENCH_COMPRESS_CHUNK ||
+            memcmp(buffer, content + offset, BENCH_COMPRESS_CHUNK) != 0) {
+            correct = 0;
+        }
+    }
+    *read_mbs = megabytes / ((bench_now_ns() - start) / 1e9);
+    close_file(path);
+    bench_unmute();
+
+    DiskUsage usage;
+    if (!correct || disk_usage(path, &usage) != FS_OK) return -1;
+    return usage.stored;
+}
+
+/**
+ * @brief Compare le stockage compressé au stockage en clair
+ *
+ * @details
+ * Pour trois contenus de BENCH_COMPRESS_SIZE octets (lignes de journal,
+ * enregistrements binaires répétitifs, octets aléatoires), écrit puis
+ * relit le fichier par blocs de BENCH_COMPRESS_CHUNK octets, une fois
+ * en clair et une fois dans un répertoire compressé : débits d'écriture
+ * et de lecture, et rapport entre octets stockés et taille du contenu.
+ * Les octets aléatoires mesurent le coût de l'abandon sur un bloc
+ * incompressible.
+ */
+static void bench_compress() {
+    static const struct {
+        const char* name;
+        void (*fill)(char*, long long);
+    } kinds[] = {
+        { "journal", bench_compress_log },
+        { "binaire", bench_compress_records },
+        { "aléatoire", bench_compress_random },
+    };
+    char path[MAX_PATH_LENGTH];
+    char* content = malloc(BENCH_COMPRESS_SIZE);
+    int correct = 1;
+
+    create_directory("/plain", 755);
+    create_directory("/packed", 755);
+    set_compression("/packed", 1);
+    printf("compress: fichiers de %lld Mo écrits puis relus par blocs de %d octets\n",
+           BENCH_COMPRESS_SIZE >> 20, BENCH_COMPRESS_CHUNK);
+    printf("  contenu       stockage   stocké/taille   écriture Mo/s   lecture Mo/s\n");
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        kinds[k].fill(content, BENCH_COMPRESS_SIZE);
+        for (int packed = 0; packed < 2; packed++) {
+            double write_mbs, read_mbs;
+            snprintf(path, sizeof(path), "/%s/%zu", packed ? "packed" : "plain", k);
+            long long stored = bench_compress_file(path, content, &write_mbs, &read_mbs);
+            if (stored < 0) correct = 0;
+            printf("  %-12s  %-9s  %13.3f   %13.0f   %12.0f\n", kinds[k].name,
+                   packed ? "compressé" : "en clair", (double)stored / BENCH_COMPRESS_SIZE, write_mbs, read_mbs);
+        }
+    }
+    free(content);
+    printf("  %s\n", correct ? "correct" : "INCORRECT");
+}
+
+/**
+ * @brief Écrit une bibliothèque dans chaque projet, déduplication active ou non
+ *
+ * @param root Répertoire des projets
+ * @param files Contenus des fichiers de la bibliothèque
+ * @param sizes Tailles de ces contenus
+ * @param physical Reçoit les octets des blocs du tas ajoutés
+ * @return double Durée de l'écriture en ns
+ */
+static double bench_dedup_write(const char* root, char** files, const int* sizes, long long* physical) {
+    char path[MAX_PATH_LENGTH];
+    long long blocks, before, after;
+    data_block_stats(&blocks, &before);
+
+    bench_mute();
+    create_directory(root, 755);
+    double start = bench_now_ns();
+    for (int p = 0; p < BENCH_DEDUP_PROJECTS; p++) {
+        snprintf(path, sizeof(path), "%s/project%02d", root, p);
+        create_directory(path, 755);
+        for (int f = 0; f < BENCH_DEDUP_FILES; f++) {
+            snprintf(path, sizeof(path), "%s/project%02d/lib%02d.c", root, p, f);
+            create_file(path, 644);
+            open_file(path, "w");
+            // Écrit par morceaux, comme un outil d'installation
+            for (int offset = 0; offset < sizes[f]; offset += 1000) {
+                int length = sizes[f] - offset < 1000 ? sizes[f] - offset : 1000;
+                append_file(path, files[f] + offset, length);
+            }
+            close_file(path);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+    bench_unmute();
+
+    data_block_stats(&blocks, &after);
+    *physical = after - before;
+    return elapsed;
+}
+
+/**
+ * @brief Mesure la déduplication des blocs sur une bibliothèque recopiée
+ *
+ * @details
+ * BENCH_DEDUP_PROJECTS projets embarquent chacun la même bibliothèque de
+ * BENCH_DEDUP_FILES fichiers, écrite fichier par fichier par ajouts
+ * successifs (et non par copy_file, qui partage déjà les blocs). Compare
+ * les octets physiques ajoutés et la durée d'écriture, déduplication
+ * inactive puis active, et vérifie le contenu relu.
+ */
+static void bench_dedup() {
+    char* files[BENCH_DEDUP_FILES];
+    int sizes[BENCH_DEDUP_FILES];
+    long long logical = 0;
+    for (int f = 0; f < BENCH_DEDUP_FILES; f++) {
+        sizes[f] = 1 + (int)(bench_rand() % BENCH_DEDUP_MAX_SIZE);
+        files[f] = malloc(sizes[f]);
+        bench_compress_log(files[f], sizes[f]);
+        logical += sizes[f];
+    }
+    logical *= BENCH_DEDUP_PROJECTS;
+
+    long long plain, packed;
+    int saved = fs_dedup;
+    fs_dedup = 0;
+    double plain_ns = bench_dedup_write("/vendor_plain", files, sizes, &plain);
+    fs_dedup = 1;
+    double packed_ns = bench_dedup_write("/vendor_dedup", files, sizes, &packed);
+    fs_dedup = saved;
+
+    int correct = 1;
+    char path[MAX_PATH_LENGTH];
+    static char buffer[BENCH_DEDUP_MAX_SIZE];
+    for (int f = 0; f < BENCH_DEDUP_FILES; f++) {
+        snprintf(path, sizeof(path), "/vendor_dedup/project%02d/lib%02d.c", (int)(bench_rand() % BENCH_DEDUP_PROJECTS), f);
+        bench_mute();
+        open_file(path, "r");
+        long long length = pread_file(path, buffer, sizeof(buffer), 0);
+        close_file(path);
+        bench_unmute();
+        if (length != sizes[f] || memcmp(buffer, files[f], sizes[f]) != 0) correct = 0;
+    }
+    StorageStats stats;
+    storage_stats(&stats);
+
+    printf("dedup: %d projets x %d fichiers écrits par ajouts de 1000 octets, %.1f Mo logiques (%s)\n",
+           BENCH_DEDUP_PROJECTS, BENCH_DEDUP_FILES, logical / 1048576.0, correct ? "correct" : "INCORRECT");
+    printf("  sans déduplication : %8.1f Mo physiques, écriture %8.1f ms\n", plain / 1048576.0, plain_ns / 1e6);
+    printf("  avec déduplication : %8.1f Mo physiques, écriture %8.1f ms (%lld blocs dédupliqués)\n",
+           packed / 1048576.0, packed_ns / 1e6, stats.dedup_hits);
+    for (int f = 0; f < BENCH_DEDUP_FILES; f++) free(files[f]);
+}
+
+/**
+ * @brief Résout des chemins à tour de rôle
+ *
+ * @param paths Chemins, BENCH_SYMLINK_FILES entrées
+ * @param targets Nœuds attendus
+ * @param cold 1 pour invalider les cibles de liens mémorisées avant chaque résolution
+ * @param errors Incrémenté pour chaque résultat inattendu
+ * @return double Durée moyenne d'une résolution en ns
+ */
+static double bench_symlink_pass(char (*paths)[64], FileNode** targets, int cold, long* errors) {
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_SYMLINK_LOOKUPS; i++) {
+        int index = i % BENCH_SYMLINK_FILES;
+        if (cold) dcache_link_flush();
+        if (get_file_by_path(paths[index]) != targets[index]) (*errors)++;
+    }
+    return (bench_now_ns() - start) / BENCH_SYMLINK_LOOKUPS;
+}
+
+/**
+ * @brief Mesure la résolution des chemins à travers une ferme de liens symboliques
+ *
+ * @details
+ * BENCH_SYMLINK_FILES fichiers rangés sous BENCH_SYMLINK_PREFIX sont
+ * chacun désignés par une chaîne de BENCH_SYMLINK_CHAIN liens absolus,
+ * de /farm/link_N jusqu'au fichier. Compare la résolution du chemin réel
+ * (cache de résolution), celle du lien de tête sans puis avec les cibles
+ * mémorisées, et la détection d'une boucle.
+ */
+static void bench_symlink() {
+    char path[MAX_PATH_LENGTH] = "";
+    char (*direct)[64] = malloc(BENCH_SYMLINK_FILES * sizeof(*direct));
+    char (*linked)[64] = malloc(BENCH_SYMLINK_FILES * sizeof(*linked));
+    FileNode** targets = malloc(BENCH_SYMLINK_FILES * sizeof(FileNode*));
+
+    bench_mute();
+    snprintf(path, sizeof(path), "%s/", BENCH_SYMLINK_PREFIX);
+    for (char* slash = strchr(path + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        create_directory(path, 755);
+        *slash = '/';
+    }
+    create_directory("/farm", 755);
+    change_directory("/farm");
+    for (int f = 0; f < BENCH_SYMLINK_FILES; f++) {
+        snprintf(direct[f], sizeof(direct[f]), BENCH_SYMLINK_PREFIX "/file_%03d", f);
+        create_file(direct[f], 644);
+        targets[f] = get_file_by_path(direct[f]);
+        // Chaîne : link_N -> hop1_N -> ... -> fichier
+        char name[32], target[64];
+        snprintf(target, sizeof(target), "%s", direct[f]);
+        for (int hop = BENCH_SYMLINK_CHAIN - 1; hop >= 0; hop--) {
+            if (hop == 0) snprintf(name, sizeof(name), "link_%03d", f);
+            else snprintf(name, sizeof(name), "hop%d_%03d", hop, f);
+            create_symbolic_link(target, name);
+            snprintf(target, sizeof(target), "/farm/%s", name);
+        }
+        snprintf(linked[f], sizeof(linked[f]), "%s", target);
+    }
+    create_symbolic_link("/farm/loop_b", "loop_a");
+    create_symbolic_link("/farm/loop_a", "loop_b");
+    change_directory("/");
+    bench_unmute();
+
+    long errors = 0;
+    double direct_ns = bench_symlink_pass(direct, targets, 0, &errors);
+    double cold_ns = bench_symlink_pass(linked, targets, 1, &errors);
+    double warm_ns = bench_symlink_pass(linked, targets, 0, &errors);
+
+    FileInfo info;
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_SYMLINK_LOOKUPS / 100; i++) {
+        if (stat_file("/farm/loop_a", &info) != FS_ERR_LOOP) errors++;
+    }
+    double loop_ns = (bench_now_ns() - start) / (BENCH_SYMLINK_LOOKUPS / 100);
+
+    // Une suppression invalide les cibles mémorisées
+    bench_mute();
+    delete_file(direct[0]);
+    bench_unmute();
+    if (get_file_by_path(linked[0]) != NULL || real_path(linked[1], path) != FS_OK ||
+        strcmp(path, direct[1]) != 0) {
+        errors++;
+    }
+    // Un lien désigné par un chemin absolu rejoint son répertoire, pas le répertoire courant
+    bench_mute();
+    int placed = create_symbolic_link(direct[1], "/farm/absolute") == FS_OK &&
+                 create_hard_link(direct[2], "/farm/hard") == FS_OK &&
+                 create_symbolic_link(direct[1], "/missing/absolute") == FS_ERR_INVALID_PATH;
+    bench_unmute();
+    if (!placed || get_file_by_path("/farm/absolute") != targets[1] ||
+        stat_file("/farm/hard", &info) != FS_OK || info.links != 2) {
+        errors++;
+    }
+    free(direct);
+    free(linked);
+    free(targets);
+
+    printf("symlink: %d fichiers à 8 niveaux, chaînes de %d liens (%s)\n",
+           BENCH_SYMLINK_FILES, BENCH_SYMLINK_CHAIN, errors == 0 ? "correct" : "INCORRECT");
+    printf("  chemin réel               : %8.1f ns/résolution\n", direct_ns);
+    printf("  lien, cibles à résoudre   : %8.1f ns/résolution\n", cold_ns);
+    printf("  lien, cibles mémorisées   : %8.1f ns/résolution (x%.1f)\n", warm_ns, cold_ns / warm_ns);
+    printf("  boucle détectée (stat)    : %8.1f ns\n", loop_ns);
+}
+
+/**
+ * @brief Page d'un parcours trié (visiteur de list_directory_sorted)
+ */
+typedef struct {
+    char names[BENCH_ORDER_PAGE][MAX_NAME_LENGTH]; /**< Noms reçus */
+    int count;                      /**< Nombre de noms reçus */
+} BenchOrderPage;
+
+/**
+ * @brief Recopie un nom dans une page, arrête le parcours quand elle est pleine (DirVisitor)
+ */
+static int bench_order_collect(const char* name, const FileInfo* info, void* arg) {
+    BenchOrderPage* page = arg;
+    snprintf(page->names[page->count++], MAX_NAME_LENGTH, "%s", name);
+    return page->count == BENCH_ORDER_PAGE;
+}
+
+/**
+ * @brief Noms recopiés par bench_order_gather
+ */
+typedef struct {
+    char* names;                    /**< Tampon de MAX_NAME_LENGTH octets par nom */
+    int count;                      /**< Nombre de noms recopiés */
+} BenchOrderNames;
+
+/**
+ * @brief Recopie tous les noms d'un répertoire (DirVisitor)
+ */
+static int bench_order_gather(const char* name, const FileInfo* info, void* arg) {
+    BenchOrderNames* gathered = arg;
+    snprintf(gathered->names + (size_t)gathered->count++ * MAX_NAME_LENGTH, MAX_NAME_LENGTH, "%s", name);
+    return 0;
+}
+
+/**
+ * @brief Compare deux noms (pour qsort)
+ */
+static int bench_order_compare(const void* left, const void* right) {
+    return strcmp(left, right);
+}
+
+/**
+ * @brief Page lue sans index : recopie, trie tout le répertoire, puis cherche le départ
+ *
+ * @param after Nom à partir duquel reprendre (exclu)
+ * @param names Tampon de BENCH_ORDER_ENTRIES noms
+ * @return int Nombre d'entrées de la page
+ */
+static int bench_order_sorted_page(const char* after, char* names) {
+    BenchOrderNames gathered = { names, 0 };
+    list_directory("/sorted", bench_order_gather, &gathered);
+    int count = gathered.count;
+    qsort(names, count, MAX_NAME_LENGTH, bench_order_compare);
+    int low = 0, high = count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (strcmp(names + (size_t)middle * MAX_NAME_LENGTH, after) <= 0) low = middle + 1;
+        else high = middle;
+    }
+    return count - low < BENCH_ORDER_PAGE ? count - low : BENCH_ORDER_PAGE;
+}
+
+/**
+ * @brief Mesure les parcours dans l'ordre des noms d'un grand répertoire
+ *
+ * @details
+ * /sorted reçoit BENCH_ORDER_ENTRIES fichiers créés dans un ordre
+ * aléatoire. Compare une page de BENCH_ORDER_PAGE entrées obtenue en
+ * triant tout le répertoire à chaque fois et par list_directory_sorted
+ * (index ordonné construit au premier appel), mesure une énumération par
+ * préfixe et le surcoût des créations dans un répertoire indexé, puis
+ * vérifie qu'une pagination complète rend chaque nom une fois, dans l'ordre.
+ */
+static void bench_order() {
+    char path[MAX_PATH_LENGTH];
+    int* order = malloc(BENCH_ORDER_ENTRIES * sizeof(int));
+    for (int i = 0; i < BENCH_ORDER_ENTRIES; i++) order[i] = i;
+    for (int i = BENCH_ORDER_ENTRIES - 1; i > 0; i--) {
+        int j = (int)(bench_rand() % (i + 1));
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    bench_mute();
+    create_directory("/sorted", 755);
+    for (int i = 0; i < BENCH_ORDER_ENTRIES; i++) {
+        snprintf(path, sizeof(path), "/sorted/f_%07d", order[i]);
+        create_file(path, 644);
+    }
+    bench_unmute();
+
+    char* names = malloc((size_t)BENCH_ORDER_ENTRIES * MAX_NAME_LENGTH);
+    char after[MAX_NAME_LENGTH];
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_ORDER_SORTS; i++) {
+        snprintf(after, sizeof(after), "f_%07d", (int)(bench_rand() % BENCH_ORDER_ENTRIES));
+        bench_order_sorted_page(after, names);
+    }
+    double sort_ns = (bench_now_ns() - start) / BENCH_ORDER_SORTS;
+    free(names);
+
+    BenchOrderPage* page = malloc(sizeof(BenchOrderPage));
+    page->count = 0;
+    start = bench_now_ns();
+    list_directory_sorted("/sorted", NULL, NULL, bench_order_collect, page);
+    double build_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_ORDER_PAGES; i++) {
+        snprintf(after, sizeof(after), "f_%07d", (int)(bench_rand() % BENCH_ORDER_ENTRIES));
+        page->count = 0;
+        list_directory_sorted("/sorted", after, NULL, bench_order_collect, page);
+    }
+    double page_ns = (bench_now_ns() - start) / BENCH_ORDER_PAGES;
+
+    int prefixed = 0;
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_ORDER_PAGES; i++) {
+        snprintf(after, sizeof(after), "f_0%04d", (int)(bench_rand() % (BENCH_ORDER_ENTRIES / 100)));
+        page->count = 0;
+        list_directory_sorted("/sorted", NULL, after, bench_order_collect, page);
+        prefixed += page->count;
+    }
+    double prefix_ns = (bench_now_ns() - start) / BENCH_ORDER_PAGES;
+
+    // Créations dans un répertoire sans index puis dans un répertoire indexé
+    double create_ns[2];
+    for (int indexed = 0; indexed < 2; indexed++) {
+        const char* dir = indexed ? "/created_sorted" : "/created_plain";
+        create_directory(dir, 755);
+        if (indexed) list_directory_sorted(dir, NULL, NULL, bench_order_collect, page);
+        bench_mute();
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_ORDER_CREATES; i++) {
+            snprintf(path, sizeof(path), "%s/f_%07d", dir, order[i]);
+            create_file(path, 644);
+        }
+        create_ns[indexed] = (bench_now_ns() - start) / BENCH_ORDER_CREATES;
+        bench_unmute();
+    }
+
+    // Pagination complète : chaque nom une fois, strictement croissant
+    int errors = prefixed != BENCH_ORDER_PAGES * 100;
+    long seen = 0;
+    char last[MAX_NAME_LENGTH] = "";
+    do {
+        page->count = 0;
+        list_directory_sorted("/sorted", seen ? last : NULL, NULL, bench_order_collect, page);
+        for (int i = 0; i < page->count; i++) {
+            if (seen > 0 && strcmp(page->names[i], last) <= 0) errors++;
+            snprintf(last, sizeof(last), "%s", page->names[i]);
+            seen++;
+        }
+    } while (page->count == BENCH_ORDER_PAGE);
+    if (seen != BENCH_ORDER_ENTRIES) errors++;
+    free(page);
+    free(order);
+
+    printf("order: %d entrées créées dans un ordre aléatoire, pages de %d (%s)\n",
+           BENCH_ORDER_ENTRIES, BENCH_ORDER_PAGE, errors == 0 ? "correct" : "INCORRECT");
+    printf("  page en triant le répertoire : %10.1f us\n", sort_ns / 1e3);
+    printf("  construction de l'index      : %10.1f us (premier appel)\n", build_ns / 1e3);
+    printf("  page après un nom (index)    : %10.2f us\n", page_ns / 1e3);
+    printf("  énumération d'un préfixe     : %10.2f us (100 entrées)\n", prefix_ns / 1e3);
+    printf("  création sans / avec index   : %10.2f / %.2f us\n", create_ns[0] / 1e3, create_ns[1] / 1e3);
+}
+
+/**
+ * @brief Cumule l'occupation des entrées trouvées (FindVisitor de bench_usage)
+ */
+static int bench_usage_sum(const char* path, const FileInfo* info, void* arg) {
+    DiskUsage* usage = arg;
+    if (info->type == DIRECTORY_TYPE) {
+        usage->directories++;
+    } else {
+        usage->files++;
+        usage->bytes += info->size;
+    }
+    return 0;
+}
+
+/**
+ * @brief Mesure ce que coûte la mise à jour de l'écriture
+ *
+ * @param path Fichier ouvert en écriture, vide
+ * @return double Durée moyenne d'une écriture en fin de fichier (ns)
+ */
+static double bench_usage_append(const char* path) {
+    char chunk[BENCH_USAGE_WRITE_SIZE];
+    memset(chunk, 'u', sizeof(chunk));
+    double start = bench_now_ns();
+    for (int i = 0; i < BENCH_USAGE_WRITES; i++) {
+        pwrite_file(path, chunk, sizeof(chunk), (long long)i * sizeof(chunk));
+    }
+    return (bench_now_ns() - start) / BENCH_USAGE_WRITES;
+}
+
+/**
+ * @brief Mesure du et df en temps constant et le coût des quotas
+ *
+ * @details
+ * Construit /u : BENCH_USAGE_DIRS répertoires de BENCH_USAGE_SUB_DIRS
+ * sous-répertoires de BENCH_USAGE_FILES fichiers, dont un par
+ * sous-répertoire a un contenu. Compare un parcours complet (ce que
+ * coûtait du, mesuré ici par find_files) à la lecture des compteurs
+ * tenus à jour (disk_usage, disk_free), puis des écritures en fin de
+ * fichier sans quota et sous les quotas de deux ancêtres. Vérifie que
+ * les compteurs égalent le parcours et qu'un quota atteint refuse
+ * l'écriture suivante.
+ */
+static void bench_usage() {
+    char path[MAX_PATH_LENGTH];
+    bench_mute();
+    create_directory("/u", 755);
+    for (int d = 0; d < BENCH_USAGE_DIRS; d++) {
+        snprintf(path, sizeof(path), "/u/d%04d", d);
+        create_directory(path, 755);
+        for (int s = 0; s < BENCH_USAGE_SUB_DIRS; s++) {
+            snprintf(path, sizeof(path), "/u/d%04d/s%02d", d, s);
+            create_directory(path, 755);
+            for (int f = 0; f < BENCH_USAGE_FILES; f++) {
+                snprintf(path, sizeof(path), "/u/d%04d/s%02d/f%03d", d, s, f);
+                create_file(path, 644);
+            }
+            snprintf(path, sizeof(path), "/u/d%04d/s%02d/f000", d, s);
+            open_file(path, "w");
+            write_file(path, path);
+            close_file(path);
+        }
+    }
+    bench_unmute();
+
+    DiskUsage walked = { 0, 0, 0, 0 };
+    FindQuery query = { NULL, -1, -1, -1 };
+    double start = bench_now_ns();
+    find_files("/u", &query, bench_usage_sum, &walked);
+    double walk_ms = (bench_now_ns() - start) / 1e6;
+
+    DiskUsage usage;
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_USAGE_READS; i++) disk_usage("/u", &usage);
+    double du_ns = (bench_now_ns() - start) / BENCH_USAGE_READS;
+
+    DiskFree info;
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_USAGE_READS; i++) disk_free("/u/d0500/s05", &info);
+    double df_ns = (bench_now_ns() - start) / BENCH_USAGE_READS;
+
+    int errors = usage.files != walked.files || usage.directories != walked.directories ||
+                 usage.bytes != walked.bytes;
+
+    // Écritures qui agrandissent le fichier, sans puis sous quotas
+    double append_ns[2];
+    long long total = (long long)BENCH_USAGE_WRITES * BENCH_USAGE_WRITE_SIZE;
+    for (int quota = 0; quota < 2; quota++) {
+        snprintf(path, sizeof(path), "/u/d%04d/s01/append", quota);
+        if (quota) {
+            set_quota("/u", usage.bytes + 2 * total, 0);
+            set_quota("/u/d0001", total + 4096, usage.files + usage.directories);
+        }
+        bench_mute();
+        create_file(path, 644);
+        open_file(path, "w");
+        bench_unmute();
+        append_ns[quota] = bench_usage_append(path);
+        // Le quota de /u/d0001 est presque atteint : la suite est refusée
+        if (quota && pwrite_file(path, path, 4096, total) != FS_ERR_QUOTA) errors++;
+        bench_mute();
+        close_file(path);
+        bench_unmute();
+    }
+    disk_free("/u/d0001/s01", &info);
+    if (info.avail_bytes < 0 || info.avail_bytes > 4096) errors++;
+    set_quota("/u", 0, 0);
+    set_quota("/u/d0001", 0, 0);
+
+    printf("usage: %lld répertoires, %lld fichiers (%s)\n",
+           walked.directories, walked.files, errors == 0 ? "correct" : "INCORRECT");
+    printf("  parcours complet (ancien du) : %10.1f ms\n", walk_ms);
+    printf("  du (compteurs tenus à jour)  : %10.1f ns\n", du_ns);
+    printf("  df (profondeur 3)            : %10.1f ns\n", df_ns);
+    printf("  écriture sans / sous quotas  : %10.1f / %.1f ns (%d octets)\n",
+           append_ns[0], append_ns[1], BENCH_USAGE_WRITE_SIZE);
+}
+
+/**
+ * @brief Description d'un benchmark exécutable
+ */
+typedef struct {
+    const char* name;               /**< Nom passé en ligne de commande */
+    void (*run)();                  /**< Fonction de mesure */
+} Benchmark;
+
+/** @brief Table des benchmarks disponibles */
+static const Benchmark benchmarks[] = {
+    { "lookup", bench_lookup },
+    { "nodes", bench_nodes },
+    { "image", bench_image },
+    { "journal", bench_journal },
+    { "extents", bench_extents },
+    { "copy", bench_copy },
+    { "move", bench_move },
+    { "threads", bench_threads },
+    { "sessions", bench_sessions },
+    { "handles", bench_handles },
+    { "dcache", bench_dcache },
+    { "batch", bench_batch },
+    { "readdir", bench_readdir },
+    { "walk", bench_walk },
+    { "names", bench_names },
+    { "tags", bench_tags },
+    { "compress", bench_compress },
+    { "dedup", bench_dedup },
+    { "order", bench_order },
+    { "usage", bench_usage },
+    { "symlink", bench_symlink },
+    { "teardown", bench_teardown },
+};
+
+/**
+ * @brief Point d'entrée des benchmarks
+ *
+ * @param argc Nombre d'arguments
+ * @param argv Noms des benchmarks à exécuter (tous si aucun)
+ * @return int 0 en cas de succès, 1 si un nom est inconnu
+ */
+int main(int argc, char* argv[]) {
+    char workdir[] = "/tmp/fs_bench_XXXXXX";
+    if (mkdtemp(workdir) == NULL || chdir(workdir) != 0) {
+        perror("Erreur lors de la création du répertoire temporaire");
+        return 1;
+    }
+
+    int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        int selected = argc < 2;
+        for (int a = 1; a < argc; a++) {
+            if (strcmp(argv[a], benchmarks[i].name) == 0) selected = 1;
+        }
+        if (!selected) continue;
+
+        // Chaque benchmark repart d'un système de fichiers vide
+        if (root_directory != NULL) {
+            tree_release();
+            close(fs_fd);
+        }
+        unlink(FS_FILENAME);
+        unlink(FS_JOURNAL_FILENAME);
+        init_file_system();
+        // Les arborescences synthétiques ne sont pas journalisées
+        journal_close();
+        benchmarks[i].run();
+    }
+
+    for (int a = 1; a < argc; a++) {
+        int known = 0;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(argv[a], benchmarks[i].name) == 0) known = 1;
+        }
+        if (!known) {
+            fprintf(stderr, "Benchmark inconnu : %s\n", argv[a]);
+            status = 1;
+        }
+    }
+
+    unlink(FS_FILENAME);
+    unlink(FS_JOURNAL_FILENAME);
+    rmdir(workdir);
+    return status;
+}
@@ -9,6 +9,45 @@
  * - Liens durs et symboliques
  * - Persistance des données
  *
+ * Aucune fonction n'affiche de message : les erreurs sont renvoyées sous
+ * forme de codes FsError (voir fs_strerror), les messages et l'affichage
+ * des résultats appartiennent à l'interface en ligne de commande
+ * (fs_cli.c).
+ *
+ * Concurrence : les opérations publiques peuvent être appelées depuis
+ * plusieurs threads. Les verrous, toujours pris dans cet ordre, sont :
+ * - fs_tree_lock : pris en lecture par toutes les opérations, en
+ *   écriture par celles qui libèrent des nœuds (delete_file), changent
+ *   des chemins déjà résolus (move_file) ou lisent l'arborescence entière
+ *   (save_file_system). Un nœud trouvé sous ce verrou ne peut donc pas
+ *   être libéré, ni son chemin journalisé devenir faux, avant la fin de
+ *   l'opération
+ * - le verrou de chaque répertoire (DirData::lock) : protège ses
+ *   enfants et leur état (permissions, ouverture). La résolution d'un
+ *   chemin le prend en lecture, répertoire après répertoire, sans en
+ *   détenir deux à la fois ; un déplacement verrouille ses deux
+ *   répertoires par ordre d'adresse
+ * - le verrou de chaque contenu (FileData::lock) : lectures en parallèle,
+ *   un seul écrivain
+ * - fs_rename_lock : protège les noms et les parents des nœuds pendant
+ *   un déplacement et la construction d'un chemin ; rien n'est
+ *   verrouillé après lui
+ * - les verrous du cache de résolution (voir fs_dcache.c), pris seuls le
+ *   temps d'une recherche, d'une insertion ou d'une invalidation
+ * Les lecteurs et les écrivains de sous-arbres disjoints ne se bloquent
+ * donc pas. Chaque opération journalise avant de relâcher les verrous
+ * qui rendent son effet visible, de sorte que le journal respecte
+ * l'ordre des opérations dépendantes.
+ *
+ * L'initialisation, le chargement, la sauvegarde finale et
+ * tree_release() se font hors de toute concurrence.
+ *
+ * Sessions : le répertoire de travail et la table des descripteurs
+ * sont propres à chaque session (voir fs_internal.h) et ne sont donc
+ * pas verrouillés. Un nœud retenu par une session (open_count) et
+ * supprimé par une autre est seulement détaché ; le dernier qui le
+ * relâche le libère.
+ *
  * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
  * @date 2024
  */
@@ -22,8 +61,10 @@
 #include <fcntl.h>      /**< Pour les opérations sur les fichiers (open, O_RDWR) */
 #include <unistd.h>     /**< Pour les opérations système (read, write, close) */
 #include <sys/stat.h>   /**< Pour les permissions des fichiers */
-#include <ctype.h>      /**< Pour le traitement des caractères (isspace) */
+#include <errno.h>      /**< Pour errno (erreurs d'entrée/sortie) */
+#include <fnmatch.h>    /**< Pour les motifs de noms de find_files */
 #include "file_manager.h" /**< Définitions des structures et constantes */
+#include "fs_internal.h"  /**< Fonctions internes partagées entre modules */
 
 /**
  * @brief Variables globales du système de fichiers
@@ -32,142 +73,1257 @@
 /** @brief Répertoire racine du système de fichiers */
 FileNode* root_directory = NULL;
 
-/** @brief Répertoire de travail actuel */
-FileNode* current_directory = NULL;
+/** @brief Session des threads qui n'en ont pas attaché (interface en ligne de commande) */
+static Session fs_default_session;
+
+/** @brief Session attachée au thread appelant, NULL pour la session par défaut */
+static _Thread_local Session* fs_thread_session;
 
 /** @brief Descripteur de fichier pour le stockage persistant */
 int fs_fd;
 
+/** @brief Génération de l'image chargée ou écrite en dernier */
+uint32_t fs_generation = 0;
+
+/** @brief Mode de chargement de l'image (projection par défaut) */
+LoadMode fs_load_mode = LOAD_MMAP;
+
+/** @brief Verrou de l'arborescence (voir « Concurrence » en tête de fichier) */
+static pthread_rwlock_t fs_tree_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/** @brief Verrou des déplacements : noms et parents des nœuds rattachés */
+static pthread_mutex_t fs_rename_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Index haché des répertoires
+ *
+ * Chaque répertoire possède une table à adressage ouvert (sondage linéaire)
+ * qui associe le nom d'un enfant à son nœud. L'empreinte du nom est stockée
+ * dans l'emplacement, à côté du pointeur et de la longueur du nom, ce qui
+ * permet d'écarter presque tous les candidats sans déréférencer le nœud :
+ * seul un candidat de même empreinte et de même longueur est comparé.
+ * Un tableau contigu d'étiquettes d'un octet (une par emplacement)
+ * précède même la lecture des emplacements : la recherche en compare
+ * 8 à 32 d'un coup (voir fs_tags.c).
+ * Le tableau children de DirData reste la référence pour l'ordre d'insertion.
+ */
+
+/** @brief Capacité minimale d'un index de répertoire (puissance de 2) */
+#define DIR_INDEX_MIN_CAPACITY 8
+
+/** @brief Capacité initiale du tableau des enfants d'un répertoire */
+#define DIR_MIN_CAPACITY 4
+
+/**
+ * @brief Emplacement d'un index de répertoire
+ */
+typedef struct DirIndexSlot {
+    unsigned int hash;              /**< Empreinte du nom de l'entrée */
+    unsigned int length;            /**< Longueur du nom de l'entrée */
+    FileNode* node;                 /**< Nœud indexé (NULL = emplacement libre) */
+} DirIndexSlot;
+
+/**
+ * @brief Table de hachage des enfants d'un répertoire
+ */
+struct DirIndex {
+    unsigned int capacity;          /**< Nombre d'emplacements (puissance de 2) */
+    unsigned int used;              /**< Emplacements occupés, pierres tombales comprises */
+    unsigned char* tags;            /**< Étiquette de chaque emplacement, suivie de TAG_GROUP_MAX octets */
+    DirIndexSlot slots[];           /**< Emplacements de la table */
+};
+
+/** @brief Nœud sentinelle marquant un emplacement supprimé */
+static FileNode dir_index_tombstone;
+#define DIR_INDEX_TOMBSTONE (&dir_index_tombstone)
+
+/**
+ * @brief Calcule l'empreinte d'un nom de longueur donnée (FNV-1a 32 bits)
+ *
+ * @param name Début du nom (pas forcément terminé par '\0')
+ * @param len Nombre d'octets à hacher
+ * @return unsigned int Empreinte du nom
+ */
+static unsigned int hash_name_n(const char* name, size_t len) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Relâche le nom d'un nœud, sauf s'il est emprunté à l'image
+ *
+ * @param node Nœud concerné
+ */
+static void node_drop_name(FileNode* node) {
+    if (node->name != NULL && !(node->flags & NODE_NAME_MAPPED)) {
+        name_release(node->name);
+    }
+}
+
+/**
+ * @brief Étiquette d'un nom dans l'index d'un répertoire
+ *
+ * @param hash Empreinte du nom
+ * @return unsigned char Bits de poids fort de l'empreinte (ceux de poids
+ *         faible choisissent l'emplacement), rendus impairs pour ne
+ *         jamais valoir TAG_EMPTY ni TAG_TOMBSTONE
+ */
+static unsigned char dir_tag(unsigned int hash) {
+    return (unsigned char)((hash >> 24) | 1);
+}
+
+/**
+ * @brief Remplace le nom d'un nœud par une copie déjà internée
+ *
+ * @param node Nœud à nommer
+ * @param copy Nom renvoyé par name_intern, dont le nœud prend la référence
+ * @param len Longueur du nom
+ * @param hash Empreinte du nom
+ *
+ * @details
+ * Ne peut pas échouer : le déplacement interne le nouveau nom avant de
+ * modifier l'arborescence, puis l'affecte ici.
+ */
+static void node_take_name(FileNode* node, const char* copy, size_t len, unsigned int hash) {
+    node_drop_name(node);
+    node->name = (char*)copy;
+    node->name_length = (unsigned char)len;
+    node->name_hash = hash;
+    node->flags &= ~NODE_NAME_MAPPED;
+}
+
+/**
+ * @brief Affecte le nom d'un nœud et met à jour son empreinte
+ *
+ * @param node Nœud à nommer
+ * @param name Nouveau nom (moins de MAX_NAME_LENGTH caractères)
+ * @return int 0 en cas de succès, -1 si le nom est trop long ou si
+ *         l'allocation échoue
+ */
+static int node_set_name(FileNode* node, const char* name) {
+    size_t len = strlen(name);
+    if (len >= MAX_NAME_LENGTH) return -1;
+    unsigned int hash = hash_name_n(name, len);
+    const char* copy = name_intern(name, len, hash);
+    if (copy == NULL) return -1;
+    node_take_name(node, copy, len, hash);
+    return 0;
+}
+
+/**
+ * @brief Alloue un nœud vierge et, pour un répertoire, son DirData
+ *
+ * @param type Type du nœud (FILE_TYPE ou DIRECTORY_TYPE)
+ * @param permissions Permissions (format octal)
+ * @return FileNode* Nouveau nœud sans nom, NULL si l'allocation échoue
+ */
+static FileNode* node_alloc_blank(FileType type, int permissions) {
+    FileNode* node = small_alloc(sizeof(FileNode));
+    if (node == NULL) return NULL;
+    memset(node, 0, sizeof(FileNode));
+
+    if (type == DIRECTORY_TYPE) {
+        node->dir_data = small_alloc(sizeof(DirData));
+        if (node->dir_data == NULL) {
+            small_free(node, sizeof(FileNode));
+            return NULL;
+        }
+        memset(node->dir_data, 0, sizeof(DirData));
+        node->dir_data->usage.directories = 1;
+        pthread_rwlock_init(&node->dir_data->lock, NULL);
+    }
+    node->type = type;
+    node->permissions = permissions;
+    return node;
+}
+
+/**
+ * @brief Alloue et initialise un nœud détaché de l'arborescence
+ *
+ * Point de création unique des nœuds : les répertoires reçoivent ici
+ * leur DirData, les fichiers n'en ont pas. Le nœud et son DirData sont
+ * alloués dans les dalles (voir fs_alloc.c), le nom est interné (voir
+ * fs_names.c).
+ *
+ * @param name Nom du nœud
+ * @param type Type du nœud (FILE_TYPE ou DIRECTORY_TYPE)
+ * @param permissions Permissions (format octal)
+ * @return FileNode* Nouveau nœud, NULL si l'allocation échoue
+ */
+FileNode* node_alloc(const char* name, FileType type, int permissions) {
+    FileNode* node = node_alloc_blank(type, permissions);
+    if (node == NULL) return NULL;
+
+    if (node_set_name(node, name) != 0) {
+        node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+/**
+ * @brief Alloue un nœud dont le nom est emprunté à l'image projetée
+ *
+ * @param name Nom terminé par '\0', qui doit survivre au nœud
+ * @param len Longueur du nom
+ * @param type Type du nœud (FILE_TYPE ou DIRECTORY_TYPE)
+ * @param permissions Permissions (format octal)
+ * @return FileNode* Nouveau nœud, NULL si l'allocation échoue
+ *
+ * @details
+ * Le nom n'est pas recopié : il ne le sera que si le nœud est renommé.
+ */
+FileNode* node_alloc_mapped(const char* name, size_t len, FileType type, int permissions) {
+    FileNode* node = node_alloc_blank(type, permissions);
+    if (node == NULL) return NULL;
+
+    node->name = (char*)name;
+    node->name_length = (unsigned char)len;
+    node->name_hash = hash_name_n(name, len);
+    node->flags = NODE_NAME_MAPPED;
+    return node;
+}
+
+/**
+ * @brief Libère les ressources d'un nœud qui ne sont pas dans les dalles
+ *
+ * @param node Nœud concerné
+ *
+ * @details
+ * Tableau des enfants, index, contenu et cibles de liens de plus de
+ * SMALL_MAX_SIZE octets (les noms sont libérés par names_reset()).
+ * Utilisée seule par tree_release(), qui libère ensuite les dalles en
+ * bloc.
+ */
+static void node_release_heap(FileNode* node) {
+    if (node->dir_data != NULL) {
+        free(node->dir_data->children);
+        free(node->dir_data->child_seqs);
+        free(node->dir_data->index);
+        order_free(node->dir_data->order);
+    }
+    data_release(node->data);
+    if (node->symlink_target != NULL && !(node->flags & NODE_SYMLINK_MAPPED) &&
+        strlen(node->symlink_target) + 1 > SMALL_MAX_SIZE) {
+        free(node->symlink_target);
+    }
+}
+
+/**
+ * @brief Libère un nœud isolé (sans ses enfants)
+ *
+ * @param node Nœud à libérer
+ *
+ * @details
+ * Un fichier dont le contenu garde d'autres liens est retiré de la liste
+ * de ses noms (voir usage_charge).
+ */
+void node_free(FileNode* node) {
+    FileData* data = node->data;
+    if (data != NULL && __atomic_load_n(&data->links, __ATOMIC_ACQUIRE) > 1) {
+        pthread_rwlock_wrlock(&data->lock);
+        data_remove_name(data, node);
+        pthread_rwlock_unlock(&data->lock);
+    }
+    if (node->dir_data != NULL) {
+        free(node->dir_data->children);
+        free(node->dir_data->child_seqs);
+        free(node->dir_data->index);
+        order_free(node->dir_data->order);
+        pthread_rwlock_destroy(&node->dir_data->lock);
+        small_free(node->dir_data, sizeof(DirData));
+    }
+    data_release(node->data);
+    if (node->symlink_target != NULL && !(node->flags & NODE_SYMLINK_MAPPED)) {
+        small_free(node->symlink_target, strlen(node->symlink_target) + 1);
+    }
+    node_drop_name(node);
+    small_free(node, sizeof(FileNode));
+}
+
+/**
+ * @brief Insère un nœud dans une table qui dispose de place libre
+ *
+ * @param index Table de destination
+ * @param node Nœud à insérer (son empreinte doit être à jour)
+ */
+static void dir_index_place(struct DirIndex* index, FileNode* node) {
+    unsigned int mask = index->capacity - 1;
+    unsigned int i = node->name_hash & mask;
+
+    while (index->slots[i].node != NULL && index->slots[i].node != DIR_INDEX_TOMBSTONE) {
+        i = (i + 1) & mask;
+    }
+    if (index->slots[i].node == NULL) {
+        index->used++;
+    }
+    index->slots[i].hash = node->name_hash;
+    index->slots[i].length = node->name_length;
+    index->slots[i].node = node;
+    index->tags[i] = dir_tag(node->name_hash);
+}
+
+/**
+ * @brief Garantit que l'index peut accueillir de nouvelles entrées
+ *
+ * @param dir Répertoire concerné
+ * @param extra Nombre d'insertions à venir
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * - Le facteur de charge (pierres tombales comprises) reste sous 3/4
+ * - La table est reconstruite à partir du tableau children, ce qui
+ *   élimine au passage les pierres tombales
+ */
+static int dir_index_reserve(DirData* dir, unsigned int extra) {
+    struct DirIndex* index = dir->index;
+    if (index != NULL && (index->used + extra) * 4 <= index->capacity * 3) {
+        return 0;
+    }
+
+    unsigned int capacity = DIR_INDEX_MIN_CAPACITY;
+    while (capacity < (dir->child_count + extra) * 2) {
+        capacity *= 2;
+    }
+
+    struct DirIndex* rebuilt = calloc(1, sizeof(struct DirIndex) + capacity * sizeof(DirIndexSlot) +
+                                         capacity + TAG_GROUP_MAX);
+    if (rebuilt == NULL) return -1;
+    rebuilt->capacity = capacity;
+    rebuilt->tags = (unsigned char*)(rebuilt->slots + capacity);
+    for (int i = 0; i < dir->child_count; i++) {
+        dir_index_place(rebuilt, dir->children[i]);
+    }
+
+    free(index);
+    dir->index = rebuilt;
+    return 0;
+}
+
+/**
+ * @brief Recherche un enfant dans un répertoire verrouillé et matérialisé
+ *
+ * @param data Répertoire dans lequel chercher (verrou détenu par l'appelant)
+ * @param name Début du nom de l'entrée recherchée
+ * @param len Longueur du nom
+ * @return FileNode* Nœud trouvé, NULL s'il n'existe pas
+ *
+ * @details
+ * - Sonde la table par groupes de tag_kernel->width étiquettes ; un
+ *   groupe qui déborde de la table est tronqué, le suivant repart de 0
+ * - Seuls les emplacements d'étiquette égale situés avant le premier
+ *   emplacement libre sont examinés ; la table n'étant jamais pleine
+ *   (voir dir_index_reserve), la recherche se termine
+ */
+static FileNode* dir_find(const DirData* data, const char* name, size_t len) {
+    const struct DirIndex* index = data->index;
+    if (index == NULL || len >= MAX_NAME_LENGTH) return NULL;
+
+    unsigned int hash = hash_name_n(name, len);
+    unsigned char tag = dir_tag(hash);
+    const TagKernel* kernel = tag_kernel;
+    unsigned int mask = index->capacity - 1;
+    for (unsigned int i = hash & mask; ; ) {
+        unsigned int width = index->capacity - i < kernel->width ? index->capacity - i : kernel->width;
+        unsigned int valid = width >= 32 ? ~0u : (1u << width) - 1;
+        unsigned int empty;
+        unsigned int match = kernel->match(index->tags + i, tag, &empty) & valid;
+        empty &= valid;
+        if (empty != 0) {
+            match &= (empty & -empty) - 1;
+        }
+        for (; match != 0; match &= match - 1) {
+            const DirIndexSlot* slot = &index->slots[i + __builtin_ctz(match)];
+            if (slot->hash == hash && slot->length == len && memcmp(slot->node->name, name, len) == 0) {
+                return slot->node;
+            }
+        }
+        if (empty != 0) {
+            return NULL;
+        }
+        i = (i + width) & mask;
+    }
+}
+
+/**
+ * @brief Verrouille un répertoire en écriture et matérialise ses enfants
+ *
+ * @param dir Répertoire concerné
+ * @return int 0 si le verrou est pris, -1 si la matérialisation échoue
+ *         (le verrou est alors relâché)
+ */
+static int dir_lock_write(FileNode* dir) {
+    pthread_rwlock_wrlock(&dir->dir_data->lock);
+    if (dir_materialize(dir) != 0) {
+        pthread_rwlock_unlock(&dir->dir_data->lock);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Verrouille un répertoire en lecture, ses enfants étant matérialisés
+ *
+ * @param dir Répertoire concerné
+ * @return int 0 si un verrou est pris, -1 si la matérialisation échoue
+ *
+ * @details
+ * Matérialiser modifie le répertoire : si ses enfants sont encore dans
+ * l'image, le verrou est pris en écriture le temps de les créer et
+ * conservé ainsi.
+ */
+static int dir_lock_read(FileNode* dir) {
+    DirData* data = dir->dir_data;
+    pthread_rwlock_rdlock(&data->lock);
+    if (!data->image_pending) return 0;
+    pthread_rwlock_unlock(&data->lock);
+    return dir_lock_write(dir);
+}
+
+/**
+ * @brief Relâche le verrou d'un répertoire
+ *
+ * @param dir Répertoire verrouillé par dir_lock_read ou dir_lock_write
+ */
+static void dir_unlock(FileNode* dir) {
+    pthread_rwlock_unlock(&dir->dir_data->lock);
+}
+
+/**
+ * @brief Verrouille le répertoire parent d'un nœud rattaché
+ *
+ * @param node Nœud concerné (pas la racine)
+ * @param write 1 pour un verrou en écriture, 0 en lecture
+ * @return FileNode* Parent verrouillé
+ *
+ * @details
+ * Le parent peut changer (move_file) tant qu'il n'est pas verrouillé :
+ * si le nœud a été déplacé entre la lecture de son parent et le
+ * verrouillage, on recommence avec le nouveau parent.
+ */
+static FileNode* node_lock_parent(FileNode* node, int write) {
+    for (;;) {
+        FileNode* parent = __atomic_load_n(&node->parent, __ATOMIC_ACQUIRE);
+        if (write) {
+            pthread_rwlock_wrlock(&parent->dir_data->lock);
+        } else {
+            pthread_rwlock_rdlock(&parent->dir_data->lock);
+        }
+        if (node->parent == parent) return parent;
+        pthread_rwlock_unlock(&parent->dir_data->lock);
+    }
+}
+
+/**
+ * @brief Recherche un enfant par son nom dans un répertoire
+ *
+ * Routine de recherche partagée par la résolution de chemins et par
+ * toutes les opérations qui ciblent une entrée de répertoire. Le nom
+ * est désigné par un pointeur et une longueur afin que la résolution
+ * de chemins puisse chercher un composant sans le recopier.
+ *
+ * @param dir Répertoire dans lequel chercher (verrouillé le temps de la recherche)
+ * @param name Début du nom de l'entrée recherchée
+ * @param len Longueur du nom
+ * @return FileNode* Nœud trouvé, NULL s'il n'existe pas
+ */
+static FileNode* dir_lookup_n(FileNode* dir, const char* name, size_t len) {
+    if (dir->dir_data == NULL || len >= MAX_NAME_LENGTH) return NULL;
+    if (dir_lock_read(dir) != 0) return NULL;
+    FileNode* node = dir_find(dir->dir_data, name, len);
+    dir_unlock(dir);
+    return node;
+}
+
+/**
+ * @brief Recherche un enfant par son nom (chaîne terminée par '\0')
+ *
+ * @param dir Répertoire dans lequel chercher
+ * @param name Nom de l'entrée recherchée
+ * @return FileNode* Nœud trouvé, NULL s'il n'existe pas
+ */
+FileNode* dir_lookup(FileNode* dir, const char* name) {
+    return dir_lookup_n(dir, name, strlen(name));
+}
+
+/**
+ * @brief Agrandit le tableau des enfants et celui de leurs numéros d'insertion
+ *
+ * @param data Répertoire concerné
+ * @param capacity Nouvelle capacité (supérieure à l'actuelle)
+ * @return int 0 en cas de succès, -1 si l'allocation échoue (capacité inchangée)
+ */
+static int dir_grow(DirData* data, int capacity) {
+    FileNode** children = realloc(data->children, capacity * sizeof(FileNode*));
+    if (children == NULL) return -1;
+    data->children = children;
+    unsigned long long* seqs = realloc(data->child_seqs, capacity * sizeof(unsigned long long));
+    if (seqs == NULL) return -1;
+    data->child_seqs = seqs;
+    data->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Réserve la place de plusieurs enfants dans un répertoire
+ *
+ * @param dir Répertoire concerné
+ * @param count Nombre total d'enfants attendus
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * Utilisé par le chargement, qui connaît à l'avance la taille de chaque
+ * répertoire : le tableau et l'index sont dimensionnés en une fois.
+ */
+int dir_reserve(FileNode* dir, int count) {
+    DirData* data = dir->dir_data;
+    if (data->image_pending && dir_materialize(dir) != 0) return -1;
+    if (count > data->capacity && dir_grow(data, count) != 0) return -1;
+    if (count > data->child_count) {
+        return dir_index_reserve(data, count - data->child_count);
+    }
+    return 0;
+}
+
+/**
+ * @brief Garantit qu'un répertoire peut recevoir un enfant de plus
+ *
+ * @param dir Répertoire parent
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * - Le tableau des enfants double de taille lorsqu'il est plein
+ * - L'index est agrandi si nécessaire
+ * - L'index ordonné, s'il existe, réserve sa place (voir order_reserve)
+ * - Après un succès, dir_link_child ne peut plus échouer
+ */
+static int dir_prepare_child(FileNode* dir) {
+    DirData* data = dir->dir_data;
+    if (data->image_pending && dir_materialize(dir) != 0) return -1;
+    if (data->child_count == data->capacity &&
+        dir_grow(data, data->capacity ? data->capacity * 2 : DIR_MIN_CAPACITY) != 0) {
+        return -1;
+    }
+    if (data->order != NULL && order_reserve(data->order) != 0) return -1;
+    return dir_index_reserve(data, 1);
+}
+
+/**
+ * @brief Ajoute un enfant à un répertoire préparé par dir_prepare_child
+ *
+ * @param dir Répertoire parent
+ * @param child Nœud à ajouter (nom et empreinte déjà renseignés)
+ */
+static void dir_link_child(FileNode* dir, FileNode* child) {
+    DirData* data = dir->dir_data;
+    dir_index_place(data->index, child);
+    if (data->order != NULL) order_insert(data->order, child);
+    data->child_seqs[data->child_count] = ++data->next_seq;
+    data->children[data->child_count++] = child;
+    __atomic_store_n(&child->parent, dir, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ajoute un enfant à un répertoire
+ *
+ * @param dir Répertoire parent
+ * @param child Nœud à ajouter (nom et empreinte déjà renseignés)
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * La place est réservée avant toute modification (dir_prepare_child),
+ * de sorte qu'un échec d'allocation laisse le répertoire intact.
+ */
+int dir_add_child(FileNode* dir, FileNode* child) {
+    if (dir_prepare_child(dir) != 0) {
+        return -1;
+    }
+    dir_link_child(dir, child);
+    return 0;
+}
+
+/**
+ * @brief Retire un enfant d'un répertoire sans le libérer
+ *
+ * @param dir Répertoire parent
+ * @param child Nœud à retirer
+ *
+ * @details
+ * - Remplace l'emplacement de l'index par une pierre tombale
+ * - Retire l'enfant de l'index ordonné, s'il existe (sous son nom actuel)
+ * - Décale les tableaux children et child_seqs pour conserver l'ordre
+ *   d'insertion : les numéros restent croissants
+ */
+static void dir_remove_child(FileNode* dir, FileNode* child) {
+    DirData* data = dir->dir_data;
+    struct DirIndex* index = data->index;
+    if (index != NULL) {
+        unsigned int mask = index->capacity - 1;
+        for (unsigned int i = child->name_hash & mask; index->slots[i].node != NULL; i = (i + 1) & mask) {
+            if (index->slots[i].node == child) {
+                index->slots[i].node = DIR_INDEX_TOMBSTONE;
+                index->tags[i] = TAG_TOMBSTONE;
+                break;
+            }
+        }
+    }
+    if (data->order != NULL) order_remove(data->order, child);
+
+    for (int i = 0; i < data->child_count; i++) {
+        if (data->children[i] == child) {
+            memmove(&data->children[i], &data->children[i + 1],
+                    (data->child_count - i - 1) * sizeof(FileNode*));
+            memmove(&data->child_seqs[i], &data->child_seqs[i + 1],
+                    (data->child_count - i - 1) * sizeof(unsigned long long));
+            data->child_count--;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Indique si un nœud a été supprimé de l'arborescence
+ *
+ * @param node Nœud concerné
+ * @return int 1 si le nœud est détaché (voir recursive_delete), 0 sinon
+ */
+static int node_unlinked(FileNode* node) {
+    return node != root_directory && __atomic_load_n(&node->parent, __ATOMIC_ACQUIRE) == NULL;
+}
+
+/**
+ * @brief Occupation des sous-arbres
+ *
+ * Chaque répertoire tient dans DirData::usage l'occupation de son
+ * sous-arbre (fichiers, répertoires, octets), de sorte que du et df se
+ * lisent en temps constant. Chaque opération reporte sa variation sur
+ * le parent de l'entrée touchée et sur tous ses ancêtres :
+ * - création, copie et liens : l'entrée créée
+ * - écriture : la variation de taille, sur les ancêtres de chacun des
+ *   noms du contenu (FileData::names)
+ * - suppression : l'occupation du sous-arbre retiré
+ * - déplacement : retirée sous l'ancien parent, ajoutée sous le nouveau,
+ *   jusqu'à leur premier ancêtre commun
+ * Les compteurs sont atomiques : des opérations sur des sous-arbres
+ * disjoints les ajustent sans verrou commun. Les parents ne changent
+ * pas pendant qu'on les remonte, seuls move_file et delete_file les
+ * modifiant, sous fs_tree_lock en écriture.
+ *
+ * Une variation qui agrandit le sous-arbre est réservée (usage_reserve) :
+ * elle est ajoutée, puis retirée si un ancêtre dépasse alors son quota
+ * (FS_ERR_QUOTA). Deux réservations concurrentes ne peuvent donc pas
+ * dépasser ensemble un quota que chacune respecte.
+ */
+
+/** @brief Variation nulle (voir usage_settle) */
+static const DiskUsage usage_none;
+
+/**
+ * @brief Ajoute une variation aux compteurs d'un répertoire
+ *
+ * @param data Répertoire concerné
+ * @param delta Variation (négative pour une diminution)
+ */
+static void usage_add_one(DirData* data, const DiskUsage* delta) {
+    __atomic_add_fetch(&data->usage.files, delta->files, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&data->usage.directories, delta->directories, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&data->usage.bytes, delta->bytes, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&data->usage.stored, delta->stored, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Opposé d'une variation
+ *
+ * @param delta Variation
+ * @return DiskUsage Variation qui l'annule
+ */
+static DiskUsage usage_negate(const DiskUsage* delta) {
+    return (DiskUsage){ -delta->files, -delta->directories, -delta->bytes, -delta->stored };
+}
+
+/**
+ * @brief Reporte une variation sur un répertoire et ses ancêtres
+ *
+ * @param dir Répertoire qui contient l'entrée concernée (NULL pour une
+ *        entrée détachée : rien à faire)
+ * @param stop Premier ancêtre exclu (NULL pour remonter jusqu'à la racine)
+ * @param delta Variation
+ */
+static void usage_add(FileNode* dir, FileNode* stop, const DiskUsage* delta) {
+    for (; dir != stop; dir = dir->parent) {
+        usage_add_one(dir->dir_data, delta);
+    }
+}
+
+/**
+ * @brief Indique si un répertoire dépasse l'un de ses quotas après une variation
+ *
+ * @param data Répertoire concerné, la variation déjà ajoutée
+ * @param delta Variation ajoutée
+ * @return int 1 si la variation agrandit un compteur limité au-delà de son quota
+ */
+static int usage_over_quota(DirData* data, const DiskUsage* delta) {
+    long long max_bytes = __atomic_load_n(&data->quota_bytes, __ATOMIC_RELAXED);
+    long long max_nodes = __atomic_load_n(&data->quota_nodes, __ATOMIC_RELAXED);
+    if (max_bytes > 0 && delta->bytes > 0 &&
+        __atomic_load_n(&data->usage.bytes, __ATOMIC_SEQ_CST) > max_bytes) {
+        return 1;
+    }
+    // Le répertoire lui-même n'est pas compté dans son quota d'entrées
+    return max_nodes > 0 && delta->files + delta->directories > 0 &&
+           __atomic_load_n(&data->usage.files, __ATOMIC_SEQ_CST) +
+           __atomic_load_n(&data->usage.directories, __ATOMIC_SEQ_CST) - 1 > max_nodes;
+}
+
+/**
+ * @brief Réserve une variation sur un répertoire et ses ancêtres, sous leurs quotas
+ *
+ * @param dir Répertoire qui reçoit la variation
+ * @param stop Premier ancêtre exclu (NULL pour remonter jusqu'à la racine)
+ * @param delta Variation
+ * @return int FS_OK si elle est appliquée ; FS_ERR_QUOTA si un répertoire
+ *         dépasserait son quota (rien n'est alors appliqué)
+ */
+static int usage_reserve(FileNode* dir, FileNode* stop, const DiskUsage* delta) {
+    for (FileNode* ancestor = dir; ancestor != stop; ancestor = ancestor->parent) {
+        usage_add_one(ancestor->dir_data, delta);
+        if (usage_over_quota(ancestor->dir_data, delta)) {
+            DiskUsage undo = usage_negate(delta);
+            usage_add(dir, ancestor->parent, &undo);
+            return FS_ERR_QUOTA;
+        }
+    }
+    return FS_OK;
+}
+
+/**
+ * @brief Reporte une variation d'un contenu sur les ancêtres de chacun de ses noms
+ *
+ * @param node Nœud par lequel le contenu est modifié
+ * @param data Contenu du nœud (sous son verrou en écriture), NULL accepté
+ * @param delta Variation
+ * @param reserve 1 pour réserver sous les quotas (voir usage_reserve), 0
+ *        pour appliquer sans condition
+ * @return int FS_OK, ou FS_ERR_QUOTA si la réservation échoue (rien
+ *         n'est alors appliqué)
+ *
+ * @details
+ * Un contenu partagé par des liens durs est compté sous chacun de ses
+ * noms ; un nom détaché (supprimé mais encore ouvert) n'est plus compté.
+ */
+static int usage_charge(FileNode* node, FileData* data, const DiskUsage* delta, int reserve) {
+    FileNode* const* names = data != NULL && data->names != NULL ? data->names : &node;
+    unsigned int count = data != NULL && data->names != NULL ? data->name_count : 1;
+    for (unsigned int i = 0; i < count; i++) {
+        if (!reserve) {
+            usage_add(names[i]->parent, NULL, delta);
+        } else if (usage_reserve(names[i]->parent, NULL, delta) != FS_OK) {
+            DiskUsage undo = usage_negate(delta);
+            while (i-- > 0) usage_add(names[i]->parent, NULL, &undo);
+            return FS_ERR_QUOTA;
+        }
+    }
+    return FS_OK;
+}
+
+/**
+ * @brief Reporte sur les noms d'un contenu la variation qu'il a subie au-delà de la réservation
+ *
+ * @param node Nœud par lequel le contenu a été modifié
+ * @param data Contenu (sous son verrou en écriture)
+ * @param before Taille (bytes) et octets stockés (stored) avant la modification
+ * @param reserved Variation déjà réservée par usage_charge (usage_none sinon)
+ *
+ * @details
+ * Corrige aussi une écriture qui a échoué en cours de route, et compte
+ * les octets stockés, qui ne dépendent que de la compression.
+ */
+static void usage_settle(FileNode* node, FileData* data, const DiskUsage* before, const DiskUsage* reserved) {
+    DiskUsage delta = { 0, 0, data_size(data) - before->bytes - reserved->bytes,
+                        data_stored(data) - before->stored - reserved->stored };
+    if (delta.bytes != 0 || delta.stored != 0) {
+        usage_charge(node, data, &delta, 0);
+    }
+}
+
+/**
+ * @brief Occupation d'une entrée, son sous-arbre compris
+ *
+ * @param node Entrée concernée
+ * @param usage Occupation à remplir
+ *
+ * @details
+ * Celle d'un répertoire est lue dans ses compteurs, celle d'un fichier
+ * (ou d'un lien symbolique) est celle de son contenu.
+ */
+void node_usage(const FileNode* node, DiskUsage* usage) {
+    if (node->dir_data != NULL) {
+        const DiskUsage* counters = &node->dir_data->usage;
+        usage->files = __atomic_load_n(&counters->files, __ATOMIC_RELAXED);
+        usage->directories = __atomic_load_n(&counters->directories, __ATOMIC_RELAXED);
+        usage->bytes = __atomic_load_n(&counters->bytes, __ATOMIC_RELAXED);
+        usage->stored = __atomic_load_n(&counters->stored, __ATOMIC_RELAXED);
+        return;
+    }
+    FileData* content = __atomic_load_n(&node->data, __ATOMIC_ACQUIRE);
+    usage->files = 1;
+    usage->directories = 0;
+    usage->bytes = data_size(content);
+    usage->stored = data_stored(content);
+}
+
+/**
+ * @brief Retient un nœud pour une session (fichier ouvert ou répertoire de travail)
+ *
+ * @param node Nœud à retenir
+ */
+static void node_pin(FileNode* node) {
+    __atomic_add_fetch(&node->open_count, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Relâche un nœud retenu par node_pin
+ *
+ * @param node Nœud à relâcher
+ *
+ * @details
+ * Un nœud supprimé pendant qu'il était retenu a seulement été détaché :
+ * le dernier à le relâcher le libère. Appelée sous fs_tree_lock, alors
+ * que la suppression le prend en écriture : les deux ne se croisent pas.
+ */
+static void node_unpin(FileNode* node) {
+    if (__atomic_sub_fetch(&node->open_count, 1, __ATOMIC_ACQ_REL) == 0 && node_unlinked(node)) {
+        node_free(node);
+    }
+}
+
+/**
+ * @brief Emplacement de départ d'un nœud dans la table des fichiers ouverts par chemin
+ *
+ * @param session Session concernée (table non vide)
+ * @param node Nœud recherché
+ * @return unsigned int Indice dans open_files
+ */
+static unsigned int open_slot(const Session* session, const FileNode* node) {
+    // Les nœuds sont alignés sur 64 octets : ignorer les bits toujours nuls
+    return (unsigned int)(((uintptr_t)node >> 6) * 2654435761u) & (session->open_capacity - 1);
+}
+
+/**
+ * @brief Cherche un fichier ouvert par open_file dans une session
+ *
+ * @param session Session concernée
+ * @param node Fichier recherché
+ * @return PathOpen* Entrée du fichier, NULL s'il n'est pas ouvert par son chemin
+ */
+static PathOpen* session_find_open(Session* session, const FileNode* node) {
+    if (session->open_count == 0) return NULL;
+    unsigned int mask = session->open_capacity - 1;
+    for (unsigned int i = open_slot(session, node); session->open_files[i].node != NULL; i = (i + 1) & mask) {
+        if (session->open_files[i].node == node) return &session->open_files[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Place une entrée dans une table des fichiers ouverts non pleine
+ *
+ * @param session Session concernée
+ * @param entry Entrée à placer
+ */
+static void session_place_open(Session* session, PathOpen entry) {
+    unsigned int mask = session->open_capacity - 1;
+    unsigned int i = open_slot(session, entry.node);
+    while (session->open_files[i].node != NULL) {
+        i = (i + 1) & mask;
+    }
+    session->open_files[i] = entry;
+}
+
+/**
+ * @brief Associe un fichier ouvert par son chemin à son descripteur
+ *
+ * @param session Session concernée
+ * @param node Fichier ouvert
+ * @param fd Descripteur du fichier
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * La table est doublée au-delà de 3/4 de remplissage.
+ */
+static int session_add_open(Session* session, FileNode* node, int fd) {
+    if ((session->open_count + 1) * 4 > session->open_capacity * 3) {
+        unsigned int capacity = session->open_capacity ? session->open_capacity * 2 : 16;
+        PathOpen* table = calloc(capacity, sizeof(PathOpen));
+        if (table == NULL) return -1;
+
+        PathOpen* old = session->open_files;
+        unsigned int old_capacity = session->open_capacity;
+        session->open_files = table;
+        session->open_capacity = capacity;
+        for (unsigned int i = 0; i < old_capacity; i++) {
+            if (old[i].node != NULL) session_place_open(session, old[i]);
+        }
+        free(old);
+    }
+    session_place_open(session, (PathOpen){ node, fd });
+    session->open_count++;
+    return 0;
+}
+
+/**
+ * @brief Retire une entrée de la table des fichiers ouverts par chemin
+ *
+ * @param session Session concernée
+ * @param entry Entrée renvoyée par session_find_open
+ *
+ * @details
+ * Les entrées suivantes de la même séquence de sondage sont décalées
+ * pour combler le trou : la table n'a pas besoin de marqueurs.
+ */
+static void session_remove_open(Session* session, PathOpen* entry) {
+    unsigned int mask = session->open_capacity - 1;
+    unsigned int hole = entry - session->open_files;
+    for (unsigned int i = (hole + 1) & mask; session->open_files[i].node != NULL; i = (i + 1) & mask) {
+        unsigned int home = open_slot(session, session->open_files[i].node);
+        // L'entrée peut remonter si le trou est entre son emplacement de départ et elle
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            session->open_files[hole] = session->open_files[i];
+            hole = i;
+        }
+    }
+    session->open_files[hole].node = NULL;
+    session->open_count--;
+}
+
+/**
+ * @brief Alloue le plus petit descripteur libre d'une session
+ *
+ * @param session Session concernée
+ * @param node Fichier ouvert, retenu jusqu'à la fermeture du descripteur
+ * @param mode Mode d'ouverture
+ * @return int Descripteur, -1 si l'allocation échoue
+ *
+ * @details
+ * La table des descripteurs est doublée quand elle est pleine ; fd_hint
+ * évite de réexaminer les descripteurs occupés du début de la table.
+ */
+static int session_alloc_fd(Session* session, FileNode* node, int mode) {
+    int fd = session->fd_hint;
+    while (fd < session->fd_capacity && session->fds[fd].node != NULL) {
+        fd++;
+    }
+    if (fd == session->fd_capacity) {
+        int capacity = session->fd_capacity ? session->fd_capacity * 2 : 16;
+        OpenFile* fds = realloc(session->fds, capacity * sizeof(OpenFile));
+        if (fds == NULL) return -1;
+        memset(fds + session->fd_capacity, 0, (capacity - session->fd_capacity) * sizeof(OpenFile));
+        session->fds = fds;
+        session->fd_capacity = capacity;
+    }
+    session->fds[fd] = (OpenFile){ node, mode, 0 };
+    session->fd_hint = fd + 1;
+    node_pin(node);
+    return fd;
+}
+
+/**
+ * @brief Retrouve l'entrée d'un descripteur de la session courante
+ *
+ * @param fd Descripteur
+ * @return OpenFile* Entrée du descripteur, NULL s'il n'est pas ouvert (FS_ERR_BAD_FD)
+ */
+static OpenFile* session_fd(int fd) {
+    Session* session = session_current();
+    if (fd < 0 || fd >= session->fd_capacity || session->fds[fd].node == NULL) {
+        return NULL;
+    }
+    return &session->fds[fd];
+}
+
+/**
+ * @brief Range dans la table de déduplication les derniers blocs écrits d'un fichier
+ *
+ * @param node Fichier qui vient d'être écrit
+ *
+ * @details
+ * Voir data_seal ; les octets stockés peuvent changer, la variation est
+ * reportée sur les ancêtres de ses noms.
+ */
+static void node_seal(FileNode* node) {
+    FileData* data = __atomic_load_n(&node->data, __ATOMIC_ACQUIRE);
+    if (!fs_dedup || data == NULL) return;
+    pthread_rwlock_wrlock(&data->lock);
+    DiskUsage before = { 0, 0, data_size(data), data_stored(data) };
+    data_seal(data);
+    usage_settle(node, data, &before, &usage_none);
+    pthread_rwlock_unlock(&data->lock);
+}
+
+/**
+ * @brief Libère un descripteur et relâche son fichier
+ *
+ * @param session Session concernée
+ * @param fd Descripteur ouvert
+ *
+ * @details
+ * - Appelée sous fs_tree_lock : le fichier peut être libéré s'il a été
+ *   supprimé entre-temps
+ * - Un fichier ouvert en écriture est scellé (node_seal)
+ */
+static void session_free_fd(Session* session, int fd) {
+    FileNode* node = session->fds[fd].node;
+    if (session->fds[fd].mode & FILE_MODE_WRITE) node_seal(node);
+    PathOpen* entry = session_find_open(session, node);
+    if (entry != NULL && entry->fd == fd) {
+        session_remove_open(session, entry);
+    }
+    session->fds[fd].node = NULL;
+    if (fd < session->fd_hint) session->fd_hint = fd;
+    node_unpin(node);
+}
+
+/**
+ * @brief Relâche le répertoire de travail et les fichiers ouverts d'une session
+ *
+ * @param session Session concernée (sous fs_tree_lock ou hors concurrence)
+ */
+static void session_release(Session* session) {
+    for (int fd = 0; fd < session->fd_capacity; fd++) {
+        if (session->fds[fd].node != NULL) node_unpin(session->fds[fd].node);
+    }
+    free(session->fds);
+    session->fds = NULL;
+    session->fd_capacity = 0;
+    session->fd_hint = 0;
+    free(session->open_files);
+    session->open_files = NULL;
+    session->open_capacity = 0;
+    session->open_count = 0;
+    if (session->cwd != NULL) node_unpin(session->cwd);
+    session->cwd = NULL;
+}
+
+/**
+ * @brief Retourne la session du thread appelant
+ *
+ * @return Session* Session attachée par session_attach, ou la session par défaut
+ */
+Session* session_current() {
+    return fs_thread_session ? fs_thread_session : &fs_default_session;
+}
+
+/**
+ * @brief Attache une session au thread appelant
+ *
+ * @param session Session à attacher, NULL pour revenir à la session par défaut
+ * @return Session* Session attachée auparavant (NULL pour la session par défaut)
+ *
+ * @details
+ * Un serveur peut ainsi faire travailler un petit nombre de threads pour
+ * un grand nombre de sessions, en attachant la session de chaque requête
+ * le temps de la traiter.
+ */
+Session* session_attach(Session* session) {
+    Session* previous = fs_thread_session;
+    fs_thread_session = session;
+    return previous;
+}
+
+/**
+ * @brief Crée une session
+ *
+ * @return Session* Session placée à la racine, sans fichier ouvert ;
+ *         NULL si l'allocation échoue
+ */
+Session* session_create() {
+    Session* session = calloc(1, sizeof(Session));
+    if (session == NULL) return NULL;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    session_set_cwd(session, root_directory);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return session;
+}
+
+/**
+ * @brief Détruit une session
+ *
+ * @param session Session créée par session_create
+ *
+ * @details
+ * - Ferme tous ses fichiers ouverts et relâche son répertoire de travail
+ * - La détache du thread appelant si elle y était attachée
+ * - Toutes les sessions doivent être détruites avant tree_release()
+ */
+void session_destroy(Session* session) {
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    session_release(session);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    if (fs_thread_session == session) fs_thread_session = NULL;
+    free(session);
+}
+
+/**
+ * @brief Change le répertoire de travail d'une session
+ *
+ * @param session Session concernée
+ * @param dir Nouveau répertoire de travail
+ */
+void session_set_cwd(Session* session, FileNode* dir) {
+    node_pin(dir);
+    if (session->cwd != NULL) node_unpin(session->cwd);
+    session->cwd = dir;
+}
+
 /**
  * @brief Initialise le système de fichiers
  *
+ * @return int 0 en cas de succès ; FS_ERR_JOURNAL si le journal ne peut
+ *         être ouvert (le système est utilisable, les modifications sont
+ *         sauvées à la fermeture) ; FS_ERR_IO ou FS_ERR_NO_MEMORY si le
+ *         système est inutilisable
+ *
  * Cette fonction crée ou charge le système de fichiers.
  * Si un système existant est trouvé, il est chargé.
  * Sinon, un nouveau système est créé avec un répertoire racine.
+ * Les opérations journalisées depuis la dernière image sont ensuite
+ * rejouées (voir fs_journal.c).
  */
-void init_file_system() {
+int init_file_system() {
+    tags_select(NULL);
     fs_fd = open(FS_FILENAME, O_RDWR | O_CREAT, 0644);
     if (fs_fd < 0) {
-        perror("Erreur lors de l'ouverture du fichier système");
-        exit(EXIT_FAILURE);
+        return FS_ERR_IO;
     }
 
     // Essayer de charger le système de fichiers existant
     if (load_file_system() != 0) {
     // Si le chargement échoue, créer un nouveau système de fichiers
-    root_directory = (FileNode*)malloc(sizeof(FileNode));
-    strcpy(root_directory->name, "/");
-    root_directory->type = DIRECTORY_TYPE;
-    root_directory->permissions = 755;
-    root_directory->size = 0;
-    root_directory->parent = NULL;
-    root_directory->child_count = 0;
-    root_directory->content = NULL;
-    root_directory->is_open = 0;
-    root_directory->ref_count = 1;
-    root_directory->symlink_target = NULL;
+    root_directory = node_alloc("/", DIRECTORY_TYPE, 755);
+    if (root_directory == NULL) {
+        close(fs_fd);
+        fs_fd = -1;
+        return FS_ERR_NO_MEMORY;
+    }
     }
-    current_directory = root_directory;
+    session_set_cwd(&fs_default_session, root_directory);
+
+    // Rejouer les opérations effectuées depuis le dernier point de reprise
+    return journal_open() == 0 ? FS_OK : FS_ERR_JOURNAL;
 }
 
 /**
- * @brief Sauvegarde récursivement un répertoire et son contenu
+ * @brief Sauvegarde l'état complet du système de fichiers
  * 
- * Cette fonction sauvegarde un nœud de répertoire et tous ses enfants
- * dans le fichier de stockage persistant.
+ * Cette fonction sauvegarde l'intégralité du système de fichiers
+ * dans le fichier de stockage persistant, au format décrit dans fs_image.c.
  * 
- * @param fd Descripteur du fichier de stockage
- * @param dir Pointeur vers le nœud de répertoire à sauvegarder
+ * C'est le point de reprise du journal : une fois la nouvelle image en
+ * place, les opérations journalisées y sont incluses et le journal est vidé.
  * 
  * @details
- * - Vérifie d'abord si le nœud est valide
- * - Écrit le nœud courant dans le fichier
- * - Sauvegarde récursivement tous les enfants
+ * - Vérifie si le descripteur de fichier est valide
+ * - Écrit l'image, de génération supérieure, dans un fichier temporaire
+ *   puis la synchronise
+ * - Remplace atomiquement l'ancienne image par renommage, de sorte
+ *   qu'une interruption en cours d'écriture ne la détruit jamais
+ * - Rouvre le descripteur sur la nouvelle image et vide le journal ; si
+ *   une interruption survient avant, le journal de l'ancienne génération
+ *   sera ignoré au prochain démarrage
+ * - Appelée sous fs_tree_lock en écriture : l'image est un instantané
+ *   cohérent de l'arborescence
+ *
+ * @return int 0 en cas de succès, FS_ERR_IO en cas d'échec (errno
+ *         indique la cause ; l'ancienne image est intacte)
  */
-void save_directory(int fd, FileNode* dir) {
-    if (!dir) return;
+static int save_file_system_locked() {
+    if (fs_fd < 0) return FS_OK;
     
-    // écrire le noeud
-    write(fd, dir, sizeof(FileNode));
+    const char* temp_name = FS_FILENAME ".tmp";
+    int fd = open(temp_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return FS_ERR_IO;
+    }
     
-    // récursively save children
-    for (int i = 0; i < dir->child_count; i++) {
-        save_directory(fd, dir->children[i]);
+    // Sauvegarder le système de fichiers
+    uint32_t generation = fs_generation + 1;
+    if (save_image(fd, root_directory, generation) != 0 || fsync(fd) != 0) {
+        int error = errno;
+        close(fd);
+        unlink(temp_name);
+        errno = error;
+        return FS_ERR_IO;
+    }
+    close(fd);
+    
+    if (rename(temp_name, FS_FILENAME) != 0) {
+        int error = errno;
+        unlink(temp_name);
+        errno = error;
+        return FS_ERR_IO;
     }
+    fs_generation = generation;
+    
+    // fs_fd désigne encore l'ancienne image : l'échanger contre la nouvelle
+    int new_fd = open(FS_FILENAME, O_RDWR);
+    if (new_fd >= 0) {
+        close(fs_fd);
+        fs_fd = new_fd;
+    }
+    // L'image est en place : un journal non vidé est seulement ignoré au
+    // prochain démarrage, sa génération étant périmée
+    return journal_reset() == 0 ? FS_OK : FS_ERR_IO;
 }
 
 /**
- * @brief Sauvegarde l'état complet du système de fichiers
- * 
- * Cette fonction sauvegarde l'intégralité du système de fichiers
- * dans le fichier de stockage persistant.
- * 
- * @details
- * - Vérifie si le descripteur de fichier est valide
- * - Tronque le fichier existant
- * - Réinitialise le pointeur de fichier
- * - Lance la sauvegarde récursive depuis la racine
+ * @brief Sauvegarde le système de fichiers (voir save_file_system_locked)
+ *
+ * @return int 0 en cas de succès, FS_ERR_IO en cas d'échec
  */
-void save_file_system() {
-    if (fs_fd < 0) return;
-    
-    // Tronquer le fichier à zéro octet
-    ftruncate(fs_fd, 0);
-    lseek(fs_fd, 0, SEEK_SET);
-    
-    // Sauvegarder le système de fichiers
-    save_directory(fs_fd, root_directory);
+int save_file_system() {
+    pthread_rwlock_wrlock(&fs_tree_lock);
+    int status = save_file_system_locked();
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
 }
 
 /**
- * @brief Charge récursivement un répertoire depuis le stockage
- * 
- * @param fd Descripteur du fichier de stockage
- * @return FileNode* Pointeur vers le nœud chargé, NULL en cas d'erreur
- * 
+ * @brief Synchronise sur disque les modifications journalisées
+ *
+ * @return int 0 en cas de succès, FS_ERR_IO si une écriture du journal
+ *         ou le point de reprise a échoué depuis la dernière synchronisation
+ *
  * @details
- * - Alloue la mémoire pour un nouveau nœud
- * - Lit les données du nœud depuis le fichier
- * - Charge récursivement tous les enfants
- * - Établit les liens parent-enfant
+ * Les opérations ne synchronisent pas le journal elles-mêmes : l'appelant
+ * choisit la fréquence (après chaque commande en mode interactif, par
+ * lots en mode script).
  */
-FileNode* load_directory(int fd) {
-    FileNode* node = (FileNode*)malloc(sizeof(FileNode));
-    
-    // Lire le noeud
-    if (read(fd, node, sizeof(FileNode)) <= 0) {
-        free(node);
-        return NULL;
-    }
-    
-    // Récursivement charger les enfants
-    for (int i = 0; i < node->child_count; i++) {
-        node->children[i] = load_directory(fd);
-        if (node->children[i]) {
-            node->children[i]->parent = node;
-        }
-    }
-    
-    return node;
+int sync_file_system() {
+    return journal_sync() == 0 ? FS_OK : FS_ERR_IO;
 }
 
 /**
  * @brief Charge le système de fichiers depuis le stockage
  * 
- * @return int 0 en cas de succès, -1 en cas d'échec
+ * @return int 0 en cas de succès, FS_ERR_IO en cas d'échec
  * 
  * @details
  * - Vérifie si le descripteur de fichier est valide
- * - Réinitialise le pointeur de fichier
- * - Lance le chargement récursif depuis la racine
+ * - Selon fs_load_mode, reconstruit toute l'arborescence ou se contente
+ *   de projeter l'image et d'en matérialiser la racine (voir fs_image.c)
+ * - Échoue si le fichier est vide, d'un autre format ou corrompu
  */
 int load_file_system() {
-    if (fs_fd < 0) return -1;
+    if (fs_fd < 0) return FS_ERR_IO;
     
-    lseek(fs_fd, 0, SEEK_SET);
-    root_directory = load_directory(fs_fd);
+    root_directory = fs_load_mode == LOAD_MMAP ? map_image(fs_fd, &fs_generation)
+                                               : load_image(fs_fd, &fs_generation);
     
-    return root_directory ? 0 : -1;
+    return root_directory ? FS_OK : FS_ERR_IO;
 }
 
 // Fermer le système de fichiers
@@ -175,136 +1331,436 @@ int load_file_system() {
  * @brief Ferme proprement le système de fichiers
  * 
  * Cette fonction effectue la fermeture propre du système de fichiers,
- * en sauvegardant l'état actuel et en libérant les ressources.
+ * en s'assurant que l'état actuel est persistant et en libérant les ressources.
  * 
  * @details
  * - Vérifie si le descripteur de fichier est valide
- * - Sauvegarde l'état actuel du système de fichiers
+ * - Synchronise et ferme le journal, qui contient déjà toutes les
+ *   modifications : l'image n'est pas réécrite
+ * - Sauvegarde l'image complète seulement si la journalisation est inactive
  * - Ferme le fichier de stockage
  * - Réinitialise le descripteur de fichier
+ *
+ * @return int 0 en cas de succès, FS_ERR_IO si la sauvegarde ou la
+ *         synchronisation du journal a échoué
  */
-void close_file_system() {
+int close_file_system() {
+    int status = FS_OK;
     if (fs_fd >= 0) {
-        save_file_system();
+        if (journal_fd < 0) {
+            status = save_file_system();
+        }
+        if (journal_close() != 0) status = FS_ERR_IO;
         close(fs_fd);
         fs_fd = -1;
     }
+    return status;
 }
 
 /**
- * @brief Analyse un chemin et retourne le nœud correspondant
- * 
+ * @brief État d'une résolution de chemin (voir path_walk)
+ */
+typedef struct PathWalk {
+    int missing;                    /**< 1 si seul le dernier composant manque */
+    int status;                     /**< Code d'erreur (FsError) si le chemin est invalide */
+    int followed;                   /**< 1 si un lien symbolique a été suivi */
+    int links;                      /**< Liens suivis par toute la résolution (voir MAX_SYMLINK_FOLLOW) */
+} PathWalk;
+
+static FileNode* path_walk_at(FileNode* start, const char* path, int follow, PathWalk* walk);
+
+/**
+ * @brief Suit un lien symbolique
+ *
+ * @param link Lien à suivre
+ * @param walk Résolution en cours (links est incrémenté, status renseigné en cas d'échec)
+ * @return FileNode* Nœud désigné par la cible, liens suivis ; NULL si la
+ *         cible n'existe pas (FS_ERR_NOT_FOUND) ou si la résolution suit
+ *         plus de MAX_SYMLINK_FOLLOW liens (FS_ERR_LOOP)
+ *
+ * @details
+ * - Une cible relative part du répertoire du lien
+ * - La cible résolue est mémorisée par lien (voir dcache_link_lookup) :
+ *   une chaîne de liens déjà suivie ne coûte plus qu'une recherche
+ */
+static FileNode* path_follow(FileNode* link, PathWalk* walk) {
+    walk->followed = 1;
+    if (++walk->links > MAX_SYMLINK_FOLLOW) {
+        walk->status = FS_ERR_LOOP;
+        return NULL;
+    }
+    unsigned int generation;
+    FileNode* target = dcache_link_lookup(link, &generation);
+    if (target != NULL) return target;
+    if (link->symlink_target[0] == '\0') {
+        walk->status = FS_ERR_NOT_FOUND;
+        return NULL;
+    }
+
+    PathWalk inner = { 0, FS_OK, 0, walk->links };
+    FileNode* parent = __atomic_load_n(&link->parent, __ATOMIC_ACQUIRE);
+    target = path_walk_at(parent != NULL ? parent : root_directory, link->symlink_target, 1, &inner);
+    walk->links = inner.links;
+    if (target == NULL || inner.missing) {
+        walk->status = target == NULL ? inner.status : FS_ERR_NOT_FOUND;
+        return NULL;
+    }
+    dcache_link_insert(link, target, generation);
+    return target;
+}
+
+/**
+ * @brief Analyse un chemin à partir d'un répertoire et retourne le nœud correspondant
+ *
+ * @param start Répertoire de départ d'un chemin relatif
  * @param path Le chemin à analyser
+ * @param follow 1 pour suivre un lien symbolique en dernier composant,
+ *        0 pour renvoyer le lien lui-même
+ * @param walk État de la résolution : missing reçoit 1 si le dernier
+ *        composant n'existe pas (le répertoire qui le recevrait est alors
+ *        renvoyé), status le code d'erreur d'un échec
  * @return FileNode* Pointeur vers le nœud trouvé, NULL si le chemin est invalide
- * 
+ *
  * @details
- * - Gère les chemins absolus (commençant par '/') et relatifs
+ * - Gère les chemins absolus (commençant par '/') et relatifs à start
  * - Traite les cas spéciaux '.' (répertoire courant) et '..' (répertoire parent)
  * - Pour un nouveau fichier/répertoire, retourne le parent si le chemin n'existe pas
+ * - Suit les liens symboliques des composants intermédiaires, et du
+ *   dernier si follow est non nul (voir path_follow) ; '..' après un
+ *   lien remonte depuis sa cible
+ * - Un chemin absolu déjà résolu sans suivre de lien est retrouvé dans
+ *   le cache de résolution (voir fs_dcache.c), sans parcourir ses composants
+ * - Verrouille chaque répertoire traversé le temps d'y chercher un
+ *   composant ; le nœud renvoyé reste valide tant que l'appelant détient
+ *   fs_tree_lock (en lecture suffit)
  */
-FileNode* get_file_by_path(const char* path) {
-    // Traiter les cas spéciaux pour la racine et le répertoire courant
+static FileNode* path_walk_at(FileNode* start, const char* path, int follow, PathWalk* walk) {
+    walk->missing = 0;
+    walk->status = FS_ERR_INVALID_PATH;
+    // Traiter les cas spéciaux pour la racine et le répertoire de départ
     if (strcmp(path, "/") == 0) return root_directory;
-    if (strcmp(path, ".") == 0) return current_directory;
+    if (strcmp(path, ".") == 0) return start;
     
-    // Copier le chemin pour l'analyse
-    char path_copy[MAX_PATH_LENGTH];
-    strncpy(path_copy, path, MAX_PATH_LENGTH - 1);
-    path_copy[MAX_PATH_LENGTH - 1] = '\0';
-    
-    // Déterminer le répertoire de départ
-    FileNode* current = (path_copy[0] == '/') ? root_directory : current_directory;
-    if (path_copy[0] == '/') {
-        memmove(path_copy, path_copy + 1, strlen(path_copy));
+    // Un chemin absolu déjà résolu ne coûte qu'une recherche dans le cache
+    DcacheKey key;
+    int cacheable = path[0] == '/' && dcache_key(path, &key) == 0;
+    if (cacheable) {
+        FileNode* cached = dcache_lookup(&key);
+        if (cached != NULL) {
+            walk->missing = key.missing;
+            // Entrée mémorisée sans suivre le lien final : le suivre ici
+            if (follow && !key.missing && cached->symlink_target != NULL) return path_follow(cached, walk);
+            return cached;
+        }
     }
+
+    // Déterminer le répertoire de départ
+    FileNode* current = (path[0] == '/') ? root_directory : start;
     
-    // Diviser le chemin par '/' et rechercher niveau par niveau
-    char* token = strtok(path_copy, "/");
-    while (token != NULL) {
-        if (strcmp(token, ".") == 0) {
+    // Parcourir le chemin composant par composant, sans le recopier
+    const char* cursor = path;
+    while (*cursor) {
+        while (*cursor == '/') cursor++;
+        if (*cursor == '\0') break;
+        
+        const char* component = cursor;
+        while (*cursor && *cursor != '/') cursor++;
+        size_t len = cursor - component;
+        
+        if (len == 1 && component[0] == '.') {
             // Current directory
-        } else if (strcmp(token, "..") == 0) {
+        } else if (len == 2 && component[0] == '.' && component[1] == '.') {
             // Parent directory
-            if (current->parent != NULL) {
-                current = current->parent;
+            FileNode* parent = __atomic_load_n(&current->parent, __ATOMIC_ACQUIRE);
+            if (parent != NULL) {
+                current = parent;
             }
         } else {
-            // Chercher le fichier dans les enfants
-            int found = 0;
-            for (int i = 0; i < current->child_count; i++) {
-                if (strcmp(current->children[i]->name, token) == 0) {
-                    current = current->children[i];
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found) {
+            // Chercher le fichier dans l'index du répertoire
+            FileNode* child = dir_lookup_n(current, component, len);
+            while (*cursor == '/') cursor++;
+            int last = *cursor == '\0';
+            if (child == NULL) {
                 // Si c'est le dernier composant du chemin, retourner le répertoire parent
                 // pour permettre la création de nouveaux fichiers/répertoires
-                if (strtok(NULL, "/") == NULL) {
+                if (last) {
+                    // Entrée négative, seulement sous un répertoire (voir fs_dcache.c)
+                    if (cacheable && !walk->followed && current->type == DIRECTORY_TYPE) {
+                        dcache_insert(&key, current, 1);
+                    }
+                    walk->missing = 1;
                     return current;
                 }
                 // Si ce n'est pas le dernier composant, le chemin est invalide
                 return NULL;
             }
+            if (child->symlink_target != NULL && (follow || !last)) {
+                child = path_follow(child, walk);
+                if (child == NULL) return NULL;
+            }
+            current = child;
         }
-        token = strtok(NULL, "/");
     }
     
+    if (cacheable && !walk->followed) dcache_insert(&key, current, 0);
     return current;
 }
 
+/**
+ * @brief Analyse un chemin relatif au répertoire de travail de la session (voir path_walk_at)
+ *
+ * @param path Le chemin à analyser
+ * @param follow 1 pour suivre un lien symbolique en dernier composant
+ * @param walk État de la résolution
+ * @return FileNode* Nœud trouvé, NULL si le chemin est invalide
+ */
+static FileNode* path_walk(const char* path, int follow, PathWalk* walk) {
+    walk->followed = 0;
+    walk->links = 0;
+    return path_walk_at(session_current()->cwd, path, follow, walk);
+}
+
+/**
+ * @brief Analyse un chemin et retourne le nœud correspondant (voir path_walk)
+ *
+ * @param path Le chemin à analyser (liens symboliques suivis)
+ * @return FileNode* Nœud désigné ; si seul le dernier composant manque, le
+ *         répertoire qui le recevrait ; NULL si le chemin est invalide
+ */
+FileNode* get_file_by_path(const char* path) {
+    PathWalk walk;
+    return path_walk(path, 1, &walk);
+}
+
+/**
+ * @brief Résout un chemin qui doit désigner une entrée existante
+ *
+ * @param path Le chemin à analyser
+ * @param follow 1 pour suivre un lien symbolique en dernier composant
+ * @param status Reçoit FS_ERR_NOT_FOUND si seul le dernier composant
+ *        manque, FS_ERR_LOOP si la résolution tourne en rond,
+ *        FS_ERR_INVALID_PATH si le chemin est invalide
+ * @return FileNode* Nœud désigné, NULL s'il n'existe pas
+ */
+static FileNode* path_resolve(const char* path, int follow, int* status) {
+    PathWalk walk;
+    FileNode* node = path_walk(path, follow, &walk);
+    if (node == NULL || walk.missing) {
+        *status = node == NULL ? walk.status : FS_ERR_NOT_FOUND;
+        return NULL;
+    }
+    return node;
+}
+
+/**
+ * @brief Résout un chemin qui doit désigner une entrée existante, liens suivis (voir path_resolve)
+ */
+static FileNode* path_lookup(const char* path, int* status) {
+    return path_resolve(path, 1, status);
+}
+
+/**
+ * @brief Résout le chemin d'un répertoire existant, liens suivis (voir path_lookup)
+ *
+ * @param path Chemin du répertoire (le parent d'une entrée, en général)
+ * @param status Reçoit FS_ERR_INVALID_PATH si le répertoire manque ou
+ *        n'en est pas un, FS_ERR_LOOP si la résolution tourne en rond
+ * @return FileNode* Répertoire désigné, NULL en cas d'échec
+ *
+ * @details
+ * Un parent manquant est traité comme un composant intermédiaire
+ * manquant (voir create_node) : il ne désigne jamais le répertoire qui
+ * le recevrait.
+ */
+static FileNode* dir_resolve(const char* path, int* status) {
+    FileNode* dir = path_lookup(path, status);
+    if (dir == NULL) {
+        if (*status == FS_ERR_NOT_FOUND) *status = FS_ERR_INVALID_PATH;
+        return NULL;
+    }
+    if (dir->type != DIRECTORY_TYPE) {
+        *status = FS_ERR_INVALID_PATH;
+        return NULL;
+    }
+    return dir;
+}
+
+static int node_path(FileNode* node, char* path);
+
+/**
+ * @brief Retire du cache de résolution le chemin d'une entrée de répertoire
+ *
+ * @param dir Répertoire de l'entrée
+ * @param name Nom de l'entrée, créée, supprimée ou déplacée
+ *
+ * @details
+ * À appeler une fois le changement visible. Rien n'est fait pour un
+ * répertoire supprimé : aucun chemin ne le traverse plus.
+ */
+static void dcache_forget(FileNode* dir, const char* name) {
+    char path[MAX_PATH_LENGTH];
+    if (node_path(dir, path) != 0) return;
+
+    size_t length = strlen(path);
+    size_t name_length = strlen(name);
+    if (length > 1) path[length++] = '/';
+    if (length + name_length > DCACHE_PATH_MAX) return;
+    memcpy(path + length, name, name_length);
+    dcache_invalidate(path, length + name_length);
+}
+
+
+/**
+ * @brief Trouve le répertoire qui recevra une nouvelle entrée
+ *
+ * @param path Chemin de la nouvelle entrée
+ * @param walk Reçoit l'état de la résolution (voir entry_created)
+ * @param name Reçoit le nom de l'entrée, dernier composant de path
+ * @param status Reçoit le code d'erreur d'un échec (FsError)
+ * @return FileNode* Répertoire parent, non verrouillé ; NULL si le nom
+ *         est trop long (FS_ERR_NAME_TOO_LONG), existe déjà
+ *         (FS_ERR_EXISTS) ou si le parent manque ou n'est pas un
+ *         répertoire (FS_ERR_INVALID_PATH)
+ *
+ * @details
+ * Le dernier composant n'est pas suivi : un lien existant porte déjà le
+ * nom. Partagée par la création de fichiers, de répertoires et de liens.
+ */
+static FileNode* entry_parent(const char* path, PathWalk* walk, const char** name, int* status) {
+    if (strlen(path) >= MAX_PATH_LENGTH) {
+        *status = FS_ERR_NAME_TOO_LONG;
+        return NULL;
+    }
+    // Extraire le nom à partir du chemin complet
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    if (strlen(base) >= MAX_NAME_LENGTH) {
+        *status = FS_ERR_NAME_TOO_LONG;
+        return NULL;
+    }
+
+    FileNode* parent = path_walk(path, 0, walk);
+    if (parent == NULL) {
+        *status = walk->status;
+        return NULL;
+    }
+    if (!walk->missing) {
+        *status = FS_ERR_EXISTS;
+        return NULL;
+    }
+    if (parent->type != DIRECTORY_TYPE || node_unlinked(parent)) {
+        *status = FS_ERR_INVALID_PATH;
+        return NULL;
+    }
+    *name = base;
+    return parent;
+}
+
+/**
+ * @brief Retire du cache de résolution l'entrée négative d'un nom créé
+ *
+ * @param path Chemin de la nouvelle entrée
+ * @param walk État de la résolution de path (voir entry_parent)
+ * @param parent Répertoire de l'entrée
+ * @param name Nom de l'entrée
+ *
+ * @details
+ * Le nom existe désormais : une entrée négative du cache est périmée,
+ * sous le chemin réel du parent si la résolution a suivi un lien.
+ */
+static void entry_created(const char* path, const PathWalk* walk, FileNode* parent, const char* name) {
+    DcacheKey key;
+    if (!walk->followed && dcache_key(path, &key) == 0) dcache_invalidate(path, key.length);
+    else dcache_forget(parent, name);
+}
+
+/**
+ * @brief Crée une entrée (fichier ou répertoire) désignée par un chemin
+ * 
+ * @param path Chemin de l'entrée à créer
+ * @param type Type de l'entrée (FILE_TYPE ou DIRECTORY_TYPE)
+ * @param permissions Permissions de l'entrée (format octal)
+ * @param charge Occupation de la nouvelle entrée, réservée sous les
+ *        quotas de ses ancêtres (voir usage_reserve)
+ * @param created Reçoit le nouveau nœud
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ * 
+ * @details
+ * - Refuse un chemin ou un nom trop long (FS_ERR_NAME_TOO_LONG) au lieu
+ *   de le tronquer
+ * - Vérifie si le répertoire parent existe et est valide, et qu'aucune
+ *   entrée ne porte déjà ce nom (voir entry_parent)
+ * - Initialise un nouveau nœud, qui hérite de la politique de
+ *   compression du parent, et met à jour le répertoire parent ; un
+ *   quota dépassé le refuse (FS_ERR_QUOTA)
+ * - Partagée par la création et la copie, qui sont chacune
+ *   journalisées comme une seule opération
+ * - Le nœud est renvoyé avec son parent encore verrouillé en écriture :
+ *   l'appelant le complète, journalise, puis appelle dir_unlock(node->parent)
+ */
+static int create_node(const char* path, FileType type, int permissions, const DiskUsage* charge,
+                       FileNode** created) {
+    PathWalk walk;
+    const char* name;
+    int status;
+    FileNode* parent = entry_parent(path, &walk, &name, &status);
+    if (parent == NULL) {
+        return status;
+    }
+    if (dir_lock_write(parent) != 0) {
+        return FS_ERR_NO_MEMORY;
+    }
+    
+    if (dir_find(parent->dir_data, name, strlen(name)) != NULL) {
+        dir_unlock(parent);
+        return FS_ERR_EXISTS;
+    }
+
+    FileNode* node = node_alloc(name, type, permissions);
+    if (node != NULL && parent->dir_data->compress) {
+        // Politique de compression héritée du répertoire (voir set_compression)
+        if (node->dir_data != NULL) node->dir_data->compress = 1;
+        else node->flags |= NODE_COMPRESS;
+    }
+    if (node == NULL || dir_prepare_child(parent) != 0) {
+        dir_unlock(parent);
+        if (node) node_free(node);
+        return FS_ERR_NO_MEMORY;
+    }
+    status = usage_reserve(parent, NULL, charge);
+    if (status != FS_OK) {
+        dir_unlock(parent);
+        node_free(node);
+        return status;
+    }
+    dir_link_child(parent, node);
+    entry_created(path, &walk, parent, name);
+    *created = node;
+    return FS_OK;
+}
 
 /**
  * @brief Crée un nouveau fichier dans le système
  * 
  * @param path Chemin du fichier à créer
  * @param permissions Permissions du fichier (format octal)
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
- * - Vérifie si le répertoire parent existe et est valide
- * - Vérifie si le répertoire n'est pas plein
- * - Initialise un nouveau nœud de type fichier
- * - Met à jour la structure du répertoire parent
+ * - Crée l'entrée dans le répertoire parent (voir create_node)
+ * - Journalise la création
  */
 int create_file(const char* path, int permissions) {
-    // Obtenir le répertoire parent et le nom du fichier
-    char path_copy[MAX_PATH_LENGTH];
-    char *filename;
-    strncpy(path_copy, path, MAX_PATH_LENGTH - 1);
-    
-    // Extraire le nom du fichier à partir du chemin complet
-    filename = strrchr(path_copy, '/');
-    filename = filename ? filename + 1 : path_copy;
-    
-    FileNode* parent = get_file_by_path(path);
-    if (parent == NULL || parent->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin invalide.\n");
-        return -1;
+    FileNode* node;
+    DiskUsage charge = { 1, 0, 0, 0 };
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = create_node(path, FILE_TYPE, permissions, &charge, &node);
+    if (status == FS_OK) {
+        journal_append(JOURNAL_CREATE_FILE, path, NULL, permissions);
+        dir_unlock(node->parent);
     }
-    
-    if (parent->child_count >= MAX_FILES) {
-        printf("Erreur : répertoire plein.\n");
-        return -1;
-    }
-
-    FileNode* new_file = (FileNode*)malloc(sizeof(FileNode));
-    strncpy(new_file->name, filename, MAX_NAME_LENGTH - 1);
-    new_file->name[MAX_NAME_LENGTH - 1] = '\0';
-    new_file->type = FILE_TYPE;
-    new_file->permissions = permissions;
-    new_file->size = 0;  // initialize size 0
-    new_file->parent = parent;
-    new_file->child_count = 0;
-    new_file->content = NULL;         
-    new_file->is_open = 0;  
-    new_file->ref_count = 1;        
-    new_file->symlink_target = NULL; 
-
-    parent->children[parent->child_count++] = new_file;
-    printf("Fichier '%s' créé avec permissions %d.\n", path, permissions);
-    return 0;
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
 }
 
 
@@ -313,237 +1769,661 @@ int create_file(const char* path, int permissions) {
  * 
  * @param path Chemin du répertoire à créer
  * @param permissions Permissions du répertoire (format octal)
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
- * - Vérifie si le répertoire parent existe et est valide
- * - Vérifie si le répertoire parent n'est pas plein
- * - Initialise un nouveau nœud de type répertoire
- * - Met à jour la structure du répertoire parent
+ * - Crée l'entrée dans le répertoire parent (voir create_node)
+ * - Journalise la création
  */
 int create_directory(const char* path, int permissions) {
-    // Obtenir le répertoire parent et le nom du répertoire
-    char path_copy[MAX_PATH_LENGTH];
-    char *dirname;
-    strncpy(path_copy, path, MAX_PATH_LENGTH - 1);
-    
-    // Extraire le nom du répertoire à partir du chemin complet
-    dirname = strrchr(path_copy, '/');
-    dirname = dirname ? dirname + 1 : path_copy;
-    
-    FileNode* parent = get_file_by_path(path);
-    if (parent == NULL || parent->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin invalide.\n");
-        return -1;
+    FileNode* node;
+    DiskUsage charge = { 0, 1, 0, 0 };
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = create_node(path, DIRECTORY_TYPE, permissions, &charge, &node);
+    if (status == FS_OK) {
+        journal_append(JOURNAL_CREATE_DIRECTORY, path, NULL, permissions);
+        dir_unlock(node->parent);
     }
-    
-    if (parent->child_count >= MAX_FILES) {
-        printf("Erreur : répertoire plein.\n");
-        return -1;
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Retourne l'inode d'un fichier, en le créant s'il n'existe pas
+ *
+ * @param file Fichier concerné
+ * @return FileData* Inode du fichier, NULL si la mémoire manque
+ *
+ * @details
+ * - Le nouvel inode reprend les permissions du nœud, qui ne changent
+ *   plus ensuite (voir node_set_permissions), et sa politique de
+ *   compression (NODE_COMPRESS, fixée à la création)
+ * - Deux threads peuvent écrire en même temps dans un fichier sans
+ *   inode : le premier à publier le sien gagne, l'autre libère le sien
+ */
+static FileData* file_data(FileNode* file) {
+    FileData* data = __atomic_load_n(&file->data, __ATOMIC_ACQUIRE);
+    if (data != NULL) return data;
+
+    FileData* fresh = data_alloc();
+    if (fresh == NULL) return NULL;
+    fresh->permissions = file->permissions;
+    if (file->flags & NODE_COMPRESS) fresh->flags = DATA_COMPRESS;
+    if (__atomic_compare_exchange_n(&file->data, &data, fresh, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return fresh;
+    }
+    data_release(fresh);
+    return data;
+}
+
+/**
+ * @brief Matérialise un répertoire et empile ses sous-répertoires (WalkDirFn)
+ */
+static void materialize_walk_dir(WalkWorker* worker, FileNode* dir, void* arg) {
+    int* failed = arg;
+    if (dir_lock_read(dir) != 0) {
+        __atomic_store_n(failed, 1, __ATOMIC_RELAXED);
+        return;
     }
+    DirData* data = dir->dir_data;
+    for (int i = 0; i < data->child_count; i++) {
+        if (data->children[i]->dir_data != NULL) walk_push(worker, data->children[i]);
+    }
+    dir_unlock(dir);
+}
+
+/**
+ * @brief Garantit que tous les noms d'un contenu sont dans FileData::names
+ *
+ * @param data Contenu sur le point d'être modifié (verrou non détenu)
+ *
+ * @details
+ * Les liens durs d'un contenu lu dans l'image projetée ne rejoignent
+ * names qu'à la matérialisation de leur répertoire (DATA_NAMES_PENDING) ;
+ * une variation de taille n'atteindrait pas les ancêtres des autres.
+ * Avant la première modification d'un tel contenu, toute l'arborescence
+ * est donc matérialisée, en parallèle. Cela n'arrive qu'une fois par
+ * chargement, et seulement si l'on écrit dans un fichier qui a des liens
+ * durs encore dans l'image.
+ */
+static void data_claim_names(FileData* data) {
+    if (!(__atomic_load_n(&data->flags, __ATOMIC_ACQUIRE) & DATA_NAMES_PENDING)) return;
+    int failed = 0;
+    walk_tree(root_directory, materialize_walk_dir, &failed);
+    if (!failed) __atomic_and_fetch(&data->flags, ~DATA_NAMES_PENDING, __ATOMIC_RELEASE);
+}
 
-    FileNode* new_dir = (FileNode*)malloc(sizeof(FileNode));
-    strncpy(new_dir->name, dirname, MAX_NAME_LENGTH - 1);  // Utiliser le nom extrait
-    new_dir->name[MAX_NAME_LENGTH - 1] = '\0';
-    new_dir->type = DIRECTORY_TYPE;
-    new_dir->permissions = permissions;
-    new_dir->size = 0;
-    new_dir->parent = parent;
-    new_dir->child_count = 0;
+/**
+ * @brief Permissions d'un nœud
+ *
+ * @param node Nœud concerné
+ * @return int Permissions de l'inode pour un fichier qui en a un (elles
+ *         sont communes à ses liens durs), celles du nœud sinon
+ */
+static int node_permissions(FileNode* node) {
+    FileData* data = __atomic_load_n(&node->data, __ATOMIC_ACQUIRE);
+    return data != NULL ? __atomic_load_n(&data->permissions, __ATOMIC_RELAXED) : node->permissions;
+}
 
-    parent->children[parent->child_count++] = new_dir;
-    printf("Répertoire '%s' créé avec permissions %d.\n", path, permissions);
+/**
+ * @brief Change les permissions d'un nœud
+ *
+ * @param node Nœud concerné (sous le verrou en écriture de son parent)
+ * @param permissions Nouvelles permissions (format octal)
+ * @return int 0 en cas de succès, -1 si l'inode ne peut être créé
+ *
+ * @details
+ * Les permissions d'un fichier sont toujours changées dans son inode,
+ * créé au besoin : ses liens durs les voient aussitôt, et celles du nœud
+ * ne sont jamais modifiées après sa création, ce qui permet à file_data
+ * de les recopier sans verrou.
+ */
+static int node_set_permissions(FileNode* node, int permissions) {
+    if (node->type != FILE_TYPE) {
+        node->permissions = permissions;
+        return 0;
+    }
+    FileData* data = file_data(node);
+    if (data == NULL) return -1;
+    __atomic_store_n(&data->permissions, permissions, __ATOMIC_RELAXED);
     return 0;
 }
 
 /**
- * @brief Liste le contenu d'un répertoire
+ * @brief Décrit un nœud
+ *
+ * @param node Nœud concerné (état protégé par le verrou de son parent)
+ * @param info Description à remplir
+ */
+static void node_info(FileNode* node, FileInfo* info) {
+    FileData* data = __atomic_load_n(&node->data, __ATOMIC_ACQUIRE);
+    info->type = node->type;
+    info->permissions = node_permissions(node);
+    info->size = node->type == FILE_TYPE ? data_size(data) : 0;
+    info->links = data != NULL ? __atomic_load_n(&data->links, __ATOMIC_RELAXED) : 1;
+    info->symlink = node->symlink_target != NULL;
+}
+
+/**
+ * @brief Parcourt les entrées d'un répertoire
  * 
  * @param path Chemin du répertoire à lister
+ * @param visit Fonction appelée pour chaque entrée, avec son nom et sa
+ *        description ; une valeur non nulle arrête le parcours
+ * @param arg Argument transmis à visit
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
- * - Affiche le chemin complet du répertoire
- * - Pour chaque entrée, affiche :
- *   - Le type (fichier ou répertoire)
- *   - Le nom
- *   - Les permissions
- *   - La taille (pour les fichiers uniquement)
+ * - Les entrées sont visitées dans l'ordre d'insertion
+ * - visit est appelée sous le verrou du répertoire, en lecture : elle ne
+ *   doit pas rappeler la bibliothèque
+ * - Rien n'est recopié : le nom n'est valide que pendant l'appel
+ */
+int list_directory(const char* path, DirVisitor visit, void* arg) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* dir = path_lookup(path, &status);
+    if (dir != NULL) {
+        status = dir->type != DIRECTORY_TYPE ? FS_ERR_NOT_DIRECTORY
+               : dir_lock_read(dir) != 0 ? FS_ERR_NO_MEMORY : FS_OK;
+    }
+    if (status != FS_OK) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return status;
+    }
+
+    FileInfo info;
+    for (int i = 0; i < dir->dir_data->child_count; i++) {
+        FileNode* node = dir->dir_data->children[i];
+        node_info(node, &info);
+        if (visit(node->name, &info, arg) != 0) break;
+    }
+    dir_unlock(dir);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return FS_OK;
+}
+
+/**
+ * @brief Verrouille un répertoire en lecture, son index ordonné construit
+ *
+ * @param dir Répertoire concerné
+ * @return int 0 en cas de succès, -1 si l'allocation échoue (rien n'est verrouillé)
+ *
+ * @details
+ * Le premier parcours trié d'un répertoire construit son index ordonné
+ * sous le verrou en écriture ; il est ensuite tenu à jour par
+ * dir_link_child et dir_remove_child, et n'est plus jamais retiré.
+ */
+static int dir_lock_ordered(FileNode* dir) {
+    if (dir_lock_read(dir) != 0) return -1;
+    if (dir->dir_data->order != NULL) return 0;
+    dir_unlock(dir);
+
+    if (dir_lock_write(dir) != 0) return -1;
+    DirData* data = dir->dir_data;
+    if (data->order == NULL) data->order = order_build(data->children, data->child_count);
+    int built = data->order != NULL;
+    dir_unlock(dir);
+    return built ? dir_lock_read(dir) : -1;
+}
+
+/**
+ * @brief Parcourt les entrées d'un répertoire dans l'ordre de leurs noms
+ *
+ * @param path Chemin du répertoire à lister
+ * @param after Nom à partir duquel reprendre, exclu (NULL : depuis le début)
+ * @param prefix Préfixe des noms à visiter (NULL ou "" : tous)
+ * @param visit Fonction appelée pour chaque entrée ; une valeur non nulle
+ *        arrête le parcours
+ * @param arg Argument transmis à visit
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Les noms sont comparés octet par octet, comme strcmp
+ * - Le parcours se place par recherche dans l'index ordonné
+ *   (voir fs_order.c) : une page de k entrées coûte O(log n + k) quelle
+ *   que soit la taille du répertoire
+ * - Pour paginer, rappeler avec after égal au dernier nom reçu : les
+ *   entrées ajoutées ou retirées entre deux appels sont vues ou non, sans
+ *   doublon ni saut des autres
+ * - visit est appelée sous le verrou du répertoire, en lecture, comme
+ *   pour list_directory
+ */
+int list_directory_sorted(const char* path, const char* after, const char* prefix, DirVisitor visit, void* arg) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* dir = path_lookup(path, &status);
+    if (dir != NULL) {
+        status = dir->type != DIRECTORY_TYPE ? FS_ERR_NOT_DIRECTORY
+               : dir_lock_ordered(dir) != 0 ? FS_ERR_NO_MEMORY : FS_OK;
+    }
+    if (status != FS_OK) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return status;
+    }
+
+    // Point de départ : le plus loin du nom de reprise (exclu) et du préfixe (inclus)
+    size_t prefix_length = prefix != NULL ? strlen(prefix) : 0;
+    OrderCursor cursor;
+    if (after != NULL && (prefix_length == 0 || strcmp(after, prefix) >= 0)) {
+        order_seek(dir->dir_data->order, after, strlen(after), 1, &cursor);
+    } else {
+        order_seek(dir->dir_data->order, prefix_length ? prefix : NULL, prefix_length, 0, &cursor);
+    }
+
+    FileInfo info;
+    for (FileNode* node; (node = order_next(&cursor)) != NULL;) {
+        if (prefix_length > 0 &&
+            (node->name_length < prefix_length || memcmp(node->name, prefix, prefix_length) != 0)) {
+            break;
+        }
+        node_info(node, &info);
+        if (visit(node->name, &info, arg) != 0) break;
+    }
+    dir_unlock(dir);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return FS_OK;
+}
+
+/**
+ * @brief Décrit un fichier ou un répertoire
+ *
+ * @param path Chemin de l'entrée
+ * @param info Description à remplir
+ * @return int 0 en cas de succès, FS_ERR_NOT_FOUND ou FS_ERR_INVALID_PATH
+ *         si le chemin n'existe pas, FS_ERR_LOOP si ses liens tournent en rond
+ *
+ * @details
+ * - Un lien symbolique final est suivi : la cible est décrite (voir lstat_file)
+ * - Les permissions sont lues sous le verrou du répertoire parent
+ */
+int stat_file(const char* path, FileInfo* info) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* node = path_lookup(path, &status);
+    if (node != NULL) {
+        FileNode* parent = node == root_directory || node_unlinked(node) ? NULL : node_lock_parent(node, 0);
+        node_info(node, info);
+        if (parent != NULL) dir_unlock(parent);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Décrit une entrée sans suivre un lien symbolique final
+ *
+ * @param path Chemin de l'entrée
+ * @param info Description à remplir ; pour un lien, celle du lien
+ *        lui-même (info->symlink vaut 1)
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * Les liens des composants intermédiaires sont suivis, comme pour stat_file.
+ */
+int lstat_file(const char* path, FileInfo* info) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* node = path_resolve(path, 0, &status);
+    if (node != NULL) {
+        FileNode* parent = node == root_directory || node_unlinked(node) ? NULL : node_lock_parent(node, 0);
+        node_info(node, info);
+        if (parent != NULL) dir_unlock(parent);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Chemin absolu canonique d'une entrée, liens symboliques résolus
+ *
+ * @param path Chemin de l'entrée (relatif ou absolu)
+ * @param resolved Tampon de MAX_PATH_LENGTH octets : chemin absolu, sans
+ *        composant "." ni ".." ni lien symbolique
+ * @return int 0 en cas de succès, FS_ERR_NAME_TOO_LONG si le chemin réel
+ *         dépasse MAX_PATH_LENGTH, code d'erreur (FsError) de la résolution sinon
+ *
+ * @details
+ * Le chemin est reconstruit en remontant les parents du nœud désigné
+ * (voir node_path), sans nouvelle résolution.
+ */
+int real_path(const char* path, char* resolved) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* node = path_lookup(path, &status);
+    if (node != NULL) {
+        status = node_path(node, resolved);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Ouvre un répertoire pour le parcourir par lots
+ *
+ * @param path Chemin du répertoire
+ * @param cursor Curseur à initialiser
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * Le répertoire est retenu (node_pin) jusqu'à close_directory : supprimé
+ * entre-temps, il n'est plus qu'un répertoire vide détaché.
+ */
+int open_directory(const char* path, DirCursor* cursor) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* dir = path_lookup(path, &status);
+    if (dir != NULL && dir->type != DIRECTORY_TYPE) {
+        status = FS_ERR_NOT_DIRECTORY;
+    } else if (dir != NULL) {
+        node_pin(dir);
+        cursor->dir = dir;
+        cursor->position = 0;
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Lit les entrées suivantes d'un répertoire ouvert
+ *
+ * @param cursor Curseur ouvert par open_directory
+ * @param entries Entrées à remplir (noms recopiés, aucune allocation)
+ * @param count Nombre maximal d'entrées
+ * @return int Nombre d'entrées lues, 0 à la fin du répertoire, code
+ *         d'erreur (FsError) en cas d'échec
+ *
+ * @details
+ * - Les entrées sont renvoyées dans l'ordre d'insertion ; le curseur
+ *   retient le numéro d'insertion de la dernière (DirData::child_seqs),
+ *   pas son rang : la suite est retrouvée par recherche dichotomique
+ * - Une entrée ajoutée pendant le parcours est renvoyée une fois, à la
+ *   fin ; une entrée supprimée ne décale pas les suivantes. Une entrée
+ *   présente tout le long du parcours est renvoyée exactement une fois
+ * - Le verrou du répertoire n'est tenu que le temps de copier un lot
  */
-void list_files(const char* path) {
-    char path_copy[MAX_PATH_LENGTH];
-    strncpy(path_copy, path, MAX_PATH_LENGTH - 1);
-    path_copy[MAX_PATH_LENGTH - 1] = '\0';
-    
-    FileNode* dir = get_file_by_path(path);
-    if (dir == NULL || dir->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin invalide.\n");
-        return;
-    }
-    
-    if (dir->child_count == 0) {
-        printf("Répertoire vide.\n");
-        return;
+int read_directory(DirCursor* cursor, DirEntry* entries, int count) {
+    if (cursor->dir == NULL || count < 1) return FS_ERR_INVALID;
+
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* dir = cursor->dir;
+    if (dir_lock_read(dir) != 0) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return FS_ERR_NO_MEMORY;
     }
 
-    // Afficher le chemin complet du répertoire
-    printf("Contenu du répertoire '%s' :\n", 
-           strcmp(path, ".") == 0 ? get_current_path() : path);
+    // Premier enfant ajouté après la dernière entrée renvoyée
+    DirData* data = dir->dir_data;
+    int low = 0, high = data->child_count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (data->child_seqs[mid] <= cursor->position) low = mid + 1;
+        else high = mid;
+    }
 
-    for (int i = 0; i < dir->child_count; i++) {
-        FileNode* node = dir->children[i];
-        printf("%s %s, permissions : %d", 
-            node->type == DIRECTORY_TYPE ? "Répertoire" : "Fichier",
-            node->name, 
-            node->permissions);
-        if (node->type == FILE_TYPE) {
-            printf(", taille : %d", node->size);
-        }
-        printf("\n");
+    int read = 0;
+    for (int i = low; i < data->child_count && read < count; i++, read++) {
+        FileNode* node = data->children[i];
+        memcpy(entries[read].name, node->name, node->name_length + 1);
+        node_info(node, &entries[read].info);
+        cursor->position = data->child_seqs[i];
     }
+    dir_unlock(dir);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return read;
+}
+
+/**
+ * @brief Ferme un curseur de répertoire
+ *
+ * @param cursor Curseur ouvert par open_directory (rien à faire s'il est
+ *        déjà fermé)
+ */
+void close_directory(DirCursor* cursor) {
+    if (cursor->dir == NULL) return;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    node_unpin(cursor->dir);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    cursor->dir = NULL;
 }
 
 /**
  * @brief Change le répertoire de travail courant
  * 
  * @param path Chemin du répertoire cible
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
  * - Gère les cas spéciaux : ".." (parent), "/" (racine), "." (courant)
  * - Vérifie si le chemin cible est un répertoire valide
- * - Met à jour le répertoire de travail courant
+ * - Met à jour le répertoire de travail de la session courante
+ * - Appelée sous fs_tree_lock en lecture
  */
-int change_directory(const char* path) {
+static int change_directory_locked(const char* path) {
     if (strcmp(path, "..") == 0) {
         // Retourner au répertoire parent
-        if (current_directory->parent != NULL) {
-            current_directory = current_directory->parent;
-            printf("Changement vers le répertoire parent\n");
-            return 0;
+        Session* session = session_current();
+        FileNode* parent = __atomic_load_n(&session->cwd->parent, __ATOMIC_ACQUIRE);
+        if (parent != NULL) {
+            session_set_cwd(session, parent);
+            return FS_OK;
         } else {
-            printf("Erreur : déjà à la racine\n");
-            return -1;
+            return FS_ERR_AT_ROOT;
         }
     } else if (strcmp(path, "/") == 0) {
         // Aller au répertoire racine
-        current_directory = root_directory;
-        printf("Changement vers le répertoire racine\n");
-        return 0;
+        session_set_cwd(session_current(), root_directory);
+        return FS_OK;
     } else if (strcmp(path, ".") == 0) {
         // Current directory, faire rien
         return 0;
     } else {
-        FileNode* target = NULL;
-        
-        // Trouver le répertoire cible
-        if (path[0] != '/') {
-            // Change to a subdirectory
-            for (int i = 0; i < current_directory->child_count; i++) {
-                if (strcmp(current_directory->children[i]->name, path) == 0 && 
-                    current_directory->children[i]->type == DIRECTORY_TYPE) {
-                    target = current_directory->children[i];
-                    break;
-                }
-            }
-        } else {
-            // Trouver le répertoire cible à partir de la racine
-            target = get_file_by_path(path);
-            if (target != NULL && target->type != DIRECTORY_TYPE) {
-                target = NULL;
-            }
-        }
-        
+        // Trouver le répertoire cible, relatif ou absolu (liens suivis)
+        int status;
+        FileNode* target = path_lookup(path, &status);
         if (target == NULL) {
-            printf("Erreur : répertoire '%s' non trouvé\n", path);
-            return -1;
+            return status;
+        }
+        if (target->type != DIRECTORY_TYPE) {
+            return FS_ERR_NOT_DIRECTORY;
         }
         
-        current_directory = target;
-        printf("Changement vers le répertoire '%s'\n", path);
-        return 0;
+        session_set_cwd(session_current(), target);
+        return FS_OK;
     }
 }
 
+/**
+ * @brief Change le répertoire de travail courant (voir change_directory_locked)
+ *
+ * @param path Chemin du répertoire cible
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ */
+int change_directory(const char* path) {
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = change_directory_locked(path);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
 /**
  * @brief Copie un fichier vers une nouvelle destination
  * 
  * @param source Chemin du fichier source
  * @param destination Chemin de destination
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
  * - Vérifie l'existence et la validité du fichier source
  * - Crée un nouveau fichier à la destination
- * - Copie les permissions et le contenu
+ * - Copie les permissions ; le contenu est partagé bloc par bloc avec la
+ *   source (copie sur écriture) : le coût ne dépend pas de sa taille
  * - Gère les erreurs de chemin et de permissions
+ * - Journalise l'opération réussie
+ * - Appelée sous fs_tree_lock en lecture
  */
-int copy_file(const char* source, const char* destination) {
-    // Obtenir les informations du chemin source
-    char src_path[MAX_PATH_LENGTH];
-    char *src_name;
-    strncpy(src_path, source, MAX_PATH_LENGTH - 1);
-    src_path[MAX_PATH_LENGTH - 1] = '\0';
-    
-    // Chercher le fichier source dans le répertoire parent
-    char parent_path[MAX_PATH_LENGTH] = ".";
-    src_name = strrchr(src_path, '/');
-    if (src_name) {
-        strncpy(parent_path, src_path, src_name - src_path);
-        parent_path[src_name - src_path] = '\0';
-        src_name++;
-    } else {
-        src_name = src_path;
+static int copy_file_locked(const char* source, const char* destination) {
+    // Chercher le fichier source (un lien symbolique est suivi)
+    int status;
+    FileNode* src_file = path_lookup(source, &status);
+    if (src_file == NULL) {
+        return status;
     }
-    
-    FileNode* parent = get_file_by_path(parent_path);
-    if (parent == NULL || parent->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin source invalide.\n");
-        return -1;
+    if (src_file->type != FILE_TYPE) {
+        return FS_ERR_IS_DIRECTORY;
     }
     
-    // Charger le fichier source
-    FileNode* src_file = NULL;
-    for (int i = 0; i < parent->child_count; i++) {
-        if (strcmp(parent->children[i]->name, src_name) == 0 && 
-            parent->children[i]->type == FILE_TYPE) {
-            src_file = parent->children[i];
-            break;
+    // Partager les blocs du fichier source (un fichier vide reste vide)
+    FileData* data = __atomic_load_n(&src_file->data, __ATOMIC_ACQUIRE);
+    FileData* copy = NULL;
+    if (data != NULL) {
+        pthread_rwlock_rdlock(&data->lock);
+        copy = data_clone(data);
+        pthread_rwlock_unlock(&data->lock);
+        if (copy == NULL) {
+            return FS_ERR_NO_MEMORY;
         }
     }
-    
-    if (src_file == NULL) {
-        printf("Erreur : fichier source '%s' non trouvé.\n", src_name);
-        return -1;
-    }
-    
+
     // Copyer le fichier source
-    if (create_file(destination, src_file->permissions) == 0) {
-        // Copyer le contenu du fichier source
-        FileNode* dest_file = get_file_by_path(destination);
-        if (dest_file != NULL && src_file->content != NULL) {
-            dest_file->content = strdup(src_file->content);
-            dest_file->size = src_file->size;
-            printf("Fichier '%s' copié vers '%s'.\n", source, destination);
-            return 0;
-        }
+    FileNode* dest_file;
+    DiskUsage charge = { 1, 0, data_size(copy), data_stored(copy) };
+    status = create_node(destination, FILE_TYPE, node_permissions(src_file), &charge, &dest_file);
+    if (status != FS_OK) {
+        data_release(copy);
+        return status;
     }
-    return -1;
+    dest_file->data = copy;
+    journal_append(JOURNAL_COPY, source, destination, 0);
+    dir_unlock(dest_file->parent);
+    return FS_OK;
 }
 
 /**
- * @brief Déplace un fichier vers une nouvelle destination
- * 
+ * @brief Copie un fichier vers une nouvelle destination (voir copy_file_locked)
+ *
  * @param source Chemin du fichier source
  * @param destination Chemin de destination
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ */
+int copy_file(const char* source, const char* destination) {
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = copy_file_locked(source, destination);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Premier ancêtre commun de deux répertoires rattachés
+ *
+ * @param a Premier répertoire
+ * @param b Second répertoire
+ * @return FileNode* Ancêtre commun le plus profond (a ou b si l'un contient l'autre)
+ */
+static FileNode* node_common_ancestor(FileNode* a, FileNode* b) {
+    int depth_a = 0, depth_b = 0;
+    for (FileNode* node = a; node->parent != NULL; node = node->parent) depth_a++;
+    for (FileNode* node = b; node->parent != NULL; node = node->parent) depth_b++;
+    for (; depth_a > depth_b; depth_a--) a = a->parent;
+    for (; depth_b > depth_a; depth_b--) b = b->parent;
+    while (a != b) {
+        a = a->parent;
+        b = b->parent;
+    }
+    return a;
+}
+
+/**
+ * @brief Détache un nœud de son répertoire et le rattache à un autre
+ *
+ * @param parent Répertoire actuel du nœud (verrouillé en écriture)
+ * @param node Nœud à déplacer
+ * @param src_name Nom sous lequel le nœud a été trouvé
+ * @param dest_dir Répertoire de destination (verrouillé en écriture)
+ * @param dest_name Nouveau nom du nœud
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon ;
+ *         FS_ERR_MOVE_INTO_SELF si dest_dir est dans la descendance du
+ *         nœud ; FS_ERR_QUOTA si un ancêtre de dest_dir dépasserait son quota
+ *
+ * @details
+ * - Revalide la source et la destination : le nœud a pu être déplacé
+ *   ou le nom pris entre la résolution des chemins et le verrouillage
+ * - Parcourt les ancêtres de dest_dir sous fs_rename_lock, qui fige les
+ *   parents de tous les nœuds
+ * - L'occupation du nœud passe des ancêtres de parent à ceux de
+ *   dest_dir ; leurs ancêtres communs ne changent pas (un renommage sur
+ *   place n'est jamais refusé par un quota)
+ */
+static int move_relink(FileNode* parent, FileNode* node, const char* src_name,
+                       FileNode* dest_dir, const char* dest_name) {
+    if (dir_find(parent->dir_data, src_name, strlen(src_name)) != node) {
+        return FS_ERR_NOT_FOUND;
+    }
+    if (dir_find(dest_dir->dir_data, dest_name, strlen(dest_name)) != NULL) {
+        return FS_ERR_EXISTS;
+    }
+
+    // Tout allouer avant de modifier l'arborescence
+    size_t name_length = strlen(dest_name);
+    unsigned int hash = hash_name_n(dest_name, name_length);
+    const char* name = name_intern(dest_name, name_length, hash);
+    if (name == NULL) return FS_ERR_NO_MEMORY;
+    if (dir_prepare_child(dest_dir) != 0) {
+        name_release(name);
+        return FS_ERR_NO_MEMORY;
+    }
+
+    pthread_mutex_lock(&fs_rename_lock);
+    // Un répertoire ne peut pas devenir son propre descendant
+    for (FileNode* ancestor = dest_dir; ancestor != NULL; ancestor = ancestor->parent) {
+        if (ancestor == node) {
+            pthread_mutex_unlock(&fs_rename_lock);
+            name_release(name);
+            return FS_ERR_MOVE_INTO_SELF;
+        }
+    }
+    DiskUsage moved;
+    node_usage(node, &moved);
+    FileNode* common = node_common_ancestor(parent, dest_dir);
+    int status = usage_reserve(dest_dir, common, &moved);
+    if (status != FS_OK) {
+        pthread_mutex_unlock(&fs_rename_lock);
+        name_release(name);
+        return status;
+    }
+    DiskUsage undo = usage_negate(&moved);
+    usage_add(parent, common, &undo);
+    dir_remove_child(parent, node);
+    node_take_name(node, name, name_length, hash);
+    dir_link_child(dest_dir, node);
+    pthread_mutex_unlock(&fs_rename_lock);
+    return FS_OK;
+}
+
+/**
+ * @brief Déplace ou renomme un fichier ou un répertoire
+ * 
+ * @param source Chemin de l'entrée à déplacer
+ * @param destination Nouveau chemin, ou répertoire existant qui recevra l'entrée
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
- * - Vérifie l'existence et la validité du fichier source
- * - Crée un nouveau fichier à la destination
- * - Copie les permissions et le contenu
- * - Supprime le fichier source après la copie
+ * - Vérifie l'existence de la source et de la destination
+ * - Si la destination est un répertoire existant, l'entrée y est déplacée
+ *   sous son nom ; sinon, le dernier composant donne le nouveau nom
+ * - Refuse de déplacer un répertoire dans sa propre descendance
+ * - Le nœud est détaché de son parent puis rattaché au nouveau : ni son
+ *   contenu ni ses descendants ne sont touchés, le coût ne dépend pas de
+ *   la taille du sous-arbre
+ * - Toutes les allocations (nom, place dans le répertoire de destination)
+ *   sont faites avant la première modification : en cas d'échec,
+ *   l'arborescence est inchangée
+ * - Journalise l'opération réussie
+ * - Appelée sous fs_tree_lock en lecture ; les deux répertoires sont
+ *   verrouillés en écriture (voir move_relink)
  */
-int move_file(const char* source, const char* destination) {
+static int move_file_locked(const char* source, const char* destination) {
     // Obtenir les informations du chemin source
     char src_path[MAX_PATH_LENGTH];
     char *src_name;
@@ -554,53 +2434,153 @@ int move_file(const char* source, const char* destination) {
     char parent_path[MAX_PATH_LENGTH] = ".";
     src_name = strrchr(src_path, '/');
     if (src_name) {
-        strncpy(parent_path, src_path, src_name - src_path);
-        parent_path[src_name - src_path] = '\0';
+        size_t length = src_name - src_path;
+        if (length == 0) length = 1;  // Parent de "/nom" : la racine
+        strncpy(parent_path, src_path, length);
+        parent_path[length] = '\0';
         src_name++;
     } else {
         src_name = src_path;
     }
     
-    FileNode* parent = get_file_by_path(parent_path);
-    if (parent == NULL || parent->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin source invalide.\n");
-        return -1;
+    int status;
+    FileNode* parent = dir_resolve(parent_path, &status);
+    if (parent == NULL) {
+        return status;
     }
     
     // Chercher le fichier source dans le répertoire parent
-    FileNode* src_file = NULL;
-    int src_index = -1;
-    for (int i = 0; i < parent->child_count; i++) {
-        if (strcmp(parent->children[i]->name, src_name) == 0) {
-            src_file = parent->children[i];
-            src_index = i;
-            break;
-        }
-    }
+    FileNode* src_file = dir_lookup(parent, src_name);
     
     if (src_file == NULL) {
-        printf("Erreur : fichier source '%s' non trouvé.\n", src_name);
-        return -1;
+        return FS_ERR_NOT_FOUND;
     }
-    
-    if (create_file(destination, src_file->permissions) == 0) {
-        // Copyer le contenu du fichier source
-        FileNode* dest_file = get_file_by_path(destination);
-        if (dest_file != NULL && src_file->content != NULL) {
-            dest_file->content = strdup(src_file->content);
-            dest_file->size = src_file->size;
-            
-            // Supprimer le fichier source
-            for (int i = src_index; i < parent->child_count - 1; i++) {
-                parent->children[i] = parent->children[i + 1];
-            }
-            parent->child_count--;
-            free(src_file);
-            printf("Fichier '%s' déplacé vers '%s'.\n", source, destination);
-            return 0;
+
+    // Répertoire de destination et nouveau nom
+    char dest_path[MAX_PATH_LENGTH];
+    char dest_parent_path[MAX_PATH_LENGTH] = ".";
+    if (strlen(destination) >= MAX_PATH_LENGTH) {
+        return FS_ERR_NAME_TOO_LONG;
+    }
+    strcpy(dest_path, destination);
+    const char* dest_name = strrchr(dest_path, '/');
+    if (dest_name) {
+        size_t length = dest_name - dest_path;
+        if (length == 0) length = 1;  // Parent de "/nom" : la racine
+        strncpy(dest_parent_path, dest_path, length);
+        dest_parent_path[length] = '\0';
+        dest_name++;
+    } else {
+        dest_name = dest_path;
+    }
+
+    // Le répertoire de destination doit exister : un parent manquant ne
+    // désigne pas le répertoire qui le recevrait
+    FileNode* dest_dir;
+    if (*dest_name == '\0' || strcmp(dest_name, ".") == 0 || strcmp(dest_name, "..") == 0) {
+        // Le chemin désigne forcément un répertoire existant
+        dest_dir = dir_resolve(dest_path, &status);
+        dest_name = src_name;
+    } else {
+        dest_dir = dir_resolve(dest_parent_path, &status);
+        FileNode* existing = dest_dir ? dir_lookup(dest_dir, dest_name) : NULL;
+        if (existing != NULL && existing->type == DIRECTORY_TYPE) {
+            // Déplacer dans le répertoire existant en gardant le nom
+            dest_dir = existing;
+            dest_name = src_name;
+        }
+    }
+    if (dest_dir == NULL) {
+        return status;
+    }
+    if (node_unlinked(dest_dir)) {
+        return FS_ERR_INVALID_PATH;
+    }
+    if (strlen(dest_name) >= MAX_NAME_LENGTH) {
+        return FS_ERR_NAME_TOO_LONG;
+    }
+
+    // Verrouiller les deux répertoires par ordre d'adresse
+    FileNode* first = parent < dest_dir ? parent : dest_dir;
+    FileNode* second = parent < dest_dir ? dest_dir : parent;
+    if (dir_lock_write(first) != 0) {
+        return FS_ERR_NO_MEMORY;
+    }
+    if (second != first && dir_lock_write(second) != 0) {
+        dir_unlock(first);
+        return FS_ERR_NO_MEMORY;
+    }
+
+    status = move_relink(parent, src_file, src_name, dest_dir, dest_name);
+    if (status == FS_OK) {
+        // Tous les chemins qui traversent un répertoire déplacé sont périmés
+        if (src_file->type == DIRECTORY_TYPE) {
+            dcache_flush();
+        } else {
+            dcache_forget(parent, src_name);
+            dcache_forget(dest_dir, dest_name);
+            dcache_link_flush();
         }
+        journal_append(JOURNAL_MOVE, source, destination, 0);
+    }
+    if (second != first) dir_unlock(second);
+    dir_unlock(first);
+    return status;
+}
+
+/**
+ * @brief Déplace ou renomme un fichier ou un répertoire (voir move_file_locked)
+ *
+ * @param source Chemin de l'entrée à déplacer
+ * @param destination Nouveau chemin, ou répertoire existant qui recevra l'entrée
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * fs_tree_lock est pris en écriture : une écriture concurrente est
+ * journalisée sous un chemin qui reste valide jusqu'à son
+ * enregistrement, et se rejoue donc sur le même fichier.
+ */
+int move_file(const char* source, const char* destination) {
+    pthread_rwlock_wrlock(&fs_tree_lock);
+    int status = move_file_locked(source, destination);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Libère un nœud retiré de l'arborescence, ou le détache s'il est retenu
+ *
+ * @param node Nœud sans parent ni enfants à traiter
+ *
+ * @details
+ * Un nœud retenu par une session (fichier ouvert, répertoire de travail,
+ * curseur) est seulement détaché : parent à NULL, et plus d'enfants à
+ * lire dans l'image ; le dernier node_unpin le libère.
+ */
+static void node_discard(FileNode* node) {
+    if (__atomic_load_n(&node->open_count, __ATOMIC_ACQUIRE) > 0) {
+        if (node->dir_data != NULL) node->dir_data->image_pending = 0;
+        __atomic_store_n(&node->parent, NULL, __ATOMIC_RELEASE);
+        return;
+    }
+    node_free(node);
+}
+
+/**
+ * @brief Supprime les enfants d'un répertoire puis le répertoire (WalkDirFn)
+ *
+ * @details
+ * Les sous-répertoires sont confiés au parcours avant que leur parent ne
+ * soit libéré : chacun ne dépend plus que de lui-même.
+ */
+static void delete_walk_dir(WalkWorker* worker, FileNode* dir, void* arg) {
+    DirData* data = dir->dir_data;
+    while (data->child_count > 0) {
+        FileNode* child = data->children[--data->child_count];
+        if (child->dir_data != NULL) walk_push(worker, child);
+        else node_discard(child);
     }
-    return -1;
+    node_discard(dir);
 }
 
 /**
@@ -609,35 +2589,78 @@ int move_file(const char* source, const char* destination) {
  * @param node Pointeur vers le nœud à supprimer
  * 
  * @details
- * - Supprime récursivement tous les nœuds enfants
- * - Libère la mémoire allouée pour le nœud
- * - Gère les cas de répertoires et fichiers
+ * - Les sous-répertoires sont supprimés en parallèle (walk_tree)
+ * - Libère la mémoire allouée pour le nœud : les nœuds et les noms
+ *   retournent dans leurs dalles, free n'est appelé que pour les
+ *   dalles vidées (voir fs_alloc.c)
+ * - Un nœud retenu par une session n'est que détaché (node_discard)
+ * - Appelée sous fs_tree_lock en écriture
  */
 void recursive_delete(FileNode* node) {
-    // Supprimer d'abord tous les nœuds enfants récursivement
     if (node == NULL) return;
-    
-    while (node->child_count > 0) {
-        recursive_delete(node->children[node->child_count - 1]);
-        node->child_count--;
+    if (node->dir_data != NULL) {
+        walk_tree(node, delete_walk_dir, NULL);
+    } else {
+        node_discard(node);
     }
-    
-    
-    free(node);
+}
+
+/**
+ * @brief Libère les ressources hors dalles d'un sous-arbre
+ *
+ * @param node Racine du sous-arbre
+ */
+static void subtree_release_heap(FileNode* node) {
+    if (node->dir_data != NULL) {
+        for (int i = 0; i < node->dir_data->child_count; i++) {
+            subtree_release_heap(node->dir_data->children[i]);
+        }
+    }
+    node_release_heap(node);
+}
+
+/**
+ * @brief Détruit toute l'arborescence en bloc
+ *
+ * @details
+ * - Libère les tableaux d'enfants, les index et les grands contenus
+ * - Libère la projection de l'image, dont les nœuds empruntaient les données
+ * - Libère ensuite toutes les dalles d'un coup : les nœuds, les noms et
+ *   les petits contenus ne sont pas libérés un par un
+ * - Relâche le répertoire de travail et les descripteurs de la session
+ *   par défaut ; les autres sessions doivent avoir été détruites
+ * - root_directory devient NULL
+ */
+void tree_release() {
+    // Libère d'abord les fichiers supprimés que seuls ses descripteurs retenaient
+    session_release(&fs_default_session);
+    dcache_flush();
+    if (root_directory != NULL) {
+        subtree_release_heap(root_directory);
+    }
+    unmap_image();
+    dedup_reset();
+    names_reset();
+    small_release_all();
+    root_directory = NULL;
 }
 
 /**
  * @brief Supprime un fichier ou un répertoire
  * 
  * @param filename Chemin du fichier ou répertoire à supprimer
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
  * - Vérifie l'existence et la validité du chemin
  * - Gère la suppression récursive pour les répertoires
- * - Met à jour la structure du répertoire parent
+ * - Met à jour la structure du répertoire parent et retire l'occupation
+ *   du sous-arbre de celle de ses ancêtres
+ * - Journalise l'opération réussie
+ * - Appelée sous fs_tree_lock en écriture : aucune autre opération ne
+ *   peut utiliser les nœuds libérés
  */
-int delete_file(const char* filename) {
+static int delete_file_locked(const char* filename) {
     // Obtenir le nom du fichier après le dernier '/'
     char path_copy[MAX_PATH_LENGTH];
     char *name;
@@ -651,49 +2674,57 @@ int delete_file(const char* filename) {
     // Extraction du nom du fichier à partir du chemin complet
     char parent_path[MAX_PATH_LENGTH] = ".";
     if (name != path_copy) {
-        strncpy(parent_path, path_copy, name - path_copy);
-        parent_path[name - path_copy - 1] = '\0';
+        size_t length = name - path_copy - 1;
+        if (length == 0) length = 1;  // Parent de "/nom" : la racine
+        strncpy(parent_path, path_copy, length);
+        parent_path[length] = '\0';
     }
     
-    FileNode* parent = get_file_by_path(parent_path);
-    if (parent == NULL || parent->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin invalide.\n");
-        return -1;
+    int status;
+    FileNode* parent = dir_resolve(parent_path, &status);
+    if (parent == NULL) {
+        return status;
     }
     
     // Trouver le fichier cible
-    FileNode* target = NULL;
-    int target_index = -1;
-    for (int i = 0; i < parent->child_count; i++) {
-        if (strcmp(parent->children[i]->name, name) == 0) {
-            target = parent->children[i];
-            target_index = i;
-            break;
-        }
-    }
+    FileNode* target = dir_lookup(parent, name);
     
     if (target == NULL) {
-        printf("Erreur : fichier '%s' non trouvé.\n", name);
-        return -1;
+        return FS_ERR_NOT_FOUND;
     }
     
-    // Si c'est un répertoire, supprimer récursivement
-    if (target->type == DIRECTORY_TYPE) {
-        recursive_delete(target);
-    } else {
-        free(target);
-    }
+    // Supprimer le nœud du parent avant de le libérer, avec son occupation
+    DiskUsage removed;
+    node_usage(target, &removed);
+    removed = usage_negate(&removed);
+    usage_add(parent, NULL, &removed);
+    dir_remove_child(parent, target);
+    int is_directory = target->type == DIRECTORY_TYPE;
+    // Tous les chemins qui traversent un répertoire supprimé sont périmés
+    if (is_directory) dcache_flush();
+    else dcache_forget(parent, name);
+    // Un lien dont la cible passait par ce nom ne la désigne plus
+    dcache_link_flush();
     
-    // Supprimer le nœud du parent
-    for (int i = target_index; i < parent->child_count - 1; i++) {
-        parent->children[i] = parent->children[i + 1];
-    }
-    parent->child_count--;
+    // Supprimer récursivement ; un nœud encore ouvert par une session
+    // n'est que détaché (voir recursive_delete)
+    recursive_delete(target);
     
-    printf("%s '%s' supprimé.\n", 
-           target->type == DIRECTORY_TYPE ? "Répertoire" : "Fichier", 
-           name);
-    return 0;
+    journal_append(JOURNAL_DELETE, filename, NULL, 0);
+    return FS_OK;
+}
+
+/**
+ * @brief Supprime un fichier ou un répertoire (voir delete_file_locked)
+ *
+ * @param filename Chemin du fichier ou répertoire à supprimer
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ */
+int delete_file(const char* filename) {
+    pthread_rwlock_wrlock(&fs_tree_lock);
+    int status = delete_file_locked(filename);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
 }
 
 /**
@@ -701,14 +2732,17 @@ int delete_file(const char* filename) {
  * 
  * @param filename Chemin du fichier ou répertoire
  * @param permissions Nouvelles permissions (format octal)
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
  * - Vérifie l'existence et la validité du chemin
  * - Met à jour les permissions du fichier ou répertoire
  * - Gère les erreurs de chemin invalide
+ * - Journalise l'opération réussie
+ * - Appelée sous fs_tree_lock en lecture ; les permissions sont modifiées
+ *   sous le verrou du répertoire parent
  */
-int set_permissions(const char* filename, int permissions) {
+static int set_permissions_locked(const char* filename, int permissions) {
     // Obtenir le nom du fichier après le dernier '/'
     char path_copy[MAX_PATH_LENGTH];
     char *name;
@@ -722,90 +2756,530 @@ int set_permissions(const char* filename, int permissions) {
     
     char parent_path[MAX_PATH_LENGTH] = ".";
     if (name != path_copy) {
-        strncpy(parent_path, path_copy, name - path_copy);
-        parent_path[name - path_copy - 1] = '\0';
+        size_t length = name - path_copy - 1;
+        if (length == 0) length = 1;  // Parent de "/nom" : la racine
+        strncpy(parent_path, path_copy, length);
+        parent_path[length] = '\0';
     }
     
-    FileNode* parent = get_file_by_path(parent_path);
-    if (parent == NULL || parent->type != DIRECTORY_TYPE) {
-        printf("Erreur : chemin invalide.\n");
-        return -1;
+    int status;
+    FileNode* parent = dir_resolve(parent_path, &status);
+    if (parent == NULL) {
+        return status;
+    }
+    if (dir_lock_write(parent) != 0) {
+        return FS_ERR_NO_MEMORY;
     }
     
     
-    FileNode* target = NULL;
-    for (int i = 0; i < parent->child_count; i++) {
-        if (strcmp(parent->children[i]->name, name) == 0) {
-            target = parent->children[i];
-            break;
+    FileNode* target = dir_find(parent->dir_data, name, strlen(name));
+    
+    if (target == NULL) {
+        dir_unlock(parent);
+        return FS_ERR_NOT_FOUND;
+    }
+    
+    if (node_set_permissions(target, permissions) != 0) {
+        dir_unlock(parent);
+        return FS_ERR_NO_MEMORY;
+    }
+    journal_append(JOURNAL_CHMOD, filename, NULL, permissions);
+    dir_unlock(parent);
+    return FS_OK;
+}
+
+/**
+ * @brief Modifie les permissions d'un fichier ou répertoire (voir set_permissions_locked)
+ *
+ * @param filename Chemin du fichier ou répertoire
+ * @param permissions Nouvelles permissions (format octal)
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ */
+int set_permissions(const char* filename, int permissions) {
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = set_permissions_locked(filename, permissions);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief État partagé d'un parcours de set_permissions_recursive
+ */
+typedef struct ChmodWalk {
+    int permissions;                /**< Nouvelles permissions */
+    int failed;                     /**< 1 si un répertoire n'a pu être lu (atomique) */
+} ChmodWalk;
+
+/**
+ * @brief Change les permissions des enfants d'un répertoire (WalkDirFn)
+ */
+static void chmod_walk_dir(WalkWorker* worker, FileNode* dir, void* arg) {
+    ChmodWalk* chmod = arg;
+    if (dir_lock_write(dir) != 0) {
+        __atomic_store_n(&chmod->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    DirData* data = dir->dir_data;
+    for (int i = 0; i < data->child_count; i++) {
+        FileNode* child = data->children[i];
+        if (node_set_permissions(child, chmod->permissions) != 0) {
+            __atomic_store_n(&chmod->failed, 1, __ATOMIC_RELAXED);
+        }
+        if (child->dir_data != NULL) walk_push(worker, child);
+    }
+    dir_unlock(dir);
+}
+
+/**
+ * @brief Modifie les permissions d'une entrée et de tout son sous-arbre
+ *
+ * @param path Chemin de l'entrée
+ * @param permissions Nouvelles permissions (format octal)
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Les sous-répertoires sont traités en parallèle (walk_tree), chacun
+ *   sous son verrou en écriture
+ * - Prend fs_tree_lock en écriture : l'opération est journalisée en un
+ *   seul enregistrement, qu'aucune autre modification du sous-arbre ne
+ *   doit devancer
+ * - Si un répertoire de l'image ne peut être matérialisé, son sous-arbre
+ *   garde ses permissions et FS_ERR_NO_MEMORY est renvoyé ; le reste est
+ *   modifié et journalisé
+ */
+int set_permissions_recursive(const char* path, int permissions) {
+    int status = FS_OK;
+    pthread_rwlock_wrlock(&fs_tree_lock);
+    FileNode* node = path_lookup(path, &status);
+    if (node != NULL) {
+        ChmodWalk chmod = { permissions, 0 };
+        if (node_set_permissions(node, permissions) != 0) chmod.failed = 1;
+        if (node->dir_data != NULL) walk_tree(node, chmod_walk_dir, &chmod);
+        if (chmod.failed) status = FS_ERR_NO_MEMORY;
+        journal_append(JOURNAL_CHMOD_RECURSIVE, path, NULL, permissions);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Applique ou retire la compression transparente d'un contenu
+ *
+ * @param path Chemin d'un fichier ou d'un répertoire
+ * @param enabled 1 pour compresser, 0 pour stocker en clair
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Fichier : la politique est rangée dans son inode (commune à ses liens
+ *   durs) et son contenu est aussitôt recodé, sous le verrou de l'inode
+ * - Répertoire : la politique est héritée par les fichiers et
+ *   répertoires créés ensuite dedans ; les entrées existantes gardent
+ *   la leur
+ * - Une copie garde la politique de sa source (voir data_clone)
+ */
+int set_compression(const char* path, int enabled) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* node = path_lookup(path, &status);
+    if (node != NULL && node->dir_data != NULL) {
+        pthread_rwlock_wrlock(&node->dir_data->lock);
+        node->dir_data->compress = enabled != 0;
+        journal_append(JOURNAL_COMPRESS, path, NULL, enabled != 0);
+        pthread_rwlock_unlock(&node->dir_data->lock);
+    } else if (node != NULL) {
+        FileData* data = file_data(node);
+        if (data == NULL) {
+            status = FS_ERR_NO_MEMORY;
+        } else {
+            data_claim_names(data);
+            pthread_rwlock_wrlock(&data->lock);
+            DiskUsage before = { 0, 0, data_size(data), data_stored(data) };
+            if (data_set_compress(data, enabled != 0) != 0) status = FS_ERR_NO_MEMORY;
+            usage_settle(node, data, &before, &usage_none);
+            journal_append(JOURNAL_COMPRESS, path, NULL, enabled != 0);
+            pthread_rwlock_unlock(&data->lock);
+        }
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief État partagé d'un parcours de find_files
+ */
+typedef struct FindWalk {
+    const FindQuery* query;         /**< Critères */
+    FindVisitor visit;              /**< Fonction appelée pour chaque entrée trouvée */
+    void* arg;                      /**< Argument transmis à visit */
+    pthread_mutex_t lock;           /**< Sérialise les appels à visit */
+    int stopped;                    /**< 1 dès que visit a demandé l'arrêt (protégé par lock) */
+    int failed;                     /**< 1 si un répertoire n'a pu être lu (atomique) */
+} FindWalk;
+
+/**
+ * @brief Teste une entrée et la signale si elle satisfait les critères
+ *
+ * @param worker File du thread appelant (NULL pour la racine de la recherche)
+ * @param find Parcours en cours
+ * @param node Entrée candidate (état protégé par le verrou de son parent)
+ *
+ * @details
+ * Les critères les moins coûteux sont testés d'abord ; le chemin n'est
+ * construit que pour une entrée trouvée.
+ */
+static void find_check(WalkWorker* worker, FindWalk* find, FileNode* node) {
+    const FindQuery* query = find->query;
+    if (query->type >= 0 && node->type != (FileType)query->type) return;
+    if (query->name != NULL && fnmatch(query->name, node->name, 0) != 0) return;
+
+    FileInfo info;
+    node_info(node, &info);
+    if (query->min_size >= 0 && info.size < query->min_size) return;
+    if (query->max_size >= 0 && info.size > query->max_size) return;
+
+    char path[MAX_PATH_LENGTH];
+    if (node_path(node, path) != 0) return;
+    pthread_mutex_lock(&find->lock);
+    if (!find->stopped && find->visit(path, &info, find->arg) != 0) {
+        find->stopped = 1;
+        if (worker != NULL) walk_stop(worker);
+    }
+    pthread_mutex_unlock(&find->lock);
+}
+
+/**
+ * @brief Teste les enfants d'un répertoire (WalkDirFn)
+ */
+static void find_walk_dir(WalkWorker* worker, FileNode* dir, void* arg) {
+    FindWalk* find = arg;
+    if (dir_lock_read(dir) != 0) {
+        __atomic_store_n(&find->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    DirData* data = dir->dir_data;
+    for (int i = 0; i < data->child_count; i++) {
+        FileNode* child = data->children[i];
+        find_check(worker, find, child);
+        if (child->dir_data != NULL) walk_push(worker, child);
+    }
+    dir_unlock(dir);
+}
+
+/**
+ * @brief Recherche les entrées d'un sous-arbre qui satisfont des critères
+ *
+ * @param path Racine de la recherche, elle-même candidate
+ * @param query Critères (nom, type, taille)
+ * @param visit Fonction appelée avec le chemin absolu et la description
+ *        de chaque entrée trouvée ; une valeur non nulle arrête la recherche
+ * @param arg Argument transmis à visit
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Les sous-répertoires sont parcourus en parallèle (walk_tree) : les
+ *   entrées sont signalées dans un ordre quelconque, les appels à visit
+ *   étant sérialisés
+ * - visit est appelée sous le verrou d'un répertoire, en lecture
+ * - Les liens symboliques ne sont pas suivis
+ */
+int find_files(const char* path, const FindQuery* query, FindVisitor visit, void* arg) {
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* root = path_lookup(path, &status);
+    if (root != NULL) {
+        FindWalk find = { query, visit, arg, PTHREAD_MUTEX_INITIALIZER, 0, 0 };
+        FileNode* parent = root == root_directory ? NULL : node_lock_parent(root, 0);
+        find_check(NULL, &find, root);
+        if (parent != NULL) dir_unlock(parent);
+        if (root->dir_data != NULL && !find.stopped) walk_tree(root, find_walk_dir, &find);
+        if (find.failed) status = FS_ERR_NO_MEMORY;
+        pthread_mutex_destroy(&find.lock);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Lit l'occupation d'un sous-arbre
+ *
+ * @param path Racine du sous-arbre (fichier ou répertoire)
+ * @param usage Occupation à remplir
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Taille apparente : somme des tailles des contenus, un contenu
+ *   partagé par plusieurs liens durs étant compté à chaque nom
+ * - Occupation réelle (stored) : octets des extents après compression,
+ *   comptés de la même façon
+ * - Lue dans les compteurs du répertoire, tenus à jour par chaque
+ *   opération : temps constant, quelle que soit la taille du sous-arbre
+ */
+int disk_usage(const char* path, DiskUsage* usage) {
+    int status = FS_OK;
+    memset(usage, 0, sizeof(DiskUsage));
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* root = path_lookup(path, &status);
+    if (root != NULL) node_usage(root, usage);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Place restante sous un quota
+ *
+ * @param quota Quota (0 : sans limite)
+ * @param used Consommation comptée par ce quota
+ * @param avail Place déjà trouvée sous d'autres quotas (-1 : sans limite),
+ *        réduite si celui-ci est plus restrictif
+ */
+static void quota_avail(long long quota, long long used, long long* avail) {
+    if (quota <= 0) return;
+    long long left = quota > used ? quota - used : 0;
+    if (*avail < 0 || left < *avail) *avail = left;
+}
+
+/**
+ * @brief Lit l'occupation, les quotas et la place disponible d'un répertoire
+ *
+ * @param path Répertoire concerné
+ * @param info Informations à remplir
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - usage : comme disk_usage ; quota_bytes, quota_nodes : quotas du
+ *   répertoire lui-même (0 sans limite)
+ * - avail_bytes, avail_nodes : ce qu'on peut encore y créer, le plus
+ *   restrictif des quotas du répertoire et de ses ancêtres (-1 si aucun
+ *   ne limite)
+ * - Temps proportionnel à la profondeur du répertoire
+ */
+int disk_free(const char* path, DiskFree* info) {
+    int status = FS_OK;
+    memset(info, 0, sizeof(DiskFree));
+    info->avail_bytes = -1;
+    info->avail_nodes = -1;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* dir = path_lookup(path, &status);
+    if (dir != NULL && dir->dir_data == NULL) {
+        status = FS_ERR_NOT_DIRECTORY;
+    } else if (dir != NULL) {
+        node_usage(dir, &info->usage);
+        info->quota_bytes = __atomic_load_n(&dir->dir_data->quota_bytes, __ATOMIC_RELAXED);
+        info->quota_nodes = __atomic_load_n(&dir->dir_data->quota_nodes, __ATOMIC_RELAXED);
+        for (FileNode* ancestor = dir; ancestor != NULL; ancestor = ancestor->parent) {
+            DiskUsage used;
+            node_usage(ancestor, &used);
+            DirData* data = ancestor->dir_data;
+            quota_avail(__atomic_load_n(&data->quota_bytes, __ATOMIC_RELAXED),
+                        used.bytes, &info->avail_bytes);
+            quota_avail(__atomic_load_n(&data->quota_nodes, __ATOMIC_RELAXED),
+                        used.files + used.directories - 1, &info->avail_nodes);
         }
     }
-    
-    if (target == NULL) {
-        printf("Erreur : fichier '%s' non trouvé.\n", name);
-        return -1;
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Fixe les quotas d'un répertoire
+ *
+ * @param path Répertoire concerné
+ * @param max_bytes Taille apparente maximale de son sous-arbre (0 : sans limite)
+ * @param max_nodes Nombre maximal de fichiers et répertoires dans son
+ *        sous-arbre, lui-même exclu (0 : sans limite)
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Les quotas sont vérifiés à chaque écriture, création, copie, lien ou
+ *   déplacement qui agrandit le sous-arbre (FS_ERR_QUOTA)
+ * - Un quota inférieur à l'occupation actuelle est accepté : rien n'est
+ *   supprimé, mais le sous-arbre ne peut plus que diminuer
+ * - Journalise l'opération réussie
+ */
+int set_quota(const char* path, long long max_bytes, long long max_nodes) {
+    if (max_bytes < 0 || max_nodes < 0) {
+        return FS_ERR_INVALID;
     }
-    
-    target->permissions = permissions;
-    printf("Permissions du fichier '%s' modifiées à %d.\n", name, permissions);
-    return 0;
+    int status = FS_OK;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* dir = path_lookup(path, &status);
+    if (dir != NULL && dir->dir_data == NULL) {
+        status = FS_ERR_NOT_DIRECTORY;
+    } else if (dir != NULL && dir_lock_write(dir) != 0) {
+        status = FS_ERR_NO_MEMORY;
+    } else if (dir != NULL) {
+        __atomic_store_n(&dir->dir_data->quota_bytes, max_bytes, __ATOMIC_RELAXED);
+        __atomic_store_n(&dir->dir_data->quota_nodes, max_nodes, __ATOMIC_RELAXED);
+        journal_append_quota(path, max_bytes, max_nodes);
+        dir_unlock(dir);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Mesure l'occupation mémoire des contenus
+ *
+ * @param stats Statistiques à remplir
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Octets logiques et référencés : disk_usage de la racine
+ * - Octets physiques : blocs du tas effectivement alloués, chacun compté
+ *   une fois quel que soit le nombre de contenus qui le désignent (copies
+ *   et blocs dédupliqués)
+ */
+int storage_stats(StorageStats* stats) {
+    DiskUsage usage;
+    memset(stats, 0, sizeof(StorageStats));
+    int status = disk_usage("/", &usage);
+    if (status != FS_OK) return status;
+
+    size_t dedup_blocks, dedup_bytes, dedup_hits;
+    dedup_stats(&dedup_blocks, &dedup_bytes, &dedup_hits);
+    stats->logical = usage.bytes;
+    stats->referenced = usage.stored;
+    data_block_stats(&stats->blocks, &stats->physical);
+    stats->dedup_blocks = (long long)dedup_blocks;
+    stats->dedup_hits = (long long)dedup_hits;
+    return FS_OK;
 }
 
+static int open_file_locked(Session* session, const char* path, const char* mode);
+static int open_mode_check(FileNode* file, const char* mode);
+
 /**
  * @brief Ouvre un fichier en mode lecture ou écriture
  * 
  * @param path Chemin du fichier à ouvrir
  * @param mode Mode d'ouverture ("r" pour lecture, "w" pour écriture, "rw" pour les deux)
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
  * - Vérifie l'existence et le type du fichier
  * - Vérifie les permissions d'accès
  * - Gère les différents modes d'ouverture
- * - Empêche l'ouverture multiple d'un même fichier
+ * - Empêche l'ouverture multiple d'un même fichier dans une session ;
+ *   d'autres sessions peuvent l'ouvrir en même temps
+ * - Le fichier est ajouté à la table des fichiers ouverts de la session
+ *   courante et retenu jusqu'à sa fermeture
  */
 int open_file(const char* path, const char* mode) {
-    FileNode* file = get_file_by_path(path);
-    if (file == NULL || file->type != FILE_TYPE) {
-        printf("Erreur : fichier '%s' non trouvé.\n", path);
-        return -1;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = open_file_locked(session_current(), path, mode);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
+}
+
+/**
+ * @brief Ouvre un fichier pour une session (voir open_file)
+ *
+ * @param session Session courante
+ * @param path Chemin du fichier à ouvrir
+ * @param mode Mode d'ouverture ("r", "w" ou "rw")
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * Appelée sous fs_tree_lock en lecture.
+ */
+static int open_file_locked(Session* session, const char* path, const char* mode) {
+    int status;
+    FileNode* file = path_lookup(path, &status);
+    if (file == NULL) {
+        return status;
     }
+    if (file->type != FILE_TYPE) {
+        return FS_ERR_IS_DIRECTORY;
+    }
+
+    int requested_mode = open_mode_check(file, mode);
+    if (requested_mode < 0) {
+        return requested_mode;
+    }
+
+    if (session_find_open(session, file) != NULL) {
+        return FS_ERR_ALREADY_OPEN;
+    }
+
+    int fd = session_alloc_fd(session, file, requested_mode);
+    if (fd < 0 || session_add_open(session, file, fd) != 0) {
+        if (fd >= 0) session_free_fd(session, fd);
+        return FS_ERR_NO_MEMORY;
+    }
+    return FS_OK;
+}
 
-    int owner_perm = (file->permissions / 100);
+/**
+ * @brief Vérifie qu'un fichier peut être ouvert dans un mode donné
+ *
+ * @param file Fichier à ouvrir
+ * @param mode Mode d'ouverture ("r", "w" ou "rw")
+ * @return int FILE_MODE_READ, FILE_MODE_WRITE ou FILE_MODE_BOTH ;
+ *         FS_ERR_BAD_MODE si le mode est invalide, FS_ERR_PERMISSION s'il est refusé
+ *
+ * @details
+ * Les permissions sont lues sous le verrou du répertoire parent.
+ */
+static int open_mode_check(FileNode* file, const char* mode) {
+    FileNode* parent = node_lock_parent(file, 0);
+    int owner_perm = (node_permissions(file) / 100);
+    dir_unlock(parent);
     int requested_mode = 0;
 
     if (strcmp(mode, "r") == 0) {
         if (!(owner_perm & 4)) {
-            printf("Erreur : permission de lecture refusée.\n");
-            return -1;
+            return FS_ERR_PERMISSION;
         }
         requested_mode = FILE_MODE_READ;
     } else if (strcmp(mode, "w") == 0) {
         if (!(owner_perm & 2)) {
-            printf("Erreur : permission d'écriture refusée.\n");
-            return -1;
+            return FS_ERR_PERMISSION;
         }
         requested_mode = FILE_MODE_WRITE;
     } else if (strcmp(mode, "rw") == 0) {
         if (!(owner_perm & 6)) {
-            printf("Erreur : permissions insuffisantes.\n");
-            return -1;
+            return FS_ERR_PERMISSION;
         }
         requested_mode = FILE_MODE_BOTH;
     } else {
-        printf("Erreur : mode d'ouverture invalide.\n");
-        return -1;
+        return FS_ERR_BAD_MODE;
     }
+    return requested_mode;
+}
 
-    if (file->is_open) {
-        printf("Erreur : fichier déjà ouvert.\n");
-        return -1;
+/**
+ * @brief Retrouve un fichier ouvert dans un mode donné
+ * 
+ * @param path Chemin du fichier
+ * @param mode FILE_MODE_READ ou FILE_MODE_WRITE
+ * @param file Reçoit le fichier trouvé
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * Appelée sous fs_tree_lock en lecture ; le fichier doit être ouvert
+ * dans la session courante.
+ */
+static int get_open_file(const char* path, int mode, FileNode** file) {
+    int status;
+    FileNode* node = path_lookup(path, &status);
+    if (node == NULL) {
+        return status;
+    }
+    if (node->type != FILE_TYPE) {
+        return FS_ERR_IS_DIRECTORY;
     }
 
-    file->is_open = 1;
-    file->open_mode = requested_mode;
-    printf("Fichier '%s' ouvert en mode %s.\n", path, mode);
-    return 0;
+    Session* session = session_current();
+    PathOpen* entry = session_find_open(session, node);
+    if (entry == NULL) {
+        return FS_ERR_NOT_OPEN;
+    }
+
+    if (!(session->fds[entry->fd].mode & mode)) {
+        return mode == FILE_MODE_READ ? FS_ERR_NOT_READABLE : FS_ERR_NOT_WRITABLE;
+    }
+    *file = node;
+    return FS_OK;
 }
 
 /**
@@ -814,113 +3288,456 @@ int open_file(const char* path, const char* mode) {
  * @param path Chemin du fichier à lire
  * @param buffer Buffer pour stocker le contenu lu
  * @param size Taille maximale du buffer
- * @return int Nombre d'octets lus, -1 en cas d'erreur
+ * @return int Nombre d'octets lus, code d'erreur (FsError) sinon
  * 
  * @details
  * - Vérifie si le fichier est ouvert en lecture
- * - Copie le contenu dans le buffer fourni
+ * - Copie le début du contenu dans le buffer fourni
  * - Gère la taille maximale du buffer
  * - Ajoute le caractère nul à la fin
  */
 int read_file(const char* path, char* buffer, int size) {
-    FileNode* file = get_file_by_path(path);
-    if (file == NULL || file->type != FILE_TYPE) {
-        printf("Erreur : fichier '%s' non trouvé.\n", path);
-        return -1;
-    }
-
-    if (!file->is_open) {
-        printf("Erreur : fichier non ouvert.\n");
-        return -1;
+    if (size < 1) {
+        return FS_ERR_INVALID;
     }
-
-    if (!(file->open_mode & FILE_MODE_READ)) {
-        printf("Erreur : fichier non ouvert en lecture.\n");
-        return -1;
+    FileNode* file;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = get_open_file(path, FILE_MODE_READ, &file);
+    if (status != FS_OK) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return status;
     }
 
-    if (file->content == NULL) {
-        printf("Fichier vide.\n");
-        buffer[0] = '\0';
-        return 0;
+    // Assurer que le buffer est suffisamment grand
+    int copy_size = 0;
+    FileData* data = __atomic_load_n(&file->data, __ATOMIC_ACQUIRE);
+    if (data != NULL) {
+        pthread_rwlock_rdlock(&data->lock);
+        copy_size = (int)data_read(data, buffer, size - 1, 0);
+        pthread_rwlock_unlock(&data->lock);
     }
+    pthread_rwlock_unlock(&fs_tree_lock);
 
-    // Assurer que le buffer est suffisamment grand
-    int copy_size = (size - 1 < file->size) ? (size - 1) : file->size;
-    strncpy(buffer, file->content, copy_size);
     buffer[copy_size] = '\0';
-    printf("Contenu lu : %s\n", buffer);
     return copy_size;
 }
 
 /**
- * @brief Écrit du contenu dans un fichier
+ * @brief Lit une portion d'un fichier à partir d'une position
  * 
  * @param path Chemin du fichier
- * @param content Contenu à écrire
- * @return int Nombre d'octets écrits, -1 en cas d'erreur
+ * @param buffer Buffer de destination (non terminé par '\0')
+ * @param count Nombre d'octets à lire
+ * @param offset Position de lecture
+ * @return long long Nombre d'octets lus (0 en fin de fichier), code d'erreur (FsError) sinon
  * 
  * @details
- * - Vérifie si le fichier est ouvert en écriture
- * - Libère l'ancien contenu si nécessaire
- * - Alloue de la mémoire pour le nouveau contenu
- * - Met à jour la taille du fichier
+ * - Vérifie si le fichier est ouvert en lecture
+ * - Ne copie que les extents couverts par la portion demandée
  */
-int write_file(const char* path, const char* content) {
-    FileNode* file = get_file_by_path(path);
-    if (file == NULL || file->type != FILE_TYPE) {
-        printf("Erreur : fichier '%s' non trouvé.\n", path);
-        return -1;
+long long pread_file(const char* path, char* buffer, long long count, long long offset) {
+    if (offset < 0 || count < 0) {
+        return FS_ERR_INVALID;
     }
 
-    if (!file->is_open) {
-        printf("Erreur : fichier non ouvert.\n");
-        return -1;
+    FileNode* file;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    long long done = get_open_file(path, FILE_MODE_READ, &file);
+    FileData* data = done == FS_OK ? __atomic_load_n(&file->data, __ATOMIC_ACQUIRE) : NULL;
+    if (data != NULL) {
+        pthread_rwlock_rdlock(&data->lock);
+        done = data_read(data, buffer, count, offset);
+        pthread_rwlock_unlock(&data->lock);
     }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return done;
+}
 
-    if (!(file->open_mode & FILE_MODE_WRITE)) {
-        printf("Erreur : fichier non ouvert en écriture.\n");
-        return -1;
+/**
+ * @brief Écrit une portion d'un fichier à partir d'une position
+ * 
+ * @param file Fichier ouvert en écriture
+ * @param path Chemin du fichier pour le journal, NULL pour ne pas journaliser
+ * @param data Octets à écrire
+ * @param count Nombre d'octets
+ * @param offset Position d'écriture, ignorée si append vaut 1
+ * @param append 1 pour écrire à la fin du fichier
+ * @return long long Nombre d'octets écrits, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - La position de fin est lue sous le verrou d'écriture du contenu :
+ *   deux ajouts concurrents ne s'écrasent pas
+ * - L'agrandissement est réservé sous les quotas des répertoires qui
+ *   contiennent le fichier (FS_ERR_QUOTA, rien n'est alors écrit)
+ * - L'écriture est journalisée avant de relâcher ce verrou, dans l'ordre
+ *   où elle a été appliquée
+ */
+static long long file_pwrite(FileNode* file, const char* path, const char* data,
+                             long long count, long long offset, int append) {
+    if (offset < 0 || count < 0) {
+        return FS_ERR_INVALID;
+    }
+    FileData* content = file_data(file);
+    if (content == NULL) {
+        return FS_ERR_NO_MEMORY;
+    }
+    data_claim_names(content);
+
+    pthread_rwlock_wrlock(&content->lock);
+    if (append) offset = data_size(content);
+    DiskUsage before = { 0, 0, data_size(content), data_stored(content) };
+    DiskUsage growth = { 0, 0, offset + count > before.bytes ? offset + count - before.bytes : 0, 0 };
+    if (growth.bytes > 0 && usage_charge(file, content, &growth, 1) != FS_OK) {
+        pthread_rwlock_unlock(&content->lock);
+        return FS_ERR_QUOTA;
+    }
+    long long written = data_write(content, data, count, offset);
+    usage_settle(file, content, &before, &growth);
+    if (written == count && path != NULL) {
+        journal_append_write(path, data, count, offset);
+    }
+    pthread_rwlock_unlock(&content->lock);
+
+    if (written != count) {
+        return FS_ERR_NO_MEMORY;
     }
+    return count;
+}
+
+/**
+ * @brief Écrit une portion d'un fichier à partir d'une position
+ * 
+ * @param path Chemin du fichier
+ * @param data Octets à écrire (quelconques, '\0' compris)
+ * @param count Nombre d'octets à écrire
+ * @param offset Position d'écriture
+ * @return long long Nombre d'octets écrits, code d'erreur (FsError) sinon
+ * 
+ * @details
+ * - Vérifie si le fichier est ouvert en écriture
+ * - Ne modifie que les extents couverts : le coût est proportionnel à
+ *   count, pas à la taille du fichier
+ * - Écrire au-delà de la fin agrandit le fichier, l'intervalle se lisant
+ *   comme des zéros
+ * - Journalise l'opération réussie
+ */
+long long pwrite_file(const char* path, const char* data, long long count, long long offset) {
+    FileNode* file;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    long long written = get_open_file(path, FILE_MODE_WRITE, &file);
+    if (written == FS_OK) written = file_pwrite(file, path, data, count, offset, 0);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return written;
+}
+
+/**
+ * @brief Ajoute des octets à la fin d'un fichier
+ * 
+ * @param path Chemin du fichier
+ * @param data Octets à ajouter
+ * @param count Nombre d'octets à ajouter
+ * @return long long Nombre d'octets écrits, code d'erreur (FsError) sinon
+ * 
+ * @details
+ * Équivaut à pwrite_file à la position de fin du fichier ; seul le
+ * dernier extent et les nouveaux sont touchés.
+ */
+long long append_file(const char* path, const char* data, long long count) {
+    FileNode* file;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    long long written = get_open_file(path, FILE_MODE_WRITE, &file);
+    if (written == FS_OK) written = file_pwrite(file, path, data, count, 0, 1);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return written;
+}
 
-    // Libre la mémoire actuelle du contenu du fichier
-    if (file->content != NULL) {
-        free(file->content);
+/**
+ * @brief Remplace tout le contenu d'un fichier
+ *
+ * @param file Fichier concerné
+ * @param path Chemin du fichier pour le journal, NULL pour ne pas journaliser
+ * @param content Nouveau contenu
+ * @param length Longueur du contenu
+ * @return long long Nombre d'octets écrits, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Le fichier est vidé puis réécrit (un contenu lu dans l'image
+ *   projetée n'est jamais modifié)
+ * - Un contenu plus long que l'ancien est refusé s'il dépasse un quota
+ *   (FS_ERR_QUOTA, l'ancien contenu est alors conservé)
+ * - Appelée sous fs_tree_lock en lecture
+ */
+static long long file_replace(FileNode* file, const char* path, const char* content, long long length) {
+    FileData* data = file_data(file);
+    if (data == NULL) {
+        return FS_ERR_NO_MEMORY;
     }
+    data_claim_names(data);
+    pthread_rwlock_wrlock(&data->lock);
+    DiskUsage before = { 0, 0, data_size(data), data_stored(data) };
+    DiskUsage growth = { 0, 0, length > before.bytes ? length - before.bytes : 0, 0 };
+    if (growth.bytes > 0 && usage_charge(file, data, &growth, 1) != FS_OK) {
+        pthread_rwlock_unlock(&data->lock);
+        return FS_ERR_QUOTA;
+    }
+    int failed = data_truncate(data, 0) != 0 || data_write(data, content, length, 0) != length;
+    usage_settle(file, data, &before, &growth);
+    if (!failed && path != NULL) {
+        journal_append(JOURNAL_WRITE, path, content, 0);
+    }
+    pthread_rwlock_unlock(&data->lock);
+    return failed ? FS_ERR_NO_MEMORY : length;
+}
+
+/**
+ * @brief Écrit du contenu dans un fichier
+ * 
+ * @param path Chemin du fichier
+ * @param content Contenu à écrire
+ * @return int Nombre d'octets écrits, code d'erreur (FsError) sinon
+ * 
+ * @details
+ * - Vérifie si le fichier est ouvert en écriture
+ * - Remplace tout le contenu (voir file_replace) ; le nouveau contenu
+ *   est visible par tous les liens durs du fichier
+ * - Journalise l'opération réussie
+ */
+int write_file(const char* path, const char* content) {
+    FileNode* file;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    long long status = get_open_file(path, FILE_MODE_WRITE, &file);
+    if (status == FS_OK) status = file_replace(file, path, content, strlen(content));
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return (int)status;
+}
 
-    // Alloue de la mémoire pour le nouveau contenu
-    file->content = strdup(content);
-    file->size = strlen(content);
-    printf("Contenu écrit dans '%s' (taille: %d octets).\n", path, file->size);
-    return file->size;
+/**
+ * @brief Rejoue une écriture journalisée
+ *
+ * @param path Chemin du fichier
+ * @param data Octets écrits
+ * @param count Nombre d'octets
+ * @param offset Position d'écriture, ignorée si replace vaut 1
+ * @param replace 1 pour remplacer tout le contenu (write_file), 0 pour
+ *        écrire à la position (pwrite_file, write_fd)
+ * @return long long Nombre d'octets écrits, code d'erreur (FsError) sinon
+ *
+ * @details
+ * L'écriture a été faite par un descripteur ouvert à l'époque : ni
+ * l'ouverture ni les permissions ne sont vérifiées de nouveau, un chmod
+ * postérieur à l'ouverture ne devant pas la faire disparaître. Le
+ * fichier est scellé comme à la fermeture de ce descripteur.
+ */
+long long replay_write(const char* path, const char* data, long long count, long long offset, int replace) {
+    int status;
+    long long written;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* file = path_lookup(path, &status);
+    if (file == NULL) {
+        written = status;
+    } else if (file->type != FILE_TYPE) {
+        written = FS_ERR_IS_DIRECTORY;
+    } else {
+        written = replace ? file_replace(file, NULL, data, count)
+                          : file_pwrite(file, NULL, data, count, offset, 0);
+        if (written >= 0) node_seal(file);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return written;
 }
 
 /**
  * @brief Ferme un fichier ouvert
  * 
  * @param path Chemin du fichier à fermer
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
- * - Vérifie si le fichier existe et est ouvert
- * - Réinitialise les flags d'ouverture
- * - Libère les ressources associées
+ * - Vérifie si le fichier existe et est ouvert par son chemin dans la
+ *   session courante
+ * - Libère son descripteur et relâche le fichier
  */
 int close_file(const char* path) {
-    FileNode* file = get_file_by_path(path);
+    int status;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* file = path_lookup(path, &status);
+    if (file == NULL) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return status;
+    }
+
+    Session* session = session_current();
+    PathOpen* entry = session_find_open(session, file);
+    if (entry == NULL) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return FS_ERR_NOT_OPEN;
+    }
+    session_free_fd(session, entry->fd);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return FS_OK;
+}
+
+/**
+ * @brief Ouvre un fichier et renvoie un descripteur
+ *
+ * @param path Chemin du fichier
+ * @param mode Mode d'ouverture ("r", "w" ou "rw")
+ * @return int Descripteur (le plus petit libre de la session), code d'erreur (FsError) sinon
+ *
+ * @details
+ * - Le chemin n'est résolu qu'une fois : fd_read et fd_write accèdent
+ *   ensuite directement au fichier
+ * - Un même fichier peut être ouvert plusieurs fois, par la même session
+ *   ou par d'autres ; chaque descripteur a sa propre position
+ * - Le fichier reste accessible par ses descripteurs s'il est déplacé ou
+ *   supprimé
+ */
+int fd_open(const char* path, const char* mode) {
+    int status;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* file = path_lookup(path, &status);
     if (file == NULL || file->type != FILE_TYPE) {
-        printf("Erreur : fichier '%s' non trouvé.\n", path);
-        return -1;
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return file == NULL ? status : FS_ERR_IS_DIRECTORY;
     }
 
-    if (!file->is_open) {
-        printf("Erreur : fichier non ouvert.\n");
-        return -1;
+    int fd = open_mode_check(file, mode);
+    if (fd >= 0) {
+        fd = session_alloc_fd(session_current(), file, fd);
+        if (fd < 0) fd = FS_ERR_NO_MEMORY;
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return fd;
+}
+
+/**
+ * @brief Lit à la position courante d'un descripteur
+ *
+ * @param fd Descripteur ouvert en lecture
+ * @param buffer Buffer de destination (non terminé par '\0')
+ * @param count Nombre d'octets à lire
+ * @return long long Nombre d'octets lus (0 en fin de fichier), code d'erreur (FsError) sinon
+ *
+ * @details
+ * La position du descripteur avance du nombre d'octets lus.
+ */
+long long fd_read(int fd, char* buffer, long long count) {
+    if (count < 0) {
+        return FS_ERR_INVALID;
+    }
+    OpenFile* entry = session_fd(fd);
+    if (entry == NULL) return FS_ERR_BAD_FD;
+    if (!(entry->mode & FILE_MODE_READ)) {
+        return FS_ERR_NOT_READABLE;
+    }
+
+    long long done = 0;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileData* data = __atomic_load_n(&entry->node->data, __ATOMIC_ACQUIRE);
+    if (data != NULL) {
+        pthread_rwlock_rdlock(&data->lock);
+        done = data_read(data, buffer, count, entry->offset);
+        pthread_rwlock_unlock(&data->lock);
+    }
+    pthread_rwlock_unlock(&fs_tree_lock);
+    entry->offset += done;
+    return done;
+}
+
+/**
+ * @brief Écrit à la position courante d'un descripteur
+ *
+ * @param fd Descripteur ouvert en écriture
+ * @param data Octets à écrire
+ * @param count Nombre d'octets à écrire
+ * @return long long Nombre d'octets écrits, code d'erreur (FsError) sinon
+ *
+ * @details
+ * - La position du descripteur avance du nombre d'octets écrits
+ * - L'écriture est journalisée sous le chemin actuel du fichier ; elle
+ *   ne l'est pas si le fichier a été supprimé
+ * - Un fichier déplacé à un chemin de plus de MAX_PATH_LENGTH octets ne
+ *   peut être journalisé : l'écriture est refusée (FS_ERR_NAME_TOO_LONG)
+ *   plutôt que perdue au rejeu
+ */
+long long fd_write(int fd, const char* data, long long count) {
+    OpenFile* entry = session_fd(fd);
+    if (entry == NULL) return FS_ERR_BAD_FD;
+    if (!(entry->mode & FILE_MODE_WRITE)) {
+        return FS_ERR_NOT_WRITABLE;
+    }
+
+    char path[MAX_PATH_LENGTH];
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = node_path(entry->node, path);
+    if (status == FS_ERR_NAME_TOO_LONG) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return status;
+    }
+    long long written = file_pwrite(entry->node, status == FS_OK ? path : NULL, data, count, entry->offset, 0);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    if (written > 0) entry->offset += written;
+    return written;
+}
+
+/**
+ * @brief Déplace la position courante d'un descripteur
+ *
+ * @param fd Descripteur ouvert
+ * @param offset Déplacement
+ * @param whence SEEK_SET (depuis le début), SEEK_CUR (depuis la position
+ *        courante) ou SEEK_END (depuis la fin du fichier)
+ * @return long long Nouvelle position, code d'erreur (FsError) sinon
+ *
+ * @details
+ * La position peut dépasser la fin du fichier : une écriture y agrandit
+ * le fichier, l'intervalle se lisant comme des zéros.
+ */
+long long fd_seek(int fd, long long offset, int whence) {
+    OpenFile* entry = session_fd(fd);
+    if (entry == NULL) return FS_ERR_BAD_FD;
+
+    long long base;
+    if (whence == SEEK_SET) {
+        base = 0;
+    } else if (whence == SEEK_CUR) {
+        base = entry->offset;
+    } else if (whence == SEEK_END) {
+        base = 0;
+        pthread_rwlock_rdlock(&fs_tree_lock);
+        FileData* data = __atomic_load_n(&entry->node->data, __ATOMIC_ACQUIRE);
+        if (data != NULL) {
+            pthread_rwlock_rdlock(&data->lock);
+            base = data_size(data);
+            pthread_rwlock_unlock(&data->lock);
+        }
+        pthread_rwlock_unlock(&fs_tree_lock);
+    } else {
+        return FS_ERR_INVALID;
+    }
+
+    if (base + offset < 0) {
+        return FS_ERR_INVALID;
     }
+    entry->offset = base + offset;
+    return entry->offset;
+}
 
-    file->is_open = 0;
-    file->open_mode = 0;  // Réinitialiser le mode d'ouverture
-    printf("Fichier '%s' fermé.\n", path);
+/**
+ * @brief Ferme un descripteur
+ *
+ * @param fd Descripteur ouvert
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ *
+ * @details
+ * Si le descripteur a été obtenu par open_file, le fichier n'est plus
+ * ouvert par son chemin.
+ */
+int fd_close(int fd) {
+    if (session_fd(fd) == NULL) return FS_ERR_BAD_FD;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    session_free_fd(session_current(), fd);
+    pthread_rwlock_unlock(&fs_tree_lock);
     return 0;
 }
 
@@ -930,229 +3747,268 @@ int close_file(const char* path) {
  * @return char* Chaîne de caractères représentant le chemin absolu
  * 
  * @details
- * - Utilise un buffer statique pour stocker le chemin
+ * - Stocke le chemin dans le tampon de la session courante, valide
+ *   jusqu'au prochain appel pour cette session
  * - Remonte l'arborescence depuis le répertoire courant jusqu'à la racine
- * - Gère le cas spécial du répertoire racine "/"
- * - Construit le chemin en concaténant les noms des répertoires
+ *   (voir node_path)
  */
 char* get_current_path() {
-    static char path[MAX_PATH_LENGTH];
-    FileNode* current = current_directory;
-    path[0] = '\0';
-    
-    // Si c'est le répertoire racine, retourner "/"
-    if (current == root_directory) {
-        return "/";
-    }
-    
-    // Construire le chemin complet
-    while (current != root_directory) {
-        char temp[MAX_PATH_LENGTH];
-        snprintf(temp, sizeof(temp), "/%s%s", current->name, path);
-        strncpy(path, temp, MAX_PATH_LENGTH - 1);
+    Session* session = session_current();
+    node_path(session->cwd, session->path);
+    return session->path;
+}
+
+/**
+ * @brief Construit le chemin absolu d'un nœud
+ *
+ * @param node Nœud concerné
+ * @param path Tampon de MAX_PATH_LENGTH octets
+ * @return int 0 en cas de succès, FS_ERR_NOT_FOUND si le nœud a été
+ *         supprimé, FS_ERR_NAME_TOO_LONG si son chemin ne tient pas dans
+ *         le tampon (qui contient alors la fin du chemin)
+ *
+ * @details
+ * Les noms sont placés depuis la fin du tampon en remontant vers la
+ * racine, sous fs_rename_lock, puis le chemin est ramené au début. Un
+ * chemin trop long est tronqué par le début ; la remontée continue
+ * pour savoir si le nœud est encore rattaché.
+ */
+static int node_path(FileNode* node, char* path) {
+    size_t start = MAX_PATH_LENGTH - 1;
+    path[start] = '\0';
+    int truncated = 0;
+
+    pthread_mutex_lock(&fs_rename_lock);
+    FileNode* current = node;
+    while (current != NULL && current != root_directory) {
+        size_t length = current->name_length;
+        if (start < length + 1) truncated = 1;
+        if (!truncated) {
+            start -= length;
+            memcpy(path + start, current->name, length);
+            path[--start] = '/';
+        }
         current = current->parent;
     }
-    
-    return path[0] ? path : "/";
+    pthread_mutex_unlock(&fs_rename_lock);
+
+    // Si c'est le répertoire racine, le chemin est "/"
+    if (start == MAX_PATH_LENGTH - 1) path[--start] = '/';
+    memmove(path, path + start, MAX_PATH_LENGTH - start);
+    if (current != root_directory) return FS_ERR_NOT_FOUND;
+    return truncated ? FS_ERR_NAME_TOO_LONG : FS_OK;
 }
 
 /**
  * @brief Crée un lien dur vers un fichier existant
  * 
  * @param target Chemin du fichier cible
- * @param link_name Nom du nouveau lien dur
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @param link_name Chemin du nouveau lien dur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
  * - Vérifie l'existence et le type du fichier cible
- * - Incrémente le compteur de références du fichier
- * - Crée une nouvelle entrée dans le répertoire courant
- * - Partage le même contenu que le fichier cible
+ * - Vérifie que le répertoire du lien existe et que le nom est libre
+ *   (voir entry_parent)
+ * - Crée l'inode du fichier s'il n'en a pas encore et incrémente son
+ *   nombre de liens
+ * - Crée une nouvelle entrée dans ce répertoire, qui désigne le même
+ *   inode : contenu, taille, permissions et nombre de liens sont
+ *   communs à tous les liens
+ * - Le contenu est compté une fois de plus, sous le répertoire du lien
+ *   (FS_ERR_QUOTA si cela dépasse un quota)
+ * - Journalise l'opération réussie
+ * - Appelée sous fs_tree_lock en lecture ; le répertoire du lien est
+ *   verrouillé en écriture
  */
-int create_hard_link(const char* target, const char* link_name) {
-    FileNode* target_file = get_file_by_path(target);
-    if (target_file == NULL || target_file->type != FILE_TYPE) {
-        printf("Erreur : fichier cible '%s' non trouvé.\n", target);
-        return -1;
+static int create_hard_link_locked(const char* target, const char* link_name) {
+    // Un lien symbolique n'est pas suivi : le lien dur le duplique
+    int status;
+    FileNode* target_file = path_resolve(target, 0, &status);
+    if (target_file == NULL) {
+        return status;
+    }
+    if (target_file->type != FILE_TYPE) {
+        return FS_ERR_IS_DIRECTORY;
     }
 
-    target_file->ref_count++;
-    FileNode* link = (FileNode*)malloc(sizeof(FileNode));
-    memcpy(link, target_file, sizeof(FileNode));
-    strncpy(link->name, link_name, MAX_NAME_LENGTH - 1);
-    link->name[MAX_NAME_LENGTH - 1] = '\0';
+    PathWalk walk;
+    const char* name;
+    FileNode* parent = entry_parent(link_name, &walk, &name, &status);
+    if (parent == NULL) {
+        return status;
+    }
+    // Les liens durs partagent le même contenu : le créer s'il n'existe pas encore
+    FileData* data = file_data(target_file);
+    if (data == NULL) {
+        return FS_ERR_NO_MEMORY;
+    }
+    data_claim_names(data);
+    if (dir_lock_write(parent) != 0) {
+        return FS_ERR_NO_MEMORY;
+    }
+    if (dir_find(parent->dir_data, name, strlen(name)) != NULL) {
+        dir_unlock(parent);
+        return FS_ERR_EXISTS;
+    }
 
-    FileNode* parent = get_file_by_path(".");
-    parent->children[parent->child_count++] = link;
-    printf("Lien dur '%s' créé vers '%s'.\n", link_name, target);
-    return 0;
+    FileNode* link = node_alloc(name, FILE_TYPE, node_permissions(target_file));
+    if (link != NULL && target_file->symlink_target != NULL) {
+        link->symlink_target = small_strndup(target_file->symlink_target,
+                                             strlen(target_file->symlink_target));
+        if (link->symlink_target == NULL) {
+            node_free(link);
+            link = NULL;
+        }
+    }
+    if (link == NULL || dir_prepare_child(parent) != 0) {
+        dir_unlock(parent);
+        if (link) node_free(link);
+        return FS_ERR_NO_MEMORY;
+    }
+    // Le nouveau nom compte le contenu sous ses ancêtres et rejoint ceux
+    // qu'une écriture met à jour
+    pthread_rwlock_wrlock(&data->lock);
+    DiskUsage charge = { 1, 0, data_size(data), data_stored(data) };
+    status = usage_reserve(parent, NULL, &charge);
+    if (status == FS_OK && data_add_name(data, target_file, link) != 0) {
+        DiskUsage undo = usage_negate(&charge);
+        usage_add(parent, NULL, &undo);
+        status = FS_ERR_NO_MEMORY;
+    }
+    if (status != FS_OK) {
+        pthread_rwlock_unlock(&data->lock);
+        dir_unlock(parent);
+        node_free(link);
+        return status;
+    }
+    dir_link_child(parent, link);
+    link->data = data;
+    __atomic_add_fetch(&data->links, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&data->lock);
+    entry_created(link_name, &walk, parent, name);
+    journal_append(JOURNAL_HARD_LINK, target, link_name, 0);
+    dir_unlock(parent);
+    return FS_OK;
+}
+
+/**
+ * @brief Crée un lien dur vers un fichier existant (voir create_hard_link_locked)
+ *
+ * @param target Chemin du fichier cible
+ * @param link_name Chemin du nouveau lien dur
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
+ */
+int create_hard_link(const char* target, const char* link_name) {
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    int status = create_hard_link_locked(target, link_name);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return status;
 }
 
 /**
  * @brief Crée un lien symbolique vers un fichier ou répertoire
  * 
  * @param target Chemin de la cible
- * @param link_name Nom du nouveau lien symbolique
- * @return int 0 en cas de succès, -1 en cas d'erreur
+ * @param link_name Chemin du nouveau lien symbolique
+ * @return int 0 en cas de succès, code d'erreur (FsError) sinon
  * 
  * @details
+ * - Vérifie que le répertoire du lien existe et que le nom est libre
+ *   (voir entry_parent)
  * - Crée un nouveau nœud de type lien symbolique
  * - Stocke le chemin de la cible
  * - Ne vérifie pas l'existence de la cible (lien symbolique peut être cassé)
+ * - Compte comme un fichier dans le quota d'entrées des ancêtres
  * - Initialise les attributs du lien
+ * - Journalise l'opération réussie
  */
 int create_symbolic_link(const char* target, const char* link_name) {
-    FileNode* link = (FileNode*)malloc(sizeof(FileNode));
-    strncpy(link->name, link_name, MAX_NAME_LENGTH - 1);
-    link->name[MAX_NAME_LENGTH - 1] = '\0';
-    link->type = FILE_TYPE;
-    link->permissions = 777;
-    link->size = 0;
-    link->symlink_target = strdup(target);
-    link->is_open = 0;
-    link->ref_count = 1;
-
-    FileNode* parent = get_file_by_path(".");
-    parent->children[parent->child_count++] = link;
-    printf("Lien symbolique '%s' créé vers '%s'.\n", link_name, target);
-    return 0;
-}
-
-/**
- * @brief Traite les commandes utilisateur du système de fichiers
- * 
- * @details
- * - Initialise le système de fichiers si nécessaire
- * - Boucle principale de lecture des commandes
- * - Parse les arguments en gérant les guillemets
- * - Exécute la commande correspondante
- * - Gère les erreurs et affiche l'aide si nécessaire
- * - Sauvegarde l'état à la sortie
- */
-void handle_command() {
-    // Vérifier si le répertoire racine existe
-    if (root_directory == NULL) {
-        init_file_system();
+    PathWalk walk;
+    const char* name;
+    int status;
+    pthread_rwlock_rdlock(&fs_tree_lock);
+    FileNode* parent = entry_parent(link_name, &walk, &name, &status);
+    if (parent == NULL) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return status;
+    }
+    if (dir_lock_write(parent) != 0) {
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return FS_ERR_NO_MEMORY;
+    }
+    if (dir_find(parent->dir_data, name, strlen(name)) != NULL) {
+        dir_unlock(parent);
+        pthread_rwlock_unlock(&fs_tree_lock);
+        return FS_ERR_EXISTS;
     }
 
-    char input[1024];
-    while (1) {
-        printf("\nEntrez une commande (create/mkdir/ls/copy/move/rm/chmod/cd/open/close/read/write/ln/exit) : ");
-        fgets(input, sizeof(input), stdin);
-        input[strcspn(input, "\n")] = '\0';
-
-        if (strcmp(input, "exit") == 0) {
-            printf("Sauvegarde du système de fichiers...\n");
-            close_file_system();
-            printf("Au revoir !\n");
-            break;
+    // La cible est copiée avant tout lien : un échec ne laisse rien derrière lui
+    FileNode* link = node_alloc(name, FILE_TYPE, 777);
+    if (link != NULL) {
+        link->symlink_target = small_strndup(target, strlen(target));
+        if (link->symlink_target == NULL) {
+            node_free(link);
+            link = NULL;
         }
+    }
+    if (link == NULL || dir_prepare_child(parent) != 0) {
+        dir_unlock(parent);
+        pthread_rwlock_unlock(&fs_tree_lock);
+        if (link) node_free(link);
+        return FS_ERR_NO_MEMORY;
+    }
+    DiskUsage charge = { 1, 0, 0, 0 };
+    status = usage_reserve(parent, NULL, &charge);
+    if (status != FS_OK) {
+        dir_unlock(parent);
+        pthread_rwlock_unlock(&fs_tree_lock);
+        node_free(link);
+        return status;
+    }
+    dir_link_child(parent, link);
+    entry_created(link_name, &walk, parent, name);
+    journal_append(JOURNAL_SYMLINK, target, link_name, 0);
+    dir_unlock(parent);
+    pthread_rwlock_unlock(&fs_tree_lock);
+    return FS_OK;
+}
 
-        char *argv[10];
-        int argc = 0;
-        char *token = NULL;
-        char *rest = input;
-        char *quote_start = NULL;
-
-        while (*rest) {
-            // Passer les espaces blancs
-            while (*rest && isspace(*rest)) rest++;
-            if (!*rest) break;
-
-            if (*rest == '"') {
-                // Traiter les chaînes entre guillemets
-                rest++; 
-                quote_start = rest;
-                while (*rest && *rest != '"') rest++;
-                if (*rest == '"') {
-                    *rest = '\0'; 
-                    argv[argc++] = quote_start;
-                    rest++;
-                } else {
-                    // Non fermere les guillemets
-                    argv[argc++] = quote_start;
-                    break;
-                }
-            } else {
-                // Traiter les mots séparés par des espaces
-                token = rest;
-                while (*rest && !isspace(*rest) && *rest != '"') rest++;
-                if (*rest) {
-                    *rest++ = '\0';
-                }
-                argv[argc++] = token;
-            }
-
-            if (argc >= 10) break;
-        }
+/** @brief Messages des codes d'erreur, indexés par l'opposé du code */
+static const char* const fs_error_messages[] = {
+    [0] = "succès",
+    [-FS_ERR_INVALID_PATH] = "chemin invalide",
+    [-FS_ERR_NOT_FOUND] = "fichier ou répertoire introuvable",
+    [-FS_ERR_EXISTS] = "le nom existe déjà",
+    [-FS_ERR_NOT_DIRECTORY] = "n'est pas un répertoire",
+    [-FS_ERR_IS_DIRECTORY] = "est un répertoire",
+    [-FS_ERR_PERMISSION] = "permission refusée",
+    [-FS_ERR_BAD_MODE] = "mode d'ouverture invalide",
+    [-FS_ERR_ALREADY_OPEN] = "fichier déjà ouvert",
+    [-FS_ERR_NOT_OPEN] = "fichier non ouvert",
+    [-FS_ERR_NOT_READABLE] = "fichier non ouvert en lecture",
+    [-FS_ERR_NOT_WRITABLE] = "fichier non ouvert en écriture",
+    [-FS_ERR_BAD_FD] = "descripteur invalide",
+    [-FS_ERR_INVALID] = "position, taille ou origine invalide",
+    [-FS_ERR_AT_ROOT] = "déjà à la racine",
+    [-FS_ERR_MOVE_INTO_SELF] = "impossible de déplacer un répertoire dans lui-même",
+    [-FS_ERR_NO_MEMORY] = "mémoire insuffisante",
+    [-FS_ERR_IO] = "erreur d'entrée/sortie",
+    [-FS_ERR_JOURNAL] = "journal indisponible",
+    [-FS_ERR_NAME_TOO_LONG] = "nom trop long",
+    [-FS_ERR_LOOP] = "trop de niveaux de liens symboliques",
+    [-FS_ERR_QUOTA] = "quota du répertoire dépassé",
+};
 
-        if (argc == 0) continue;
-
-        const char *command = argv[0];
-
-        if (strcmp(command, "create") == 0 && argc == 3) {  
-            create_file(argv[1], atoi(argv[2]));  
-        } else if (strcmp(command, "mkdir") == 0 && argc == 3) {
-            create_directory(argv[1], atoi(argv[2]));
-        } else if (strcmp(command, "ls") == 0 || strcmp(command, "list") == 0) {
-            list_files(argc > 1 ? argv[1] : ".");
-        } else if (strcmp(command, "cd") == 0 && argc == 2) {
-            change_directory(argv[1]);
-        } else if (strcmp(command, "copy") == 0 && argc == 3) {
-            copy_file(argv[1], argv[2]);
-        } else if (strcmp(command, "move") == 0 && argc == 3) {
-            move_file(argv[1], argv[2]);
-        } else if ((strcmp(command, "rm") == 0 || strcmp(command, "delete") == 0) && argc >= 2) {
-            // Verifier si la commande est rm -r
-            if (argc == 3 && strcmp(argv[1], "-r") == 0) {
-                // rm -r 
-                delete_file(argv[2]);
-            } else {
-                // Vrifier si le chemin est un répertoire
-                char path_copy[MAX_PATH_LENGTH];
-                strncpy(path_copy, argv[1], MAX_PATH_LENGTH - 1);
-                path_copy[MAX_PATH_LENGTH - 1] = '\0';
-                
-                FileNode* target = get_file_by_path(path_copy);
-                if (target != NULL && target->type == DIRECTORY_TYPE) {
-                    printf("Erreur : '%s' est un répertoire. Utilisez 'rm -r' pour supprimer un répertoire.\n", argv[1]);
-                } else {
-                    delete_file(argv[1]);
-                }
-            }
-        } else if (strcmp(command, "chmod") == 0 && argc == 3) {
-            set_permissions(argv[1], atoi(argv[2]));
-        } else if (strcmp(command, "open") == 0 && argc == 3) {
-            open_file(argv[1], argv[2]);
-        } else if (strcmp(command, "close") == 0 && argc == 2) {
-            close_file(argv[1]);
-        } else if (strcmp(command, "read") == 0 && argc == 2) {
-            char buffer[1024];
-            read_file(argv[1], buffer, sizeof(buffer));
-        } else if (strcmp(command, "write") == 0 && argc == 3) {
-            write_file(argv[1], argv[2]);
-        } else if (strcmp(command, "ln") == 0 && argc == 3) {
-            create_hard_link(argv[1], argv[2]);
-        } else if (strcmp(command, "ln") == 0 && argc == 4 && strcmp(argv[1], "-s") == 0) {
-            create_symbolic_link(argv[2], argv[3]);
-        }else {
-            printf("Commande non reconnue ou arguments invalides.\n");
-            printf("Usage:\n");
-            printf("  create <fichier> <permissions>\n");
-            printf("  mkdir <répertoire> <permissions>\n");
-            printf("  ls [chemin]\n");
-            printf("  cd <chemin>\n");
-            printf("  copy <source> <destination>\n");
-            printf("  move <source> <destination>\n");
-            printf("  rm [-r] <chemin>\n");
-            printf("  chmod <chemin> <permissions>\n");
-            printf("  open <fichier> <mode>     (mode: r ou w)\n");
-            printf("  close <fichier>\n");
-            printf("  read <fichier>\n");
-            printf("  write <fichier> <contenu>\n");
-            printf("  ln <source> <lien>        (lien dur)\n");
-            printf("  ln -s <source> <lien>     (lien symbolique)\n");
-            printf("  exit\n");
-        }
-    }
+/**
+ * @brief Traduit un code d'erreur en message
+ *
+ * @param error Code renvoyé par une opération (FsError)
+ * @return const char* Message en français, sans majuscule ni point final ;
+ *         "erreur inconnue" pour un code qui n'est pas un FsError
+ */
+const char* fs_strerror(int error) {
+    size_t count = sizeof(fs_error_messages) / sizeof(fs_error_messages[0]);
+    if (error > 0 || (size_t)-error >= count) return "erreur inconnue";
+    return fs_error_messages[-error];
 }
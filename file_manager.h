@@ -1,22 +1,6 @@
 #ifndef FILE_MANAGER_H
 #define FILE_MANAGER_H
 
-// Simulation du système de fichiers
-#define MAX_FILES 100
-#define MAX_PATH_LENGTH 256
-#define MAX_NAME_LENGTH 50
-
-typedef enum {
-    FILE_TYPE,
-    DIRECTORY_TYPE
-} FileType;
-
-// Définition des modes d'ouverture de fichier
-#define FILE_MODE_READ  1
-#define FILE_MODE_WRITE 2
-#define FILE_MODE_BOTH  3
-#define FS_FILENAME "filesystem.dat"
-
 /**
  * @file file_manager.h
  * @brief Interface du système de fichiers virtuel
@@ -31,18 +15,34 @@ typedef enum {
  * - Liens durs et symboliques
  * - Persistance des données
  *
+ * Les opérations publiques peuvent être appelées depuis plusieurs
+ * threads (voir « Concurrence » dans file_manager.c), à l'exception de
+ * l'initialisation, du chargement et de la fermeture.
+ *
+ * Le répertoire de travail et les fichiers ouverts appartiennent à une
+ * session (Session) ; l'arborescence est partagée par toutes. Chaque
+ * opération agit pour la session attachée au thread appelant par
+ * session_attach(), ou à défaut pour la session par défaut.
+ *
+ * La bibliothèque (libvfs) n'affiche rien : les opérations renvoient un
+ * code d'erreur négatif (FsError), que fs_strerror() traduit en message,
+ * et leurs résultats dans des structures (FileInfo). L'interface en
+ * ligne de commande est déclarée dans fs_cli.h.
+ *
  * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
  * @date 2024
  */
 
-/** @brief Nombre maximum de fichiers par répertoire */
-#define MAX_FILES 100
+#include <pthread.h>
 
 /** @brief Longueur maximale d'un chemin */
 #define MAX_PATH_LENGTH 256
 
-/** @brief Longueur maximale d'un nom de fichier */
-#define MAX_NAME_LENGTH 50
+/** @brief Longueur maximale d'un nom de fichier, '\0' compris (un nom plus long est refusé) */
+#define MAX_NAME_LENGTH 256
+
+/** @brief Nombre maximal de liens symboliques suivis par une résolution de chemin */
+#define MAX_SYMLINK_FOLLOW 40
 
 /**
  * @brief Types de nœuds dans le système de fichiers
@@ -52,6 +52,34 @@ typedef enum {
     DIRECTORY_TYPE  /**< Nœud de type répertoire */
 } FileType;
 
+/**
+ * @brief Codes d'erreur renvoyés par les opérations (toujours négatifs)
+ */
+typedef enum {
+    FS_OK = 0,                      /**< Succès */
+    FS_ERR_INVALID_PATH = -1,       /**< Chemin invalide (répertoire intermédiaire absent) */
+    FS_ERR_NOT_FOUND = -2,          /**< Fichier ou répertoire introuvable */
+    FS_ERR_EXISTS = -3,             /**< Le nom existe déjà */
+    FS_ERR_NOT_DIRECTORY = -4,      /**< N'est pas un répertoire */
+    FS_ERR_IS_DIRECTORY = -5,       /**< Est un répertoire */
+    FS_ERR_PERMISSION = -6,         /**< Permission refusée */
+    FS_ERR_BAD_MODE = -7,           /**< Mode d'ouverture invalide */
+    FS_ERR_ALREADY_OPEN = -8,       /**< Fichier déjà ouvert par son chemin dans la session */
+    FS_ERR_NOT_OPEN = -9,           /**< Fichier non ouvert dans la session */
+    FS_ERR_NOT_READABLE = -10,      /**< Fichier non ouvert en lecture */
+    FS_ERR_NOT_WRITABLE = -11,      /**< Fichier non ouvert en écriture */
+    FS_ERR_BAD_FD = -12,            /**< Descripteur invalide */
+    FS_ERR_INVALID = -13,           /**< Position, taille ou origine invalide */
+    FS_ERR_AT_ROOT = -14,           /**< Déjà à la racine */
+    FS_ERR_MOVE_INTO_SELF = -15,    /**< Déplacement d'un répertoire dans sa descendance */
+    FS_ERR_NO_MEMORY = -16,         /**< Mémoire insuffisante */
+    FS_ERR_IO = -17,                /**< Erreur d'entrée/sortie (image, journal ; voir errno) */
+    FS_ERR_JOURNAL = -18,           /**< Journal indisponible : modifications sauvées à la fermeture */
+    FS_ERR_NAME_TOO_LONG = -19,     /**< Nom (MAX_NAME_LENGTH) ou chemin (MAX_PATH_LENGTH) trop long */
+    FS_ERR_LOOP = -20,              /**< Plus de MAX_SYMLINK_FOLLOW liens symboliques suivis (boucle) */
+    FS_ERR_QUOTA = -21              /**< Quota d'octets ou d'entrées d'un répertoire dépassé (voir set_quota) */
+} FsError;
+
 /** @brief Mode lecture seule */
 #define FILE_MODE_READ  1
 /** @brief Mode écriture seule */
@@ -60,39 +88,188 @@ typedef enum {
 #define FILE_MODE_BOTH  3
 /** @brief Nom du fichier de stockage persistant */
 #define FS_FILENAME "filesystem.dat"
+/** @brief Nom du journal des modifications postérieures à l'image */
+#define FS_JOURNAL_FILENAME "filesystem.journal"
+
+/**
+ * @brief Modes de chargement de l'image persistante
+ */
+typedef enum {
+    LOAD_EAGER,     /**< Lecture complète de l'image et copie dans le tas */
+    LOAD_MMAP       /**< Projection de l'image, nœuds matérialisés à la demande */
+} LoadMode;
+
+/**
+ * @brief Description d'une entrée, renvoyée par stat_file, list_directory et read_directory
+ */
+typedef struct FileInfo {
+    FileType type;                  /**< FILE_TYPE ou DIRECTORY_TYPE */
+    int permissions;                /**< Permissions (format octal, ex: 644) */
+    long long size;                 /**< Taille du contenu (0 pour un répertoire) */
+    int links;                      /**< Nombre de liens durs */
+    int symlink;                    /**< 1 pour un lien symbolique */
+} FileInfo;
+
+/**
+ * @brief Fonction appelée par list_directory pour chaque entrée
+ *
+ * Appelée sous le verrou du répertoire : elle ne doit pas rappeler la
+ * bibliothèque. Une valeur non nulle arrête le parcours.
+ */
+typedef int (*DirVisitor)(const char* name, const FileInfo* info, void* arg);
+
+/**
+ * @brief Critères de recherche de find_files
+ */
+typedef struct FindQuery {
+    const char* name;               /**< Motif du nom (fnmatch : *, ?, [...]), NULL pour tous */
+    int type;                       /**< FILE_TYPE, DIRECTORY_TYPE, ou -1 pour les deux */
+    long long min_size;             /**< Taille minimale en octets, -1 sans minimum */
+    long long max_size;             /**< Taille maximale en octets, -1 sans maximum */
+} FindQuery;
+
+/**
+ * @brief Fonction appelée par find_files pour chaque entrée trouvée
+ *
+ * Les appels sont sérialisés mais viennent de plusieurs threads, dans
+ * un ordre quelconque ; comme DirVisitor, elle ne doit pas rappeler la
+ * bibliothèque. Une valeur non nulle arrête la recherche.
+ */
+typedef int (*FindVisitor)(const char* path, const FileInfo* info, void* arg);
+
+/**
+ * @brief Occupation d'un sous-arbre, lue par disk_usage
+ */
+typedef struct DiskUsage {
+    long long files;                /**< Nombre de fichiers (liens symboliques compris) */
+    long long directories;          /**< Nombre de répertoires, la racine du sous-arbre comprise */
+    long long bytes;                /**< Taille cumulée des contenus (chaque lien dur compté) */
+    long long stored;               /**< Octets occupés par ces contenus, après compression */
+} DiskUsage;
+
+/**
+ * @brief Occupation et quotas d'un répertoire, lus par disk_free (df)
+ */
+typedef struct DiskFree {
+    DiskUsage usage;                /**< Occupation du sous-arbre (voir disk_usage) */
+    long long quota_bytes;          /**< Quota d'octets du répertoire, 0 sans limite */
+    long long quota_nodes;          /**< Quota d'entrées (fichiers et répertoires, lui exclu), 0 sans limite */
+    long long avail_bytes;          /**< Octets encore autorisés dessous par le plus strict des quotas du répertoire et de ses ancêtres, -1 sans limite */
+    long long avail_nodes;          /**< Entrées encore autorisées dessous, de même, -1 sans limite */
+} DiskFree;
+
+/**
+ * @brief Occupation mémoire des contenus, calculée par storage_stats
+ */
+typedef struct StorageStats {
+    long long logical;              /**< Taille cumulée des contenus (chaque lien dur compté) */
+    long long referenced;           /**< Octets des extents désignés par les contenus, après compression (un bloc partagé compté à chaque contenu) */
+    long long physical;             /**< Octets des blocs du tas réellement alloués (hors image projetée) */
+    long long blocks;               /**< Nombre de blocs du tas */
+    long long dedup_blocks;         /**< Blocs rangés dans la table de déduplication */
+    long long dedup_hits;           /**< Blocs écrits ramenés à un bloc identique existant */
+} StorageStats;
+
+/** @brief Index haché des enfants d'un répertoire (défini dans file_manager.c) */
+struct DirIndex;
+
+/** @brief Index ordonné des enfants d'un répertoire (défini dans fs_order.c) */
+struct DirOrder;
+
+/** @brief Contenu d'un fichier, découpé en extents (défini dans fs_internal.h) */
+struct FileData;
+
+/**
+ * @brief État propre aux répertoires
+ *
+ * Alloué séparément du nœud pour que les fichiers et les liens n'en
+ * paient pas le coût. Le tableau des enfants croît géométriquement,
+ * un répertoire n'a donc pas de nombre maximal d'entrées.
+ */
+typedef struct DirData {
+    struct FileNode** children;     /**< Tableau des enfants, dans l'ordre d'insertion */
+    unsigned long long* child_seqs; /**< Numéro d'insertion de chaque enfant, croissant (voir read_directory) */
+    unsigned long long next_seq;    /**< Dernier numéro d'insertion attribué */
+    int child_count;                /**< Nombre d'enfants dans le répertoire */
+    int capacity;                   /**< Nombre d'emplacements alloués dans children et child_seqs */
+    struct DirIndex* index;         /**< Index haché des enfants */
+    struct DirOrder* order;         /**< Index ordonné des enfants, construit au premier parcours trié (NULL avant) */
+    unsigned int image_index;       /**< Index du répertoire dans l'image projetée */
+    int image_pending;              /**< 1 si les enfants restent à lire dans l'image */
+    int compress;                   /**< 1 si les entrées créées dedans sont compressées (voir set_compression) */
+    DiskUsage usage;                /**< Occupation du sous-arbre, le répertoire compris, tenue à jour par chaque opération (atomique) */
+    long long quota_bytes;          /**< Octets autorisés dans le sous-arbre, 0 sans limite (atomique, voir set_quota) */
+    long long quota_nodes;          /**< Entrées autorisées sous le répertoire, 0 sans limite (atomique) */
+    pthread_rwlock_t lock;          /**< Protège les champs ci-dessus et l'état des enfants */
+} DirData;
 
 /**
  * @brief Structure représentant un nœud dans le système de fichiers
  *
  * Cette structure est utilisée pour représenter à la fois les fichiers et les répertoires.
- * Elle contient toutes les métadonnées nécessaires ainsi que les liens vers d'autres nœuds.
+ * Pour un fichier, c'est une entrée de répertoire (nom vers inode) : son
+ * contenu, ses permissions et son nombre de liens sont dans l'inode
+ * partagé par ses liens durs (data, voir fs_internal.h).
+ * Ses champs sont ordonnés pour tenir dans une ligne de cache (64 octets).
  */
 typedef struct FileNode {
-    char name[MAX_NAME_LENGTH];     /**< Nom du fichier ou répertoire */
+    char* name;                     /**< Nom interné (partagé, voir fs_names.c) ou emprunté à l'image */
+    unsigned int name_hash;         /**< Empreinte du nom, calculée une seule fois */
     FileType type;                  /**< Type (FILE_TYPE ou DIRECTORY_TYPE) */
-    int permissions;                /**< Permissions (format octal, ex: 644) */
-    int size;                       /**< Taille du fichier en octets */
-    struct FileNode* parent;        /**< Pointeur vers le répertoire parent */
-    struct FileNode* children[MAX_FILES]; /**< Tableau des enfants (pour les répertoires) */
-    int child_count;                /**< Nombre d'enfants dans le répertoire */
-    char* content;                  /**< Contenu du fichier */
-    int is_open;                    /**< État du fichier (1=ouvert, 0=fermé) */
-    int ref_count;                  /**< Nombre de références (pour les liens durs) */
+    int permissions;                /**< Permissions d'un répertoire, ou d'un fichier sans inode (format octal) */
+    unsigned int open_count;        /**< Ouvertures et répertoires de travail qui retiennent le nœud (atomique) */
+    struct FileNode* parent;        /**< Répertoire parent (NULL pour la racine et un nœud supprimé) */
+    DirData* dir_data;              /**< Enfants du répertoire (NULL pour un fichier) */
+    struct FileData* data;          /**< Inode du fichier, partagé par ses liens durs (NULL si jamais écrit) */
     char* symlink_target;           /**< Cible du lien symbolique */
-    int open_mode;                  /**< Mode d'ouverture actuel */
+    unsigned char flags;            /**< Indicateurs internes (NODE_*, voir fs_internal.h) */
+    unsigned char name_length;      /**< Longueur du nom (< MAX_NAME_LENGTH) */
 } FileNode;
 
+/**
+ * @brief Entrée renvoyée par read_directory
+ */
+typedef struct DirEntry {
+    char name[MAX_NAME_LENGTH];     /**< Nom de l'entrée */
+    FileInfo info;                  /**< Description de l'entrée */
+} DirEntry;
+
+/**
+ * @brief Curseur de parcours d'un répertoire, alloué par l'appelant
+ *
+ * Ouvert par open_directory, fermé par close_directory (avant
+ * close_file_system). Ses champs sont internes.
+ */
+typedef struct DirCursor {
+    FileNode* dir;                  /**< Répertoire parcouru, retenu jusqu'à close_directory */
+    unsigned long long position;    /**< Numéro d'insertion de la dernière entrée renvoyée */
+} DirCursor;
+
 /** @brief Pointeur vers le répertoire racine du système */
 extern FileNode* root_directory;
 
-/** @brief Pointeur vers le répertoire de travail actuel */
-extern FileNode* current_directory;
+/**
+ * @brief Session d'un utilisateur : répertoire de travail et fichiers ouverts
+ *
+ * Définie dans fs_internal.h. Une session n'est utilisée que par un
+ * thread à la fois ; des sessions différentes travaillent en parallèle.
+ */
+typedef struct Session Session;
+
+/** @brief Mode de chargement utilisé par init_file_system (LOAD_MMAP par défaut) */
+extern LoadMode fs_load_mode;
+
+/** @brief Nombre de threads des parcours de sous-arbres (find, chmod -R, rm -r), 0 pour un par processeur */
+extern int fs_walk_threads;
+
+/** @brief Déduplication des blocs écrits (1 par défaut, voir storage_stats) */
+extern int fs_dedup;
 
 /**
  * @brief Crée un nouveau fichier
  * @param path Chemin du fichier à créer
  * @param permissions Permissions du fichier (format octal)
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int create_file(const char* path, int permissions);
 
@@ -100,36 +277,97 @@ int create_file(const char* path, int permissions);
  * @brief Crée un nouveau répertoire
  * @param path Chemin du répertoire à créer
  * @param permissions Permissions du répertoire (format octal)
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int create_directory(const char* path, int permissions);
 
 /**
- * @brief Liste le contenu d'un répertoire
- * @param path Chemin du répertoire à lister
+ * @brief Parcourt les entrées d'un répertoire, dans l'ordre d'insertion
+ * @param path Chemin du répertoire
+ * @param visit Fonction appelée pour chaque entrée (voir DirVisitor)
+ * @param arg Argument transmis à visit
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int list_directory(const char* path, DirVisitor visit, void* arg);
+
+/**
+ * @brief Parcourt les entrées d'un répertoire dans l'ordre de leurs noms
+ * @param path Chemin du répertoire
+ * @param after Nom à partir duquel reprendre, exclu (NULL : depuis le début)
+ * @param prefix Préfixe des noms à visiter (NULL ou "" : tous)
+ * @param visit Fonction appelée pour chaque entrée (voir DirVisitor)
+ * @param arg Argument transmis à visit
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int list_directory_sorted(const char* path, const char* after, const char* prefix, DirVisitor visit, void* arg);
+
+/**
+ * @brief Décrit un fichier ou un répertoire
+ * @param path Chemin de l'entrée
+ * @param info Description à remplir
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int stat_file(const char* path, FileInfo* info);
+
+/**
+ * @brief Décrit une entrée sans suivre un lien symbolique final
+ * @param path Chemin de l'entrée
+ * @param info Description à remplir (info->symlink : 1 pour un lien)
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int lstat_file(const char* path, FileInfo* info);
+
+/**
+ * @brief Chemin absolu canonique d'une entrée, liens symboliques résolus
+ * @param path Chemin de l'entrée
+ * @param resolved Tampon de MAX_PATH_LENGTH octets à remplir
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int real_path(const char* path, char* resolved);
+
+/**
+ * @brief Ouvre un répertoire pour le parcourir par lots (voir read_directory)
+ * @param path Chemin du répertoire
+ * @param cursor Curseur à initialiser
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int open_directory(const char* path, DirCursor* cursor);
+
+/**
+ * @brief Lit les entrées suivantes d'un répertoire ouvert
+ * @param cursor Curseur ouvert par open_directory
+ * @param entries Entrées à remplir
+ * @param count Nombre maximal d'entrées
+ * @return Nombre d'entrées lues (0 à la fin du répertoire), code d'erreur (FsError) en cas d'échec
+ */
+int read_directory(DirCursor* cursor, DirEntry* entries, int count);
+
+/**
+ * @brief Ferme un curseur de répertoire
+ * @param cursor Curseur ouvert par open_directory
  */
-void list_files(const char* path);
+void close_directory(DirCursor* cursor);
 
 /**
- * @brief Copie un fichier
+ * @brief Copie un fichier (son contenu est partagé jusqu'à la première écriture)
  * @param source Chemin du fichier source
  * @param destination Chemin de destination
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int copy_file(const char* source, const char* destination);
 
 /**
- * @brief Déplace un fichier
- * @param source Chemin du fichier source
- * @param destination Chemin de destination
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @brief Déplace ou renomme un fichier ou un répertoire, sans recopie
+ * @param source Chemin de l'entrée à déplacer
+ * @param destination Nouveau chemin, ou répertoire existant qui recevra l'entrée
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int move_file(const char* source, const char* destination);
 
 /**
  * @brief Supprime un fichier ou répertoire
  * @param path Chemin de l'élément à supprimer
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int delete_file(const char* path);
 
@@ -137,14 +375,72 @@ int delete_file(const char* path);
  * @brief Modifie les permissions d'un fichier
  * @param path Chemin du fichier
  * @param permissions Nouvelles permissions (format octal)
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int set_permissions(const char* path, int permissions);
 
+/**
+ * @brief Modifie les permissions d'une entrée et de tout son sous-arbre (chmod -R)
+ * @param path Chemin de l'entrée
+ * @param permissions Nouvelles permissions (format octal)
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int set_permissions_recursive(const char* path, int permissions);
+
+/**
+ * @brief Mesure l'occupation mémoire des contenus (octets logiques et physiques)
+ * @param stats Statistiques à remplir
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int storage_stats(StorageStats* stats);
+
+/**
+ * @brief Applique ou retire la compression transparente d'un fichier ou d'un répertoire
+ * @param path Chemin de l'entrée (un répertoire transmet la politique aux entrées créées dedans)
+ * @param enabled 1 pour compresser, 0 pour stocker en clair
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int set_compression(const char* path, int enabled);
+
+/**
+ * @brief Recherche les entrées d'un sous-arbre qui satisfont des critères
+ * @param path Racine de la recherche (comprise dans les candidats)
+ * @param query Critères
+ * @param visit Fonction appelée avec le chemin absolu de chaque entrée trouvée
+ * @param arg Argument transmis à visit
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int find_files(const char* path, const FindQuery* query, FindVisitor visit, void* arg);
+
+/**
+ * @brief Lit l'occupation d'un sous-arbre (du), en temps constant
+ * @param path Racine du sous-arbre (fichier ou répertoire)
+ * @param usage Occupation à remplir
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int disk_usage(const char* path, DiskUsage* usage);
+
+/**
+ * @brief Lit l'occupation, les quotas et la place disponible d'un répertoire (df)
+ * @param path Chemin du répertoire
+ * @param info Informations à remplir
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int disk_free(const char* path, DiskFree* info);
+
+/**
+ * @brief Fixe les quotas d'un répertoire, vérifiés à chaque écriture et création dessous
+ * @param path Chemin du répertoire
+ * @param max_bytes Taille cumulée maximale des contenus du sous-arbre, 0 sans limite
+ * @param max_nodes Nombre maximal de fichiers et répertoires sous lui, 0 sans limite
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int set_quota(const char* path, long long max_bytes, long long max_nodes);
+
 /**
  * @brief Change le répertoire courant
  * @param path Chemin du nouveau répertoire courant
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int change_directory(const char* path);
 
@@ -159,14 +455,14 @@ FileNode* get_file_by_path(const char* path);
  * @brief Ouvre un fichier
  * @param path Chemin du fichier
  * @param mode Mode d'ouverture ("r"=lecture, "w"=écriture, "rw"=les deux)
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int open_file(const char* path, const char* mode);
 
 /**
  * @brief Ferme un fichier
  * @param path Chemin du fichier
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int close_file(const char* path);
 
@@ -175,7 +471,7 @@ int close_file(const char* path);
  * @param path Chemin du fichier
  * @param buffer Buffer pour stocker le contenu lu
  * @param size Taille du buffer
- * @return Nombre d'octets lus, -1 en cas d'erreur
+ * @return Nombre d'octets lus, code d'erreur (FsError) en cas d'erreur
  */
 int read_file(const char* path, char* buffer, int size);
 
@@ -183,56 +479,165 @@ int read_file(const char* path, char* buffer, int size);
  * @brief Écrit dans un fichier
  * @param path Chemin du fichier
  * @param content Contenu à écrire
- * @return Nombre d'octets écrits, -1 en cas d'erreur
+ * @return Nombre d'octets écrits, code d'erreur (FsError) en cas d'erreur
  */
 int write_file(const char* path, const char* content);
 
+/**
+ * @brief Lit une portion d'un fichier ouvert en lecture
+ * @param path Chemin du fichier
+ * @param buffer Buffer de destination (non terminé par '\0')
+ * @param count Nombre d'octets à lire
+ * @param offset Position de lecture
+ * @return Nombre d'octets lus (0 en fin de fichier), code d'erreur (FsError) en cas d'erreur
+ */
+long long pread_file(const char* path, char* buffer, long long count, long long offset);
+
+/**
+ * @brief Écrit une portion d'un fichier ouvert en écriture
+ * @param path Chemin du fichier
+ * @param data Octets à écrire (quelconques, '\0' compris)
+ * @param count Nombre d'octets à écrire
+ * @param offset Position d'écriture (au-delà de la fin, l'intervalle se lit comme des zéros)
+ * @return Nombre d'octets écrits, code d'erreur (FsError) en cas d'erreur
+ */
+long long pwrite_file(const char* path, const char* data, long long count, long long offset);
+
+/**
+ * @brief Ajoute des octets à la fin d'un fichier ouvert en écriture
+ * @param path Chemin du fichier
+ * @param data Octets à ajouter
+ * @param count Nombre d'octets à ajouter
+ * @return Nombre d'octets écrits, code d'erreur (FsError) en cas d'erreur
+ */
+long long append_file(const char* path, const char* data, long long count);
+
+/**
+ * @brief Ouvre un fichier et renvoie un descripteur de la session courante
+ * @param path Chemin du fichier
+ * @param mode Mode d'ouverture ("r"=lecture, "w"=écriture, "rw"=les deux)
+ * @return Descripteur (le plus petit libre), code d'erreur (FsError) en cas d'échec
+ */
+int fd_open(const char* path, const char* mode);
+
+/**
+ * @brief Lit à la position courante d'un descripteur, puis l'avance
+ * @param fd Descripteur ouvert en lecture
+ * @param buffer Buffer de destination (non terminé par '\0')
+ * @param count Nombre d'octets à lire
+ * @return Nombre d'octets lus (0 en fin de fichier), code d'erreur (FsError) en cas d'erreur
+ */
+long long fd_read(int fd, char* buffer, long long count);
+
+/**
+ * @brief Écrit à la position courante d'un descripteur, puis l'avance
+ * @param fd Descripteur ouvert en écriture
+ * @param data Octets à écrire
+ * @param count Nombre d'octets à écrire
+ * @return Nombre d'octets écrits, code d'erreur (FsError) en cas d'erreur
+ */
+long long fd_write(int fd, const char* data, long long count);
+
+/**
+ * @brief Déplace la position courante d'un descripteur
+ * @param fd Descripteur ouvert
+ * @param offset Déplacement
+ * @param whence SEEK_SET, SEEK_CUR ou SEEK_END
+ * @return Nouvelle position, code d'erreur (FsError) en cas d'erreur
+ */
+long long fd_seek(int fd, long long offset, int whence);
+
+/**
+ * @brief Ferme un descripteur
+ * @param fd Descripteur ouvert
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
+ */
+int fd_close(int fd);
+
 /**
  * @brief Crée un lien dur
  * @param target Chemin de la cible
- * @param link_name Nom du lien
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @param link_name Chemin du lien
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int create_hard_link(const char* target, const char* link_name);
 
 /**
  * @brief Crée un lien symbolique
  * @param target Chemin de la cible
- * @param link_name Nom du lien
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @param link_name Chemin du lien
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int create_symbolic_link(const char* target, const char* link_name);
 
 /**
  * @brief Initialise le système de fichiers
+ * @return 0 en cas de succès ; FS_ERR_JOURNAL si le système est utilisable
+ *         sans journal ; autre code d'erreur (FsError) s'il est inutilisable
  */
-void init_file_system();
+int init_file_system();
 
 /**
  * @brief Sauvegarde l'état du système de fichiers
+ * @return 0 en cas de succès, FS_ERR_IO en cas d'échec (voir errno)
+ */
+int save_file_system();
+
+/**
+ * @brief Synchronise sur disque les modifications journalisées
+ * @return 0 en cas de succès, FS_ERR_IO si une écriture du journal a échoué
+ *         depuis la dernière synchronisation
  */
-void save_file_system();
+int sync_file_system();
 
 /**
  * @brief Ferme proprement le système de fichiers
+ * @return 0 en cas de succès, FS_ERR_IO en cas d'échec
  */
-void close_file_system();
+int close_file_system();
 
 /**
  * @brief Charge l'état du système de fichiers
- * @return 0 en cas de succès, -1 en cas d'échec
+ * @return 0 en cas de succès, code d'erreur (FsError) en cas d'échec
  */
 int load_file_system();
 
 /**
- * @brief Gère l'interface en ligne de commande
+ * @brief Traduit un code d'erreur en message
+ * @param error Code renvoyé par une opération (FsError)
+ * @return Message en français, sans majuscule ni point final
  */
-void handle_command();
+const char* fs_strerror(int error);
 
 /**
  * @brief Obtient le chemin absolu du répertoire courant
- * @return Chaîne de caractères représentant le chemin
+ * @return Chaîne de caractères représentant le chemin (propre à la session)
  */
 char* get_current_path();
 
+/**
+ * @brief Crée une session placée à la racine, sans fichier ouvert
+ * @return Nouvelle session, NULL en cas d'échec
+ */
+Session* session_create();
+
+/**
+ * @brief Ferme les fichiers ouverts d'une session et la libère
+ * @param session Session à détruire (ni NULL ni la session par défaut)
+ */
+void session_destroy(Session* session);
+
+/**
+ * @brief Attache une session au thread appelant
+ * @param session Session à attacher, NULL pour revenir à la session par défaut
+ * @return Session attachée auparavant (NULL pour la session par défaut)
+ */
+Session* session_attach(Session* session);
+
+/**
+ * @brief Retourne la session du thread appelant
+ * @return Session attachée, ou la session par défaut
+ */
+Session* session_current();
+
 #endif // FILE_MANAGER_H
@@ -0,0 +1,251 @@
+/**
+ * @file fs_alloc.c
+ * @brief Allocateur par dalles des petits objets du système de fichiers
+ *
+ * Les nœuds, leurs DirData, les noms, les cibles de liens et les petits
+ * contenus sont alloués dans des dalles (slabs) de SLAB_SIZE octets,
+ * découpées en objets d'une même classe de taille. Par rapport à un
+ * appel malloc par objet :
+ * - pas d'en-tête par objet : un nœud de 64 octets occupe 64 octets
+ * - les objets créés ensemble sont voisins en mémoire
+ * - libérer un objet revient à l'empiler sur la liste libre de sa dalle ;
+ *   une dalle vidée est rendue au système en un seul appel free, de sorte
+ *   qu'une suppression récursive n'appelle free qu'une fois par dalle
+ * - small_release_all() libère toutes les dalles d'un coup
+ *
+ * Les objets plus grands que SMALL_MAX_SIZE sont confiés à malloc.
+ *
+ * small_alloc et small_free peuvent être appelées depuis plusieurs
+ * threads : les dalles sont protégées par un verrou unique (small_lock).
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "fs_internal.h"
+
+/** @brief Taille d'une dalle (puissance de 2, les dalles sont alignées sur leur taille) */
+#define SLAB_SIZE (64 * 1024)
+/** @brief Granularité des classes de taille */
+#define SMALL_GRANULE 16
+/** @brief Nombre de classes de taille */
+#define SMALL_CLASSES (SMALL_MAX_SIZE / SMALL_GRANULE)
+
+/**
+ * @brief En-tête d'une dalle, placé au début de celle-ci
+ */
+typedef struct Slab {
+    struct SlabCache* cache;        /**< Classe de taille de la dalle */
+    struct Slab* prev;              /**< Dalle précédente de la classe */
+    struct Slab* next;              /**< Dalle suivante de la classe */
+    struct Slab* prev_partial;      /**< Dalle non pleine précédente */
+    struct Slab* next_partial;      /**< Dalle non pleine suivante */
+    void* free_list;                /**< Objets libérés, chaînés par leur premier mot */
+    unsigned int live;              /**< Nombre d'objets alloués */
+    unsigned int bump;              /**< Nombre d'objets jamais distribués déjà entamés */
+    int partial;                    /**< 1 si la dalle est dans la liste des dalles non pleines */
+} Slab;
+
+/** @brief Position du premier objet dans une dalle */
+#define SLAB_HEADER_SIZE ((sizeof(Slab) + SMALL_GRANULE - 1) & ~(size_t)(SMALL_GRANULE - 1))
+
+/**
+ * @brief Ensemble des dalles d'une classe de taille
+ */
+typedef struct SlabCache {
+    size_t object_size;             /**< Taille des objets de la classe */
+    unsigned int per_slab;          /**< Nombre d'objets par dalle */
+    Slab* slabs;                    /**< Toutes les dalles de la classe */
+    Slab* partial;                  /**< Dalles disposant d'au moins un objet libre */
+} SlabCache;
+
+/** @brief Classes de taille : SMALL_GRANULE, 2 * SMALL_GRANULE, ..., SMALL_MAX_SIZE */
+static SlabCache small_caches[SMALL_CLASSES];
+
+/** @brief Protège toutes les dalles et leurs listes */
+static pthread_mutex_t small_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Ajoute une dalle à la liste des dalles non pleines de sa classe
+ *
+ * @param slab Dalle concernée
+ */
+static void slab_link_partial(Slab* slab) {
+    SlabCache* cache = slab->cache;
+    slab->prev_partial = NULL;
+    slab->next_partial = cache->partial;
+    if (cache->partial != NULL) cache->partial->prev_partial = slab;
+    cache->partial = slab;
+    slab->partial = 1;
+}
+
+/**
+ * @brief Retire une dalle de la liste des dalles non pleines de sa classe
+ *
+ * @param slab Dalle concernée
+ */
+static void slab_unlink_partial(Slab* slab) {
+    if (slab->prev_partial != NULL) slab->prev_partial->next_partial = slab->next_partial;
+    else slab->cache->partial = slab->next_partial;
+    if (slab->next_partial != NULL) slab->next_partial->prev_partial = slab->prev_partial;
+    slab->partial = 0;
+}
+
+/**
+ * @brief Alloue une nouvelle dalle vide pour une classe
+ *
+ * @param cache Classe de taille
+ * @return Slab* Nouvelle dalle (déjà dans la liste des dalles non pleines), NULL en cas d'échec
+ */
+static Slab* slab_create(SlabCache* cache) {
+    if (cache->per_slab == 0) {
+        cache->per_slab = (SLAB_SIZE - SLAB_HEADER_SIZE) / cache->object_size;
+    }
+
+    Slab* slab = aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+    if (slab == NULL) return NULL;
+    memset(slab, 0, sizeof(Slab));
+    slab->cache = cache;
+    slab->next = cache->slabs;
+    if (cache->slabs != NULL) cache->slabs->prev = slab;
+    cache->slabs = slab;
+    slab_link_partial(slab);
+    return slab;
+}
+
+/**
+ * @brief Alloue un petit objet
+ *
+ * @param size Taille demandée en octets
+ * @return void* Objet alloué (non initialisé), NULL en cas d'échec
+ *
+ * @details
+ * - Réutilise en priorité un objet libéré, puis entame la dalle
+ * - Au-delà de SMALL_MAX_SIZE, délègue à malloc
+ */
+void* small_alloc(size_t size) {
+    if (size > SMALL_MAX_SIZE) return malloc(size);
+    if (size == 0) size = 1;
+
+    SlabCache* cache = &small_caches[(size - 1) / SMALL_GRANULE];
+    pthread_mutex_lock(&small_lock);
+    if (cache->object_size == 0) {
+        cache->object_size = ((size - 1) / SMALL_GRANULE + 1) * SMALL_GRANULE;
+    }
+
+    Slab* slab = cache->partial;
+    if (slab == NULL && (slab = slab_create(cache)) == NULL) {
+        pthread_mutex_unlock(&small_lock);
+        return NULL;
+    }
+
+    void* object;
+    if (slab->free_list != NULL) {
+        object = slab->free_list;
+        slab->free_list = *(void**)object;
+    } else {
+        object = (char*)slab + SLAB_HEADER_SIZE + (size_t)slab->bump * cache->object_size;
+        slab->bump++;
+    }
+    if (++slab->live == cache->per_slab) {
+        slab_unlink_partial(slab);
+    }
+    pthread_mutex_unlock(&small_lock);
+    return object;
+}
+
+/**
+ * @brief Libère un petit objet
+ *
+ * @param ptr Objet à libérer (NULL accepté)
+ * @param size Taille passée à small_alloc
+ *
+ * @details
+ * - La dalle de l'objet est retrouvée par alignement de son adresse
+ * - Une dalle vidée est rendue au système, sauf si c'est la seule
+ *   dalle non pleine de sa classe (évite d'en recréer une aussitôt)
+ */
+void small_free(void* ptr, size_t size) {
+    if (ptr == NULL) return;
+    if (size > SMALL_MAX_SIZE) {
+        free(ptr);
+        return;
+    }
+
+    Slab* slab = (Slab*)((uintptr_t)ptr & ~(uintptr_t)(SLAB_SIZE - 1));
+    SlabCache* cache = slab->cache;
+    pthread_mutex_lock(&small_lock);
+    *(void**)ptr = slab->free_list;
+    slab->free_list = ptr;
+    slab->live--;
+    if (!slab->partial) {
+        slab_link_partial(slab);
+    }
+
+    if (slab->live == 0 && (cache->partial != slab || slab->next_partial != NULL)) {
+        slab_unlink_partial(slab);
+        if (slab->prev != NULL) slab->prev->next = slab->next;
+        else cache->slabs = slab->next;
+        if (slab->next != NULL) slab->next->prev = slab->prev;
+        free(slab);
+    }
+    pthread_mutex_unlock(&small_lock);
+}
+
+/**
+ * @brief Copie une chaîne de longueur connue dans un petit objet
+ *
+ * @param text Chaîne à copier (pas forcément terminée par '\0')
+ * @param len Nombre d'octets à copier
+ * @return char* Copie terminée par '\0' (à libérer par small_free(copie, len + 1)),
+ *         NULL en cas d'échec
+ */
+char* small_strndup(const char* text, size_t len) {
+    char* copy = small_alloc(len + 1);
+    if (copy == NULL) return NULL;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/**
+ * @brief Octets occupés par les petits objets alloués
+ *
+ * @return size_t Somme des objets vivants, arrondis à leur classe de
+ *         taille ; les objets confiés à malloc ne sont pas comptés
+ */
+size_t small_live_bytes() {
+    size_t live = 0;
+    pthread_mutex_lock(&small_lock);
+    for (int i = 0; i < SMALL_CLASSES; i++) {
+        for (Slab* slab = small_caches[i].slabs; slab != NULL; slab = slab->next) {
+            live += (size_t)slab->live * small_caches[i].object_size;
+        }
+    }
+    pthread_mutex_unlock(&small_lock);
+    return live;
+}
+
+/**
+ * @brief Libère toutes les dalles de toutes les classes
+ *
+ * Destruction en bloc : tous les petits objets deviennent invalides,
+ * quel que soit leur nombre, en un appel free par dalle. Aucun autre
+ * thread ne doit utiliser le système de fichiers pendant l'appel.
+ */
+void small_release_all() {
+    for (int i = 0; i < SMALL_CLASSES; i++) {
+        Slab* slab = small_caches[i].slabs;
+        while (slab != NULL) {
+            Slab* next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        small_caches[i].slabs = NULL;
+        small_caches[i].partial = NULL;
+    }
+}
@@ -0,0 +1,792 @@
+/**
+ * @file fs_cli.c
+ * @brief Interface en ligne de commande du système de fichiers virtuel
+ *
+ * Chaque commande est une fonction courte qui appelle une opération de
+ * la bibliothèque puis affiche son résultat, ou le message de son code
+ * d'erreur (fs_strerror). Les commandes sont décrites par une table
+ * triée par nom, parcourue par recherche dichotomique.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
+#include "fs_cli.h"
+
+/** @brief Nombre de commandes d'un script entre deux synchronisations du journal */
+#define COMMAND_SYNC_INTERVAL 4096
+
+/**
+ * @brief Affiche la liste des commandes reconnues
+ */
+static void command_usage() {
+    printf("Commande non reconnue ou arguments invalides.\n");
+    printf("Usage:\n");
+    printf("  create <fichier> <permissions>\n");
+    printf("  mkdir <répertoire> <permissions>\n");
+    printf("  ls [chemin] [-sort] [-prefix préfixe] [-after nom]\n");
+    printf("  cd <chemin>\n");
+    printf("  copy <source> <destination>\n");
+    printf("  move <source> <destination>\n");
+    printf("  rm [-r] <chemin>\n");
+    printf("  chmod [-R] <chemin> <permissions>\n");
+    printf("  compress <chemin> on|off\n");
+    printf("  find [chemin] [-name motif] [-type f|d] [-size [+|-]octets]\n");
+    printf("  du [chemin]\n");
+    printf("  df [chemin]\n");
+    printf("  quota <répertoire> <octets> <entrées>   (0 : sans limite)\n");
+    printf("  dedupstat\n");
+    printf("  open <fichier> <mode>     (mode: r ou w)\n");
+    printf("  close <fichier>\n");
+    printf("  read <fichier>\n");
+    printf("  write <fichier> <contenu>\n");
+    printf("  append <fichier> <contenu>\n");
+    printf("  ln <source> <lien>        (lien dur)\n");
+    printf("  ln -s <source> <lien>     (lien symbolique)\n");
+    printf("  realpath <chemin>\n");
+    printf("  exit\n");
+}
+
+/**
+ * @brief Affiche l'erreur renvoyée par une opération
+ *
+ * @param status Valeur renvoyée par l'opération (négative : code FsError)
+ * @param path Chemin concerné par l'erreur
+ * @return int 0 si l'opération a réussi, -1 sinon
+ */
+static int command_report(long long status, const char* path) {
+    if (status >= 0) return 0;
+    printf("Erreur : '%s' : %s.\n", path, fs_strerror((int)status));
+    return -1;
+}
+
+/**
+ * @brief Dernier composant d'un chemin
+ *
+ * @param path Chemin
+ * @return const char* Nom désigné par le chemin (dans path)
+ */
+static const char* command_basename(const char* path) {
+    const char* name = strrchr(path, '/');
+    return name ? name + 1 : path;
+}
+
+/**
+ * @brief Commande create : crée un fichier
+ */
+static int command_create(int argc, char* argv[]) {
+    int permissions = atoi(argv[2]);
+    int status = create_file(argv[1], permissions);
+    if (status == FS_OK) {
+        printf("Fichier '%s' créé avec permissions %d.\n", argv[1], permissions);
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande mkdir : crée un répertoire
+ */
+static int command_mkdir(int argc, char* argv[]) {
+    int permissions = atoi(argv[2]);
+    int status = create_directory(argv[1], permissions);
+    if (status == FS_OK) {
+        printf("Répertoire '%s' créé avec permissions %d.\n", argv[1], permissions);
+    }
+    return command_report(status, argv[1]);
+}
+
+/** @brief Nombre d'entrées lues à la fois par command_ls */
+#define COMMAND_LS_BATCH 64
+
+/**
+ * @brief Lot d'entrées recopiées par command_ls_collect
+ */
+typedef struct LsBatch {
+    DirEntry entries[COMMAND_LS_BATCH]; /**< Entrées du lot */
+    int count;                      /**< Nombre d'entrées remplies */
+} LsBatch;
+
+/**
+ * @brief Recopie une entrée d'un parcours trié (visiteur de list_directory_sorted)
+ *
+ * @return int 1 quand le lot est plein (arrête le parcours)
+ */
+static int command_ls_collect(const char* name, const FileInfo* info, void* arg) {
+    LsBatch* batch = arg;
+    DirEntry* entry = &batch->entries[batch->count++];
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->info = *info;
+    return batch->count == COMMAND_LS_BATCH;
+}
+
+/**
+ * @brief Affiche un lot d'entrées de command_ls
+ *
+ * @param path Répertoire listé
+ * @param entries Entrées à afficher
+ * @param count Nombre d'entrées
+ * @param total Nombre d'entrées déjà affichées (0 : affiche l'en-tête)
+ */
+static void command_ls_print(const char* path, const DirEntry* entries, int count, long total) {
+    if (total == 0) {
+        printf("Contenu du répertoire '%s' :\n", strcmp(path, ".") == 0 ? get_current_path() : path);
+    }
+    for (int i = 0; i < count; i++) {
+        const FileInfo* info = &entries[i].info;
+        printf("%s %s, permissions : %d",
+               info->type == DIRECTORY_TYPE ? "Répertoire" : "Fichier", entries[i].name, info->permissions);
+        if (info->type == FILE_TYPE) {
+            printf(", taille : %lld", info->size);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Liste un répertoire dans l'ordre des noms, page par page
+ *
+ * @param path Répertoire à lister
+ * @param after Nom à partir duquel commencer, exclu (NULL : depuis le début)
+ * @param prefix Préfixe des noms à lister (NULL : tous)
+ * @return int Nombre d'entrées affichées, code d'erreur (FsError) en cas d'échec
+ *
+ * @details
+ * Chaque page de COMMAND_LS_BATCH entrées reprend après le dernier nom
+ * de la précédente (list_directory_sorted) ; rien n'est affiché sous le
+ * verrou du répertoire.
+ */
+static long command_ls_sorted(const char* path, const char* after, const char* prefix) {
+    LsBatch* batch = malloc(sizeof(LsBatch));
+    if (batch == NULL) return FS_ERR_NO_MEMORY;
+    char last[MAX_NAME_LENGTH];
+    long total = 0;
+    int status;
+    do {
+        batch->count = 0;
+        status = list_directory_sorted(path, after, prefix, command_ls_collect, batch);
+        if (status != FS_OK || batch->count == 0) break;
+        command_ls_print(path, batch->entries, batch->count, total);
+        total += batch->count;
+        memcpy(last, batch->entries[batch->count - 1].name, sizeof(last));
+        after = last;
+    } while (batch->count == COMMAND_LS_BATCH);
+    free(batch);
+    return status != FS_OK ? status : total;
+}
+
+/**
+ * @brief Commandes ls et list : liste un répertoire (le courant par défaut)
+ *
+ * @details
+ * ls [chemin] [-sort] [-prefix préfixe] [-after nom]
+ * - Sans option, les entrées sont lues et affichées dans l'ordre
+ *   d'insertion par lots de COMMAND_LS_BATCH (read_directory) : la
+ *   mémoire ne dépend pas de la taille du répertoire, et aucun verrou
+ *   n'est tenu pendant l'affichage
+ * - Avec une option, elles sont affichées dans l'ordre des noms
+ *   (command_ls_sorted), à partir du nom qui suit -after et limitées aux
+ *   noms qui commencent par -prefix
+ */
+static int command_ls(int argc, char* argv[]) {
+    const char* path = ".";
+    const char* after = NULL;
+    const char* prefix = NULL;
+    int sorted = 0;
+    int i = 1;
+    if (i < argc && argv[i][0] != '-') path = argv[i++];
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "-sort") == 0) {
+            sorted = 1;
+        } else if (strcmp(argv[i], "-prefix") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+            sorted = 1;
+        } else if (strcmp(argv[i], "-after") == 0 && i + 1 < argc) {
+            after = argv[++i];
+            sorted = 1;
+        } else {
+            command_usage();
+            return -1;
+        }
+    }
+
+    long total = 0;
+    long count;
+    if (sorted) {
+        count = total = command_ls_sorted(path, after, prefix);
+        if (count < 0) return command_report(count, path);
+    } else {
+        DirEntry entries[COMMAND_LS_BATCH];
+        DirCursor cursor;
+        int status = open_directory(path, &cursor);
+        if (status != FS_OK) return command_report(status, path);
+        while ((count = read_directory(&cursor, entries, COMMAND_LS_BATCH)) > 0) {
+            command_ls_print(path, entries, count, total);
+            total += count;
+        }
+        close_directory(&cursor);
+    }
+    if (count >= 0 && total == 0) {
+        printf(sorted ? "Aucune entrée.\n" : "Répertoire vide.\n");
+    }
+    return command_report(count, path);
+}
+
+/**
+ * @brief Commande cd : change de répertoire de travail
+ */
+static int command_cd(int argc, char* argv[]) {
+    int status = change_directory(argv[1]);
+    if (status == FS_OK) {
+        if (strcmp(argv[1], "..") == 0) {
+            printf("Changement vers le répertoire parent\n");
+        } else if (strcmp(argv[1], "/") == 0) {
+            printf("Changement vers le répertoire racine\n");
+        } else if (strcmp(argv[1], ".") != 0) {
+            printf("Changement vers le répertoire '%s'\n", argv[1]);
+        }
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande copy : copie un fichier
+ */
+static int command_copy(int argc, char* argv[]) {
+    int status = copy_file(argv[1], argv[2]);
+    if (status == FS_OK) {
+        printf("Fichier '%s' copié vers '%s'.\n", argv[1], argv[2]);
+    }
+    return command_report(status, status == FS_ERR_EXISTS ? argv[2] : argv[1]);
+}
+
+/**
+ * @brief Commande move : déplace ou renomme une entrée
+ */
+static int command_move(int argc, char* argv[]) {
+    // Le type ne sert qu'au message : move_file vérifie lui-même la source
+    FileInfo info;
+    if (stat_file(argv[1], &info) != FS_OK) info.type = FILE_TYPE;
+    int status = move_file(argv[1], argv[2]);
+    if (status == FS_OK) {
+        printf("%s '%s' déplacé vers '%s'.\n",
+               info.type == DIRECTORY_TYPE ? "Répertoire" : "Fichier", argv[1], argv[2]);
+    }
+    return command_report(status, status == FS_ERR_EXISTS ? argv[2] : argv[1]);
+}
+
+/**
+ * @brief Commandes rm et delete : un répertoire n'est supprimé qu'avec -r
+ */
+static int command_rm(int argc, char* argv[]) {
+    int recursive = argc == 3 && strcmp(argv[1], "-r") == 0;
+    const char* path = recursive ? argv[2] : argv[1];
+
+    FileInfo info;
+    if (stat_file(path, &info) != FS_OK) info.type = FILE_TYPE;
+    if (info.type == DIRECTORY_TYPE && !recursive) {
+        printf("Erreur : '%s' est un répertoire. Utilisez 'rm -r' pour supprimer un répertoire.\n", path);
+        return -1;
+    }
+    int status = delete_file(path);
+    if (status == FS_OK) {
+        printf("%s '%s' supprimé.\n",
+               info.type == DIRECTORY_TYPE ? "Répertoire" : "Fichier", command_basename(path));
+    }
+    return command_report(status, path);
+}
+
+/**
+ * @brief Commande chmod : change les permissions, de tout un sous-arbre avec -R
+ */
+static int command_chmod(int argc, char* argv[]) {
+    if (argc == 4) {
+        if (strcmp(argv[1], "-R") != 0) {
+            command_usage();
+            return -1;
+        }
+        int permissions = atoi(argv[3]);
+        int status = set_permissions_recursive(argv[2], permissions);
+        if (status == FS_OK) {
+            printf("Permissions de '%s' et de son contenu modifiées à %d.\n", argv[2], permissions);
+        }
+        return command_report(status, argv[2]);
+    }
+    int permissions = atoi(argv[2]);
+    int status = set_permissions(argv[1], permissions);
+    if (status == FS_OK) {
+        printf("Permissions du fichier '%s' modifiées à %d.\n", command_basename(argv[1]), permissions);
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande compress : applique ou retire la compression transparente
+ */
+static int command_compress(int argc, char* argv[]) {
+    int enabled = strcmp(argv[2], "on") == 0;
+    if (!enabled && strcmp(argv[2], "off") != 0) {
+        command_usage();
+        return -1;
+    }
+    int status = set_compression(argv[1], enabled);
+    if (status == FS_OK) {
+        printf("Compression de '%s' %s.\n", argv[1], enabled ? "activée" : "désactivée");
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Affiche une entrée trouvée (FindVisitor de command_find)
+ */
+static int command_find_entry(const char* path, const FileInfo* info, void* arg) {
+    (*(long*)arg)++;
+    printf("%s\n", path);
+    return 0;
+}
+
+/**
+ * @brief Commande find : recherche par nom, type et taille
+ *
+ * @details
+ * find [chemin] [-name motif] [-type f|d] [-size [+|-]octets] : avec
+ * +N, les tailles strictement supérieures à N ; avec -N, strictement
+ * inférieures. Les chemins trouvés sont absolus, dans un ordre quelconque.
+ */
+static int command_find(int argc, char* argv[]) {
+    FindQuery query = { NULL, -1, -1, -1 };
+    const char* path = ".";
+    int i = 1;
+    if (i < argc && argv[i][0] != '-') path = argv[i++];
+    for (; i + 1 < argc; i += 2) {
+        const char* value = argv[i + 1];
+        if (strcmp(argv[i], "-name") == 0) {
+            query.name = value;
+        } else if (strcmp(argv[i], "-type") == 0 && (strcmp(value, "f") == 0 || strcmp(value, "d") == 0)) {
+            query.type = value[0] == 'f' ? FILE_TYPE : DIRECTORY_TYPE;
+        } else if (strcmp(argv[i], "-size") == 0) {
+            long long size = atoll(value + (value[0] == '+' || value[0] == '-'));
+            if (value[0] != '-') query.min_size = value[0] == '+' ? size + 1 : size;
+            if (value[0] != '+') query.max_size = value[0] == '-' ? size - 1 : size;
+            // -size -0 : aucune taille ne convient
+            if (value[0] == '-' && size <= 0) query.min_size = 1, query.max_size = 0;
+        } else {
+            break;
+        }
+    }
+    if (i != argc) {
+        command_usage();
+        return -1;
+    }
+
+    long found = 0;
+    int status = find_files(path, &query, command_find_entry, &found);
+    if (status == FS_OK && found == 0) {
+        printf("Aucune entrée trouvée.\n");
+    }
+    return command_report(status, path);
+}
+
+/**
+ * @brief Commande du : occupation d'un sous-arbre (le répertoire courant par défaut)
+ */
+static int command_du(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : ".";
+    DiskUsage usage;
+    int status = disk_usage(path, &usage);
+    if (status == FS_OK) {
+        printf("%lld octets (%lld stockés), %lld fichier(s), %lld répertoire(s) : '%s'\n",
+               usage.bytes, usage.stored, usage.files, usage.directories, path);
+    }
+    return command_report(status, path);
+}
+
+/**
+ * @brief Affiche une limite et ce qu'il en reste (command_df)
+ */
+static void command_df_limit(const char* label, long long quota, long long avail) {
+    if (quota > 0) printf("%s : %lld", label, quota);
+    else printf("%s : sans limite", label);
+    if (avail >= 0) printf(", %lld disponible(s)\n", avail);
+    else printf("\n");
+}
+
+/**
+ * @brief Commande df : occupation, quotas et place disponible d'un répertoire
+ *
+ * @details
+ * La place disponible tient compte des quotas des ancêtres.
+ */
+static int command_df(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : ".";
+    DiskFree info;
+    int status = disk_free(path, &info);
+    if (status == FS_OK) {
+        printf("Occupation : %lld octets (%lld stockés), %lld fichier(s), %lld répertoire(s)\n",
+               info.usage.bytes, info.usage.stored, info.usage.files, info.usage.directories);
+        command_df_limit("Quota d'octets ", info.quota_bytes, info.avail_bytes);
+        command_df_limit("Quota d'entrées", info.quota_nodes, info.avail_nodes);
+    }
+    return command_report(status, path);
+}
+
+/**
+ * @brief Commande quota : fixe les quotas d'octets et d'entrées d'un répertoire
+ */
+static int command_quota(int argc, char* argv[]) {
+    long long max_bytes = atoll(argv[2]);
+    long long max_nodes = atoll(argv[3]);
+    int status = set_quota(argv[1], max_bytes, max_nodes);
+    if (status == FS_OK) {
+        printf("Quotas de '%s' : %lld octets, %lld entrées (0 : sans limite).\n",
+               argv[1], max_bytes, max_nodes);
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande dedupstat : octets logiques et physiques des contenus
+ */
+static int command_dedupstat(int argc, char* argv[]) {
+    StorageStats stats;
+    int status = storage_stats(&stats);
+    if (status == FS_OK) {
+        printf("Octets logiques   : %lld\n", stats.logical);
+        printf("Octets référencés : %lld (après compression)\n", stats.referenced);
+        printf("Octets physiques  : %lld (%lld bloc(s), dont %lld dans la table de déduplication)\n",
+               stats.physical, stats.blocks, stats.dedup_blocks);
+        printf("Blocs dédupliqués : %lld\n", stats.dedup_hits);
+        if (stats.physical > 0) {
+            printf("Rapport logique/physique : %.2f\n", (double)stats.logical / stats.physical);
+        }
+    }
+    return command_report(status, "/");
+}
+
+/**
+ * @brief Commande open : ouvre un fichier
+ */
+static int command_open(int argc, char* argv[]) {
+    int status = open_file(argv[1], argv[2]);
+    if (status == FS_OK) {
+        printf("Fichier '%s' ouvert en mode %s.\n", argv[1], argv[2]);
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande close : ferme un fichier
+ */
+static int command_close(int argc, char* argv[]) {
+    int status = close_file(argv[1]);
+    if (status == FS_OK) {
+        printf("Fichier '%s' fermé.\n", argv[1]);
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande read : affiche le début d'un fichier ouvert
+ */
+static int command_read(int argc, char* argv[]) {
+    char buffer[1024];
+    int length = read_file(argv[1], buffer, sizeof(buffer));
+    if (length == 0) {
+        printf("Fichier vide.\n");
+    } else if (length > 0) {
+        printf("Contenu lu : %s\n", buffer);
+    }
+    return command_report(length, argv[1]);
+}
+
+/**
+ * @brief Commande write : remplace le contenu d'un fichier ouvert
+ */
+static int command_write(int argc, char* argv[]) {
+    int length = write_file(argv[1], argv[2]);
+    if (length >= 0) {
+        printf("Contenu écrit dans '%s' (taille: %d octets).\n", argv[1], length);
+    }
+    return command_report(length, argv[1]);
+}
+
+/**
+ * @brief Commande append : ajoute à la fin d'un fichier ouvert
+ */
+static int command_append(int argc, char* argv[]) {
+    FileInfo info;
+    long long written = append_file(argv[1], argv[2], strlen(argv[2]));
+    if (written >= 0 && stat_file(argv[1], &info) == FS_OK) {
+        printf("Contenu ajouté à '%s' (taille: %lld octets).\n", argv[1], info.size);
+    }
+    return command_report(written, argv[1]);
+}
+
+/**
+ * @brief Commande ln : lien dur, ou symbolique avec -s
+ */
+static int command_ln(int argc, char* argv[]) {
+    if (argc == 3) {
+        int status = create_hard_link(argv[1], argv[2]);
+        if (status == FS_OK) {
+            printf("Lien dur '%s' créé vers '%s'.\n", argv[2], argv[1]);
+        }
+        return command_report(status, status == FS_ERR_EXISTS ? argv[2] : argv[1]);
+    }
+    if (strcmp(argv[1], "-s") == 0) {
+        int status = create_symbolic_link(argv[2], argv[3]);
+        if (status == FS_OK) {
+            printf("Lien symbolique '%s' créé vers '%s'.\n", argv[3], argv[2]);
+        }
+        return command_report(status, argv[3]);
+    }
+    command_usage();
+    return -1;
+}
+
+/**
+ * @brief Commande realpath : chemin absolu canonique, liens symboliques résolus
+ */
+static int command_realpath(int argc, char* argv[]) {
+    char resolved[MAX_PATH_LENGTH];
+    int status = real_path(argv[1], resolved);
+    if (status == FS_OK) {
+        printf("%s\n", resolved);
+    }
+    return command_report(status, argv[1]);
+}
+
+/**
+ * @brief Commande exit : interrompt la lecture des commandes
+ */
+static int command_exit(int argc, char* argv[]) {
+    return COMMAND_EXIT;
+}
+
+/**
+ * @brief Description d'une commande de l'interface
+ */
+typedef struct Command {
+    const char* name;               /**< Nom de la commande */
+    int min_args;                   /**< Nombre minimal de mots, nom compris */
+    int max_args;                   /**< Nombre maximal de mots, nom compris */
+    int (*run)(int argc, char* argv[]); /**< Exécution : 0, -1 en cas d'erreur ou COMMAND_EXIT */
+} Command;
+
+/** @brief Nombre maximal de mots d'une commande */
+#define COMMAND_MAX_ARGS 10
+
+/** @brief Table des commandes, triée par nom (recherche dichotomique) */
+static const Command commands[] = {
+    { "append", 3, 3, command_append },
+    { "cd", 2, 2, command_cd },
+    { "chmod", 3, 4, command_chmod },
+    { "close", 2, 2, command_close },
+    { "compress", 3, 3, command_compress },
+    { "copy", 3, 3, command_copy },
+    { "create", 3, 3, command_create },
+    { "dedupstat", 1, 1, command_dedupstat },
+    { "delete", 2, COMMAND_MAX_ARGS, command_rm },
+    { "df", 1, 2, command_df },
+    { "du", 1, 2, command_du },
+    { "exit", 1, 1, command_exit },
+    { "find", 1, COMMAND_MAX_ARGS, command_find },
+    { "list", 1, COMMAND_MAX_ARGS, command_ls },
+    { "ln", 3, 4, command_ln },
+    { "ls", 1, COMMAND_MAX_ARGS, command_ls },
+    { "mkdir", 3, 3, command_mkdir },
+    { "move", 3, 3, command_move },
+    { "open", 3, 3, command_open },
+    { "quota", 4, 4, command_quota },
+    { "read", 2, 2, command_read },
+    { "realpath", 2, 2, command_realpath },
+    { "rm", 2, COMMAND_MAX_ARGS, command_rm },
+    { "write", 3, 3, command_write },
+};
+
+/**
+ * @brief Compare un nom de commande à une entrée de la table (pour bsearch)
+ */
+static int command_compare(const void* name, const void* command) {
+    return strcmp(name, ((const Command*)command)->name);
+}
+
+/**
+ * @brief Découpe une ligne de commande en mots
+ *
+ * @param line Ligne à découper, modifiée sur place
+ * @param argv Mots trouvés (au plus COMMAND_MAX_ARGS)
+ * @return int Nombre de mots
+ *
+ * @details
+ * Les mots sont séparés par des espaces ; une chaîne entre guillemets
+ * forme un seul mot, espaces compris.
+ */
+static int command_split(char* line, char* argv[]) {
+    int argc = 0;
+    char *token = NULL;
+    char *rest = line;
+    char *quote_start = NULL;
+
+    while (*rest) {
+        // Passer les espaces blancs
+        while (*rest && isspace(*rest)) rest++;
+        if (!*rest) break;
+
+        if (*rest == '"') {
+            // Traiter les chaînes entre guillemets
+            rest++;
+            quote_start = rest;
+            while (*rest && *rest != '"') rest++;
+            if (*rest == '"') {
+                *rest = '\0';
+                argv[argc++] = quote_start;
+                rest++;
+            } else {
+                // Non fermere les guillemets
+                argv[argc++] = quote_start;
+                break;
+            }
+        } else {
+            // Traiter les mots séparés par des espaces
+            token = rest;
+            while (*rest && !isspace(*rest) && *rest != '"') rest++;
+            if (*rest) {
+                *rest++ = '\0';
+            }
+            argv[argc++] = token;
+        }
+
+        if (argc >= COMMAND_MAX_ARGS) break;
+    }
+    return argc;
+}
+
+/**
+ * @brief Exécute une ligne de commande
+ *
+ * @param line Ligne sans fin de ligne, modifiée sur place
+ * @return int 0 en cas de succès (ou ligne vide), -1 en cas d'erreur,
+ *         COMMAND_EXIT pour la commande exit
+ *
+ * @details
+ * - Découpe la ligne en mots (voir command_split)
+ * - Trouve la commande par recherche dichotomique dans la table triée
+ *   commands, puis vérifie son nombre d'arguments
+ * - Affiche l'aide si la commande est inconnue ou mal formée
+ */
+int execute_command(char* line) {
+    char *argv[COMMAND_MAX_ARGS];
+    int argc = command_split(line, argv);
+    if (argc == 0) return 0;
+
+    const Command* command = bsearch(argv[0], commands, sizeof(commands) / sizeof(commands[0]),
+                                     sizeof(Command), command_compare);
+    if (command == NULL || argc < command->min_args || argc > command->max_args) {
+        command_usage();
+        return -1;
+    }
+    return command->run(argc, argv);
+}
+
+/**
+ * @brief Exécute les commandes lues dans un flux, une par ligne
+ *
+ * @param input Flux des commandes (stdin, script, journal de commandes)
+ * @param options COMMAND_PROMPT et/ou COMMAND_QUIET
+ * @return long Nombre de commandes en erreur
+ *
+ * @details
+ * - Initialise le système de fichiers si nécessaire ; s'il est
+ *   inutilisable, le programme s'arrête
+ * - Avec COMMAND_PROMPT (mode interactif), affiche l'invite avant chaque
+ *   commande et synchronise le journal après chacune
+ * - Sans (mode script), synchronise le journal toutes les
+ *   COMMAND_SYNC_INTERVAL commandes : une commande peut être perdue en
+ *   cas d'arrêt brutal tant que la synchronisation suivante n'a pas eu lieu
+ * - Avec COMMAND_QUIET, les messages des commandes sont écartés ; les
+ *   erreurs du stockage restent affichées sur la sortie d'erreur
+ * - À la commande exit ou à la fin du flux, ferme proprement le système
+ *   de fichiers
+ */
+long run_commands(FILE* input, int options) {
+    // Vérifier si le répertoire racine existe
+    if (root_directory == NULL) {
+        int status = init_file_system();
+        if (status == FS_ERR_JOURNAL) {
+            fprintf(stderr, "Avertissement : %s, les modifications seront sauvegardées à la fermeture.\n",
+                    fs_strerror(status));
+        } else if (status != FS_OK) {
+            fprintf(stderr, "Erreur lors de l'ouverture du système de fichiers : %s.\n",
+                    fs_strerror(status));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int saved_stdout = -1;
+    if (options & COMMAND_QUIET) {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+    }
+
+    char input_line[1024];
+    long failures = 0;
+    long pending = 0;
+    while (1) {
+        if (options & COMMAND_PROMPT) {
+            printf("\nEntrez une commande (create/mkdir/ls/copy/move/rm/chmod/compress/find/du/df/quota/dedupstat/cd/open/close/read/write/append/ln/realpath/exit) : ");
+        }
+        if (fgets(input_line, sizeof(input_line), input) == NULL) {
+            break;
+        }
+        input_line[strcspn(input_line, "\n")] = '\0';
+
+        int status = execute_command(input_line);
+        if (status == COMMAND_EXIT) break;
+        if (status < 0) failures++;
+
+        // Une seule synchronisation du journal par commande (par lot en mode script)
+        if ((options & COMMAND_PROMPT) || ++pending == COMMAND_SYNC_INTERVAL) {
+            if (sync_file_system() != FS_OK) {
+                fprintf(stderr, "Erreur lors de la synchronisation du journal : %s.\n",
+                        fs_strerror(FS_ERR_IO));
+            }
+            pending = 0;
+        }
+    }
+
+    printf("Sauvegarde du système de fichiers...\n");
+    if (close_file_system() != FS_OK) {
+        fprintf(stderr, "Erreur lors de la sauvegarde du système de fichiers : %s.\n",
+                fs_strerror(FS_ERR_IO));
+    }
+    printf("Au revoir !\n");
+
+    if (saved_stdout >= 0) {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    return failures;
+}
+
+/**
+ * @brief Traite les commandes utilisateur du système de fichiers
+ *
+ * @details
+ * Interface interactive : lit les commandes sur l'entrée standard en
+ * affichant l'invite (voir run_commands).
+ */
+void handle_command() {
+    run_commands(stdin, COMMAND_PROMPT);
+}
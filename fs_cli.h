@@ -0,0 +1,46 @@
+#ifndef FS_CLI_H
+#define FS_CLI_H
+
+/**
+ * @file fs_cli.h
+ * @brief Interface en ligne de commande du système de fichiers virtuel
+ *
+ * Frontal de la bibliothèque décrite dans file_manager.h : découpe les
+ * commandes, appelle les opérations et affiche leurs résultats et leurs
+ * erreurs. C'est le seul module qui écrit sur la sortie standard.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdio.h>
+#include "file_manager.h"
+
+/** @brief run_commands : affiche l'invite et synchronise le journal après chaque commande */
+#define COMMAND_PROMPT 0x01
+/** @brief run_commands : écarte les messages des commandes */
+#define COMMAND_QUIET  0x02
+/** @brief Valeur renvoyée par execute_command pour la commande exit */
+#define COMMAND_EXIT   1
+
+/**
+ * @brief Gère l'interface en ligne de commande
+ */
+void handle_command();
+
+/**
+ * @brief Exécute une ligne de commande (ex: "create /a 644")
+ * @param line Ligne sans fin de ligne, modifiée sur place
+ * @return 0 en cas de succès, -1 en cas d'erreur, COMMAND_EXIT pour exit
+ */
+int execute_command(char* line);
+
+/**
+ * @brief Exécute les commandes d'un flux jusqu'à exit ou la fin du flux, puis ferme le système
+ * @param input Flux des commandes, une par ligne
+ * @param options COMMAND_PROMPT (mode interactif), COMMAND_QUIET
+ * @return Nombre de commandes en erreur
+ */
+long run_commands(FILE* input, int options);
+
+#endif // FS_CLI_H
@@ -0,0 +1,675 @@
+/**
+ * @file fs_data.c
+ * @brief Contenu des fichiers, stocké par extents de taille fixe
+ *
+ * Le contenu d'un fichier (FileData) est une table d'extents de
+ * DATA_BLOCK_SIZE octets. Lire ou écrire à une position ne touche que
+ * les extents concernés : ajouter 1 Ko à la fin d'un fichier de 1 Go
+ * coûte 1 Ko de copie, et le contenu peut contenir n'importe quel octet
+ * (y compris '\0').
+ *
+ * Chaque extent désigne :
+ * - soit un bloc du tas (DataBlock), alloué à la taille utile (puissance
+ *   de 2, au plus DATA_BLOCK_SIZE) pour que les petits fichiers restent
+ *   petits ; les petits blocs viennent des dalles (voir fs_alloc.c)
+ * - soit une zone de l'image projetée (EXTENT_MAPPED), recopiée dans le
+ *   tas à la première écriture
+ * - soit rien (trou) : les octets correspondants valent zéro
+ *
+ * Un contenu soumis à la politique DATA_COMPRESS compresse chaque extent
+ * qu'il écrit (voir fs_lz.c) : le bloc du tas ne porte plus que le flux
+ * compressé (EXTENT_COMPRESSED), décodé à la lecture et recopié en clair
+ * dans un nouveau bloc à l'écriture suivante. Un extent qui ne gagne pas
+ * au moins 1/DATA_COMPRESS_GAIN de sa taille reste en clair. La
+ * compression se fait extent par extent, au fil de l'écriture : écrire
+ * quelques octets dans un fichier compressé ne recode que l'extent touché.
+ *
+ * Un FileData est partagé par les liens durs d'un même fichier et
+ * compte ses références (links). Les copies d'un fichier ont chacune leur
+ * FileData mais partagent ses blocs, qui comptent aussi leurs références
+ * (refs) : copier ne recopie que la table des extents, et un bloc
+ * partagé n'est dupliqué qu'à la première écriture qui le touche.
+ *
+ * Un bloc achevé par une écriture (son dernier octet écrit), ou encore
+ * à part à la fermeture d'un fichier ouvert en écriture (data_seal), est
+ * rangé dans la table de déduplication (voir fs_dedup.c) : s'il est
+ * identique à un bloc déjà rangé, il est libéré et l'extent désigne ce
+ * dernier. Écrire deux fois le même contenu ne coûte qu'un exemplaire.
+ *
+ * Les compteurs links et refs sont modifiés de façon atomique : un même
+ * bloc peut être partagé par des contenus verrouillés indépendamment.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include "fs_internal.h"
+
+/** @brief Capacité minimale d'un bloc du tas */
+#define DATA_MIN_CAPACITY 16
+
+/** @brief Un extent compressé doit gagner au moins 1/DATA_COMPRESS_GAIN de sa taille */
+#define DATA_COMPRESS_GAIN 8
+
+/** @brief Taille en dessous de laquelle un extent n'est pas compressé */
+#define DATA_COMPRESS_MIN 64
+
+/** @brief Nombre de blocs du tas alloués (atomique) */
+static long long data_block_count;
+
+/** @brief Octets des blocs du tas alloués (atomique) */
+static long long data_block_bytes;
+
+/** @brief Retrouve le bloc du tas qui porte les octets d'un extent */
+#define EXTENT_BLOCK(extent) ((DataBlock*)((extent)->bytes - offsetof(DataBlock, bytes)))
+
+/**
+ * @brief Alloue un bloc du tas référencé une fois
+ *
+ * @param capacity Nombre d'octets du bloc
+ * @return DataBlock* Bloc non initialisé, NULL en cas d'échec
+ */
+static DataBlock* block_alloc(unsigned int capacity) {
+    DataBlock* block = small_alloc(sizeof(DataBlock) + capacity);
+    if (block == NULL) return NULL;
+    block->refs = 1;
+    block->capacity = capacity;
+    block->key = 0;
+    __atomic_add_fetch(&data_block_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&data_block_bytes, capacity, __ATOMIC_RELAXED);
+    return block;
+}
+
+/**
+ * @brief Libère un bloc du tas dont la dernière référence a été relâchée
+ *
+ * @param block Bloc concerné (retiré au préalable de la table de déduplication)
+ */
+static void block_free(DataBlock* block) {
+    if (block->key != 0) dedup_forget(block);
+    __atomic_sub_fetch(&data_block_count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&data_block_bytes, block->capacity, __ATOMIC_RELAXED);
+    small_free(block, sizeof(DataBlock) + block->capacity);
+}
+
+/**
+ * @brief Alloue un contenu vide
+ *
+ * @return FileData* Contenu vide référencé une fois, NULL en cas d'échec
+ */
+FileData* data_alloc() {
+    FileData* data = small_alloc(sizeof(FileData));
+    if (data == NULL) return NULL;
+    memset(data, 0, sizeof(FileData));
+    data->links = 1;
+    pthread_rwlock_init(&data->lock, NULL);
+    return data;
+}
+
+/**
+ * @brief Abandonne la référence d'un extent sur son bloc du tas
+ *
+ * @param extent Extent concerné (remis à l'état de trou)
+ *
+ * @details
+ * Le bloc est libéré avec sa dernière référence.
+ */
+static void extent_clear(DataExtent* extent) {
+    if (extent->bytes != NULL && !(extent->flags & EXTENT_MAPPED)) {
+        DataBlock* block = EXTENT_BLOCK(extent);
+        if (__atomic_sub_fetch(&block->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+            block_free(block);
+        }
+    }
+    memset(extent, 0, sizeof(DataExtent));
+}
+
+/**
+ * @brief Indique si un extent peut être modifié en place
+ *
+ * @param extent Extent concerné
+ * @return int 1 si l'extent désigne un bloc du tas en clair, hors de la
+ *         table de déduplication, dont il est le seul référent
+ */
+static int extent_exclusive(const DataExtent* extent) {
+    return extent->bytes != NULL && !(extent->flags & (EXTENT_MAPPED | EXTENT_COMPRESSED)) &&
+           EXTENT_BLOCK(extent)->key == 0 &&
+           __atomic_load_n(&EXTENT_BLOCK(extent)->refs, __ATOMIC_ACQUIRE) == 1;
+}
+
+/**
+ * @brief Range le bloc d'un extent dans la table de déduplication
+ *
+ * @param extent Extent concerné
+ *
+ * @details
+ * Seul un bloc du tas que l'extent est seul à désigner est rangé : un
+ * bloc partagé par des copies pourrait redevenir exclusif et être
+ * modifié en place par l'une d'elles. S'il existe déjà un bloc
+ * identique, l'extent le désigne et son propre bloc est libéré.
+ */
+static void extent_intern(DataExtent* extent) {
+    if (!fs_dedup || extent->bytes == NULL || (extent->flags & EXTENT_MAPPED)) return;
+    DataBlock* block = EXTENT_BLOCK(extent);
+    if (block->key != 0 || __atomic_load_n(&block->refs, __ATOMIC_ACQUIRE) != 1) return;
+
+    DataBlock* shared = dedup_intern(block);
+    if (shared != block) {
+        block_free(block);
+        extent->bytes = shared->bytes;
+    }
+}
+
+/**
+ * @brief Octets occupés par un extent
+ *
+ * @param extent Extent concerné
+ * @return unsigned int Taille du bloc du tas (flux compressé ou octets en
+ *         clair), octets valides d'un extent projeté, 0 pour un trou
+ */
+static unsigned int extent_stored(const DataExtent* extent) {
+    if (extent->bytes == NULL) return 0;
+    if (extent->flags & EXTENT_MAPPED) return extent->capacity;
+    return EXTENT_BLOCK(extent)->capacity;
+}
+
+/**
+ * @brief Ajuste le nombre d'octets occupés par un contenu
+ *
+ * @param data Contenu concerné (sous son verrou en écriture)
+ * @param delta Variation en octets
+ *
+ * @details
+ * Atomique : disk_usage lit le compteur sans prendre le verrou.
+ */
+static void data_add_stored(FileData* data, long long delta) {
+    __atomic_add_fetch(&data->stored, delta, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Compresse un extent, s'il y gagne assez
+ *
+ * @param extent Extent concerné
+ *
+ * @details
+ * Le flux est rangé dans un nouveau bloc du tas : un bloc partagé ou un
+ * extent projeté n'est pas modifié. Un extent trop petit,
+ * incompressible, ou dont le nouveau bloc ne peut être alloué reste en
+ * clair : la compression n'est jamais une erreur.
+ */
+static void extent_compress(DataExtent* extent) {
+    if (extent->bytes == NULL || (extent->flags & EXTENT_COMPRESSED) ||
+        extent->capacity < DATA_COMPRESS_MIN) {
+        return;
+    }
+
+    char buffer[DATA_BLOCK_SIZE];
+    unsigned int limit = extent->capacity - extent->capacity / DATA_COMPRESS_GAIN;
+    unsigned int length = lz_compress(extent->bytes, extent->capacity, buffer, limit);
+    if (length == 0) return;
+    DataBlock* block = block_alloc(length);
+    if (block == NULL) return;
+    memcpy(block->bytes, buffer, length);
+
+    unsigned int capacity = extent->capacity;
+    extent_clear(extent);
+    extent->bytes = block->bytes;
+    extent->capacity = capacity;
+    extent->flags = EXTENT_COMPRESSED;
+}
+
+/**
+ * @brief Décode le début d'un extent compressé
+ *
+ * @param extent Extent concerné (EXTENT_COMPRESSED)
+ * @param buffer Destination
+ * @param length Nombre d'octets à décoder (au plus extent->capacity)
+ * @return int 0 en cas de succès, -1 si le flux est invalide
+ */
+static int extent_decode(const DataExtent* extent, char* buffer, unsigned int length) {
+    return lz_decompress(extent->bytes, EXTENT_BLOCK(extent)->capacity, buffer, length);
+}
+
+/**
+ * @brief Abandonne une référence sur un contenu
+ *
+ * @param data Contenu concerné (NULL accepté)
+ *
+ * @details
+ * Le contenu et tous ses blocs sont libérés avec la dernière référence.
+ */
+void data_release(FileData* data) {
+    if (data == NULL || __atomic_sub_fetch(&data->links, 1, __ATOMIC_ACQ_REL) > 0) return;
+    for (unsigned int i = 0; i < data->extent_count; i++) {
+        extent_clear(&data->extents[i]);
+    }
+    free(data->extents);
+    free(data->names);
+    pthread_rwlock_destroy(&data->lock);
+    small_free(data, sizeof(FileData));
+}
+
+/**
+ * @brief Taille d'un contenu
+ *
+ * @param data Contenu (NULL pour un fichier jamais écrit)
+ * @return long long Taille en octets
+ */
+long long data_size(const FileData* data) {
+    return data ? data->size : 0;
+}
+
+/**
+ * @brief Octets occupés par un contenu
+ *
+ * @param data Contenu (NULL pour un fichier jamais écrit)
+ * @return long long Taille des extents après compression (un bloc
+ *         partagé par des copies est compté dans chacune)
+ */
+long long data_stored(const FileData* data) {
+    return data ? __atomic_load_n(&data->stored, __ATOMIC_RELAXED) : 0;
+}
+
+/**
+ * @brief Agrandit la table des extents pour couvrir un nombre de blocs
+ *
+ * @param data Contenu concerné
+ * @param count Nombre de blocs à couvrir
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * La table double de taille : une suite d'ajouts en fin de fichier
+ * coûte un temps constant amorti par bloc.
+ */
+static int data_reserve(FileData* data, unsigned long long count) {
+    if (count > UINT_MAX) return -1;
+    if (count > data->extent_capacity) {
+        unsigned long long capacity = data->extent_capacity ? data->extent_capacity : 1;
+        while (capacity < count) capacity *= 2;
+        if (capacity > UINT_MAX) capacity = UINT_MAX;
+        DataExtent* extents = realloc(data->extents, capacity * sizeof(DataExtent));
+        if (extents == NULL) return -1;
+        data->extents = extents;
+        data->extent_capacity = (unsigned int)capacity;
+    }
+    if (count > data->extent_count) {
+        memset(data->extents + data->extent_count, 0,
+               (count - data->extent_count) * sizeof(DataExtent));
+        data->extent_count = (unsigned int)count;
+    }
+    return 0;
+}
+
+/**
+ * @brief Rend un extent modifiable sur au moins need octets
+ *
+ * @param extent Extent concerné
+ * @param need Nombre d'octets qui doivent être accessibles
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ *
+ * @details
+ * - Un trou ou un bloc trop petit reçoit un bloc du tas de capacité
+ *   doublée, les octets existants étant recopiés et le reste mis à zéro
+ * - Un extent projeté est recopié dans le tas (l'image n'est jamais modifiée)
+ * - Un extent compressé est décodé dans un nouveau bloc
+ * - Un bloc partagé avec une copie est dupliqué (copie sur écriture)
+ */
+static int extent_make_writable(DataExtent* extent, unsigned int need) {
+    if (extent_exclusive(extent) && extent->capacity >= need) {
+        return 0;
+    }
+
+    unsigned int keep = extent->bytes ? extent->capacity : 0;
+    unsigned int capacity = DATA_MIN_CAPACITY;
+    while (capacity < need || capacity < keep) capacity *= 2;
+    if (capacity > DATA_BLOCK_SIZE) capacity = DATA_BLOCK_SIZE;
+
+    DataBlock* block = block_alloc(capacity);
+    if (block == NULL) return -1;
+    if (keep > 0 && (extent->flags & EXTENT_COMPRESSED)) {
+        if (extent_decode(extent, block->bytes, keep) != 0) {
+            block_free(block);
+            return -1;
+        }
+    } else if (keep > 0) {
+        memcpy(block->bytes, extent->bytes, keep);
+    }
+    memset(block->bytes + keep, 0, capacity - keep);
+
+    extent_clear(extent);
+    extent->bytes = block->bytes;
+    extent->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Lit une portion d'un contenu
+ *
+ * @param data Contenu (NULL pour un fichier vide)
+ * @param buffer Destination
+ * @param count Nombre d'octets demandés
+ * @param offset Position de lecture
+ * @return long long Nombre d'octets lus (0 au-delà de la fin)
+ */
+long long data_read(const FileData* data, char* buffer, long long count, long long offset) {
+    long long size = data_size(data);
+    if (offset < 0 || count <= 0 || offset >= size) return 0;
+    if (count > size - offset) count = size - offset;
+
+    long long done = 0;
+    while (done < count) {
+        long long position = offset + done;
+        unsigned long long block = position / DATA_BLOCK_SIZE;
+        unsigned int in = position % DATA_BLOCK_SIZE;
+        unsigned int length = DATA_BLOCK_SIZE - in;
+        if (length > count - done) length = count - done;
+
+        // Octets présents dans l'extent, le reste est un trou
+        unsigned int present = 0;
+        if (block < data->extent_count) {
+            const DataExtent* extent = &data->extents[block];
+            if (extent->bytes != NULL && extent->capacity > in) {
+                present = extent->capacity - in < length ? extent->capacity - in : length;
+                if (extent->flags & EXTENT_COMPRESSED) {
+                    char block_bytes[DATA_BLOCK_SIZE];
+                    if (extent_decode(extent, block_bytes, in + present) != 0) present = 0;
+                    else memcpy(buffer + done, block_bytes + in, present);
+                } else {
+                    memcpy(buffer + done, extent->bytes + in, present);
+                }
+            }
+        }
+        memset(buffer + done + present, 0, length - present);
+        done += length;
+    }
+    return count;
+}
+
+/**
+ * @brief Note qu'un extent a été écrit sans être rangé dans la table de déduplication
+ *
+ * @param data Contenu concerné
+ * @param index Index de l'extent
+ */
+static void data_unsealed(FileData* data, unsigned int index) {
+    if (data->unsealed_begin == data->unsealed_end) {
+        data->unsealed_begin = index;
+        data->unsealed_end = index + 1;
+    } else if (index < data->unsealed_begin) {
+        data->unsealed_begin = index;
+    } else if (index >= data->unsealed_end) {
+        data->unsealed_end = index + 1;
+    }
+}
+
+/**
+ * @brief Écrit une portion d'un contenu, en l'agrandissant si nécessaire
+ *
+ * @param data Contenu concerné
+ * @param buffer Octets à écrire
+ * @param count Nombre d'octets
+ * @param offset Position d'écriture (au-delà de la fin, l'intervalle est un trou)
+ * @return long long Nombre d'octets écrits, -1 en cas d'erreur
+ *
+ * @details
+ * Seuls les extents couverts par [offset, offset + count) sont touchés ;
+ * avec la politique DATA_COMPRESS, chacun est recompressé aussitôt écrit.
+ * Un extent dont le dernier octet est écrit est rangé dans la table de
+ * déduplication (les écritures suivantes le dupliqueront d'abord).
+ */
+long long data_write(FileData* data, const char* buffer, long long count, long long offset) {
+    if (offset < 0 || count < 0) return -1;
+    if (count == 0) return 0;
+
+    long long end = offset + count;
+    if (data_reserve(data, (end + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE) != 0) {
+        return -1;
+    }
+
+    int compress = __atomic_load_n(&data->flags, __ATOMIC_RELAXED) & DATA_COMPRESS;
+    long long done = 0;
+    while (done < count) {
+        long long position = offset + done;
+        DataExtent* extent = &data->extents[position / DATA_BLOCK_SIZE];
+        unsigned int in = position % DATA_BLOCK_SIZE;
+        unsigned int length = DATA_BLOCK_SIZE - in;
+        if (length > count - done) length = count - done;
+
+        unsigned int stored = extent_stored(extent);
+        if (extent_make_writable(extent, in + length) != 0) {
+            // Les octets déjà écrits restent en place
+            if (offset + done > data->size) data->size = offset + done;
+            return -1;
+        }
+        memcpy(extent->bytes + in, buffer + done, length);
+        if (compress) extent_compress(extent);
+        if (in + length == DATA_BLOCK_SIZE) extent_intern(extent);
+        else data_unsealed(data, (unsigned int)(position / DATA_BLOCK_SIZE));
+        data_add_stored(data, (long long)extent_stored(extent) - stored);
+        done += length;
+    }
+    if (end > data->size) data->size = end;
+    return count;
+}
+
+/**
+ * @brief Change la taille d'un contenu
+ *
+ * @param data Contenu concerné
+ * @param size Nouvelle taille
+ * @return int 0 en cas de succès, -1 en cas d'erreur
+ *
+ * @details
+ * - Raccourcir libère les extents au-delà de la nouvelle fin et efface
+ *   la fin du dernier bloc, qui se relira comme des zéros (un bloc
+ *   projeté, partagé ou compressé n'est pas modifié : seule sa partie
+ *   valide est réduite)
+ * - Agrandir crée un trou
+ */
+int data_truncate(FileData* data, long long size) {
+    if (size < 0) return -1;
+    unsigned long long blocks = (size + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE;
+
+    if (size < data->size) {
+        for (unsigned long long i = blocks; i < data->extent_count; i++) {
+            data_add_stored(data, -(long long)extent_stored(&data->extents[i]));
+            extent_clear(&data->extents[i]);
+        }
+        if (blocks < data->extent_count) data->extent_count = (unsigned int)blocks;
+
+        unsigned int in = size % DATA_BLOCK_SIZE;
+        DataExtent* last = blocks > 0 ? &data->extents[blocks - 1] : NULL;
+        if (in > 0 && last != NULL && last->bytes != NULL && last->capacity > in) {
+            if (extent_exclusive(last)) {
+                memset(last->bytes + in, 0, last->capacity - in);
+            } else {
+                long long stored = extent_stored(last);
+                last->capacity = in;
+                data_add_stored(data, (long long)extent_stored(last) - stored);
+            }
+        }
+    } else if (data_reserve(data, blocks) != 0) {
+        return -1;
+    }
+    data->size = size;
+    return 0;
+}
+
+/**
+ * @brief Range dans la table de déduplication les blocs d'un contenu qui n'y sont pas encore
+ *
+ * @param data Contenu concerné
+ *
+ * @details
+ * Appelée à la fermeture d'un fichier ouvert en écriture et après le
+ * chargement d'une image : le dernier bloc, et ceux modifiés sans être
+ * achevés, n'ont pas été rangés par data_write. Seul l'intervalle
+ * d'extents qu'elle a noté est parcouru : fermer un gros fichier après
+ * une petite écriture ne coûte que les blocs touchés.
+ */
+void data_seal(FileData* data) {
+    unsigned int end = data->unsealed_end < data->extent_count ? data->unsealed_end : data->extent_count;
+    for (unsigned int i = data->unsealed_begin; i < end; i++) {
+        DataExtent* extent = &data->extents[i];
+        unsigned int stored = extent_stored(extent);
+        extent_intern(extent);
+        data_add_stored(data, (long long)extent_stored(extent) - stored);
+    }
+    data->unsealed_begin = data->unsealed_end = 0;
+}
+
+/**
+ * @brief Blocs du tas alloués pour l'ensemble des contenus
+ *
+ * @param blocks Nombre de blocs
+ * @param bytes Octets de ces blocs
+ */
+void data_block_stats(long long* blocks, long long* bytes) {
+    *blocks = __atomic_load_n(&data_block_count, __ATOMIC_RELAXED);
+    *bytes = __atomic_load_n(&data_block_bytes, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Applique ou retire la politique de compression d'un contenu
+ *
+ * @param data Contenu concerné
+ * @param enabled 1 pour compresser, 0 pour stocker en clair
+ * @return int 0 en cas de succès, -1 si un extent n'a pu être décodé
+ *         faute de mémoire (les extents déjà traités le restent)
+ *
+ * @details
+ * Les extents existants sont aussitôt recodés : compressés (ceux qui y
+ * gagnent) ou remis en clair.
+ */
+int data_set_compress(FileData* data, int enabled) {
+    if (enabled) __atomic_or_fetch(&data->flags, DATA_COMPRESS, __ATOMIC_RELAXED);
+    else __atomic_and_fetch(&data->flags, ~DATA_COMPRESS, __ATOMIC_RELAXED);
+
+    for (unsigned int i = 0; i < data->extent_count; i++) {
+        DataExtent* extent = &data->extents[i];
+        unsigned int stored = extent_stored(extent);
+        if (enabled) {
+            extent_compress(extent);
+        } else if ((extent->flags & EXTENT_COMPRESSED) &&
+                   extent_make_writable(extent, extent->capacity) != 0) {
+            return -1;
+        }
+        extent_intern(extent);
+        data_add_stored(data, (long long)extent_stored(extent) - stored);
+    }
+    return 0;
+}
+
+/**
+ * @brief Ajoute un nom (lien dur) à la liste des nœuds d'un contenu
+ *
+ * @param data Contenu concerné (sous son verrou en écriture)
+ * @param first Seul nom actuel du contenu, ajouté d'abord si la liste
+ *        n'existe pas encore (NULL sinon)
+ * @param name Nouveau nom
+ * @return int 0 en cas de succès, -1 si l'allocation échoue (liste inchangée)
+ *
+ * @details
+ * La liste n'est créée qu'au deuxième lien : un fichier qui n'a jamais
+ * eu qu'un nom n'en paie pas le coût. Elle double quand elle est pleine.
+ */
+int data_add_name(FileData* data, FileNode* first, FileNode* name) {
+    int add_first = data->names == NULL && first != NULL;
+    unsigned int need = data->name_count + 1 + add_first;
+    if (need > data->name_capacity) {
+        unsigned int capacity = data->name_capacity ? data->name_capacity * 2 : 4;
+        while (capacity < need) capacity *= 2;
+        FileNode** names = realloc(data->names, capacity * sizeof(FileNode*));
+        if (names == NULL) return -1;
+        data->names = names;
+        data->name_capacity = capacity;
+    }
+    if (add_first) data->names[data->name_count++] = first;
+    data->names[data->name_count++] = name;
+    return 0;
+}
+
+/**
+ * @brief Retire un nom de la liste des nœuds d'un contenu
+ *
+ * @param data Contenu concerné (sous son verrou en écriture)
+ * @param name Nom à retirer (absent de la liste accepté)
+ *
+ * @details
+ * Le dernier nom prend la place du nom retiré : l'ordre est sans importance.
+ */
+void data_remove_name(FileData* data, FileNode* name) {
+    for (unsigned int i = 0; i < data->name_count; i++) {
+        if (data->names[i] == name) {
+            data->names[i] = data->names[--data->name_count];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Duplique un contenu en partageant ses blocs
+ *
+ * @param data Contenu source (NULL accepté)
+ * @return FileData* Copie indépendante, NULL si data est NULL ou en cas d'échec
+ *
+ * @details
+ * - Seule la table des extents est recopiée : le coût ne dépend que du
+ *   nombre de blocs, aucun octet de contenu n'est copié
+ * - La copie reprend les permissions et la politique de compression ;
+ *   les extents compressés restent compressés
+ * - Chaque bloc du tas gagne une référence ; la source comme la copie le
+ *   dupliqueront avant d'y écrire (voir extent_make_writable)
+ * - Les extents projetés sont partagés tels quels (l'image est en lecture seule)
+ */
+FileData* data_clone(const FileData* data) {
+    if (data == NULL) return NULL;
+    FileData* copy = data_alloc();
+    if (copy == NULL || data_reserve(copy, data->extent_count) != 0) {
+        data_release(copy);
+        return NULL;
+    }
+
+    memcpy(copy->extents, data->extents, data->extent_count * sizeof(DataExtent));
+    for (unsigned int i = 0; i < data->extent_count; i++) {
+        const DataExtent* extent = &data->extents[i];
+        if (extent->bytes != NULL && !(extent->flags & EXTENT_MAPPED)) {
+            __atomic_add_fetch(&EXTENT_BLOCK(extent)->refs, 1, __ATOMIC_RELAXED);
+        }
+    }
+    copy->size = data->size;
+    copy->stored = data_stored(data);
+    // La copie n'a qu'un nom : elle ne reprend que la politique
+    copy->flags = __atomic_load_n(&data->flags, __ATOMIC_RELAXED) & ~DATA_NAMES_PENDING;
+    copy->permissions = __atomic_load_n(&data->permissions, __ATOMIC_RELAXED);
+    return copy;
+}
+
+/**
+ * @brief Crée un contenu dont les extents désignent une zone de l'image projetée
+ *
+ * @param bytes Début du contenu dans la projection (doit survivre au contenu)
+ * @param size Taille du contenu
+ * @return FileData* Nouveau contenu, NULL en cas d'échec
+ */
+FileData* data_map(const char* bytes, long long size) {
+    FileData* data = data_alloc();
+    if (data == NULL) return NULL;
+    if (data_reserve(data, (size + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE) != 0) {
+        data_release(data);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < data->extent_count; i++) {
+        long long start = (long long)i * DATA_BLOCK_SIZE;
+        data->extents[i].bytes = (char*)(bytes + start);
+        data->extents[i].capacity = size - start < DATA_BLOCK_SIZE ? size - start : DATA_BLOCK_SIZE;
+        data->extents[i].flags = EXTENT_MAPPED;
+    }
+    data->size = size;
+    data->stored = size;
+    return data;
+}
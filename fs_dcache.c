@@ -0,0 +1,374 @@
+/**
+ * @file fs_dcache.c
+ * @brief Cache de résolution des chemins absolus
+ *
+ * get_file_by_path parcourt un chemin composant par composant, une
+ * recherche dans l'index haché d'un répertoire par niveau. Le cache
+ * mémorise le résultat de la résolution d'un chemin absolu entier, de
+ * sorte qu'un chemin déjà résolu ne coûte plus qu'un calcul d'empreinte
+ * et une recherche dans une seule case :
+ * - entrée positive : le chemin désigne un nœud existant
+ * - entrée négative : seul le dernier composant manque ; la résolution
+ *   renvoie alors le répertoire qui le recevrait (voir get_file_by_path)
+ *
+ * Seuls les chemins canoniques (sans composant vide, "." ni "..") d'au
+ * plus DCACHE_PATH_MAX octets sont mémorisés ; leur texte est
+ * rangé dans l'entrée, sans allocation.
+ *
+ * Invalidation :
+ * - création d'un fichier, d'un répertoire ou d'un lien, suppression ou
+ *   déplacement d'un fichier : l'entrée du seul nom concerné est retirée
+ *   (dcache_invalidate)
+ * - suppression ou déplacement d'un répertoire : tous les chemins qui le
+ *   traversent changent de résultat ; le cache entier est invalidé en
+ *   changeant de génération (dcache_flush), sans le parcourir
+ *
+ * Seules les résolutions qui n'ont suivi aucun lien symbolique sont
+ * mémorisées par chemin : le résultat d'un chemin qui traverse un lien
+ * dépend aussi du chemin de sa cible. La cible résolue de chaque lien
+ * est mémorisée à part, par nœud (dcache_link_lookup) : un lien déjà
+ * suivi ne coûte plus qu'une case, quelle que soit la longueur de la
+ * chaîne de liens et du chemin de la cible. Ces entrées sont toutes
+ * invalidées, en changeant de génération, par chaque suppression ou
+ * déplacement (dcache_link_flush) : une création ne change le résultat
+ * d'aucune résolution réussie, et les échecs ne sont pas mémorisés.
+ *
+ * Les cases sont protégées par DCACHE_LOCKS verrous. Une création,
+ * concurrente d'une résolution du même chemin, pourrait invalider
+ * l'entrée avant que la résolution n'y range un résultat négatif
+ * périmé : le numéro de séquence de la case, relevé avant la
+ * résolution, empêche alors l'insertion.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "fs_internal.h"
+
+/** @brief Nombre de cases du cache (puissance de 2) */
+#define DCACHE_BUCKETS 2048
+/** @brief Nombre d'entrées par case */
+#define DCACHE_WAYS 4
+/** @brief Une case pleine n'admet qu'une insertion proposée sur DCACHE_ADMIT */
+#define DCACHE_ADMIT 8
+/** @brief Nombre de verrous, partagés par les cases de même rang modulo DCACHE_LOCKS */
+#define DCACHE_LOCKS 64
+/** @brief Nombre d'entrées du cache des cibles de liens (puissance de 2) */
+#define DCACHE_LINKS 4096
+
+/**
+ * @brief Case du cache : quelques entrées de même empreinte modulo DCACHE_BUCKETS
+ *
+ * Tient dans une ligne de cache : une recherche infructueuse ne lit
+ * qu'elle, le texte des chemins (dcache_paths) n'est comparé que si une
+ * empreinte correspond.
+ */
+typedef struct DcacheBucket {
+    unsigned int seq;                       /**< Incrémenté à chaque invalidation dans la case */
+    unsigned int generation;                /**< Génération des entrées ; autre que la courante : case vide */
+    unsigned char victim;                   /**< Prochaine entrée remplacée si la case est pleine */
+    unsigned char missing;                  /**< Bit i : l'entrée i est négative */
+    unsigned char length[DCACHE_WAYS];      /**< Longueur des chemins */
+    unsigned int hash[DCACHE_WAYS];         /**< Empreinte des chemins */
+    FileNode* node[DCACHE_WAYS];            /**< Résultat de la résolution (NULL : entrée libre) */
+} DcacheBucket;
+
+/** @brief Cases du cache */
+static DcacheBucket dcache_buckets[DCACHE_BUCKETS];
+
+/** @brief Texte des chemins mémorisés, non terminés par '\0' */
+static char dcache_paths[DCACHE_BUCKETS][DCACHE_WAYS][DCACHE_PATH_MAX];
+
+/** @brief Verrous des cases : protègent leurs entrées, leur séquence et leurs chemins */
+static pthread_rwlock_t dcache_locks[DCACHE_LOCKS];
+
+/** @brief Insertions proposées par le thread dans une case pleine */
+static _Thread_local unsigned int dcache_attempts;
+
+/** @brief Génération courante ; une case d'une autre génération est vide */
+static unsigned int dcache_generation;
+
+/**
+ * @brief Entrée du cache des cibles de liens
+ */
+typedef struct DcacheLink {
+    FileNode* link;                         /**< Lien symbolique (NULL : entrée libre) */
+    FileNode* target;                       /**< Nœud désigné par sa cible, liens suivis */
+    unsigned int generation;                /**< Génération de l'entrée ; autre que la courante : entrée vide */
+} DcacheLink;
+
+/** @brief Cibles résolues des liens, indexées par l'adresse du lien */
+static DcacheLink dcache_links[DCACHE_LINKS];
+
+/** @brief Génération courante des cibles de liens */
+static unsigned int dcache_link_generation;
+
+/** @brief Initialisation des verrous */
+static pthread_once_t dcache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Initialise les verrous des cases (une seule fois)
+ */
+static void dcache_init() {
+    for (int i = 0; i < DCACHE_LOCKS; i++) {
+        pthread_rwlock_init(&dcache_locks[i], NULL);
+    }
+}
+
+/**
+ * @brief Verrou d'une empreinte
+ *
+ * @param hash Empreinte du chemin
+ * @return pthread_rwlock_t* Verrou de la case correspondante, initialisé
+ */
+static pthread_rwlock_t* dcache_lock(unsigned int hash) {
+    pthread_once(&dcache_once, dcache_init);
+    return &dcache_locks[hash & (DCACHE_LOCKS - 1)];
+}
+
+/**
+ * @brief Cherche un chemin dans une case
+ *
+ * @param index Rang de la case
+ * @param path Chemin
+ * @param length Longueur du chemin
+ * @param hash Empreinte du chemin
+ * @return int Rang de l'entrée, -1 si le chemin n'y est pas
+ */
+static int dcache_find(unsigned int index, const char* path, unsigned int length, unsigned int hash) {
+    DcacheBucket* bucket = &dcache_buckets[index];
+    if (bucket->generation != __atomic_load_n(&dcache_generation, __ATOMIC_ACQUIRE)) return -1;
+    for (int i = 0; i < DCACHE_WAYS; i++) {
+        if (bucket->node[i] != NULL && bucket->hash[i] == hash && bucket->length[i] == length &&
+            memcmp(dcache_paths[index][i], path, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Prépare la clé d'un chemin absolu
+ *
+ * @param path Chemin absolu
+ * @param key Clé à remplir
+ * @return int 0 si le chemin peut être mis en cache, -1 sinon (chemin
+ *         relatif, non canonique ou trop long)
+ *
+ * @details
+ * Vérifie la forme du chemin et calcule son empreinte (FNV-1a 32 bits)
+ * en un seul passage.
+ */
+int dcache_key(const char* path, DcacheKey* key) {
+    if (path[0] != '/') return -1;
+
+    unsigned int hash = 2166136261u;
+    size_t i = 0;
+    while (path[i] != '\0') {
+        if (i >= DCACHE_PATH_MAX) return -1;
+        if (path[i] == '/') {
+            // Composant vide, "." ou ".." : chemin non canonique
+            const char* next = path + i + 1;
+            if (next[0] == '\0' || next[0] == '/') return -1;
+            if (next[0] == '.' && (next[1] == '\0' || next[1] == '/' ||
+                                   (next[1] == '.' && (next[2] == '\0' || next[2] == '/')))) {
+                return -1;
+            }
+        }
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+        i++;
+    }
+
+    key->path = path;
+    key->length = (unsigned int)i;
+    key->hash = hash;
+    return 0;
+}
+
+/**
+ * @brief Cherche la résolution d'un chemin dans le cache
+ *
+ * @param key Clé préparée par dcache_key ; en cas d'absence, la génération
+ *        et la séquence de la case y sont relevées pour dcache_insert, qui
+ *        n'insère dans une case pleine qu'une fois sur DCACHE_ADMIT ; en
+ *        cas de succès, key->missing indique une entrée négative
+ * @return FileNode* Résultat mémorisé, NULL si le chemin n'est pas en cache
+ */
+FileNode* dcache_lookup(DcacheKey* key) {
+    unsigned int index = key->hash & (DCACHE_BUCKETS - 1);
+    pthread_rwlock_t* lock = dcache_lock(key->hash);
+
+    pthread_rwlock_rdlock(lock);
+    key->generation = __atomic_load_n(&dcache_generation, __ATOMIC_ACQUIRE);
+    key->seq = dcache_buckets[index].seq;
+    int way = dcache_find(index, key->path, key->length, key->hash);
+    FileNode* node = way < 0 ? NULL : dcache_buckets[index].node[way];
+    key->missing = way >= 0 && (dcache_buckets[index].missing >> way & 1);
+    int full = dcache_buckets[index].generation == key->generation;
+    for (int i = 0; i < DCACHE_WAYS && full; i++) {
+        if (dcache_buckets[index].node[i] == NULL) full = 0;
+    }
+    pthread_rwlock_unlock(lock);
+
+    // Case pleine : un parcours de plus de chemins que le cache n'en
+    // contient ne doit pas évincer les entrées utiles à chaque échec
+    key->admit = !full || dcache_attempts++ % DCACHE_ADMIT == 0;
+    return node;
+}
+
+/**
+ * @brief Mémorise la résolution d'un chemin
+ *
+ * @param key Clé passée à dcache_lookup avant la résolution
+ * @param node Résultat de la résolution
+ * @param missing 1 pour une entrée négative : node est le répertoire qui
+ *        recevrait le dernier composant
+ *
+ * @details
+ * N'insère rien si une invalidation a touché la case ou le cache depuis
+ * dcache_lookup : le résultat est peut-être déjà périmé. Une case d'une
+ * génération antérieure est d'abord vidée ; une entrée libre est
+ * utilisée en priorité, sinon les entrées sont remplacées à tour de
+ * rôle. Dans une case pleine, dcache_lookup n'admet qu'une insertion
+ * sur DCACHE_ADMIT : les chemins souvent résolus finissent par entrer,
+ * ceux résolus une fois ne chassent pas les autres.
+ */
+void dcache_insert(const DcacheKey* key, FileNode* node, int missing) {
+    unsigned int index = key->hash & (DCACHE_BUCKETS - 1);
+    DcacheBucket* bucket = &dcache_buckets[index];
+    pthread_rwlock_t* lock = dcache_lock(key->hash);
+    if (!key->admit) return;
+
+    pthread_rwlock_wrlock(lock);
+    if (bucket->seq != key->seq ||
+        __atomic_load_n(&dcache_generation, __ATOMIC_ACQUIRE) != key->generation) {
+        pthread_rwlock_unlock(lock);
+        return;
+    }
+    if (bucket->generation != key->generation) {
+        memset(bucket->node, 0, sizeof(bucket->node));
+        bucket->generation = key->generation;
+    }
+
+    int way = dcache_find(index, key->path, key->length, key->hash);
+    for (int i = 0; i < DCACHE_WAYS && way < 0; i++) {
+        if (bucket->node[i] == NULL) way = i;
+    }
+    if (way < 0) {
+        way = bucket->victim++ % DCACHE_WAYS;
+    }
+    bucket->node[way] = node;
+    bucket->missing = (bucket->missing & ~(1u << way)) | (missing ? 1u << way : 0);
+    bucket->hash[way] = key->hash;
+    bucket->length[way] = (unsigned char)key->length;
+    memcpy(dcache_paths[index][way], key->path, key->length);
+    pthread_rwlock_unlock(lock);
+}
+
+/**
+ * @brief Retire l'entrée d'un chemin
+ *
+ * @param path Chemin absolu canonique (pas forcément terminé par '\0')
+ * @param length Longueur du chemin
+ *
+ * @details
+ * À appeler une fois le changement visible dans l'arborescence. La
+ * séquence de la case est incrémentée même si le chemin n'y est pas :
+ * une résolution en cours de ce chemin n'insérera pas son résultat.
+ */
+void dcache_invalidate(const char* path, size_t length) {
+    if (length > DCACHE_PATH_MAX) return;
+
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+
+    unsigned int index = hash & (DCACHE_BUCKETS - 1);
+    pthread_rwlock_t* lock = dcache_lock(hash);
+    pthread_rwlock_wrlock(lock);
+    dcache_buckets[index].seq++;
+    int way = dcache_find(index, path, (unsigned int)length, hash);
+    if (way >= 0) dcache_buckets[index].node[way] = NULL;
+    pthread_rwlock_unlock(lock);
+}
+
+/**
+ * @brief Invalide tout le cache
+ *
+ * @details
+ * Change de génération sans parcourir les cases, cibles de liens
+ * comprises. Appelée sous fs_tree_lock en écriture ou hors de toute
+ * concurrence : aucune résolution n'est alors en cours.
+ */
+void dcache_flush() {
+    __atomic_add_fetch(&dcache_generation, 1, __ATOMIC_RELEASE);
+    dcache_link_flush();
+}
+
+/**
+ * @brief Empreinte de l'adresse d'un lien
+ */
+static unsigned int dcache_link_hash(const FileNode* link) {
+    uint64_t value = (uint64_t)(uintptr_t)link * 0x9E3779B97F4A7C15ull;
+    return (unsigned int)(value >> 32);
+}
+
+/**
+ * @brief Cherche la cible résolue d'un lien symbolique
+ *
+ * @param link Lien concerné
+ * @param generation Reçoit la génération courante, à passer à
+ *        dcache_link_insert après la résolution
+ * @return FileNode* Nœud désigné par la cible, NULL s'il n'est pas en cache
+ */
+FileNode* dcache_link_lookup(const FileNode* link, unsigned int* generation) {
+    unsigned int hash = dcache_link_hash(link);
+    DcacheLink* entry = &dcache_links[hash & (DCACHE_LINKS - 1)];
+    pthread_rwlock_t* lock = dcache_lock(hash);
+
+    pthread_rwlock_rdlock(lock);
+    *generation = __atomic_load_n(&dcache_link_generation, __ATOMIC_ACQUIRE);
+    FileNode* target = entry->link == link && entry->generation == *generation ? entry->target : NULL;
+    pthread_rwlock_unlock(lock);
+    return target;
+}
+
+/**
+ * @brief Mémorise la cible résolue d'un lien symbolique
+ *
+ * @param link Lien concerné
+ * @param target Nœud désigné par sa cible
+ * @param generation Génération relevée par dcache_link_lookup avant la
+ *        résolution ; si elle a changé, le résultat n'est pas mémorisé
+ */
+void dcache_link_insert(const FileNode* link, FileNode* target, unsigned int generation) {
+    unsigned int hash = dcache_link_hash(link);
+    DcacheLink* entry = &dcache_links[hash & (DCACHE_LINKS - 1)];
+    pthread_rwlock_t* lock = dcache_lock(hash);
+
+    pthread_rwlock_wrlock(lock);
+    if (__atomic_load_n(&dcache_link_generation, __ATOMIC_ACQUIRE) == generation) {
+        entry->link = (FileNode*)link;
+        entry->target = target;
+        entry->generation = generation;
+    }
+    pthread_rwlock_unlock(lock);
+}
+
+/**
+ * @brief Invalide toutes les cibles de liens mémorisées
+ *
+ * @details
+ * Appelée après une suppression ou un déplacement, sous fs_tree_lock en
+ * écriture, comme dcache_flush.
+ */
+void dcache_link_flush() {
+    __atomic_add_fetch(&dcache_link_generation, 1, __ATOMIC_RELEASE);
+}
+
@@ -0,0 +1,223 @@
+/**
+ * @file fs_dedup.c
+ * @brief Déduplication des blocs de contenu par leur empreinte
+ *
+ * Les blocs du tas (DataBlock, voir fs_data.c) achevés par une écriture
+ * sont rangés dans une table indexée par l'empreinte de leurs octets :
+ * un bloc identique à un bloc déjà rangé est abandonné au profit de
+ * celui-ci, qui gagne une référence. Les fichiers au contenu identique
+ * (bibliothèques recopiées, modèles répétés) ne coûtent ainsi qu'un
+ * exemplaire de chaque bloc, quelle que soit la façon dont ils ont été
+ * écrits.
+ *
+ * Un bloc rangé dans la table (key non nul) n'est plus jamais modifié en
+ * place : une écriture le duplique d'abord, comme un bloc partagé. La
+ * table ne détient pas de référence : le dernier extent qui relâche un
+ * bloc l'en retire (dedup_forget) avant de le libérer, et une recherche
+ * ignore un bloc dont le compteur est déjà tombé à zéro.
+ *
+ * La table est à adressage ouvert (sondage linéaire, remplie aux trois
+ * quarts au plus), sans pierre tombale, protégée par un verrou unique
+ * (dedup_lock). Les empreintes sont calculées hors du verrou ; deux blocs
+ * de même empreinte sont toujours comparés octet par octet.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "fs_internal.h"
+
+/** @brief Capacité minimale de la table (puissance de 2) */
+#define DEDUP_MIN_CAPACITY 1024
+
+/** @brief Déduplication des blocs écrits (1 par défaut) */
+int fs_dedup = 1;
+
+/** @brief Table des blocs, indexée par empreinte (NULL : emplacement libre) */
+static DataBlock** dedup_table;
+
+/** @brief Nombre d'emplacements de la table (puissance de 2, 0 si non allouée) */
+static unsigned int dedup_capacity;
+
+/** @brief Nombre de blocs rangés */
+static unsigned int dedup_count;
+
+/** @brief Octets des blocs rangés */
+static size_t dedup_bytes;
+
+/** @brief Nombre de blocs abandonnés au profit d'un bloc identique */
+static size_t dedup_hits;
+
+/** @brief Verrou de la table et des compteurs */
+static pthread_mutex_t dedup_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Mélange un mot de 64 bits dans une voie de l'empreinte
+ */
+static uint64_t dedup_mix(uint64_t lane, uint64_t word) {
+    lane = (lane ^ word) * 0x9E3779B97F4A7C15ull;
+    return lane ^ (lane >> 29);
+}
+
+/**
+ * @brief Empreinte des octets d'un bloc
+ *
+ * @param bytes Octets du bloc
+ * @param length Nombre d'octets
+ * @return unsigned int Empreinte, jamais nulle (0 : bloc hors de la table)
+ *
+ * @details
+ * Quatre voies indépendantes de 8 octets : le calcul n'attend pas le
+ * résultat d'une multiplication pour lancer la suivante.
+ */
+static unsigned int dedup_hash(const char* bytes, unsigned int length) {
+    uint64_t lanes[4] = { length, 0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull };
+    unsigned int i = 0;
+    for (; i + 32 <= length; i += 32) {
+        uint64_t words[4];
+        memcpy(words, bytes + i, sizeof(words));
+        for (int lane = 0; lane < 4; lane++) lanes[lane] = dedup_mix(lanes[lane], words[lane]);
+    }
+    for (; i < length; i++) lanes[i & 3] = dedup_mix(lanes[i & 3], (unsigned char)bytes[i]);
+
+    uint64_t hash = lanes[0] ^ (lanes[1] << 1) ^ (lanes[2] << 2) ^ (lanes[3] << 3);
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return (unsigned int)hash | 1;
+}
+
+/**
+ * @brief Prend une référence sur un bloc de la table s'il est encore vivant
+ *
+ * @param block Bloc de la table (sous dedup_lock)
+ * @return int 1 si la référence est prise, 0 si le bloc est en cours de libération
+ */
+static int dedup_retain(DataBlock* block) {
+    unsigned int refs = __atomic_load_n(&block->refs, __ATOMIC_ACQUIRE);
+    while (refs > 0) {
+        if (__atomic_compare_exchange_n(&block->refs, &refs, refs + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Double la capacité de la table
+ *
+ * @return int 0 en cas de succès, -1 si l'allocation échoue (table inchangée)
+ */
+static int dedup_grow() {
+    unsigned int capacity = dedup_capacity ? dedup_capacity * 2 : DEDUP_MIN_CAPACITY;
+    DataBlock** table = calloc(capacity, sizeof(DataBlock*));
+    if (table == NULL) return -1;
+
+    for (unsigned int i = 0; i < dedup_capacity; i++) {
+        DataBlock* block = dedup_table[i];
+        if (block == NULL) continue;
+        unsigned int j = block->key & (capacity - 1);
+        while (table[j] != NULL) j = (j + 1) & (capacity - 1);
+        table[j] = block;
+    }
+    free(dedup_table);
+    dedup_table = table;
+    dedup_capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Range un bloc dans la table, ou retrouve un bloc identique
+ *
+ * @param block Bloc du tas que l'appelant est seul à désigner, hors de la table
+ * @return DataBlock* Bloc identique déjà rangé, avec une référence pour
+ *         l'appelant (qui libère alors le sien) ; block lui-même s'il a
+ *         été rangé, ou s'il n'a pu l'être faute de mémoire
+ */
+DataBlock* dedup_intern(DataBlock* block) {
+    unsigned int key = dedup_hash(block->bytes, block->capacity);
+    pthread_mutex_lock(&dedup_lock);
+    if ((dedup_count + 1) * 4 > dedup_capacity * 3 && dedup_grow() != 0) {
+        pthread_mutex_unlock(&dedup_lock);
+        return block;
+    }
+
+    unsigned int mask = dedup_capacity - 1;
+    unsigned int i = key & mask;
+    for (DataBlock* entry; (entry = dedup_table[i]) != NULL; i = (i + 1) & mask) {
+        if (entry->key == key && entry->capacity == block->capacity &&
+            memcmp(entry->bytes, block->bytes, block->capacity) == 0 && dedup_retain(entry)) {
+            dedup_hits++;
+            pthread_mutex_unlock(&dedup_lock);
+            return entry;
+        }
+    }
+    block->key = key;
+    dedup_table[i] = block;
+    dedup_count++;
+    dedup_bytes += block->capacity;
+    pthread_mutex_unlock(&dedup_lock);
+    return block;
+}
+
+/**
+ * @brief Retire de la table un bloc dont la dernière référence vient d'être relâchée
+ *
+ * @param block Bloc rangé par dedup_intern (key non nul)
+ *
+ * @details
+ * Recule les entrées suivantes de sa grappe qui ne sont pas à leur place
+ * (voir name_release dans fs_names.c).
+ */
+void dedup_forget(DataBlock* block) {
+    pthread_mutex_lock(&dedup_lock);
+    unsigned int mask = dedup_capacity - 1;
+    unsigned int hole = block->key & mask;
+    while (dedup_table[hole] != block) hole = (hole + 1) & mask;
+    for (unsigned int j = (hole + 1) & mask; dedup_table[j] != NULL; j = (j + 1) & mask) {
+        unsigned int home = dedup_table[j]->key & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            dedup_table[hole] = dedup_table[j];
+            hole = j;
+        }
+    }
+    dedup_table[hole] = NULL;
+    dedup_count--;
+    dedup_bytes -= block->capacity;
+    pthread_mutex_unlock(&dedup_lock);
+}
+
+/**
+ * @brief Libère la table, vidée par la libération de l'arborescence
+ *
+ * @details
+ * Utilisée par tree_release(), hors de toute concurrence.
+ */
+void dedup_reset() {
+    free(dedup_table);
+    dedup_table = NULL;
+    dedup_capacity = 0;
+    dedup_count = 0;
+    dedup_bytes = 0;
+    dedup_hits = 0;
+}
+
+/**
+ * @brief Statistiques de la table de déduplication
+ *
+ * @param blocks Nombre de blocs rangés
+ * @param bytes Octets de ces blocs
+ * @param hits Nombre de blocs abandonnés au profit d'un bloc identique
+ */
+void dedup_stats(size_t* blocks, size_t* bytes, size_t* hits) {
+    pthread_mutex_lock(&dedup_lock);
+    *blocks = dedup_count;
+    *bytes = dedup_bytes;
+    *hits = dedup_hits;
+    pthread_mutex_unlock(&dedup_lock);
+}
@@ -0,0 +1,886 @@
+/**
+ * @file fs_image.c
+ * @brief Format sur disque du système de fichiers (filesystem.dat)
+ *
+ * L'image est un fichier binaire versionné et auto-descriptif, composé
+ * de quatre sections contiguës :
+ * - un en-tête (ImageHeader) : signature, version, tailles des
+ *   enregistrements et position de chaque section
+ * - la table des nœuds (ImageNode), dans l'ordre d'un parcours en
+ *   largeur : les enfants d'un répertoire y sont donc contigus
+ * - la table des chaînes : noms et cibles de liens symboliques,
+ *   terminés par '\0'
+ * - la zone de contenu : le contenu des fichiers, désigné dans la table
+ *   des nœuds par un extent (position, longueur)
+ *
+ * Les liens durs partagent un même extent : le nœud qui porte le
+ * contenu est désigné par le champ data_link de chacun des liens.
+ * Les trous d'un contenu (voir fs_data.c) sont écrits comme des zéros.
+ *
+ * Depuis la version 2, l'enregistrement d'un répertoire porte aussi
+ * l'occupation de son sous-arbre et ses quotas (voir disk_usage) : un
+ * répertoire projeté les connaît sans que ses descendants soient
+ * matérialisés. Une image de version 1 reste lisible, ses compteurs
+ * étant alors recalculés au chargement.
+ *
+ * L'écriture se fait en quelques appels writev. L'image peut être relue
+ * de deux façons (voir LoadMode) : en un seul appel pread suivi de la
+ * création de tous les nœuds, ou par projection en mémoire, les nœuds
+ * n'étant alors créés qu'au premier accès à leur répertoire.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "fs_internal.h"
+
+/** @brief Signature placée en tête de l'image */
+#define IMAGE_MAGIC "VFSIMG\r\n"
+/** @brief Version courante du format */
+#define IMAGE_VERSION 2
+/** @brief Plus ancienne version du format encore lue (sans occupation ni quotas) */
+#define IMAGE_VERSION_MIN 1
+/** @brief Valeur témoin permettant de détecter un boutisme différent */
+#define IMAGE_ENDIAN_MARK 0x01020304u
+/** @brief Index de nœud absent (parent de la racine) */
+#define IMAGE_NO_NODE UINT32_MAX
+/** @brief Le nœud est un lien symbolique */
+#define IMAGE_NODE_SYMLINK 1u
+/** @brief Le nœud est soumis à la compression transparente (voir set_compression) */
+#define IMAGE_NODE_COMPRESS 2u
+/** @brief Nombre de blocs compressés décodés avant d'écrire le lot en cours */
+#define IMAGE_DECODE_BATCH 64
+/** @brief Nombre maximal de tampons regroupés dans un appel writev */
+#define IMAGE_IOV_BATCH 1024
+
+/**
+ * @brief En-tête de l'image
+ */
+typedef struct ImageHeader {
+    char magic[8];                  /**< Signature IMAGE_MAGIC */
+    uint32_t version;               /**< Version du format */
+    uint32_t endian_mark;           /**< IMAGE_ENDIAN_MARK */
+    uint32_t header_size;           /**< Taille de cet en-tête */
+    uint32_t node_size;             /**< Taille d'un enregistrement ImageNode */
+    uint32_t node_count;            /**< Nombre de nœuds */
+    uint32_t generation;            /**< Génération du point de reprise (voir fs_journal.c) */
+    uint64_t nodes_offset;          /**< Position de la table des nœuds */
+    uint64_t strings_offset;        /**< Position de la table des chaînes */
+    uint64_t strings_size;          /**< Taille de la table des chaînes */
+    uint64_t content_offset;        /**< Position de la zone de contenu */
+    uint64_t content_size;          /**< Taille de la zone de contenu */
+} ImageHeader;
+
+/**
+ * @brief Enregistrement d'un nœud dans l'image
+ */
+typedef struct ImageNode {
+    uint32_t parent;                /**< Index du parent (IMAGE_NO_NODE pour la racine) */
+    uint32_t first_child;           /**< Index du premier enfant */
+    uint32_t child_count;           /**< Nombre d'enfants (répertoires) */
+    uint32_t type;                  /**< FILE_TYPE ou DIRECTORY_TYPE */
+    uint32_t permissions;           /**< Permissions (format octal) */
+    uint32_t ref_count;             /**< Nombre de liens durs de l'inode */
+    uint32_t name_offset;           /**< Position du nom dans la table des chaînes */
+    uint32_t name_length;           /**< Longueur du nom */
+    uint32_t symlink_offset;        /**< Position de la cible du lien symbolique */
+    uint32_t symlink_length;        /**< Longueur de la cible du lien symbolique */
+    uint32_t data_link;             /**< Index du nœud qui porte le contenu */
+    uint32_t flags;                 /**< IMAGE_NODE_SYMLINK, IMAGE_NODE_COMPRESS */
+    uint64_t content_offset;        /**< Position du contenu dans la zone de contenu */
+    uint64_t content_length;        /**< Longueur du contenu */
+    uint64_t usage_files;           /**< Répertoire : fichiers du sous-arbre (version 2) */
+    uint64_t usage_directories;     /**< Répertoire : répertoires du sous-arbre, lui compris */
+    uint64_t usage_bytes;           /**< Répertoire : taille apparente du sous-arbre */
+    uint64_t quota_bytes;           /**< Répertoire : quota d'octets (0 sans limite) */
+    uint64_t quota_nodes;           /**< Répertoire : quota d'entrées (0 sans limite) */
+} ImageNode;
+
+/**
+ * @brief Tampon extensible utilisé pour la table des chaînes
+ */
+typedef struct ImageBuffer {
+    char* data;                     /**< Octets accumulés */
+    size_t size;                    /**< Nombre d'octets utilisés */
+    size_t capacity;                /**< Nombre d'octets alloués */
+} ImageBuffer;
+
+/**
+ * @brief Ajoute une chaîne terminée par '\0' à la table des chaînes
+ *
+ * @param buffer Table des chaînes
+ * @param text Chaîne à ajouter
+ * @param offset Position de la chaîne dans la table (sortie)
+ * @param length Longueur de la chaîne (sortie)
+ * @return int 0 en cas de succès, -1 si l'allocation échoue
+ */
+static int image_add_string(ImageBuffer* buffer, const char* text, uint32_t* offset, uint32_t* length) {
+    size_t len = strlen(text);
+    if (buffer->size + len + 1 > UINT32_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+    if (buffer->size + len + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity < buffer->size + len + 1) capacity *= 2;
+        char* data = realloc(buffer->data, capacity);
+        if (data == NULL) return -1;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, text, len + 1);
+    *offset = (uint32_t)buffer->size;
+    *length = (uint32_t)len;
+    buffer->size += len + 1;
+    return 0;
+}
+
+/**
+ * @brief Écrit une suite de tampons, en reprenant les écritures partielles
+ *
+ * @param fd Descripteur de destination
+ * @param iov Tampons à écrire (modifiés en cas d'écriture partielle)
+ * @param count Nombre de tampons
+ * @return int 0 en cas de succès, -1 en cas d'erreur
+ */
+static int image_writev_all(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Retrouve le nœud qui porte déjà un contenu partagé
+ *
+ * Table d'association (adressage ouvert) entre un contenu (FileData)
+ * et l'index du premier nœud qui le référence.
+ *
+ * @param keys Contenus (NULL = emplacement libre)
+ * @param values Index des nœuds associés
+ * @param mask Capacité de la table moins un (puissance de 2)
+ * @param content Contenu recherché
+ * @param index Index à enregistrer si le contenu est nouveau
+ * @return uint32_t Index du nœud qui porte le contenu
+ */
+static uint32_t image_content_owner(const FileData** keys, uint32_t* values, size_t mask,
+                                    const FileData* content, uint32_t index) {
+    size_t i = ((uintptr_t)content >> 4) * 0x9E3779B97F4A7C15ull & mask;
+    while (keys[i] != NULL) {
+        if (keys[i] == content) return values[i];
+        i = (i + 1) & mask;
+    }
+    keys[i] = content;
+    values[i] = index;
+    return index;
+}
+
+/**
+ * @brief Indique si un nœud est soumis à la compression transparente
+ *
+ * @param node Nœud concerné
+ * @return int 1 pour un répertoire compressé ou un fichier dont l'inode
+ *         (à défaut le nœud) porte la politique, 0 sinon
+ */
+static int image_node_compressed(const FileNode* node) {
+    if (node->dir_data != NULL) return node->dir_data->compress != 0;
+    if (node->data != NULL) return (node->data->flags & DATA_COMPRESS) != 0;
+    return (node->flags & NODE_COMPRESS) != 0;
+}
+
+/**
+ * @brief Écrit l'image de l'arborescence dans un fichier
+ *
+ * @param fd Descripteur ouvert en écriture, positionné au début
+ * @param root Racine de l'arborescence à sauvegarder
+ * @param generation Génération enregistrée dans l'en-tête
+ * @return int 0 en cas de succès, -1 en cas d'erreur (errno renseigné)
+ *
+ * @details
+ * - Numérote les nœuds par un parcours en largeur, sans récursion
+ *   (les répertoires encore dans l'image projetée sont matérialisés)
+ * - Construit la table des nœuds et la table des chaînes en mémoire
+ * - Attribue un extent à chaque contenu distinct (les liens durs
+ *   partagent le même extent)
+ * - Écrit l'en-tête, les tables puis les contenus par lots de writev,
+ *   bloc par bloc, sans jamais reconstituer un contenu en mémoire
+ * - Les extents compressés sont écrits en clair : ils sont décodés par
+ *   groupes de IMAGE_DECODE_BATCH blocs, ce qui garde l'image projetable
+ */
+int save_image(int fd, const FileNode* root, uint32_t generation) {
+    size_t count = 0, capacity = 1024;
+    const FileNode** order = malloc(capacity * sizeof(FileNode*));
+    ImageNode* records = NULL;
+    const FileData** owner_keys = NULL;
+    uint32_t* owner_values = NULL;
+    struct iovec* iov = NULL;
+    char* decoded = NULL;
+    ImageBuffer strings = { NULL, 0, 0 };
+    int status = -1;
+    if (order == NULL) return -1;
+
+    // Parcours en largeur : order sert aussi de file d'attente
+    order[count++] = root;
+    for (size_t i = 0; i < count; i++) {
+        const DirData* data = order[i]->dir_data;
+        if (data == NULL) continue;
+        if (dir_materialize((FileNode*)order[i]) != 0) goto done;
+        if (count + data->child_count > capacity) {
+            while (count + data->child_count > capacity) capacity *= 2;
+            const FileNode** grown = realloc(order, capacity * sizeof(FileNode*));
+            if (grown == NULL) goto done;
+            order = grown;
+        }
+        memcpy(order + count, data->children, data->child_count * sizeof(FileNode*));
+        count += data->child_count;
+    }
+    if (count >= IMAGE_NO_NODE) {
+        errno = EFBIG;
+        goto done;
+    }
+
+    size_t owner_mask = 15;
+    while (owner_mask + 1 < count * 2) owner_mask = owner_mask * 2 + 1;
+    records = calloc(count, sizeof(ImageNode));
+    owner_keys = calloc(owner_mask + 1, sizeof(FileData*));
+    owner_values = malloc((owner_mask + 1) * sizeof(uint32_t));
+    if (records == NULL || owner_keys == NULL || owner_values == NULL) goto done;
+
+    // Construire la table des nœuds et attribuer les extents de contenu
+    uint64_t content_size = 0;
+    size_t extent_count = 0;
+    size_t next_child = 1;
+    records[0].parent = IMAGE_NO_NODE;
+    for (size_t i = 0; i < count; i++) {
+        const FileNode* node = order[i];
+        ImageNode* record = &records[i];
+
+        record->type = node->type;
+        // Un fichier qui a un inode y porte ses permissions et son nombre de liens
+        record->permissions = node->data != NULL ? node->data->permissions : node->permissions;
+        record->ref_count = node->data != NULL ? (uint32_t)node->data->links : 1;
+        record->data_link = (uint32_t)i;
+        if (image_node_compressed(node)) record->flags |= IMAGE_NODE_COMPRESS;
+        if (node->dir_data != NULL) {
+            const DirData* dir = node->dir_data;
+            record->usage_files = dir->usage.files;
+            record->usage_directories = dir->usage.directories;
+            record->usage_bytes = dir->usage.bytes;
+            record->quota_bytes = dir->quota_bytes;
+            record->quota_nodes = dir->quota_nodes;
+            record->first_child = (uint32_t)next_child;
+            record->child_count = node->dir_data->child_count;
+            for (uint32_t c = 0; c < record->child_count; c++) {
+                records[next_child + c].parent = (uint32_t)i;
+            }
+            next_child += record->child_count;
+        }
+        if (image_add_string(&strings, node->name, &record->name_offset, &record->name_length) != 0) {
+            goto done;
+        }
+        if (node->symlink_target != NULL) {
+            record->flags |= IMAGE_NODE_SYMLINK;
+            if (image_add_string(&strings, node->symlink_target,
+                                 &record->symlink_offset, &record->symlink_length) != 0) {
+                goto done;
+            }
+        }
+        if (node->data != NULL) {
+            uint32_t owner = image_content_owner(owner_keys, owner_values, owner_mask,
+                                                 node->data, (uint32_t)i);
+            if (owner == i) {
+                record->content_offset = content_size;
+                record->content_length = node->data->size;
+                content_size += node->data->size;
+                extent_count++;
+            } else {
+                record->data_link = owner;
+                record->content_offset = records[owner].content_offset;
+                record->content_length = records[owner].content_length;
+            }
+        }
+    }
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.endian_mark = IMAGE_ENDIAN_MARK;
+    header.header_size = sizeof(ImageHeader);
+    header.node_size = sizeof(ImageNode);
+    header.node_count = (uint32_t)count;
+    header.generation = generation;
+    header.nodes_offset = sizeof(ImageHeader);
+    header.strings_offset = header.nodes_offset + count * sizeof(ImageNode);
+    header.strings_size = strings.size;
+    header.content_offset = header.strings_offset + strings.size;
+    header.content_size = content_size;
+
+    // En-tête et tables d'abord, puis les contenus par lots
+    iov = malloc(IMAGE_IOV_BATCH * sizeof(struct iovec));
+    if (iov == NULL) goto done;
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = records;
+    iov[1].iov_len = count * sizeof(ImageNode);
+    iov[2].iov_base = strings.data;
+    iov[2].iov_len = strings.size;
+    if (image_writev_all(fd, iov, 3) != 0) goto done;
+
+    // Un vecteur par bloc (deux si le bloc est incomplet ou absent)
+    static const char zeros[DATA_BLOCK_SIZE];
+    int batch = 0;
+    int decoded_count = 0;
+    for (size_t i = 0; i < count && extent_count > 0; i++) {
+        const FileData* data = order[i]->data;
+        if (records[i].data_link != i || data == NULL) continue;
+        for (uint64_t start = 0, block = 0; start < records[i].content_length; start += DATA_BLOCK_SIZE, block++) {
+            uint64_t length = records[i].content_length - start;
+            if (length > DATA_BLOCK_SIZE) length = DATA_BLOCK_SIZE;
+            uint64_t present = 0;
+            int compressed = 0;
+            if (block < data->extent_count && data->extents[block].bytes != NULL) {
+                present = data->extents[block].capacity < length ? data->extents[block].capacity : length;
+                compressed = (data->extents[block].flags & EXTENT_COMPRESSED) != 0;
+            }
+            if (batch + 2 > IMAGE_IOV_BATCH || (compressed && decoded_count == IMAGE_DECODE_BATCH)) {
+                if (image_writev_all(fd, iov, batch) != 0) goto done;
+                batch = 0;
+                decoded_count = 0;
+            }
+            if (compressed) {
+                if (decoded == NULL && (decoded = malloc(IMAGE_DECODE_BATCH * DATA_BLOCK_SIZE)) == NULL) {
+                    goto done;
+                }
+                char* bytes = decoded + (size_t)decoded_count++ * DATA_BLOCK_SIZE;
+                data_read(data, bytes, (long long)length, (long long)start);
+                iov[batch].iov_base = bytes;
+                iov[batch++].iov_len = length;
+            } else if (present > 0) {
+                iov[batch].iov_base = data->extents[block].bytes;
+                iov[batch++].iov_len = present;
+            }
+            if (!compressed && present < length) {
+                iov[batch].iov_base = (void*)zeros;
+                iov[batch++].iov_len = length - present;
+            }
+        }
+    }
+    if (batch > 0 && image_writev_all(fd, iov, batch) != 0) goto done;
+    status = 0;
+
+done:
+    free(iov);
+    free(decoded);
+    free(strings.data);
+    free(owner_values);
+    free(owner_keys);
+    free(records);
+    free(order);
+    return status;
+}
+
+/**
+ * @brief Vérifie qu'une chaîne de l'image est valide
+ *
+ * @param header En-tête de l'image
+ * @param strings Début de la table des chaînes
+ * @param offset Position de la chaîne
+ * @param length Longueur annoncée
+ * @return int 1 si la chaîne est dans la table et terminée par '\0'
+ */
+static int image_string_valid(const ImageHeader* header, const char* strings,
+                              uint32_t offset, uint32_t length) {
+    return (uint64_t)offset + length < header->strings_size && strings[offset + length] == '\0';
+}
+
+/**
+ * @brief Vérifie l'en-tête d'une image et la position de ses sections
+ *
+ * @param header En-tête lu au début du fichier
+ * @param file_size Taille du fichier
+ * @return int 1 si l'image est d'un format reconnu et cohérent
+ */
+static int image_header_valid(const ImageHeader* header, size_t file_size) {
+    return memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version >= IMAGE_VERSION_MIN && header->version <= IMAGE_VERSION &&
+           header->endian_mark == IMAGE_ENDIAN_MARK && header->header_size >= sizeof(ImageHeader) &&
+           header->node_size >= (header->version < 2 ? offsetof(ImageNode, usage_files) : sizeof(ImageNode)) &&
+           header->node_count > 0 &&
+           header->nodes_offset + (uint64_t)header->node_count * header->node_size <= file_size &&
+           header->strings_offset + header->strings_size <= file_size &&
+           header->content_offset + header->content_size <= file_size;
+}
+
+/**
+ * @brief Lit un enregistrement de la table des nœuds
+ *
+ * @param header En-tête de l'image
+ * @param image Début de l'image
+ * @param index Index de l'enregistrement (doit être < node_count)
+ * @param record Enregistrement lu (sortie) ; les champs qu'une version
+ *        antérieure n'écrit pas sont nuls
+ */
+static void image_read_record(const ImageHeader* header, const char* image, uint32_t index, ImageNode* record) {
+    size_t size = header->node_size < sizeof(*record) ? header->node_size : sizeof(*record);
+    memset(record, 0, sizeof(*record));
+    memcpy(record, image + header->nodes_offset + (uint64_t)index * header->node_size, size);
+}
+
+/**
+ * @brief Vérifie les champs d'un enregistrement qui ne dépendent pas de sa position
+ *
+ * @param header En-tête de l'image
+ * @param strings Début de la table des chaînes
+ * @param record Enregistrement à vérifier
+ * @return int 1 si le type, les chaînes et l'extent de contenu sont valides
+ */
+static int image_record_valid(const ImageHeader* header, const char* strings, const ImageNode* record) {
+    return (record->type == FILE_TYPE || record->type == DIRECTORY_TYPE) &&
+           (record->type == DIRECTORY_TYPE || record->child_count == 0) &&
+           record->name_length < MAX_NAME_LENGTH &&
+           image_string_valid(header, strings, record->name_offset, record->name_length) &&
+           (!(record->flags & IMAGE_NODE_SYMLINK) ||
+            image_string_valid(header, strings, record->symlink_offset, record->symlink_length)) &&
+           record->content_offset <= header->content_size &&
+           record->content_length <= header->content_size - record->content_offset;
+}
+
+/**
+ * @brief Reconstruit l'arborescence à partir d'une image
+ *
+ * @param fd Descripteur ouvert en lecture
+ * @param generation Génération de l'image (sortie)
+ * @return FileNode* Racine reconstruite, NULL si l'image est absente ou invalide
+ *
+ * @details
+ * - Lit le fichier entier en un seul appel pread
+ * - Vérifie la signature, la version et que chaque section, chaîne et
+ *   extent est contenu dans le fichier
+ * - Crée les nœuds dans l'ordre de la table : le parent d'un nœud le
+ *   précède toujours, aucune récursion n'est nécessaire
+ * - Les liens durs retrouvent le contenu du nœud qui le porte
+ * - L'occupation des répertoires est recalculée de bas en haut (elle
+ *   compte les octets stockés, qui dépendent de la compression en cours),
+ *   leurs quotas sont lus dans l'image
+ */
+FileNode* load_image(int fd, uint32_t* generation) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ImageHeader)) {
+        return NULL;
+    }
+
+    size_t file_size = st.st_size;
+    char* image = malloc(file_size);
+    if (image == NULL) return NULL;
+    size_t done = 0;
+    while (done < file_size) {
+        ssize_t got = pread(fd, image + done, file_size - done, done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            free(image);
+            return NULL;
+        }
+        done += got;
+    }
+
+    ImageHeader header;
+    memcpy(&header, image, sizeof(header));
+    if (!image_header_valid(&header, file_size)) {
+        free(image);
+        return NULL;
+    }
+
+    const char* strings = image + header.strings_offset;
+    const char* content = image + header.content_offset;
+    FileNode** nodes = calloc(header.node_count, sizeof(FileNode*));
+    if (nodes == NULL) {
+        free(image);
+        return NULL;
+    }
+
+    uint32_t i;
+    for (i = 0; i < header.node_count; i++) {
+        ImageNode record;
+        image_read_record(&header, image, i, &record);
+
+        // Le parent doit précéder le nœud; seule la racine n'en a pas
+        int is_root = (i == 0);
+        if ((is_root != (record.parent == IMAGE_NO_NODE)) ||
+            (!is_root && (record.parent >= i || nodes[record.parent]->type != DIRECTORY_TYPE)) ||
+            record.data_link > i || !image_record_valid(&header, strings, &record)) {
+            break;
+        }
+
+        FileNode* node = node_alloc(strings + record.name_offset, record.type, record.permissions);
+        if (node == NULL) break;
+        if (!is_root && dir_add_child(nodes[record.parent], node) != 0) {
+            node_free(node);
+            break;
+        }
+        nodes[i] = node;
+        if (record.type == DIRECTORY_TYPE && dir_reserve(node, record.child_count) != 0) break;
+        if (node->dir_data != NULL) {
+            node->dir_data->quota_bytes = (long long)record.quota_bytes;
+            node->dir_data->quota_nodes = (long long)record.quota_nodes;
+        }
+        if (record.flags & IMAGE_NODE_COMPRESS) {
+            if (node->dir_data != NULL) node->dir_data->compress = 1;
+            else node->flags |= NODE_COMPRESS;
+        }
+
+        if (record.flags & IMAGE_NODE_SYMLINK) {
+            node->symlink_target = small_strndup(strings + record.symlink_offset, record.symlink_length);
+            if (node->symlink_target == NULL) break;
+        }
+        if (record.data_link != i) {
+            // Lien dur : partager le contenu du nœud qui le porte
+            node->data = nodes[record.data_link]->data;
+            if (node->data != NULL) {
+                node->data->links++;
+                if (data_add_name(node->data, nodes[record.data_link], node) != 0) break;
+            }
+        } else if (record.content_length > 0 || record.ref_count > 1) {
+            // Contenu, ou inode vide partagé par des liens durs
+            node->data = data_alloc();
+            if (node->data != NULL && (record.flags & IMAGE_NODE_COMPRESS)) node->data->flags = DATA_COMPRESS;
+            if (node->data == NULL ||
+                data_write(node->data, content + record.content_offset, record.content_length, 0) < 0) {
+                break;
+            }
+            data_seal(node->data);
+            node->data->permissions = record.permissions;
+        }
+    }
+
+    // Occupation des sous-arbres : les descendants d'un nœud le suivent
+    // dans la table, un parcours à rebours les compte avant lui
+    if (i == header.node_count) {
+        for (uint32_t n = header.node_count; n-- > 1;) {
+            DiskUsage usage;
+            node_usage(nodes[n], &usage);
+            DiskUsage* total = &nodes[n]->parent->dir_data->usage;
+            total->files += usage.files;
+            total->directories += usage.directories;
+            total->bytes += usage.bytes;
+            total->stored += usage.stored;
+        }
+    }
+
+    FileNode* root = nodes[0];
+    if (i != header.node_count && root != NULL) {
+        // Image incohérente : abandonner l'arborescence partielle
+        recursive_delete(root);
+        root = NULL;
+    }
+    free(nodes);
+    free(image);
+    *generation = header.generation;
+    return root;
+}
+
+/**
+ * @brief Image projetée en mémoire par map_image
+ *
+ * Les nœuds matérialisés depuis l'image empruntent leur nom, la cible
+ * de leur lien symbolique et leur contenu directement à cette projection.
+ * Elle reste donc en place tant que ces nœuds existent, y compris après
+ * une sauvegarde : celle-ci remplace le fichier par renommage, sans
+ * modifier l'inode projeté.
+ */
+static const char* mapped_base = NULL;
+/** @brief Taille de l'image projetée */
+static size_t mapped_size = 0;
+/** @brief Copie de l'en-tête de l'image projetée */
+static ImageHeader mapped_header;
+/**
+ * @brief Inodes partagés par des liens durs, indexés par data_link
+ *
+ * Alloué au premier lien dur rencontré. Un inode est créé avec autant
+ * de références que l'image lui compte de liens, de sorte que son
+ * nombre de liens est juste avant même que tous soient matérialisés :
+ * chaque lien matérialisé prend l'une de ces références, unmap_image
+ * rend celles qui n'ont pas été prises (mapped_unclaimed).
+ */
+static FileData** mapped_shared = NULL;
+/** @brief Références de chaque entrée de mapped_shared que nul lien matérialisé n'a encore prises */
+static uint32_t* mapped_unclaimed = NULL;
+/** @brief Protège mapped_shared : des répertoires distincts se matérialisent en parallèle */
+static pthread_mutex_t mapped_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Lit un enregistrement de la table des nœuds de l'image projetée
+ *
+ * @param index Index de l'enregistrement (doit être < node_count)
+ * @param record Enregistrement lu (sortie)
+ */
+static void mapped_record(uint32_t index, ImageNode* record) {
+    image_read_record(&mapped_header, mapped_base, index, record);
+}
+
+/**
+ * @brief Crée le contenu d'un nœud de l'image projetée
+ *
+ * @param record Enregistrement du nœud
+ * @param index Index de l'enregistrement dans la table
+ * @param node Nœud qui reçoit le contenu, son parent déjà fixé
+ * @return FileData* Contenu (une référence pour l'appelant), NULL en cas d'échec
+ *
+ * @details
+ * Les liens durs désignent le même extent : le premier matérialisé crée
+ * le contenu, les suivants le retrouvent dans mapped_shared sans avoir à
+ * matérialiser le nœud qui le porte. Chacun rejoint FileData::names ;
+ * tant que tous ne l'ont pas fait, le contenu est marqué
+ * DATA_NAMES_PENDING (voir data_claim_names).
+ */
+static FileData* mapped_data(const ImageNode* record, uint32_t index, FileNode* node) {
+    const char* bytes = mapped_base + mapped_header.content_offset + record->content_offset;
+    if (record->ref_count <= 1 && record->data_link == index) {
+        FileData* data = data_map(bytes, record->content_length);
+        if (data != NULL) {
+            data->permissions = record->permissions;
+            if (record->flags & IMAGE_NODE_COMPRESS) data->flags = DATA_COMPRESS;
+        }
+        return data;
+    }
+
+    FileData* data = NULL;
+    pthread_mutex_lock(&mapped_shared_lock);
+    if (mapped_shared == NULL) {
+        mapped_shared = calloc(mapped_header.node_count, sizeof(FileData*));
+        mapped_unclaimed = calloc(mapped_header.node_count, sizeof(uint32_t));
+        if (mapped_unclaimed == NULL) {
+            free(mapped_shared);
+            mapped_shared = NULL;
+        }
+    }
+    if (mapped_shared != NULL) {
+        FileData** shared = &mapped_shared[record->data_link];
+        if (*shared == NULL && (*shared = data_map(bytes, record->content_length)) != NULL) {
+            uint32_t links = record->ref_count > 1 ? record->ref_count : 1;
+            (*shared)->links = (int)links;
+            (*shared)->permissions = record->permissions;
+            if (record->flags & IMAGE_NODE_COMPRESS) (*shared)->flags = DATA_COMPRESS;
+            if (links > 1) {
+                (*shared)->flags |= DATA_NAMES_PENDING;
+                (*shared)->names = malloc(links * sizeof(FileNode*));
+                (*shared)->name_capacity = (*shared)->names != NULL ? links : 0;
+            }
+            mapped_unclaimed[record->data_link] = links;
+        }
+        data = *shared;
+        if (data != NULL) {
+            pthread_rwlock_wrlock(&data->lock);
+            data_add_name(data, NULL, node);
+            if (mapped_unclaimed[record->data_link] > 0) {
+                if (--mapped_unclaimed[record->data_link] == 0) {
+                    __atomic_and_fetch(&data->flags, ~DATA_NAMES_PENDING, __ATOMIC_RELEASE);
+                }
+            } else {
+                // Image incohérente : plus de liens que n'en compte l'inode
+                __atomic_add_fetch(&data->links, 1, __ATOMIC_RELAXED);
+            }
+            pthread_rwlock_unlock(&data->lock);
+        }
+    }
+    pthread_mutex_unlock(&mapped_shared_lock);
+    return data;
+}
+
+/**
+ * @brief Crée un nœud qui référence les données de l'image projetée
+ *
+ * @param record Enregistrement du nœud
+ * @param index Index de l'enregistrement dans la table
+ * @param parent Répertoire qui recevra le nœud (NULL pour la racine)
+ * @return FileNode* Nouveau nœud, NULL si l'allocation échoue
+ *
+ * @details
+ * - Nom, cible de lien et extents du contenu pointent dans la projection
+ * - Un répertoire non vide est marqué image_pending : ses enfants ne
+ *   seront créés qu'au premier accès (dir_materialize)
+ * - Un répertoire reprend l'occupation et les quotas de l'image ; ses
+ *   contenus projetés n'étant pas compressés, ses octets stockés sont
+ *   sa taille apparente
+ * - Les liens durs partagent le même contenu (voir mapped_data)
+ */
+static FileNode* mapped_node(const ImageNode* record, uint32_t index, FileNode* parent) {
+    const char* strings = mapped_base + mapped_header.strings_offset;
+    FileNode* node = node_alloc_mapped(strings + record->name_offset, record->name_length,
+                                       record->type, record->permissions);
+    if (node == NULL) return NULL;
+
+    if (record->flags & IMAGE_NODE_SYMLINK) {
+        node->symlink_target = (char*)(strings + record->symlink_offset);
+        node->flags |= NODE_SYMLINK_MAPPED;
+    }
+    if ((record->flags & IMAGE_NODE_COMPRESS) && node->dir_data == NULL) node->flags |= NODE_COMPRESS;
+    // Un lien dur est compté sous son parent dès qu'il rejoint FileData::names
+    node->parent = parent;
+    int has_inode = record->content_length > 0 || record->ref_count > 1 || record->data_link != index;
+    if (has_inode && (node->data = mapped_data(record, index, node)) == NULL) {
+        node->parent = NULL;
+        node_free(node);
+        return NULL;
+    }
+    if (node->dir_data != NULL) {
+        node->dir_data->usage.files = (long long)record->usage_files;
+        node->dir_data->usage.directories = (long long)record->usage_directories;
+        node->dir_data->usage.bytes = (long long)record->usage_bytes;
+        node->dir_data->usage.stored = (long long)record->usage_bytes;
+        node->dir_data->quota_bytes = (long long)record->quota_bytes;
+        node->dir_data->quota_nodes = (long long)record->quota_nodes;
+        node->dir_data->image_index = index;
+        node->dir_data->image_pending = record->child_count > 0;
+        node->dir_data->compress = (record->flags & IMAGE_NODE_COMPRESS) != 0;
+    }
+    return node;
+}
+
+/**
+ * @brief Projette une image en mémoire et n'en matérialise que la racine
+ *
+ * @param fd Descripteur ouvert en lecture
+ * @param generation Génération de l'image (sortie)
+ * @return FileNode* Racine de l'arborescence, NULL si l'image est absente ou invalide
+ *
+ * @details
+ * - La projection est partagée (MAP_SHARED, lecture seule) : plusieurs
+ *   processus ouvrant la même image partagent les pages du cache
+ * - Seuls l'en-tête et l'enregistrement de la racine sont lus, le coût
+ *   d'ouverture ne dépend donc pas de la taille de l'image
+ * - Une image de version 1 est chargée entièrement (load_image)
+ */
+FileNode* map_image(int fd, uint32_t* generation) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ImageHeader)) {
+        return NULL;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) return NULL;
+
+    ImageHeader header;
+    memcpy(&header, base, sizeof(header));
+    ImageNode root_record;
+    if (!image_header_valid(&header, st.st_size)) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+    if (header.version < 2) {
+        // Sans occupation des répertoires, l'image doit être lue entière
+        munmap(base, st.st_size);
+        return load_image(fd, generation);
+    }
+    image_read_record(&header, base, 0, &root_record);
+    if (root_record.parent != IMAGE_NO_NODE || root_record.type != DIRECTORY_TYPE ||
+        !image_record_valid(&header, (char*)base + header.strings_offset, &root_record)) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    mapped_base = base;
+    mapped_size = st.st_size;
+    mapped_header = header;
+    FileNode* root = mapped_node(&root_record, 0, NULL);
+    if (root == NULL) {
+        unmap_image();
+    }
+    *generation = header.generation;
+    return root;
+}
+
+/**
+ * @brief Matérialise les enfants d'un répertoire encore dans l'image projetée
+ *
+ * @param dir Répertoire concerné
+ * @return int 0 en cas de succès (ou s'il n'y a rien à faire), -1 en cas d'erreur
+ *
+ * @details
+ * - Les enregistrements des enfants sont contigus (ordre en largeur) :
+ *   ils sont tous validés avant la création du moindre nœud
+ * - Un enregistrement incohérent laisse le répertoire vide plutôt que
+ *   d'exposer une arborescence partielle
+ */
+int dir_materialize(FileNode* dir) {
+    DirData* data = dir->dir_data;
+    if (data == NULL || !data->image_pending) return 0;
+    data->image_pending = 0;
+
+    uint32_t index = data->image_index;
+    ImageNode record;
+    mapped_record(index, &record);
+    uint64_t end = (uint64_t)record.first_child + record.child_count;
+    if (record.first_child <= index || end > mapped_header.node_count) {
+        return -1;
+    }
+
+    const char* strings = mapped_base + mapped_header.strings_offset;
+    for (uint32_t c = record.first_child; c < end; c++) {
+        ImageNode child;
+        mapped_record(c, &child);
+        if (child.parent != index || !image_record_valid(&mapped_header, strings, &child)) {
+            return -1;
+        }
+    }
+
+    if (dir_reserve(dir, data->child_count + record.child_count) != 0) {
+        data->image_pending = 1;
+        return -1;
+    }
+    for (uint32_t c = record.first_child; c < end; c++) {
+        ImageNode child;
+        mapped_record(c, &child);
+        FileNode* node = mapped_node(&child, c, dir);
+        if (node == NULL) return -1;
+        dir_add_child(dir, node);
+    }
+    return 0;
+}
+
+/**
+ * @brief Libère la projection de l'image
+ *
+ * Ne doit être appelée qu'une fois tous les nœuds issus de l'image libérés.
+ */
+void unmap_image() {
+    if (mapped_shared != NULL) {
+        for (uint32_t i = 0; i < mapped_header.node_count; i++) {
+            for (uint32_t r = 0; r < mapped_unclaimed[i]; r++) {
+                data_release(mapped_shared[i]);
+            }
+        }
+        free(mapped_shared);
+        free(mapped_unclaimed);
+        mapped_shared = NULL;
+        mapped_unclaimed = NULL;
+    }
+    if (mapped_base != NULL) {
+        munmap((void*)mapped_base, mapped_size);
+        mapped_base = NULL;
+        mapped_size = 0;
+    }
+}
@@ -0,0 +1,762 @@
+#ifndef FS_INTERNAL_H
+#define FS_INTERNAL_H
+
+/**
+ * @file fs_internal.h
+ * @brief Interface interne partagée entre les modules du système de fichiers
+ *
+ * Ces fonctions manipulent directement les nœuds, sans résolution de
+ * chemin ni message à l'utilisateur. Elles ne font pas partie de
+ * l'interface publique décrite dans file_manager.h.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_manager.h"
+
+/** @brief Descripteur de fichier de l'image persistante (file_manager.c) */
+extern int fs_fd;
+
+/** @brief Génération de l'image chargée ou écrite en dernier (file_manager.c) */
+extern uint32_t fs_generation;
+
+/** @brief Descripteur du journal, -1 si la journalisation est inactive (fs_journal.c) */
+extern int journal_fd;
+
+/**
+ * @brief Opérations enregistrées dans le journal
+ */
+typedef enum {
+    JOURNAL_CREATE_FILE = 1,        /**< create_file(chemin, permissions) */
+    JOURNAL_CREATE_DIRECTORY,       /**< create_directory(chemin, permissions) */
+    JOURNAL_WRITE,                  /**< write_file(chemin, contenu) */
+    JOURNAL_COPY,                   /**< copy_file(source, destination) */
+    JOURNAL_MOVE,                   /**< move_file(source, destination) */
+    JOURNAL_DELETE,                 /**< delete_file(chemin) */
+    JOURNAL_CHMOD,                  /**< set_permissions(chemin, permissions) */
+    JOURNAL_HARD_LINK,              /**< create_hard_link(cible, lien) */
+    JOURNAL_SYMLINK,                /**< create_symbolic_link(cible, lien) */
+    JOURNAL_PWRITE,                 /**< pwrite_file(chemin, octets, position) */
+    JOURNAL_CHMOD_RECURSIVE,        /**< set_permissions_recursive(chemin, permissions) */
+    JOURNAL_COMPRESS,               /**< set_compression(chemin, activée) */
+    JOURNAL_QUOTA                   /**< set_quota(chemin, octets, entrées) */
+} JournalOp;
+
+/** @brief Le nom du nœud pointe dans l'image projetée (ne pas libérer) */
+#define NODE_NAME_MAPPED    0x01
+/** @brief Fichier créé sous une politique de compression, recopiée dans son inode */
+#define NODE_COMPRESS       0x02
+/** @brief La cible du lien symbolique pointe dans l'image projetée */
+#define NODE_SYMLINK_MAPPED 0x04
+
+/**
+ * @brief Descripteur de fichier ouvert dans une session
+ */
+typedef struct OpenFile {
+    FileNode* node;                 /**< Fichier ouvert (NULL : descripteur libre) */
+    int mode;                       /**< FILE_MODE_READ, FILE_MODE_WRITE ou FILE_MODE_BOTH */
+    long long offset;               /**< Position courante de fd_read et fd_write */
+} OpenFile;
+
+/**
+ * @brief Fichier ouvert par son chemin (open_file) dans une session
+ */
+typedef struct PathOpen {
+    FileNode* node;                 /**< Fichier ouvert (NULL : emplacement libre) */
+    int fd;                         /**< Descripteur associé */
+} PathOpen;
+
+/**
+ * @brief Contexte d'un utilisateur du système de fichiers
+ *
+ * Le répertoire de travail et chaque fichier ouvert sont retenus
+ * (FileNode::open_count) : un nœud supprimé par une autre session
+ * n'est libéré qu'une fois relâché par toutes.
+ */
+struct Session {
+    FileNode* cwd;                  /**< Répertoire de travail */
+    OpenFile* fds;                  /**< Table des descripteurs, indexée par numéro */
+    int fd_capacity;                /**< Nombre de descripteurs alloués */
+    int fd_hint;                    /**< Aucun descripteur libre en dessous */
+    PathOpen* open_files;           /**< Fichiers ouverts par open_file, indexés par adresse de nœud */
+    unsigned int open_capacity;     /**< Nombre d'emplacements (puissance de 2, 0 si aucun) */
+    unsigned int open_count;        /**< Nombre de fichiers ouverts par open_file */
+    char path[MAX_PATH_LENGTH];     /**< Tampon renvoyé par get_current_path */
+};
+
+/**
+ * @brief Change le répertoire de travail d'une session
+ *
+ * @param session Session concernée
+ * @param dir Nouveau répertoire de travail, retenu jusqu'au prochain changement
+ *
+ * @details
+ * Hors de toute concurrence ou sous fs_tree_lock : relâcher l'ancien
+ * répertoire peut le libérer s'il a été supprimé.
+ */
+void session_set_cwd(Session* session, FileNode* dir);
+
+/**
+ * @brief Rejoue une écriture journalisée, sans vérifier ouverture ni permissions
+ * @param path Chemin du fichier
+ * @param data Octets écrits
+ * @param count Nombre d'octets
+ * @param offset Position d'écriture, ignorée si replace vaut 1
+ * @param replace 1 pour remplacer tout le contenu (JOURNAL_WRITE), 0 pour écrire à la position
+ * @return Nombre d'octets écrits, code d'erreur (FsError) sinon
+ */
+long long replay_write(const char* path, const char* data, long long count, long long offset, int replace);
+
+/** @brief Taille d'un extent de contenu (voir fs_data.c) */
+#define DATA_BLOCK_SIZE 4096
+/** @brief Les octets de l'extent sont empruntés à l'image projetée */
+#define EXTENT_MAPPED 0x01
+/** @brief Le bloc de l'extent porte un flux compressé (voir fs_lz.c) */
+#define EXTENT_COMPRESSED 0x02
+
+/** @brief Politique d'un contenu : compresser les extents écrits */
+#define DATA_COMPRESS 0x01
+/** @brief Des liens durs du contenu sont encore dans l'image projetée, absents de names */
+#define DATA_NAMES_PENDING 0x02
+
+/**
+ * @brief Bloc du tas portant les octets d'un ou plusieurs extents
+ *
+ * Les copies d'un fichier partagent ses blocs (copie sur écriture) :
+ * un bloc n'est modifié en place que si refs vaut 1 et qu'il n'est pas
+ * rangé dans la table de déduplication (voir fs_dedup.c).
+ */
+typedef struct DataBlock {
+    unsigned int refs;              /**< Nombre d'extents qui désignent le bloc (atomique) */
+    unsigned int capacity;          /**< Taille allouée pour bytes */
+    unsigned int key;               /**< Empreinte si le bloc est dans la table de déduplication, 0 sinon */
+    char bytes[];                   /**< Octets du bloc */
+} DataBlock;
+
+/**
+ * @brief Extent d'un contenu : un bloc de DATA_BLOCK_SIZE octets au plus
+ */
+typedef struct DataExtent {
+    char* bytes;                    /**< Octets de l'extent (DataBlock::bytes ou image), NULL pour un trou */
+    unsigned int capacity;          /**< Octets valides (décompressés) de l'extent, le reste vaut zéro */
+    unsigned int flags;             /**< EXTENT_MAPPED ou EXTENT_COMPRESSED */
+} DataExtent;
+
+/**
+ * @brief Inode d'un fichier : contenu, permissions et nombre de liens
+ *
+ * Partagé par tous les liens durs du fichier (FileNode::data), qui n'en
+ * sont que des entrées de répertoire. Un fichier qui n'a jamais eu de
+ * contenu n'a pas encore d'inode : ses permissions sont alors celles de
+ * son nœud, recopiées à la création de l'inode.
+ *
+ * Avec la politique DATA_COMPRESS, chaque extent écrit est compressé
+ * s'il gagne au moins un huitième de sa taille (voir fs_data.c).
+ *
+ * names recense les nœuds d'un contenu qui a eu plusieurs liens : une
+ * écriture reporte la variation de taille sur les ancêtres de chacun
+ * (voir DirData::usage). Tant qu'il est NULL, le seul nom du contenu est
+ * le nœud par lequel on y accède.
+ *
+ * Les fonctions data_* ne verrouillent rien : l'appelant détient lock,
+ * en lecture pour data_read et data_clone, en écriture pour les autres.
+ */
+typedef struct FileData {
+    long long size;                 /**< Taille du contenu en octets */
+    long long stored;               /**< Octets occupés par les extents, après compression (atomique) */
+    DataExtent* extents;            /**< Table des extents, un par bloc */
+    unsigned int extent_count;      /**< Nombre d'extents utilisés */
+    unsigned int extent_capacity;   /**< Nombre d'extents alloués */
+    unsigned int unsealed_begin;    /**< Premier extent écrit sans être rangé dans la table de déduplication */
+    unsigned int unsealed_end;      /**< Fin de cet intervalle (vide si égale à unsealed_begin, voir data_seal) */
+    int links;                      /**< Nombre de nœuds (liens durs) qui partagent ce contenu (atomique) */
+    int permissions;                /**< Permissions du fichier (format octal, atomique) */
+    unsigned int flags;             /**< Politique (DATA_COMPRESS) et DATA_NAMES_PENDING (atomique) */
+    FileNode** names;               /**< Nœuds (liens durs) qui désignent le contenu, NULL s'il n'en a jamais eu qu'un */
+    unsigned int name_count;        /**< Nombre de nœuds dans names */
+    unsigned int name_capacity;     /**< Nombre d'emplacements alloués dans names */
+    pthread_rwlock_t lock;          /**< Lecteurs multiples, un seul écrivain */
+} FileData;
+
+/** @brief Taille maximale d'un objet alloué dans les dalles, un DirData compris (voir fs_alloc.c) */
+#define SMALL_MAX_SIZE 192
+
+/**
+ * @brief Alloue un petit objet dans les dalles (malloc au-delà de SMALL_MAX_SIZE)
+ * @param size Taille en octets
+ * @return Objet non initialisé, NULL en cas d'échec
+ */
+void* small_alloc(size_t size);
+
+/**
+ * @brief Libère un objet alloué par small_alloc
+ * @param ptr Objet à libérer (NULL accepté)
+ * @param size Taille passée à small_alloc
+ */
+void small_free(void* ptr, size_t size);
+
+/**
+ * @brief Copie une chaîne dans un petit objet de len + 1 octets
+ * @param text Chaîne à copier
+ * @param len Nombre d'octets à copier
+ * @return Copie terminée par '\0', NULL en cas d'échec
+ */
+char* small_strndup(const char* text, size_t len);
+
+/**
+ * @brief Octets occupés par les petits objets alloués (objets confiés à malloc exclus)
+ * @return Somme des objets vivants, arrondis à leur classe de taille
+ */
+size_t small_live_bytes();
+
+/**
+ * @brief Libère toutes les dalles en bloc (tous les petits objets deviennent invalides)
+ */
+void small_release_all();
+
+/**
+ * @brief Renvoie la copie partagée d'un nom, créée au besoin (voir fs_names.c)
+ * @param name Début du nom (pas forcément terminé par '\0')
+ * @param length Longueur du nom (< MAX_NAME_LENGTH)
+ * @param hash Empreinte du nom
+ * @return Copie terminée par '\0', à relâcher par name_release ; NULL en cas d'échec
+ */
+const char* name_intern(const char* name, size_t length, unsigned int hash);
+
+/**
+ * @brief Relâche une référence sur un nom interné, libéré avec la dernière
+ * @param text Copie renvoyée par name_intern
+ */
+void name_release(const char* text);
+
+/**
+ * @brief Vide la table des noms (tree_release, avant small_release_all)
+ */
+void names_reset();
+
+/**
+ * @brief Statistiques de la table des noms
+ * @param distinct Nombre de noms distincts (sortie)
+ * @param references Nombre de nœuds qui portent un nom interné (sortie)
+ * @param bytes Octets occupés par les copies et la table (sortie)
+ */
+void names_stats(size_t* distinct, size_t* references, size_t* bytes);
+
+/** @brief Étiquette d'un emplacement libre de l'index d'un répertoire */
+#define TAG_EMPTY     0x00
+/** @brief Étiquette d'une entrée supprimée (les étiquettes des entrées sont impaires) */
+#define TAG_TOMBSTONE 0x80
+/** @brief Nombre maximal d'étiquettes lues d'un coup (octets lisibles après la dernière) */
+#define TAG_GROUP_MAX 32
+
+/**
+ * @brief Compare un groupe d'étiquettes (voir fs_tags.c)
+ * @param tags Premier octet du groupe
+ * @param tag Étiquette recherchée
+ * @param empty Reçoit le masque des emplacements libres (TAG_EMPTY) du groupe
+ * @return Masque des emplacements d'étiquette tag (bit i : tags[i])
+ */
+typedef unsigned int (*TagMatchFn)(const unsigned char* tags, unsigned char tag, unsigned int* empty);
+
+/**
+ * @brief Noyau de filtrage des étiquettes
+ */
+typedef struct TagKernel {
+    const char* name;               /**< "avx2", "sse2" ou "scalar" */
+    unsigned int width;             /**< Nombre d'étiquettes comparées d'un coup */
+    TagMatchFn match;               /**< Comparaison d'un groupe */
+} TagKernel;
+
+/** @brief Noyau utilisé par la recherche dans les répertoires (fs_tags.c) */
+extern const TagKernel* tag_kernel;
+
+/**
+ * @brief Choisit le noyau de filtrage des étiquettes
+ * @param name "avx2", "sse2" ou "scalar", NULL pour le meilleur pris en charge
+ * @return 0 en cas de succès, -1 si le noyau est inconnu ou non pris en charge
+ */
+int tags_select(const char* name);
+
+/**
+ * @brief Compresse un bloc (voir fs_lz.c)
+ * @param source Octets à compresser
+ * @param length Nombre d'octets
+ * @param dest Destination, d'au moins limit octets
+ * @param limit Taille maximale acceptée pour le résultat
+ * @return Taille compressée, 0 si elle dépasserait limit
+ */
+unsigned int lz_compress(const char* source, unsigned int length, char* dest, unsigned int limit);
+
+/**
+ * @brief Décompresse le début d'un bloc
+ * @param source Flux produit par lz_compress
+ * @param source_length Taille du flux
+ * @param dest Destination
+ * @param length Nombre d'octets à produire
+ * @return 0 en cas de succès, -1 si le flux est invalide
+ */
+int lz_decompress(const char* source, unsigned int source_length, char* dest, unsigned int length);
+
+/**
+ * @brief Range un bloc dans la table de déduplication, ou retrouve un bloc identique (voir fs_dedup.c)
+ * @param block Bloc que l'appelant est seul à désigner, hors de la table
+ * @return Bloc identique déjà rangé (une référence pour l'appelant), ou block lui-même
+ */
+DataBlock* dedup_intern(DataBlock* block);
+
+/**
+ * @brief Retire de la table un bloc dont la dernière référence vient d'être relâchée
+ * @param block Bloc rangé par dedup_intern
+ */
+void dedup_forget(DataBlock* block);
+
+/**
+ * @brief Libère la table de déduplication (voir tree_release)
+ */
+void dedup_reset();
+
+/**
+ * @brief Statistiques de la table de déduplication
+ * @param blocks Nombre de blocs rangés
+ * @param bytes Octets de ces blocs
+ * @param hits Nombre de blocs abandonnés au profit d'un bloc identique
+ */
+void dedup_stats(size_t* blocks, size_t* bytes, size_t* hits);
+
+/** @brief Index ordonné des enfants d'un répertoire (voir fs_order.c) */
+typedef struct DirOrder DirOrder;
+
+/**
+ * @brief Curseur d'un parcours ordonné
+ */
+typedef struct OrderCursor {
+    const DirOrder* order;          /**< Index parcouru */
+    unsigned int leaf;              /**< Feuille courante */
+    unsigned int slot;              /**< Position dans la feuille */
+} OrderCursor;
+
+/**
+ * @brief Construit l'index ordonné d'un répertoire (voir fs_order.c)
+ * @param children Enfants du répertoire
+ * @param count Nombre d'enfants
+ * @return Index, NULL si l'allocation échoue
+ */
+DirOrder* order_build(FileNode** children, int count);
+
+/**
+ * @brief Libère un index ordonné
+ * @param order Index (NULL accepté)
+ */
+void order_free(DirOrder* order);
+
+/**
+ * @brief Réserve la place d'un ajout (order_insert ne peut plus échouer)
+ * @param order Index concerné
+ * @return 0 en cas de succès, -1 si l'allocation échoue
+ */
+int order_reserve(DirOrder* order);
+
+/**
+ * @brief Ajoute un enfant à l'index
+ * @param order Index préparé par order_reserve
+ * @param node Nœud à ajouter
+ */
+void order_insert(DirOrder* order, FileNode* node);
+
+/**
+ * @brief Retire un enfant de l'index (sous son nom actuel)
+ * @param order Index concerné
+ * @param node Nœud à retirer
+ */
+void order_remove(DirOrder* order, FileNode* node);
+
+/**
+ * @brief Place un curseur sur le premier enfant à partir d'une clé
+ * @param order Index concerné
+ * @param name Clé (NULL : premier enfant)
+ * @param length Longueur de la clé
+ * @param after 0 : premier enfant qui ne précède pas la clé ; 1 : premier qui la suit
+ * @param cursor Curseur à placer
+ */
+void order_seek(const DirOrder* order, const char* name, size_t length, int after, OrderCursor* cursor);
+
+/**
+ * @brief Enfant suivant d'un parcours ordonné
+ * @param cursor Curseur placé par order_seek
+ * @return Enfant suivant, NULL à la fin
+ */
+FileNode* order_next(OrderCursor* cursor);
+
+/**
+ * @brief Alloue un contenu vide, référencé une fois (voir fs_data.c)
+ * @return Nouveau contenu, NULL en cas d'échec
+ */
+FileData* data_alloc();
+
+/**
+ * @brief Abandonne une référence sur un contenu, libéré avec la dernière
+ * @param data Contenu (NULL accepté)
+ */
+void data_release(FileData* data);
+
+/**
+ * @brief Taille d'un contenu
+ * @param data Contenu (NULL pour un fichier vide)
+ * @return Taille en octets
+ */
+long long data_size(const FileData* data);
+
+/**
+ * @brief Octets occupés par un contenu, après compression
+ * @param data Contenu (NULL pour un fichier vide)
+ * @return Taille des extents en octets
+ */
+long long data_stored(const FileData* data);
+
+/**
+ * @brief Lit une portion d'un contenu
+ * @param data Contenu (NULL accepté)
+ * @param buffer Destination
+ * @param count Nombre d'octets demandés
+ * @param offset Position de lecture
+ * @return Nombre d'octets lus (0 au-delà de la fin)
+ */
+long long data_read(const FileData* data, char* buffer, long long count, long long offset);
+
+/**
+ * @brief Écrit une portion d'un contenu, en l'agrandissant si nécessaire
+ * @param data Contenu
+ * @param buffer Octets à écrire
+ * @param count Nombre d'octets
+ * @param offset Position d'écriture
+ * @return Nombre d'octets écrits, -1 en cas d'erreur
+ */
+long long data_write(FileData* data, const char* buffer, long long count, long long offset);
+
+/**
+ * @brief Change la taille d'un contenu
+ * @param data Contenu
+ * @param size Nouvelle taille
+ * @return 0 en cas de succès, -1 en cas d'erreur
+ */
+int data_truncate(FileData* data, long long size);
+
+/**
+ * @brief Range dans la table de déduplication les blocs d'un contenu qui n'y sont pas encore
+ * @param data Contenu (sous son verrou en écriture)
+ */
+void data_seal(FileData* data);
+
+/**
+ * @brief Blocs du tas alloués pour l'ensemble des contenus
+ * @param blocks Nombre de blocs
+ * @param bytes Octets de ces blocs
+ */
+void data_block_stats(long long* blocks, long long* bytes);
+
+/**
+ * @brief Applique ou retire la politique de compression d'un contenu
+ * @param data Contenu
+ * @param enabled 1 pour compresser, 0 pour stocker tel quel
+ * @return 0 en cas de succès, -1 si un extent n'a pu être décompressé faute de mémoire
+ */
+int data_set_compress(FileData* data, int enabled);
+
+/**
+ * @brief Ajoute un nom (lien dur) à la liste des nœuds d'un contenu
+ * @param data Contenu (sous son verrou en écriture)
+ * @param first Seul nom actuel du contenu, ajouté d'abord si names est encore NULL (NULL sinon)
+ * @param name Nouveau nom
+ * @return 0 en cas de succès, -1 si l'allocation échoue
+ */
+int data_add_name(FileData* data, FileNode* first, FileNode* name);
+
+/**
+ * @brief Retire un nom de la liste des nœuds d'un contenu
+ * @param data Contenu (sous son verrou en écriture)
+ * @param name Nom à retirer (absent accepté)
+ */
+void data_remove_name(FileData* data, FileNode* name);
+
+/**
+ * @brief Duplique un contenu, ses permissions et sa politique en partageant ses blocs (copie sur écriture)
+ * @param data Contenu source (NULL accepté)
+ * @return Copie indépendante, NULL si data est NULL ou en cas d'échec
+ */
+FileData* data_clone(const FileData* data);
+
+/**
+ * @brief Crée un contenu dont les extents désignent une zone de l'image projetée
+ * @param bytes Début du contenu dans la projection
+ * @param size Taille du contenu
+ * @return Nouveau contenu, NULL en cas d'échec
+ */
+FileData* data_map(const char* bytes, long long size);
+
+/**
+ * @brief Alloue et initialise un nœud détaché de l'arborescence
+ * @param name Nom du nœud
+ * @param type Type du nœud (FILE_TYPE ou DIRECTORY_TYPE)
+ * @param permissions Permissions (format octal)
+ * @return Nouveau nœud, NULL si l'allocation échoue
+ */
+FileNode* node_alloc(const char* name, FileType type, int permissions);
+
+/**
+ * @brief Alloue un nœud dont le nom est emprunté à l'image projetée
+ * @param name Nom terminé par '\0', qui doit survivre au nœud
+ * @param len Longueur du nom
+ * @param type Type du nœud (FILE_TYPE ou DIRECTORY_TYPE)
+ * @param permissions Permissions (format octal)
+ * @return Nouveau nœud, NULL si l'allocation échoue
+ */
+FileNode* node_alloc_mapped(const char* name, size_t len, FileType type, int permissions);
+
+/**
+ * @brief Libère un nœud isolé (sans ses enfants)
+ * @param node Nœud à libérer
+ */
+void node_free(FileNode* node);
+
+/**
+ * @brief Réserve la place de plusieurs enfants dans un répertoire
+ * @param dir Répertoire concerné
+ * @param count Nombre total d'enfants attendus
+ * @return 0 en cas de succès, -1 si l'allocation échoue
+ */
+int dir_reserve(FileNode* dir, int count);
+
+/**
+ * @brief Ajoute un enfant à un répertoire
+ * @param dir Répertoire parent
+ * @param child Nœud à ajouter
+ * @return 0 en cas de succès, -1 si l'allocation échoue
+ */
+int dir_add_child(FileNode* dir, FileNode* child);
+
+/**
+ * @brief Recherche un enfant par son nom, sous le verrou du répertoire
+ * @param dir Répertoire dans lequel chercher
+ * @param name Nom de l'entrée recherchée
+ * @return Nœud trouvé, NULL s'il n'existe pas
+ */
+FileNode* dir_lookup(FileNode* dir, const char* name);
+
+/**
+ * @brief Supprime récursivement un nœud et tous ses enfants
+ * @param node Nœud à supprimer
+ */
+void recursive_delete(FileNode* node);
+
+/**
+ * @brief Occupation d'une entrée : compteurs d'un répertoire, contenu d'un fichier
+ * @param node Entrée concernée
+ * @param usage Occupation à remplir
+ */
+void node_usage(const FileNode* node, DiskUsage* usage);
+
+/** @brief File de tâches d'un thread de parcours (définie dans fs_walk.c) */
+typedef struct WalkWorker WalkWorker;
+
+/**
+ * @brief Traitement d'un répertoire au cours d'un parcours parallèle
+ * @param worker File du thread, à passer à walk_push et walk_stop
+ * @param dir Répertoire à traiter
+ * @param arg Argument passé à walk_tree
+ */
+typedef void (*WalkDirFn)(WalkWorker* worker, FileNode* dir, void* arg);
+
+/**
+ * @brief Parcourt un sous-arbre en parallèle, par vol de tâches (voir fs_walk.c)
+ * @param root Premier répertoire à traiter
+ * @param visit Traitement d'un répertoire, qui empile ses sous-répertoires
+ * @param arg Argument transmis à visit
+ * @return 0 si le parcours est allé à son terme, 1 s'il a été arrêté
+ */
+int walk_tree(FileNode* root, WalkDirFn visit, void* arg);
+
+/**
+ * @brief Ajoute un répertoire à traiter au parcours en cours
+ * @param worker File du thread appelant
+ * @param dir Répertoire à traiter
+ */
+void walk_push(WalkWorker* worker, FileNode* dir);
+
+/**
+ * @brief Arrête le parcours en cours : les répertoires en attente ne sont plus traités
+ * @param worker File du thread appelant
+ */
+void walk_stop(WalkWorker* worker);
+
+/**
+ * @brief Détruit toute l'arborescence en bloc et libère la projection de
+ * l'image (root_directory devient NULL)
+ */
+void tree_release();
+
+/**
+ * @brief Écrit l'image de l'arborescence dans un fichier (voir fs_image.c)
+ * @param fd Descripteur ouvert en écriture, positionné au début
+ * @param root Racine de l'arborescence à sauvegarder
+ * @param generation Génération enregistrée dans l'image
+ * @return 0 en cas de succès, -1 en cas d'erreur (errno renseigné)
+ */
+int save_image(int fd, const FileNode* root, uint32_t generation);
+
+/**
+ * @brief Reconstruit l'arborescence à partir d'une image (voir fs_image.c)
+ * @param fd Descripteur ouvert en lecture
+ * @param generation Génération de l'image (sortie)
+ * @return Racine reconstruite, NULL si l'image est absente ou invalide
+ */
+FileNode* load_image(int fd, uint32_t* generation);
+
+/**
+ * @brief Projette une image en mémoire et n'en matérialise que la racine
+ * @param fd Descripteur ouvert en lecture
+ * @param generation Génération de l'image (sortie)
+ * @return Racine de l'arborescence, NULL si l'image est absente ou invalide
+ */
+FileNode* map_image(int fd, uint32_t* generation);
+
+/**
+ * @brief Matérialise les enfants d'un répertoire encore dans l'image projetée
+ * @param dir Répertoire concerné
+ * @return 0 en cas de succès (ou s'il n'y a rien à faire), -1 en cas d'erreur
+ */
+int dir_materialize(FileNode* dir);
+
+/**
+ * @brief Libère la projection de l'image
+ *
+ * Les nœuds issus de l'image ne doivent plus être utilisés ensuite, sauf
+ * pour être libérés.
+ */
+void unmap_image();
+
+/**
+ * @brief Ouvre le journal et rejoue les opérations postérieures à l'image (voir fs_journal.c)
+ * @return 0 en cas de succès, -1 si le journal ne peut être ouvert
+ */
+int journal_open();
+
+/**
+ * @brief Ajoute une opération réussie à la fin du journal
+ * @param op Opération effectuée
+ * @param first Premier argument (chemin)
+ * @param second Second argument, ou NULL
+ * @param permissions Permissions (création, chmod), 0 sinon
+ */
+void journal_append(JournalOp op, const char* first, const char* second, int permissions);
+
+/**
+ * @brief Ajoute une écriture à une position donnée à la fin du journal
+ * @param path Chemin du fichier
+ * @param data Octets écrits (quelconques)
+ * @param count Nombre d'octets écrits
+ * @param offset Position de l'écriture
+ */
+void journal_append_write(const char* path, const char* data, long long count, long long offset);
+
+/**
+ * @brief Ajoute un changement de quotas à la fin du journal
+ * @param path Chemin du répertoire
+ * @param max_bytes Quota d'octets
+ * @param max_nodes Quota d'entrées
+ */
+void journal_append_quota(const char* path, long long max_bytes, long long max_nodes);
+
+/**
+ * @brief Vide le journal après un point de reprise de génération fs_generation
+ * @return 0 en cas de succès, -1 en cas d'erreur
+ */
+int journal_reset();
+
+/**
+ * @brief Synchronise sur disque les enregistrements en attente
+ * @return 0 en cas de succès, -1 si une écriture a échoué depuis le dernier appel
+ */
+int journal_sync();
+
+/**
+ * @brief Synchronise puis ferme le journal
+ * @return 0 en cas de succès, -1 si une écriture a échoué depuis le dernier appel
+ */
+int journal_close();
+
+/** @brief Longueur maximale d'un chemin mémorisé par le cache de résolution */
+#define DCACHE_PATH_MAX 104
+
+/**
+ * @brief Clé d'un chemin absolu dans le cache de résolution (voir fs_dcache.c)
+ */
+typedef struct DcacheKey {
+    const char* path;               /**< Chemin (non copié) */
+    unsigned int length;            /**< Longueur du chemin */
+    unsigned int hash;              /**< Empreinte du chemin */
+    unsigned int generation;        /**< Génération relevée par dcache_lookup */
+    unsigned int seq;               /**< Séquence de la case relevée par dcache_lookup */
+    int admit;                      /**< 0 si dcache_lookup refuse l'insertion (case pleine) */
+    int missing;                    /**< 1 si l'entrée trouvée par dcache_lookup est négative */
+} DcacheKey;
+
+/**
+ * @brief Prépare la clé d'un chemin absolu
+ * @param path Chemin
+ * @param key Clé à remplir
+ * @return 0 si le chemin peut être mis en cache, -1 sinon
+ */
+int dcache_key(const char* path, DcacheKey* key);
+
+/**
+ * @brief Cherche la résolution d'un chemin dans le cache
+ * @param key Clé préparée par dcache_key
+ * @return Résultat mémorisé, NULL si absent
+ */
+FileNode* dcache_lookup(DcacheKey* key);
+
+/**
+ * @brief Mémorise la résolution d'un chemin absent du cache
+ * @param key Clé passée à dcache_lookup avant la résolution
+ * @param node Résultat de la résolution
+ * @param missing 1 pour une entrée négative (node est alors le répertoire parent)
+ */
+void dcache_insert(const DcacheKey* key, FileNode* node, int missing);
+
+/**
+ * @brief Retire l'entrée d'un chemin absolu canonique
+ * @param path Chemin (pas forcément terminé par '\0')
+ * @param length Longueur du chemin
+ */
+void dcache_invalidate(const char* path, size_t length);
+
+/**
+ * @brief Invalide tout le cache de résolution (cibles de liens comprises)
+ */
+void dcache_flush();
+
+/**
+ * @brief Cherche la cible résolue d'un lien symbolique
+ * @param link Lien concerné
+ * @param generation Reçoit la génération à passer à dcache_link_insert
+ * @return Nœud désigné par la cible, NULL s'il n'est pas en cache
+ */
+FileNode* dcache_link_lookup(const FileNode* link, unsigned int* generation);
+
+/**
+ * @brief Mémorise la cible résolue d'un lien symbolique
+ * @param link Lien concerné
+ * @param target Nœud désigné par sa cible
+ * @param generation Génération relevée par dcache_link_lookup avant la résolution
+ */
+void dcache_link_insert(const FileNode* link, FileNode* target, unsigned int generation);
+
+/**
+ * @brief Invalide toutes les cibles de liens mémorisées (suppression, déplacement)
+ */
+void dcache_link_flush();
+
+#endif // FS_INTERNAL_H
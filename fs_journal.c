@@ -0,0 +1,559 @@
+/**
+ * @file fs_journal.c
+ * @brief Journal des modifications (filesystem.journal)
+ *
+ * Chaque opération qui modifie l'arborescence ajoute un enregistrement
+ * à la fin du journal au lieu de réécrire toute l'image. Le coût de la
+ * persistance est ainsi proportionnel aux modifications, pas à la taille
+ * de l'arborescence.
+ *
+ * Le journal commence par un en-tête (JournalHeader) portant la
+ * génération de l'image à laquelle il s'applique, suivi d'une suite
+ * d'enregistrements (JournalRecord) :
+ * - l'opération, les permissions ou la position éventuelles et une
+ *   somme de contrôle
+ * - trois champs terminés par '\0' : le répertoire courant au moment
+ *   de l'opération puis ses deux arguments ; le second peut contenir
+ *   des octets quelconques (écriture à une position), sa longueur est
+ *   donnée par l'en-tête
+ *
+ * Un point de reprise (save_file_system) écrit une image de génération
+ * supérieure puis vide le journal. Il a lieu lorsque le journal atteint
+ * la taille de l'image (au moins JOURNAL_CHECKPOINT_SIZE) : réécrire
+ * l'image coûte alors au plus autant que ce qui a déjà été journalisé.
+ * Il est différé à journal_sync(), appelée hors de toute opération : une
+ * opération qui journalise détient encore ses verrous et ne peut pas
+ * attendre la sauvegarde, qui exige l'arborescence entière.
+ *
+ * Les opérations concurrentes journalisent en détenant encore les
+ * verrous qui rendent leur effet visible : l'ordre du journal respecte
+ * donc l'ordre des opérations qui dépendent l'une de l'autre. Les
+ * ajouts sont sérialisés par journal_lock. Les petits enregistrements
+ * sont accumulés dans un tampon, écrit en un seul appel par
+ * journal_sync() ou lorsqu'il est plein : une suite de commandes
+ * synchronisée par lots (mode script) ne coûte pas un appel système par
+ * opération. Au démarrage, le journal n'est rejoué
+ * que si sa génération est celle de l'image chargée : un journal
+ * antérieur au dernier point de reprise est simplement ignoré. Un
+ * enregistrement incomplet ou corrompu (écriture interrompue) termine
+ * le rejeu et est retiré du journal.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "fs_internal.h"
+
+/** @brief Signature placée en tête du journal */
+#define JOURNAL_MAGIC "VFSJRNL\n"
+/** @brief Version courante du format du journal */
+#define JOURNAL_VERSION 2
+/** @brief Taille minimale du journal au-delà de laquelle un point de reprise est effectué */
+#define JOURNAL_CHECKPOINT_SIZE (4 * 1024 * 1024)
+/** @brief Taille du tampon des enregistrements pas encore écrits */
+#define JOURNAL_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief En-tête du journal
+ */
+typedef struct JournalHeader {
+    char magic[8];                  /**< Signature JOURNAL_MAGIC */
+    uint32_t version;               /**< Version du format */
+    uint32_t generation;            /**< Génération de l'image à laquelle s'applique le journal */
+} JournalHeader;
+
+/**
+ * @brief En-tête d'un enregistrement du journal
+ */
+typedef struct JournalRecord {
+    uint32_t length;                /**< Taille des chaînes qui suivent l'en-tête */
+    uint32_t checksum;              /**< Somme de contrôle des champs suivants et des chaînes */
+    uint32_t op;                    /**< Opération (JournalOp) */
+    int32_t permissions;            /**< Permissions (création, chmod) */
+    uint32_t cwd_length;            /**< Longueur du répertoire courant */
+    uint32_t first_length;          /**< Longueur du premier argument */
+    uint32_t second_length;         /**< Longueur du second argument */
+    uint32_t reserved;              /**< Réservé (zéro) */
+    uint64_t offset;                /**< Position d'écriture (JOURNAL_PWRITE) */
+} JournalRecord;
+
+/** @brief Descripteur du journal (-1 si la journalisation est inactive) */
+int journal_fd = -1;
+
+/** @brief Taille actuelle du journal, enregistrements du tampon compris */
+static off_t journal_size = 0;
+
+/** @brief Enregistrements ajoutés mais pas encore écrits, à la fin du journal */
+static char journal_buffer[JOURNAL_BUFFER_SIZE];
+
+/** @brief Nombre d'octets occupés dans journal_buffer */
+static size_t journal_buffered = 0;
+
+/** @brief Taille du journal qui déclenche le prochain point de reprise */
+static off_t journal_checkpoint_at = JOURNAL_CHECKPOINT_SIZE;
+
+/** @brief 1 si des enregistrements restent à synchroniser sur disque */
+static int journal_dirty = 0;
+
+/** @brief 1 pendant le rejeu : les opérations rejouées ne sont pas journalisées */
+static int journal_replaying = 0;
+
+/** @brief 1 si le journal a atteint journal_checkpoint_at */
+static int journal_checkpoint_due = 0;
+
+/**
+ * @brief 1 si une écriture a échoué depuis la dernière synchronisation
+ *
+ * Les opérations ne peuvent pas signaler un échec du journal, survenu
+ * après leur effet : il est rapporté par le journal_sync() suivant.
+ */
+static int journal_failed = 0;
+
+/** @brief Sérialise les ajouts et la synchronisation */
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Calcule la somme de contrôle d'un enregistrement (FNV-1a 32 bits)
+ *
+ * @param record En-tête de l'enregistrement (NULL pour poursuivre un calcul)
+ * @param data Données de l'enregistrement
+ * @param length Nombre d'octets de data
+ * @param hash Valeur initiale (2166136261 ou résultat d'un appel précédent)
+ * @return uint32_t Somme de contrôle
+ */
+static uint32_t journal_checksum(const JournalRecord* record, const char* data,
+                                 uint32_t length, uint32_t hash) {
+    if (record != NULL) {
+        const unsigned char* bytes = (const unsigned char*)&record->op;
+        size_t fields = sizeof(JournalRecord) - offsetof(JournalRecord, op);
+        for (size_t i = 0; i < fields; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Calcule le seuil du prochain point de reprise d'après la taille de l'image
+ */
+static void journal_update_checkpoint() {
+    struct stat st;
+    journal_checkpoint_at = JOURNAL_CHECKPOINT_SIZE;
+    if (fs_fd >= 0 && fstat(fs_fd, &st) == 0 && st.st_size > journal_checkpoint_at) {
+        journal_checkpoint_at = st.st_size;
+    }
+}
+
+/**
+ * @brief Réinitialise le journal pour la génération courante de l'image
+ *
+ * @return int 0 en cas de succès, -1 en cas d'erreur
+ */
+int journal_reset() {
+    if (journal_fd < 0) return 0;
+
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.generation = fs_generation;
+    pthread_mutex_lock(&journal_lock);
+    // L'image vient d'être écrite : les enregistrements en attente y figurent
+    journal_buffered = 0;
+    int status = -1;
+    if (ftruncate(journal_fd, 0) == 0 &&
+        pwrite(journal_fd, &header, sizeof(header), 0) == sizeof(header) &&
+        fdatasync(journal_fd) == 0) {
+        journal_size = sizeof(header);
+        journal_dirty = 0;
+        journal_checkpoint_due = 0;
+        journal_update_checkpoint();
+        status = 0;
+    }
+    pthread_mutex_unlock(&journal_lock);
+    return status;
+}
+
+/**
+ * @brief Applique un enregistrement à l'arborescence
+ *
+ * @param record En-tête de l'enregistrement
+ * @param cwd Répertoire courant au moment de l'opération
+ * @param first Premier argument
+ * @param second Second argument (de longueur record->second_length)
+ *
+ * @details
+ * - Rétablit le répertoire courant, les chemins relatifs et les liens
+ *   étant résolus par rapport à lui
+ * - Rejoue l'opération par l'interface publique, donc avec les mêmes
+ *   règles que lors de son exécution initiale
+ * - Sauf les écritures, faites par un descripteur déjà ouvert : les
+ *   permissions ont pu changer depuis son ouverture, elles sont donc
+ *   rejouées sans nouvelle ouverture (replay_write)
+ */
+static void journal_apply(const JournalRecord* record, const char* cwd,
+                          const char* first, const char* second) {
+    FileNode* directory = get_file_by_path(cwd);
+    if (directory == NULL || directory->type != DIRECTORY_TYPE) return;
+    session_set_cwd(session_current(), directory);
+
+    switch (record->op) {
+    case JOURNAL_CREATE_FILE:
+        create_file(first, record->permissions);
+        break;
+    case JOURNAL_CREATE_DIRECTORY:
+        create_directory(first, record->permissions);
+        break;
+    case JOURNAL_WRITE:
+        // Écrite par un descripteur ouvert à l'époque : pas de nouvelle ouverture
+        replay_write(first, second, record->second_length, 0, 1);
+        break;
+    case JOURNAL_PWRITE:
+        replay_write(first, second, record->second_length, (long long)record->offset, 0);
+        break;
+    case JOURNAL_COPY:
+        copy_file(first, second);
+        break;
+    case JOURNAL_MOVE:
+        move_file(first, second);
+        break;
+    case JOURNAL_DELETE:
+        delete_file(first);
+        break;
+    case JOURNAL_CHMOD:
+        set_permissions(first, record->permissions);
+        break;
+    case JOURNAL_CHMOD_RECURSIVE:
+        set_permissions_recursive(first, record->permissions);
+        break;
+    case JOURNAL_COMPRESS:
+        set_compression(first, record->permissions);
+        break;
+    case JOURNAL_HARD_LINK:
+        create_hard_link(first, second);
+        break;
+    case JOURNAL_SYMLINK:
+        create_symbolic_link(first, second);
+        break;
+    case JOURNAL_QUOTA: {
+        long long max_nodes = 0;
+        if (record->second_length == sizeof(max_nodes)) {
+            memcpy(&max_nodes, second, sizeof(max_nodes));
+        }
+        set_quota(first, (long long)record->offset, max_nodes);
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Rejoue les enregistrements du journal ouvert
+ *
+ * @param size Taille du journal
+ *
+ * @details
+ * - Lit tout le journal en mémoire puis applique les enregistrements
+ *   dans l'ordre
+ * - S'arrête au premier enregistrement incomplet ou dont la somme de
+ *   contrôle est fausse, et tronque le journal à cet endroit
+ */
+static void journal_replay(off_t size) {
+    char* data = malloc(size);
+    journal_size = size;
+    if (data == NULL) return;
+    off_t done = 0;
+    while (done < size) {
+        ssize_t got = pread(journal_fd, data + done, size - done, done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        done += got;
+    }
+    size = done;
+
+    journal_replaying = 1;
+    off_t offset = sizeof(JournalHeader);
+    while (offset + (off_t)sizeof(JournalRecord) <= size) {
+        JournalRecord record;
+        memcpy(&record, data + offset, sizeof(record));
+        const char* strings = data + offset + sizeof(record);
+        if (record.length > size - offset - sizeof(record) ||
+            (uint64_t)record.cwd_length + record.first_length + record.second_length + 3 != record.length ||
+            journal_checksum(&record, strings, record.length, 2166136261u) != record.checksum) {
+            break;
+        }
+
+        const char* cwd = strings;
+        const char* first = cwd + record.cwd_length + 1;
+        const char* second = first + record.first_length + 1;
+        if (cwd[record.cwd_length] != '\0' || first[record.first_length] != '\0' ||
+            second[record.second_length] != '\0') {
+            break;
+        }
+        if (record.offset > INT64_MAX) break;
+        journal_apply(&record, cwd, first, second);
+        offset += sizeof(record) + record.length;
+    }
+    journal_replaying = 0;
+    session_set_cwd(session_current(), root_directory);
+
+    // Retirer la fin incomplète pour que les ajouts suivants soient lisibles
+    if (offset < size && ftruncate(journal_fd, offset) != 0) {
+        journal_failed = 1;
+    }
+    journal_size = offset;
+    free(data);
+}
+
+/**
+ * @brief Ouvre le journal et rejoue les opérations postérieures à l'image
+ *
+ * @return int 0 en cas de succès, -1 si le journal ne peut être ouvert
+ *
+ * @details
+ * - Rejoue le journal si sa génération est celle de l'image chargée
+ * - Sinon (journal absent, d'un autre format ou antérieur au dernier
+ *   point de reprise), le réinitialise
+ */
+int journal_open() {
+    journal_fd = open(FS_JOURNAL_FILENAME, O_RDWR | O_CREAT, 0644);
+    if (journal_fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    JournalHeader header;
+    if (fstat(journal_fd, &st) == 0 && st.st_size >= (off_t)sizeof(header) &&
+        pread(journal_fd, &header, sizeof(header), 0) == sizeof(header) &&
+        memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == JOURNAL_VERSION && header.generation == fs_generation) {
+        journal_update_checkpoint();
+        journal_replay(st.st_size);
+        return 0;
+    }
+
+    if (journal_reset() != 0) {
+        int error = errno;
+        close(journal_fd);
+        journal_fd = -1;
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Écrit les enregistrements du tampon à la fin du journal
+ *
+ * @details
+ * Appelée sous journal_lock. En cas d'échec, le journal est ramené à la
+ * dernière position valide, les enregistrements du tampon sont perdus et
+ * le prochain journal_sync() le signale.
+ */
+static void journal_flush() {
+    if (journal_buffered == 0) return;
+
+    off_t position = journal_size - journal_buffered;
+    if (pwrite(journal_fd, journal_buffer, journal_buffered, position) != (ssize_t)journal_buffered) {
+        // Un enregistrement partiel serait écarté au rejeu, mais les
+        // suivants aussi : revenir à la dernière position valide
+        journal_failed = 1;
+        if (ftruncate(journal_fd, position) != 0) {
+            // Les enregistrements suivants seraient ignorés au rejeu
+            journal_checkpoint_due = 1;
+        }
+        journal_size = position;
+    } else {
+        journal_dirty = 1;
+    }
+    journal_buffered = 0;
+}
+
+/**
+ * @brief Ajoute un enregistrement à la fin du journal
+ *
+ * @param op Opération effectuée
+ * @param first Premier argument (chemin)
+ * @param second Second argument, de second_length octets
+ * @param second_length Longueur du second argument
+ * @param permissions Permissions (création, chmod), 0 sinon
+ * @param offset Position d'écriture (JOURNAL_PWRITE), 0 sinon
+ *
+ * @details
+ * - Enregistre aussi le répertoire courant, dont dépendent les chemins
+ *   relatifs et les liens
+ * - Un enregistrement qui tient dans le tampon y est recopié ; un plus
+ *   grand est écrit aussitôt après le tampon, en un seul appel pwritev,
+ *   le second argument directement depuis le tampon de l'appelant
+ * - L'écriture du tampon et la synchronisation sur disque sont
+ *   différées à journal_sync()
+ * - Demande un point de reprise lorsque le journal devient trop grand
+ */
+static void journal_write_record(JournalOp op, const char* first, const char* second,
+                                 uint32_t second_length, int permissions, uint64_t offset) {
+    const char* cwd = get_current_path();
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    record.permissions = permissions;
+    record.offset = offset;
+    record.cwd_length = strlen(cwd);
+    record.first_length = strlen(first);
+    record.second_length = second_length;
+    record.length = record.cwd_length + record.first_length + record.second_length + 3;
+
+    // Somme de contrôle calculée sur les morceaux, sans les recopier
+    uint32_t checksum = journal_checksum(&record, cwd, record.cwd_length + 1, 2166136261u);
+    checksum = journal_checksum(NULL, first, record.first_length + 1, checksum);
+    checksum = journal_checksum(NULL, second, second_length, checksum);
+    record.checksum = journal_checksum(NULL, "", 1, checksum);
+
+    struct iovec iov[5] = {
+        { &record, sizeof(record) },
+        { (void*)cwd, record.cwd_length + 1 },
+        { (void*)first, record.first_length + 1 },
+        { (void*)second, second_length },
+        { "", 1 },
+    };
+    size_t expected = sizeof(record) + record.length;
+
+    pthread_mutex_lock(&journal_lock);
+    if (journal_buffered + expected > JOURNAL_BUFFER_SIZE) {
+        journal_flush();
+    }
+    if (expected <= JOURNAL_BUFFER_SIZE) {
+        char* cursor = journal_buffer + journal_buffered;
+        for (int i = 0; i < 5; i++) {
+            memcpy(cursor, iov[i].iov_base, iov[i].iov_len);
+            cursor += iov[i].iov_len;
+        }
+        journal_buffered += expected;
+        journal_size += expected;
+    } else {
+        ssize_t written = pwritev(journal_fd, iov, 5, journal_size);
+        if (written != (ssize_t)expected) {
+            journal_failed = 1;
+            if (ftruncate(journal_fd, journal_size) != 0) {
+                journal_checkpoint_due = 1;
+            }
+        } else {
+            journal_size += written;
+            journal_dirty = 1;
+        }
+    }
+    if (journal_size >= journal_checkpoint_at) {
+        journal_checkpoint_due = 1;
+    }
+    pthread_mutex_unlock(&journal_lock);
+}
+
+/**
+ * @brief Ajoute une opération réussie à la fin du journal
+ *
+ * @param op Opération effectuée
+ * @param first Premier argument (chemin)
+ * @param second Second argument (destination, contenu ou nom du lien), ou NULL
+ * @param permissions Permissions (création, chmod), 0 sinon
+ */
+void journal_append(JournalOp op, const char* first, const char* second, int permissions) {
+    if (journal_fd < 0 || journal_replaying) return;
+    if (second == NULL) second = "";
+    journal_write_record(op, first, second, strlen(second), permissions, 0);
+}
+
+/**
+ * @brief Ajoute une écriture à une position à la fin du journal
+ *
+ * @param path Chemin du fichier
+ * @param data Octets écrits (quelconques)
+ * @param count Nombre d'octets
+ * @param offset Position d'écriture
+ *
+ * @details
+ * Une écriture trop grande pour un enregistrement est découpée en
+ * plusieurs enregistrements consécutifs.
+ */
+void journal_append_write(const char* path, const char* data, long long count, long long offset) {
+    if (journal_fd < 0 || journal_replaying) return;
+    const long long chunk = 1 << 30;
+    do {
+        uint32_t length = count > chunk ? chunk : count;
+        journal_write_record(JOURNAL_PWRITE, path, data, length, 0, offset);
+        data += length;
+        offset += length;
+        count -= length;
+    } while (count > 0);
+}
+
+/**
+ * @brief Ajoute un changement de quotas à la fin du journal
+ *
+ * @param path Chemin du répertoire
+ * @param max_bytes Quota d'octets, porté par la position de l'enregistrement
+ * @param max_nodes Quota d'entrées, porté en binaire par le second argument
+ */
+void journal_append_quota(const char* path, long long max_bytes, long long max_nodes) {
+    if (journal_fd < 0 || journal_replaying) return;
+    journal_write_record(JOURNAL_QUOTA, path, (const char*)&max_nodes, sizeof(max_nodes),
+                         0, max_bytes);
+}
+
+/**
+ * @brief Écrit et synchronise sur disque les enregistrements ajoutés depuis le dernier appel
+ *
+ * @return int 0 en cas de succès, -1 si une écriture, la synchronisation
+ *         ou le point de reprise a échoué depuis le dernier appel
+ *
+ * Appelée une fois par commande, sans détenir de verrou du système de
+ * fichiers : les opérations d'une même commande partagent une seule
+ * synchronisation. Effectue le point de reprise demandé le cas échéant.
+ * Un point de reprise réussi rend les échecs précédents sans conséquence :
+ * l'image contient alors toutes les modifications.
+ */
+int journal_sync() {
+    if (journal_fd < 0) return 0;
+    pthread_mutex_lock(&journal_lock);
+    journal_flush();
+    if (journal_dirty) {
+        if (fdatasync(journal_fd) != 0) {
+            journal_failed = 1;
+        }
+        journal_dirty = 0;
+    }
+    int checkpoint = journal_checkpoint_due;
+    int failed = journal_failed;
+    journal_failed = 0;
+    pthread_mutex_unlock(&journal_lock);
+
+    if (checkpoint) {
+        return save_file_system() == 0 ? 0 : -1;
+    }
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Synchronise puis ferme le journal
+ *
+ * @return int 0 en cas de succès, -1 si une écriture a échoué depuis la
+ *         dernière synchronisation
+ */
+int journal_close() {
+    int status = 0;
+    if (journal_fd >= 0) {
+        status = journal_sync();
+        close(journal_fd);
+        journal_fd = -1;
+    }
+    return status;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file fs_lz.c
+ * @brief Compression LZ des extents de contenu
+ *
+ * Compresseur de la famille LZ77, sans dépendance, adapté aux blocs de
+ * DATA_BLOCK_SIZE octets (voir fs_data.c). Le flux compressé est une
+ * suite de séquences :
+ *
+ *     jeton | [longueur de littéraux] | littéraux | distance | [longueur de copie]
+ *
+ * - Le jeton porte sur 4 bits le nombre de littéraux et sur 4 bits la
+ *   longueur de la copie moins LZ_MIN_MATCH ; la valeur 15 est
+ *   prolongée par des octets 255 puis un octet de reste
+ * - La distance (2 octets, petit-boutiste) désigne le début de la copie
+ *   en arrière dans la sortie ; une copie peut recouvrir ce qu'elle
+ *   produit (répétitions)
+ * - La dernière séquence n'a que des littéraux
+ *
+ * Le compresseur retrouve les répétitions par une table d'empreintes des
+ * séquences de 4 octets (dernière position vue). Sur des données qui ne
+ * se répètent pas, il avance de plus en plus vite, et abandonne dès que
+ * la sortie dépasse la limite fixée par l'appelant : un bloc
+ * incompressible coûte peu et reste stocké tel quel.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "fs_internal.h"
+
+/** @brief Longueur minimale d'une copie */
+#define LZ_MIN_MATCH 4
+/** @brief Nombre de bits de l'empreinte d'une séquence */
+#define LZ_HASH_BITS 12
+/** @brief Valeur du jeton qui annonce une longueur prolongée */
+#define LZ_TOKEN_MAX 15
+/** @brief Distance maximale d'une copie */
+#define LZ_MAX_DISTANCE 65535
+/** @brief Échecs consécutifs (en puissance de 2) avant d'accélérer le pas */
+#define LZ_SKIP_SHIFT 5
+
+/**
+ * @brief Lit 4 octets sans contrainte d'alignement
+ */
+static uint32_t lz_read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Empreinte d'une séquence de 4 octets
+ */
+static unsigned int lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * @brief Écrit une longueur prolongée (au-delà de LZ_TOKEN_MAX)
+ *
+ * @param out Position d'écriture, avancée
+ * @param length Reste de la longueur (valeur du champ moins LZ_TOKEN_MAX)
+ */
+static void lz_put_length(unsigned char** out, unsigned int length) {
+    while (length >= 255) {
+        *(*out)++ = 255;
+        length -= 255;
+    }
+    *(*out)++ = (unsigned char)length;
+}
+
+/**
+ * @brief Écrit une séquence : littéraux puis, si length > 0, une copie
+ *
+ * @param out Position d'écriture, avancée
+ * @param end Fin de la zone de sortie autorisée
+ * @param literals Premier littéral
+ * @param literal_count Nombre de littéraux
+ * @param distance Distance de la copie
+ * @param length Longueur de la copie (0 pour la dernière séquence)
+ * @return int 0 en cas de succès, -1 si la séquence dépasse end
+ */
+static int lz_put_sequence(unsigned char** out, const unsigned char* end,
+                           const unsigned char* literals, unsigned int literal_count,
+                           unsigned int distance, unsigned int length) {
+    // Pire cas : jeton, deux longueurs prolongées et la distance
+    size_t need = 1 + literal_count + literal_count / 255 + 1 + (length ? 2 + length / 255 + 1 : 0);
+    if (need > (size_t)(end - *out)) return -1;
+
+    unsigned int literal_field = literal_count < LZ_TOKEN_MAX ? literal_count : LZ_TOKEN_MAX;
+    unsigned int match = length ? length - LZ_MIN_MATCH : 0;
+    unsigned int match_field = match < LZ_TOKEN_MAX ? match : LZ_TOKEN_MAX;
+    *(*out)++ = (unsigned char)(literal_field << 4 | match_field);
+    if (literal_field == LZ_TOKEN_MAX) lz_put_length(out, literal_count - LZ_TOKEN_MAX);
+    memcpy(*out, literals, literal_count);
+    *out += literal_count;
+    if (length == 0) return 0;
+
+    *(*out)++ = (unsigned char)(distance & 0xFF);
+    *(*out)++ = (unsigned char)(distance >> 8);
+    if (match_field == LZ_TOKEN_MAX) lz_put_length(out, match - LZ_TOKEN_MAX);
+    return 0;
+}
+
+/**
+ * @brief Compresse un bloc
+ *
+ * @param source Octets à compresser
+ * @param length Nombre d'octets (au plus LZ_MAX_DISTANCE)
+ * @param dest Destination, d'au moins limit octets
+ * @param limit Taille maximale acceptée pour le résultat
+ * @return unsigned int Taille compressée, 0 si elle dépasserait limit
+ *         (bloc incompressible)
+ */
+unsigned int lz_compress(const char* source, unsigned int length, char* dest, unsigned int limit) {
+    const unsigned char* in = (const unsigned char*)source;
+    unsigned char* out = (unsigned char*)dest;
+    const unsigned char* out_end = out + limit;
+    uint16_t table[1 << LZ_HASH_BITS];   // Position + 1 (0 : aucune)
+    memset(table, 0, sizeof(table));
+    if (length > LZ_MAX_DISTANCE) return 0;
+
+    unsigned int anchor = 0;
+    unsigned int position = 0;
+    unsigned int misses = 0;
+    while (position + LZ_MIN_MATCH <= length) {
+        uint32_t sequence = lz_read32(in + position);
+        unsigned int hash = lz_hash(sequence);
+        unsigned int candidate = table[hash];
+        table[hash] = (uint16_t)(position + 1);
+
+        if (candidate == 0 || lz_read32(in + candidate - 1) != sequence) {
+            // Pas de répétition : avancer d'autant plus vite que les échecs s'accumulent
+            position += 1 + (misses++ >> LZ_SKIP_SHIFT);
+            continue;
+        }
+        unsigned int match = candidate - 1;
+        unsigned int match_length = LZ_MIN_MATCH;
+        while (position + match_length < length && in[match + match_length] == in[position + match_length]) {
+            match_length++;
+        }
+        if (lz_put_sequence(&out, out_end, in + anchor, position - anchor,
+                            position - match, match_length) != 0) {
+            return 0;
+        }
+        position += match_length;
+        anchor = position;
+        misses = 0;
+    }
+    if (lz_put_sequence(&out, out_end, in + anchor, length - anchor, 0, 0) != 0) {
+        return 0;
+    }
+    return (unsigned int)(out - (unsigned char*)dest);
+}
+
+/**
+ * @brief Lit une longueur prolongée
+ *
+ * @param in Position de lecture, avancée
+ * @param end Fin du flux
+ * @param length Longueur à compléter
+ * @return int 0 en cas de succès, -1 si le flux est tronqué
+ */
+static int lz_get_length(const unsigned char** in, const unsigned char* end, unsigned int* length) {
+    unsigned char byte;
+    do {
+        if (*in >= end) return -1;
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+/**
+ * @brief Décompresse le début d'un bloc
+ *
+ * @param source Flux produit par lz_compress
+ * @param source_length Taille du flux
+ * @param dest Destination
+ * @param length Nombre d'octets à produire (au plus la taille d'origine :
+ *        le décodage s'arrête dès qu'ils sont produits)
+ * @return int 0 en cas de succès, -1 si le flux est invalide ou trop court
+ */
+int lz_decompress(const char* source, unsigned int source_length, char* dest, unsigned int length) {
+    const unsigned char* in = (const unsigned char*)source;
+    const unsigned char* in_end = in + source_length;
+    unsigned char* out = (unsigned char*)dest;
+    unsigned int done = 0;
+
+    while (done < length) {
+        if (in >= in_end) return -1;
+        unsigned int token = *in++;
+        unsigned int literal_count = token >> 4;
+        if (literal_count == LZ_TOKEN_MAX && lz_get_length(&in, in_end, &literal_count) != 0) return -1;
+        if (literal_count > (unsigned int)(in_end - in)) return -1;
+        unsigned int take = literal_count < length - done ? literal_count : length - done;
+        memcpy(out + done, in, take);
+        in += literal_count;
+        done += take;
+        if (done == length) break;
+
+        if (in_end - in < 2) return -1;
+        unsigned int distance = in[0] | (unsigned int)in[1] << 8;
+        in += 2;
+        unsigned int match_length = token & 0x0F;
+        if (match_length == LZ_TOKEN_MAX && lz_get_length(&in, in_end, &match_length) != 0) return -1;
+        match_length += LZ_MIN_MATCH;
+        if (distance == 0 || distance > done) return -1;
+
+        // Copie octet par octet : la source peut recouvrir la destination
+        if (match_length > length - done) match_length = length - done;
+        const unsigned char* from = out + done - distance;
+        if (distance >= match_length) {
+            memcpy(out + done, from, match_length);
+        } else {
+            for (unsigned int i = 0; i < match_length; i++) out[done + i] = from[i];
+        }
+        done += match_length;
+    }
+    return 0;
+}
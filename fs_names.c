@@ -0,0 +1,226 @@
+/**
+ * @file fs_names.c
+ * @brief Table d'internement des noms de nœuds
+ *
+ * Un nom n'est rangé qu'une fois, quel que soit le nombre de nœuds qui
+ * le portent : les milliers de « README », « Makefile » ou « index.html »
+ * d'une arborescence réelle partagent une seule copie. Chaque copie
+ * porte son empreinte, sa longueur et le nombre de nœuds qui la
+ * désignent ; la dernière référence relâchée la libère.
+ *
+ * Les copies sont allouées dans les dalles (voir fs_alloc.c) ; la table
+ * qui les retrouve par leur contenu est à adressage ouvert (sondage
+ * linéaire, remplie aux trois quarts au plus), sans pierre tombale : une
+ * suppression recule les entrées suivantes de la même grappe.
+ *
+ * La table n'est consultée qu'à la création et au renommage d'un nœud :
+ * la recherche d'un enfant compare l'empreinte et la longueur rangées
+ * dans l'index du répertoire, puis le texte du nom.
+ *
+ * name_intern et name_release peuvent être appelées depuis plusieurs
+ * threads : la table est protégée par un verrou unique (names_lock).
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "fs_internal.h"
+
+/** @brief Capacité minimale de la table (puissance de 2) */
+#define NAMES_MIN_CAPACITY 1024
+
+/**
+ * @brief Copie partagée d'un nom
+ */
+typedef struct NameEntry {
+    unsigned int hash;              /**< Empreinte du nom */
+    unsigned int refs;              /**< Nombre de nœuds qui portent le nom (protégé par names_lock) */
+    unsigned char length;           /**< Longueur du nom */
+    char text[];                    /**< Nom terminé par '\0' */
+} NameEntry;
+
+/** @brief Table des noms, indexée par empreinte (NULL : emplacement libre) */
+static NameEntry** names_table;
+
+/** @brief Nombre d'emplacements de la table (puissance de 2, 0 si non allouée) */
+static unsigned int names_capacity;
+
+/** @brief Nombre de noms distincts */
+static unsigned int names_count;
+
+/** @brief Nombre total de références */
+static size_t names_refs;
+
+/** @brief Verrou de la table et des compteurs de références */
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Copie partagée qui contient un texte
+ *
+ * @param text Texte renvoyé par name_intern
+ * @return NameEntry* Copie correspondante
+ */
+static NameEntry* name_entry(const char* text) {
+    return (NameEntry*)(text - offsetof(NameEntry, text));
+}
+
+/**
+ * @brief Taille allouée pour une copie
+ *
+ * @param length Longueur du nom
+ * @return size_t Taille passée à small_alloc
+ */
+static size_t name_entry_size(size_t length) {
+    return offsetof(NameEntry, text) + length + 1;
+}
+
+/**
+ * @brief Double la capacité de la table
+ *
+ * @return int 0 en cas de succès, -1 si l'allocation échoue (table inchangée)
+ */
+static int names_grow() {
+    unsigned int capacity = names_capacity ? names_capacity * 2 : NAMES_MIN_CAPACITY;
+    NameEntry** table = calloc(capacity, sizeof(NameEntry*));
+    if (table == NULL) return -1;
+
+    for (unsigned int i = 0; i < names_capacity; i++) {
+        NameEntry* entry = names_table[i];
+        if (entry == NULL) continue;
+        unsigned int j = entry->hash & (capacity - 1);
+        while (table[j] != NULL) j = (j + 1) & (capacity - 1);
+        table[j] = entry;
+    }
+    free(names_table);
+    names_table = table;
+    names_capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Renvoie la copie partagée d'un nom, créée au besoin
+ *
+ * @param name Début du nom (pas forcément terminé par '\0')
+ * @param length Longueur du nom (< MAX_NAME_LENGTH)
+ * @param hash Empreinte du nom (hash_name_n)
+ * @return const char* Copie terminée par '\0', à relâcher par
+ *         name_release ; NULL si l'allocation échoue
+ */
+const char* name_intern(const char* name, size_t length, unsigned int hash) {
+    pthread_mutex_lock(&names_lock);
+    if ((names_count + 1) * 4 > names_capacity * 3 && names_grow() != 0) {
+        pthread_mutex_unlock(&names_lock);
+        return NULL;
+    }
+
+    unsigned int mask = names_capacity - 1;
+    unsigned int i = hash & mask;
+    for (NameEntry* entry; (entry = names_table[i]) != NULL; i = (i + 1) & mask) {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, name, length) == 0) {
+            entry->refs++;
+            names_refs++;
+            pthread_mutex_unlock(&names_lock);
+            return entry->text;
+        }
+    }
+
+    NameEntry* entry = small_alloc(name_entry_size(length));
+    if (entry == NULL) {
+        pthread_mutex_unlock(&names_lock);
+        return NULL;
+    }
+    entry->hash = hash;
+    entry->refs = 1;
+    entry->length = (unsigned char)length;
+    memcpy(entry->text, name, length);
+    entry->text[length] = '\0';
+    names_table[i] = entry;
+    names_count++;
+    names_refs++;
+    pthread_mutex_unlock(&names_lock);
+    return entry->text;
+}
+
+/**
+ * @brief Relâche une référence sur un nom interné
+ *
+ * @param text Copie renvoyée par name_intern
+ *
+ * @details
+ * La dernière référence retire la copie de la table en reculant les
+ * entrées suivantes de sa grappe qui ne sont pas à leur place, puis la
+ * libère.
+ */
+void name_release(const char* text) {
+    NameEntry* entry = name_entry(text);
+    pthread_mutex_lock(&names_lock);
+    names_refs--;
+    if (--entry->refs > 0) {
+        pthread_mutex_unlock(&names_lock);
+        return;
+    }
+
+    unsigned int mask = names_capacity - 1;
+    unsigned int hole = entry->hash & mask;
+    while (names_table[hole] != entry) hole = (hole + 1) & mask;
+    for (unsigned int j = (hole + 1) & mask; names_table[j] != NULL; j = (j + 1) & mask) {
+        // L'entrée j peut combler le trou si sa place idéale n'est pas dans ]hole, j]
+        unsigned int home = names_table[j]->hash & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            names_table[hole] = names_table[j];
+            hole = j;
+        }
+    }
+    names_table[hole] = NULL;
+    names_count--;
+    small_free(entry, name_entry_size(entry->length));
+    pthread_mutex_unlock(&names_lock);
+}
+
+/**
+ * @brief Vide la table des noms
+ *
+ * @details
+ * Utilisée par tree_release(), avant small_release_all() : seules les
+ * copies confiées à malloc (plus de SMALL_MAX_SIZE octets) sont
+ * libérées une à une, les autres disparaissent avec les dalles.
+ */
+void names_reset() {
+    for (unsigned int i = 0; i < names_capacity; i++) {
+        NameEntry* entry = names_table[i];
+        if (entry != NULL && name_entry_size(entry->length) > SMALL_MAX_SIZE) {
+            small_free(entry, name_entry_size(entry->length));
+        }
+    }
+    free(names_table);
+    names_table = NULL;
+    names_capacity = 0;
+    names_count = 0;
+    names_refs = 0;
+}
+
+/**
+ * @brief Statistiques de la table des noms
+ *
+ * @param distinct Nombre de noms distincts
+ * @param references Nombre de nœuds qui portent un nom interné
+ * @param bytes Octets occupés par les copies et la table
+ */
+void names_stats(size_t* distinct, size_t* references, size_t* bytes) {
+    pthread_mutex_lock(&names_lock);
+    size_t total = (size_t)names_capacity * sizeof(NameEntry*);
+    for (unsigned int i = 0; i < names_capacity; i++) {
+        if (names_table[i] != NULL) {
+            // Arrondi à la granularité des dalles (voir fs_alloc.c)
+            total += (name_entry_size(names_table[i]->length) + 15) & ~(size_t)15;
+        }
+    }
+    *distinct = names_count;
+    *references = names_refs;
+    *bytes = total;
+    pthread_mutex_unlock(&names_lock);
+}
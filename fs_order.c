@@ -0,0 +1,328 @@
+/**
+ * @file fs_order.c
+ * @brief Index ordonné des enfants d'un répertoire
+ *
+ * Complète l'index haché (recherche exacte) et le tableau des enfants
+ * (ordre d'insertion, curseurs de read_directory) d'un répertoire : les
+ * enfants y sont rangés dans l'ordre de leurs noms (octet par octet,
+ * comme strcmp), ce qui permet de les parcourir triés à partir de
+ * n'importe quel nom, ou de n'énumérer que ceux qui commencent par un
+ * préfixe, en O(log n + k).
+ *
+ * La structure est un arbre B+ à deux niveaux :
+ * - des feuilles de ORDER_LEAF_MAX pointeurs de nœuds triés (quelques
+ *   lignes de cache, parcourues par recherche dichotomique)
+ * - un répertoire des feuilles, trié par le premier nom de chacune ; les
+ *   séparateurs ne sont pas recopiés mais relus dans les feuilles, ce qui
+ *   ne laisse aucun pointeur vers un nœud supprimé
+ *
+ * Une feuille pleine est coupée en deux (ou, pour un ajout en fin
+ * d'ordre, laissée pleine au profit d'une nouvelle feuille), une feuille
+ * vide est retirée et deux feuilles voisines peu remplies sont fusionnées.
+ * La feuille et la place nécessaires à un ajout sont réservées d'avance
+ * (order_reserve) : l'ajout lui-même ne peut pas échouer.
+ *
+ * L'index n'est construit qu'au premier parcours ordonné d'un répertoire
+ * (voir list_directory_sorted) puis tenu à jour ; les fonctions order_*
+ * ne verrouillent rien, l'appelant détient le verrou du répertoire.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fs_internal.h"
+
+/** @brief Nombre maximal d'enfants par feuille */
+#define ORDER_LEAF_MAX 64
+/** @brief Remplissage des feuilles à la construction (place pour des ajouts) */
+#define ORDER_LEAF_FILL 48
+
+/**
+ * @brief Feuille : enfants consécutifs dans l'ordre des noms
+ */
+typedef struct OrderLeaf {
+    unsigned int count;             /**< Nombre d'enfants (jamais nul dans l'index) */
+    FileNode* entries[ORDER_LEAF_MAX]; /**< Enfants triés par nom */
+} OrderLeaf;
+
+/**
+ * @brief Index ordonné d'un répertoire
+ */
+struct DirOrder {
+    OrderLeaf** leaves;             /**< Feuilles, triées par leur premier nom */
+    unsigned int leaf_count;        /**< Nombre de feuilles */
+    unsigned int leaf_capacity;     /**< Nombre d'emplacements alloués dans leaves */
+    OrderLeaf* spare;               /**< Feuille réservée pour la prochaine coupure */
+};
+
+/**
+ * @brief Compare le nom d'un nœud à une clé
+ *
+ * @param node Nœud concerné
+ * @param name Clé (pas forcément terminée par '\0')
+ * @param length Longueur de la clé
+ * @return int Négatif, nul ou positif selon que le nom précède, égale ou suit la clé
+ */
+static int order_compare(const FileNode* node, const char* name, size_t length) {
+    size_t common = node->name_length < length ? node->name_length : length;
+    int result = memcmp(node->name, name, common);
+    if (result != 0) return result;
+    return (node->name_length > length) - (node->name_length < length);
+}
+
+/**
+ * @brief Compare deux nœuds par leur nom (pour qsort)
+ */
+static int order_compare_nodes(const void* left, const void* right) {
+    const FileNode* other = *(FileNode* const*)right;
+    return order_compare(*(FileNode* const*)left, other->name, other->name_length);
+}
+
+/**
+ * @brief Feuille qui contient, ou contiendrait, une clé
+ *
+ * @param order Index non vide
+ * @param name Clé
+ * @param length Longueur de la clé
+ * @return unsigned int Index de la dernière feuille dont le premier nom
+ *         ne suit pas la clé (0 si la clé précède tout)
+ */
+static unsigned int order_leaf_for(const DirOrder* order, const char* name, size_t length) {
+    unsigned int low = 0, high = order->leaf_count;
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        if (order_compare(order->leaves[middle]->entries[0], name, length) <= 0) low = middle + 1;
+        else high = middle;
+    }
+    return low > 0 ? low - 1 : 0;
+}
+
+/**
+ * @brief Position d'une clé dans une feuille
+ *
+ * @param leaf Feuille concernée
+ * @param name Clé
+ * @param length Longueur de la clé
+ * @param after 0 : premier enfant qui ne précède pas la clé ; 1 : premier qui la suit
+ * @return unsigned int Position (leaf->count si aucun)
+ */
+static unsigned int order_slot_for(const OrderLeaf* leaf, const char* name, size_t length, int after) {
+    unsigned int low = 0, high = leaf->count;
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        int result = order_compare(leaf->entries[middle], name, length);
+        if (result < 0 || (after && result == 0)) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+/**
+ * @brief Construit l'index ordonné d'un répertoire
+ *
+ * @param children Enfants du répertoire
+ * @param count Nombre d'enfants
+ * @return DirOrder* Index, NULL si l'allocation échoue
+ *
+ * @details
+ * Trie une copie du tableau des enfants, puis la répartit en feuilles
+ * remplies aux trois quarts.
+ */
+DirOrder* order_build(FileNode** children, int count) {
+    DirOrder* order = calloc(1, sizeof(DirOrder));
+    FileNode** sorted = malloc((count > 0 ? count : 1) * sizeof(FileNode*));
+    unsigned int leaf_count = (count + ORDER_LEAF_FILL - 1) / ORDER_LEAF_FILL;
+    if (order == NULL || sorted == NULL) goto failed;
+    order->leaf_capacity = leaf_count > 0 ? leaf_count * 2 : 4;
+    order->leaves = malloc(order->leaf_capacity * sizeof(OrderLeaf*));
+    if (order->leaves == NULL) goto failed;
+
+    memcpy(sorted, children, count * sizeof(FileNode*));
+    qsort(sorted, count, sizeof(FileNode*), order_compare_nodes);
+    for (int start = 0; start < count; start += ORDER_LEAF_FILL) {
+        OrderLeaf* leaf = malloc(sizeof(OrderLeaf));
+        if (leaf == NULL) goto failed;
+        leaf->count = count - start < ORDER_LEAF_FILL ? count - start : ORDER_LEAF_FILL;
+        memcpy(leaf->entries, sorted + start, leaf->count * sizeof(FileNode*));
+        order->leaves[order->leaf_count++] = leaf;
+    }
+    free(sorted);
+    return order;
+
+failed:
+    free(sorted);
+    order_free(order);
+    return NULL;
+}
+
+/**
+ * @brief Libère un index ordonné
+ *
+ * @param order Index (NULL accepté)
+ */
+void order_free(DirOrder* order) {
+    if (order == NULL) return;
+    for (unsigned int i = 0; i < order->leaf_count; i++) free(order->leaves[i]);
+    free(order->leaves);
+    free(order->spare);
+    free(order);
+}
+
+/**
+ * @brief Réserve la place d'un ajout
+ *
+ * @param order Index concerné
+ * @return int 0 en cas de succès, -1 si l'allocation échoue (index inchangé)
+ *
+ * @details
+ * Après un succès, order_insert ne peut plus échouer : une feuille de
+ * réserve et un emplacement dans le répertoire des feuilles sont prêts.
+ */
+int order_reserve(DirOrder* order) {
+    if (order->spare == NULL && (order->spare = malloc(sizeof(OrderLeaf))) == NULL) {
+        return -1;
+    }
+    if (order->leaf_count + 1 > order->leaf_capacity) {
+        unsigned int capacity = order->leaf_capacity * 2;
+        OrderLeaf** leaves = realloc(order->leaves, capacity * sizeof(OrderLeaf*));
+        if (leaves == NULL) return -1;
+        order->leaves = leaves;
+        order->leaf_capacity = capacity;
+    }
+    return 0;
+}
+
+/**
+ * @brief Insère une feuille de réserve vide dans le répertoire des feuilles
+ *
+ * @param order Index préparé par order_reserve
+ * @param position Position de la nouvelle feuille
+ * @return OrderLeaf* Feuille insérée
+ */
+static OrderLeaf* order_take_spare(DirOrder* order, unsigned int position) {
+    OrderLeaf* leaf = order->spare;
+    order->spare = NULL;
+    leaf->count = 0;
+    memmove(&order->leaves[position + 1], &order->leaves[position],
+            (order->leaf_count - position) * sizeof(OrderLeaf*));
+    order->leaves[position] = leaf;
+    order->leaf_count++;
+    return leaf;
+}
+
+/**
+ * @brief Ajoute un enfant à l'index
+ *
+ * @param order Index préparé par order_reserve
+ * @param node Nœud à ajouter (nom absent de l'index)
+ */
+void order_insert(DirOrder* order, FileNode* node) {
+    const char* name = node->name;
+    size_t length = node->name_length;
+    if (order->leaf_count == 0) {
+        OrderLeaf* leaf = order_take_spare(order, 0);
+        leaf->entries[leaf->count++] = node;
+        return;
+    }
+
+    unsigned int index = order_leaf_for(order, name, length);
+    OrderLeaf* leaf = order->leaves[index];
+    if (leaf->count == ORDER_LEAF_MAX) {
+        int last = index + 1 == order->leaf_count &&
+                   order_compare(leaf->entries[ORDER_LEAF_MAX - 1], name, length) < 0;
+        OrderLeaf* right = order_take_spare(order, index + 1);
+        if (last) {
+            // Ajouts dans l'ordre : laisser la feuille pleine
+            leaf = right;
+        } else {
+            unsigned int half = ORDER_LEAF_MAX / 2;
+            right->count = ORDER_LEAF_MAX - half;
+            memcpy(right->entries, leaf->entries + half, right->count * sizeof(FileNode*));
+            leaf->count = half;
+            if (order_compare(right->entries[0], name, length) < 0) leaf = right;
+        }
+    }
+
+    unsigned int slot = order_slot_for(leaf, name, length, 0);
+    memmove(&leaf->entries[slot + 1], &leaf->entries[slot], (leaf->count - slot) * sizeof(FileNode*));
+    leaf->entries[slot] = node;
+    leaf->count++;
+}
+
+/**
+ * @brief Retire un enfant de l'index
+ *
+ * @param order Index concerné
+ * @param node Nœud à retirer (sous son nom actuel)
+ *
+ * @details
+ * Une feuille vidée est retirée (et gardée en réserve) ; une feuille
+ * qui tiendrait avec sa voisine de droite dans une demi-feuille est
+ * fusionnée avec elle.
+ */
+void order_remove(DirOrder* order, FileNode* node) {
+    if (order->leaf_count == 0) return;
+    unsigned int index = order_leaf_for(order, node->name, node->name_length);
+    OrderLeaf* leaf = order->leaves[index];
+    unsigned int slot = order_slot_for(leaf, node->name, node->name_length, 0);
+    if (slot == leaf->count || leaf->entries[slot] != node) return;
+
+    memmove(&leaf->entries[slot], &leaf->entries[slot + 1], (leaf->count - slot - 1) * sizeof(FileNode*));
+    leaf->count--;
+
+    OrderLeaf* removed = NULL;
+    if (leaf->count == 0) {
+        removed = leaf;
+    } else if (index + 1 < order->leaf_count &&
+               leaf->count + order->leaves[index + 1]->count <= ORDER_LEAF_MAX / 2) {
+        OrderLeaf* right = order->leaves[index + 1];
+        memcpy(leaf->entries + leaf->count, right->entries, right->count * sizeof(FileNode*));
+        leaf->count += right->count;
+        removed = right;
+        index++;
+    }
+    if (removed != NULL) {
+        memmove(&order->leaves[index], &order->leaves[index + 1],
+                (order->leaf_count - index - 1) * sizeof(OrderLeaf*));
+        order->leaf_count--;
+        if (order->spare == NULL) order->spare = removed;
+        else free(removed);
+    }
+}
+
+/**
+ * @brief Place un curseur sur le premier enfant à partir d'une clé
+ *
+ * @param order Index concerné
+ * @param name Clé (NULL : premier enfant)
+ * @param length Longueur de la clé
+ * @param after 0 : premier enfant qui ne précède pas la clé ; 1 : premier qui la suit
+ * @param cursor Curseur à placer
+ */
+void order_seek(const DirOrder* order, const char* name, size_t length, int after, OrderCursor* cursor) {
+    cursor->order = order;
+    cursor->leaf = 0;
+    cursor->slot = 0;
+    if (name == NULL || order->leaf_count == 0) return;
+    cursor->leaf = order_leaf_for(order, name, length);
+    cursor->slot = order_slot_for(order->leaves[cursor->leaf], name, length, after);
+}
+
+/**
+ * @brief Enfant suivant d'un parcours ordonné
+ *
+ * @param cursor Curseur placé par order_seek
+ * @return FileNode* Enfant suivant, NULL à la fin
+ */
+FileNode* order_next(OrderCursor* cursor) {
+    const DirOrder* order = cursor->order;
+    while (cursor->leaf < order->leaf_count) {
+        const OrderLeaf* leaf = order->leaves[cursor->leaf];
+        if (cursor->slot < leaf->count) return leaf->entries[cursor->slot++];
+        cursor->leaf++;
+        cursor->slot = 0;
+    }
+    return NULL;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file fs_tags.c
+ * @brief Filtrage vectoriel des étiquettes de l'index des répertoires
+ *
+ * L'index haché d'un répertoire range, à côté de ses emplacements, un
+ * tableau contigu d'étiquettes d'un octet : TAG_EMPTY pour un
+ * emplacement libre, TAG_TOMBSTONE pour une entrée supprimée, et pour
+ * une entrée les bits de poids fort de l'empreinte de son nom (valeur
+ * impaire, voir dir_tag dans file_manager.c).
+ *
+ * La recherche compare un groupe d'étiquettes d'un coup à celle du nom
+ * cherché et à TAG_EMPTY : elle n'examine que les emplacements dont
+ * l'étiquette correspond (une fausse alerte sur 128) et s'arrête au
+ * premier emplacement libre, sans lire les emplacements eux-mêmes.
+ *
+ * Trois noyaux sont disponibles, choisis à l'exécution par
+ * tags_select() selon le processeur :
+ * - avx2 : 32 étiquettes par comparaison
+ * - sse2 : 16 étiquettes par comparaison
+ * - scalar : 8 étiquettes, octet par octet (toute architecture)
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <string.h>
+#include "fs_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAGS_X86 1
+#endif
+
+/**
+ * @brief Compare 8 étiquettes, octet par octet
+ *
+ * @param tags Premier octet du groupe
+ * @param tag Étiquette recherchée
+ * @param empty Reçoit le masque des emplacements libres du groupe
+ * @return unsigned int Masque des emplacements d'étiquette tag
+ */
+static unsigned int tag_match_scalar(const unsigned char* tags, unsigned char tag, unsigned int* empty) {
+    unsigned int match = 0;
+    unsigned int free_slots = 0;
+    for (unsigned int i = 0; i < 8; i++) {
+        match |= (unsigned int)(tags[i] == tag) << i;
+        free_slots |= (unsigned int)(tags[i] == TAG_EMPTY) << i;
+    }
+    *empty = free_slots;
+    return match;
+}
+
+#ifdef TAGS_X86
+/**
+ * @brief Compare 16 étiquettes en une instruction SSE2
+ *
+ * @param tags Premier octet du groupe (lecture non alignée)
+ * @param tag Étiquette recherchée
+ * @param empty Reçoit le masque des emplacements libres du groupe
+ * @return unsigned int Masque des emplacements d'étiquette tag
+ */
+__attribute__((target("sse2")))
+static unsigned int tag_match_sse2(const unsigned char* tags, unsigned char tag, unsigned int* empty) {
+    __m128i group = _mm_loadu_si128((const __m128i*)tags);
+    *empty = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_setzero_si128()));
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
+
+/**
+ * @brief Compare 32 étiquettes en une instruction AVX2
+ *
+ * @param tags Premier octet du groupe (lecture non alignée)
+ * @param tag Étiquette recherchée
+ * @param empty Reçoit le masque des emplacements libres du groupe
+ * @return unsigned int Masque des emplacements d'étiquette tag
+ */
+__attribute__((target("avx2")))
+static unsigned int tag_match_avx2(const unsigned char* tags, unsigned char tag, unsigned int* empty) {
+    __m256i group = _mm256_loadu_si256((const __m256i*)tags);
+    *empty = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_setzero_si256()));
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8((char)tag)));
+}
+#endif
+
+/** @brief Noyaux disponibles, du plus large au plus étroit */
+static const TagKernel tag_kernels[] = {
+#ifdef TAGS_X86
+    { "avx2", 32, tag_match_avx2 },
+    { "sse2", 16, tag_match_sse2 },
+#endif
+    { "scalar", 8, tag_match_scalar },
+};
+
+/** @brief Noyau utilisé par la recherche dans les répertoires */
+const TagKernel* tag_kernel = &tag_kernels[sizeof(tag_kernels) / sizeof(tag_kernels[0]) - 1];
+
+/**
+ * @brief Indique si le processeur exécute un noyau
+ *
+ * @param kernel Noyau concerné
+ * @return int 1 si le noyau est utilisable, 0 sinon
+ */
+static int tag_kernel_supported(const TagKernel* kernel) {
+#ifdef TAGS_X86
+    __builtin_cpu_init();
+    if (kernel->match == tag_match_avx2) return __builtin_cpu_supports("avx2");
+    if (kernel->match == tag_match_sse2) return __builtin_cpu_supports("sse2");
+#endif
+    return 1;
+}
+
+/**
+ * @brief Choisit le noyau de filtrage des étiquettes
+ *
+ * @param name "avx2", "sse2" ou "scalar" ; NULL pour le plus large que
+ *        le processeur exécute
+ * @return int 0 en cas de succès, -1 si le noyau est inconnu ou non
+ *         pris en charge (le noyau courant est conservé)
+ *
+ * @details
+ * Appelée par init_file_system(), hors de toute concurrence.
+ */
+int tags_select(const char* name) {
+    int count = sizeof(tag_kernels) / sizeof(tag_kernels[0]);
+    for (int i = 0; i < count; i++) {
+        if (name != NULL && strcmp(name, tag_kernels[i].name) != 0) continue;
+        if (!tag_kernel_supported(&tag_kernels[i])) continue;
+        tag_kernel = &tag_kernels[i];
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file fs_walk.c
+ * @brief Parcours parallèle d'un sous-arbre par vol de tâches
+ *
+ * Une tâche est un répertoire à traiter. Chaque thread possède une file
+ * de tâches : il empile et dépile les siennes par le bas (les dernières
+ * trouvées, encore chaudes dans le cache), les threads inoccupés en
+ * volent par le haut (les plus anciennes, qui portent en général les
+ * plus gros sous-arbres). Chaque file est protégée par son propre
+ * verrou ; une tâche étant un répertoire entier, ces verrous ne sont
+ * pris qu'une fois par répertoire.
+ *
+ * Le parcours commence sur le thread appelant seul : les threads
+ * auxiliaires ne sont lancés que lorsque WALK_SPAWN_THRESHOLD tâches
+ * attendent, de sorte qu'un petit sous-arbre ne paie aucune création
+ * de thread. Le parcours se termine quand plus aucune tâche n'est en
+ * attente ni en cours (compteur pending).
+ *
+ * Le moteur ne verrouille ni ne modifie l'arborescence : la fonction de
+ * traitement d'un répertoire (WalkDirFn) le fait, sous fs_tree_lock
+ * détenu par l'appelant de walk_tree pendant tout le parcours.
+ *
+ * @author BAKHOUCHE Rachel|HUANG Yanmo|ANAGONOU Hervé
+ * @date 2024
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fs_internal.h"
+
+/** @brief Nombre maximal de threads d'un parcours */
+#define WALK_MAX_THREADS 64
+/** @brief Tâches en attente sur le thread appelant avant de lancer les threads auxiliaires */
+#define WALK_SPAWN_THRESHOLD 16
+/** @brief Capacité initiale d'une file de tâches */
+#define WALK_MIN_CAPACITY 64
+
+/** @brief Nombre de threads des parcours, 0 pour un par processeur */
+int fs_walk_threads = 0;
+
+/**
+ * @brief File de tâches d'un thread du parcours
+ *
+ * Les tâches en attente occupent tasks[top, bottom).
+ */
+struct WalkWorker {
+    struct Walk* walk;              /**< Parcours auquel le thread participe */
+    pthread_mutex_t lock;           /**< Protège tasks, top et bottom */
+    FileNode** tasks;               /**< Répertoires à traiter */
+    unsigned int top;               /**< Première tâche, prise par les voleurs */
+    unsigned int bottom;            /**< Fin des tâches, côté propriétaire */
+    unsigned int capacity;          /**< Nombre d'emplacements alloués */
+    unsigned int seed;              /**< Choix pseudo-aléatoire des victimes */
+};
+
+/**
+ * @brief État partagé d'un parcours
+ */
+typedef struct Walk {
+    WalkDirFn visit;                /**< Traitement d'un répertoire */
+    void* arg;                      /**< Argument transmis à visit */
+    WalkWorker workers[WALK_MAX_THREADS]; /**< Files des threads, 0 étant l'appelant */
+    pthread_t threads[WALK_MAX_THREADS];  /**< Threads auxiliaires lancés */
+    int thread_count;               /**< Nombre de threads prévus */
+    int started;                    /**< Nombre de threads en cours (l'appelant compris) */
+    long pending;                   /**< Tâches empilées et non terminées (atomique) */
+    int stop;                       /**< 1 si le parcours doit s'arrêter (atomique) */
+} Walk;
+
+/**
+ * @brief Nombre de threads à utiliser pour un parcours
+ *
+ * @return int fs_walk_threads, ou le nombre de processeurs en ligne
+ */
+static int walk_thread_count() {
+    long count = fs_walk_threads > 0 ? fs_walk_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) count = 1;
+    return count > WALK_MAX_THREADS ? WALK_MAX_THREADS : (int)count;
+}
+
+/**
+ * @brief Prend la dernière tâche de sa propre file
+ *
+ * @param worker File du thread appelant
+ * @return FileNode* Répertoire à traiter, NULL si la file est vide
+ */
+static FileNode* walk_pop(WalkWorker* worker) {
+    FileNode* dir = NULL;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->bottom > worker->top) {
+        dir = worker->tasks[--worker->bottom];
+    }
+    if (worker->bottom == worker->top) worker->top = worker->bottom = 0;
+    pthread_mutex_unlock(&worker->lock);
+    return dir;
+}
+
+/**
+ * @brief Vole la plus ancienne tâche d'un autre thread
+ *
+ * @param worker File du thread appelant
+ * @return FileNode* Répertoire à traiter, NULL si aucune file n'en a
+ *
+ * @details
+ * Les victimes sont essayées à partir d'un rang pseudo-aléatoire, pour
+ * que les voleurs ne se précipitent pas tous sur la même file.
+ */
+static FileNode* walk_steal(WalkWorker* worker) {
+    Walk* walk = worker->walk;
+    int count = __atomic_load_n(&walk->started, __ATOMIC_ACQUIRE);
+    worker->seed = worker->seed * 1103515245u + 12345u;
+    int first = (int)((worker->seed >> 16) % (unsigned int)count);
+    for (int i = 0; i < count; i++) {
+        WalkWorker* victim = &walk->workers[(first + i) % count];
+        if (victim == worker) continue;
+        pthread_mutex_lock(&victim->lock);
+        FileNode* dir = victim->bottom > victim->top ? victim->tasks[victim->top++] : NULL;
+        pthread_mutex_unlock(&victim->lock);
+        if (dir != NULL) return dir;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Boucle d'un thread : traite ses tâches, puis celles des autres
+ *
+ * @param worker File du thread
+ *
+ * @details
+ * Après un arrêt (walk_stop), les tâches restantes sont retirées sans
+ * être traitées. La boucle se termine quand pending tombe à zéro.
+ */
+static void walk_run(WalkWorker* worker) {
+    Walk* walk = worker->walk;
+    for (;;) {
+        FileNode* dir = walk_pop(worker);
+        if (dir == NULL) dir = walk_steal(worker);
+        if (dir != NULL) {
+            if (!__atomic_load_n(&walk->stop, __ATOMIC_RELAXED)) {
+                walk->visit(worker, dir, walk->arg);
+            }
+            __atomic_sub_fetch(&walk->pending, 1, __ATOMIC_ACQ_REL);
+            continue;
+        }
+        if (__atomic_load_n(&walk->pending, __ATOMIC_ACQUIRE) == 0) break;
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Point d'entrée d'un thread auxiliaire
+ *
+ * @param arg File du thread
+ */
+static void* walk_thread(void* arg) {
+    walk_run(arg);
+    return NULL;
+}
+
+/**
+ * @brief Lance les threads auxiliaires (une seule fois par parcours)
+ *
+ * @param walk Parcours concerné
+ *
+ * @details
+ * Un thread qui ne peut être créé réduit seulement le parallélisme.
+ */
+static void walk_start(Walk* walk) {
+    for (int i = 1; i < walk->thread_count; i++) {
+        if (pthread_create(&walk->threads[i], NULL, walk_thread, &walk->workers[i]) != 0) break;
+        __atomic_store_n(&walk->started, i + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Ajoute un répertoire à traiter
+ *
+ * @param worker File du thread appelant (reçue par WalkDirFn)
+ * @param dir Répertoire à traiter
+ *
+ * @details
+ * Si la file ne peut être agrandie, le répertoire est traité sur-le-champ
+ * par le thread appelant : walk_push n'échoue pas.
+ */
+void walk_push(WalkWorker* worker, FileNode* dir) {
+    Walk* walk = worker->walk;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->bottom == worker->capacity && worker->top > 0) {
+        memmove(worker->tasks, worker->tasks + worker->top,
+                (worker->bottom - worker->top) * sizeof(FileNode*));
+        worker->bottom -= worker->top;
+        worker->top = 0;
+    }
+    if (worker->bottom == worker->capacity) {
+        unsigned int capacity = worker->capacity ? worker->capacity * 2 : WALK_MIN_CAPACITY;
+        FileNode** tasks = realloc(worker->tasks, capacity * sizeof(FileNode*));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&worker->lock);
+            walk->visit(worker, dir, walk->arg);
+            return;
+        }
+        worker->tasks = tasks;
+        worker->capacity = capacity;
+    }
+    __atomic_add_fetch(&walk->pending, 1, __ATOMIC_ACQ_REL);
+    worker->tasks[worker->bottom++] = dir;
+    unsigned int waiting = worker->bottom - worker->top;
+    pthread_mutex_unlock(&worker->lock);
+
+    // Seul l'appelant de walk_tree lance les auxiliaires
+    if (worker == &walk->workers[0] && waiting >= WALK_SPAWN_THRESHOLD &&
+        walk->thread_count > 1 && __atomic_load_n(&walk->started, __ATOMIC_RELAXED) == 1) {
+        walk_start(walk);
+    }
+}
+
+/**
+ * @brief Demande l'arrêt du parcours
+ *
+ * @param worker File du thread appelant
+ *
+ * @details
+ * Les répertoires en cours de traitement sont terminés, les autres ne
+ * sont plus traités.
+ */
+void walk_stop(WalkWorker* worker) {
+    __atomic_store_n(&worker->walk->stop, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Parcourt un sous-arbre en parallèle
+ *
+ * @param root Premier répertoire à traiter
+ * @param visit Traitement d'un répertoire : il appelle walk_push pour
+ *        chacun des sous-répertoires à parcourir
+ * @param arg Argument transmis à visit
+ * @return int 0 si le parcours est allé à son terme, 1 s'il a été arrêté
+ *
+ * @details
+ * - visit peut être appelée par plusieurs threads à la fois, jamais deux
+ *   fois en même temps pour le même répertoire
+ * - Rend la main quand tous les répertoires ont été traités et que les
+ *   threads auxiliaires sont terminés
+ */
+int walk_tree(FileNode* root, WalkDirFn visit, void* arg) {
+    Walk walk;
+    memset(&walk, 0, sizeof(walk));
+    walk.visit = visit;
+    walk.arg = arg;
+    walk.thread_count = walk_thread_count();
+    walk.started = 1;
+    for (int i = 0; i < walk.thread_count; i++) {
+        walk.workers[i].walk = &walk;
+        walk.workers[i].seed = (unsigned int)i * 2654435761u + 1;
+        pthread_mutex_init(&walk.workers[i].lock, NULL);
+    }
+
+    walk_push(&walk.workers[0], root);
+    walk_run(&walk.workers[0]);
+
+    int started = __atomic_load_n(&walk.started, __ATOMIC_ACQUIRE);
+    for (int i = 1; i < started; i++) {
+        pthread_join(walk.threads[i], NULL);
+    }
+    for (int i = 0; i < walk.thread_count; i++) {
+        pthread_mutex_destroy(&walk.workers[i].lock);
+        free(walk.workers[i].tasks);
+    }
+    return walk.stop;
+}
@@ -11,19 +11,61 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "file_manager.h"
+#include <string.h>
+#include "fs_cli.h"
+
+/** @brief Taille du tampon de la sortie standard en mode script */
+#define BATCH_OUTPUT_BUFFER (64 * 1024)
 
 /**
  * @brief Fonction principale du programme
  * 
- * @return int Code de retour (0 pour succès)
+ * @param argc Nombre d'arguments
+ * @param argv Options et script éventuel
+ * @return int Code de retour (0 pour succès, 1 si une commande du script a échoué)
  * 
  * @details
- * - Initialise le système de fichiers
- * - Lance l'interface de commande interactive
- * - Gère la fermeture propre du système
+ * - Sans argument : interface de commande interactive
+ * - `-b` : mode script, les commandes sont lues sur l'entrée standard
+ *   sans invite et la sortie est mise en tampon
+ * - `-q` : mode script silencieux ; seul un bilan est affiché (sur la
+ *   sortie d'erreur)
+ * - `<fichier>` : mode script, les commandes sont lues dans le fichier
+ * - Dans tous les cas, le système est initialisé puis fermé proprement
  */
-int main() {
-    handle_command();
-    return 0;
+int main(int argc, char* argv[]) {
+    int batch = 0;
+    int quiet = 0;
+    const char* script = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0) {
+            batch = 1;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            batch = quiet = 1;
+        } else if (argv[i][0] != '-' && script == NULL) {
+            batch = 1;
+            script = argv[i];
+        } else {
+            fprintf(stderr, "Usage : %s [-b] [-q] [script]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!batch) {
+        handle_command();
+        return 0;
+    }
+
+    FILE* input = script ? fopen(script, "r") : stdin;
+    if (input == NULL) {
+        perror(script);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOFBF, BATCH_OUTPUT_BUFFER);
+    long failures = run_commands(input, quiet ? COMMAND_QUIET : 0);
+    if (quiet) {
+        fprintf(stderr, "%ld commande(s) en erreur.\n", failures);
+    }
+    if (input != stdin) fclose(input);
+    return failures == 0 ? 0 : 1;
 }